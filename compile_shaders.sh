@@ -3,8 +3,10 @@
 mkdir -p obj
 
 dxc -D__HLSL__ -Fo obj/world.vs.spv -T vs_6_8 -spirv shaders/world.hlsl -E vs_main
+dxc -D__HLSL__ -Fo obj/world_foliage.vs.spv -T vs_6_8 -spirv shaders/world.hlsl -E vs_foliage
 dxc -D__HLSL__ -Fo obj/world.fs.spv -T ps_6_8 -spirv shaders/world.hlsl -E fs_main
 ld -z noexecstack -r -b binary -o obj/world.vs.spo obj/world.vs.spv
+ld -z noexecstack -r -b binary -o obj/world_foliage.vs.spo obj/world_foliage.vs.spv
 ld -z noexecstack -r -b binary -o obj/world.fs.spo obj/world.fs.spv
 
 dxc -D__HLSL__ -Fo obj/model.vs.spv -T vs_6_8 -spirv shaders/model.hlsl -E vs_main
@@ -25,4 +27,15 @@ ld -z noexecstack -r -b binary -o obj/composite.fs.spo obj/composite.fs.spv
 dxc -D__HLSL__ -Fo obj/particle.vs.spv -T vs_6_8 -spirv shaders/particle.hlsl -E vs_main
 dxc -D__HLSL__ -Fo obj/particle.fs.spv -T ps_6_8 -spirv shaders/particle.hlsl -E fs_main
 ld -z noexecstack -r -b binary -o obj/particle.vs.spo obj/particle.vs.spv
-ld -z noexecstack -r -b binary -o obj/particle.fs.spo obj/particle.fs.spv
\ No newline at end of file
+ld -z noexecstack -r -b binary -o obj/particle.fs.spo obj/particle.fs.spv
+
+dxc -D__HLSL__ -Fo obj/particle_spawn.cs.spv -T cs_6_8 -spirv shaders/particle_sim.hlsl -E cs_spawn
+dxc -D__HLSL__ -Fo obj/particle_prepare.cs.spv -T cs_6_8 -spirv shaders/particle_sim.hlsl -E cs_prepare
+dxc -D__HLSL__ -Fo obj/particle_tick.cs.spv -T cs_6_8 -spirv shaders/particle_sim.hlsl -E cs_tick
+dxc -D__HLSL__ -Fo obj/particle_bin_scan.cs.spv -T cs_6_8 -spirv shaders/particle_sim.hlsl -E cs_bin_scan
+dxc -D__HLSL__ -Fo obj/particle_bin_scatter.cs.spv -T cs_6_8 -spirv shaders/particle_sim.hlsl -E cs_bin_scatter
+ld -z noexecstack -r -b binary -o obj/particle_spawn.cs.spo obj/particle_spawn.cs.spv
+ld -z noexecstack -r -b binary -o obj/particle_prepare.cs.spo obj/particle_prepare.cs.spv
+ld -z noexecstack -r -b binary -o obj/particle_tick.cs.spo obj/particle_tick.cs.spv
+ld -z noexecstack -r -b binary -o obj/particle_bin_scan.cs.spo obj/particle_bin_scan.cs.spv
+ld -z noexecstack -r -b binary -o obj/particle_bin_scatter.cs.spo obj/particle_bin_scatter.cs.spv
\ No newline at end of file
@@ -3,8 +3,22 @@
 #define MAX_DRAWS (1024)
 #define MAX_POINT_LIGHTS (64)
 
-#define WIND_GRID_RESOLUTION	(64)
-#define WIND_GRID_CELL_SIZE		(0.4f)
+#define WIND_GRID_DEFAULT_RESOLUTION	(64)
+#define WIND_GRID_CELL_SIZE				(0.4f)
+
+#define WORLD_LAYER_DEPTH_STEP	(-4.0f)
+
+#define FOLIAGE_TYPE_GRASS				(0)
+#define FOLIAGE_TYPE_FLOWER				(1)
+#define FOLIAGE_MAX_HEIGHT				(1.0f)
+#define FOLIAGE_VERTICES_PER_INSTANCE	(12)
+
+#define PARTICLE_LAYER_COUNT					(16)
+#define PARTICLE_SIM_GROUP_SIZE					(64)
+#define PARTICLE_COUNTERS_ALIVE_OFFSET(buffer)	((buffer) * 4)
+#define PARTICLE_COUNTERS_DISPATCH_OFFSET		(8)
+#define PARTICLE_COUNTERS_LAYER_OFFSET(layer)	(32 + (layer) * 4)
+#define PARTICLE_COUNTERS_DRAW_OFFSET(layer)	(96 + (layer) * 16)
 
 #ifdef __STDC__
 typedef struct gpu_draw_t gpu_draw_t;
@@ -12,6 +26,12 @@ typedef struct gpu_point_light_t gpu_point_light_t;
 typedef struct gpu_frame_uniforms_t gpu_frame_uniforms_t;
 typedef struct gpu_debug_renderer_uniforms_t gpu_debug_renderer_uniforms_t;
 typedef struct gpu_particle_t gpu_particle_t;
+typedef struct gpu_foliage_instance_t gpu_foliage_instance_t;
+typedef struct gpu_world_chunk_t gpu_world_chunk_t;
+typedef struct gpu_particle_state_t gpu_particle_state_t;
+typedef struct gpu_particle_effect_t gpu_particle_effect_t;
+typedef struct gpu_particle_counters_t gpu_particle_counters_t;
+typedef struct gpu_particle_sim_constants_t gpu_particle_sim_constants_t;
 #endif
 
 #ifndef __STDC__
@@ -52,6 +72,11 @@ struct gpu_frame_uniforms_t
 	uint	pointLightCount;
 	uint	spotLightCount;
 	float	elapsedTime;
+
+	uint	windGridResolution;
+	uint	_pad0;
+	uint	_pad1;
+	uint	_pad2;
 };
 
 struct gpu_debug_renderer_uniforms_t
@@ -66,10 +91,88 @@ struct gpu_particle_t
 	uint	color;
 };
 
+struct gpu_foliage_instance_t
+{
+	vec2	root;
+	uint	tangent; // snorm16x2
+	uint	params; // [0:7] height, [8] type, [9:12] layer, [13:31] seed
+};
+
+// World vertices store xy as unorm16x2 over the bounds of their chunk: p = origin + q * scale. The
+// reconstruction error is at most scale / 2, i.e. 1/131070 of the chunk's extent on each axis (under 0.001
+// units for a 100 unit chunk). z comes from the layer index.
+struct gpu_world_chunk_t
+{
+	vec2	origin;
+	vec2	scale;
+	uint	layer;
+	uint	_pad0;
+	uint	_pad1;
+	uint	_pad2;
+};
+
+// Simulation state of a particle in the gpu backend.
+struct gpu_particle_state_t
+{
+	vec2	pos;
+	vec2	vel;
+	float	age;
+	float	lifetime;
+	uint	effect;
+	uint	_pad0;
+};
+
+// How the gpu backend moves and draws the particles of one effect.
+struct gpu_particle_effect_t
+{
+	float	damping;
+	float	windAmount;
+	float	swayFrequency;
+	float	swayAmplitude;
+	float	size;
+	uint	layer;
+	uint	color;
+	float	endSize;
+};
+
+// Particle counts of the two state buffers, the indirect arguments for the tick dispatch, the particles per layer
+// and an indirect draw per layer. Shaders address it with the PARTICLE_COUNTERS_*_OFFSET byte offsets.
+struct gpu_particle_counters_t
+{
+	uint	aliveCount0;
+	uint	aliveCount1;
+	uint	dispatchX;
+	uint	dispatchY;
+	uint	dispatchZ;
+	uint	_pad0;
+	uint	_pad1;
+	uint	_pad2;
+	uint	layerCount[PARTICLE_LAYER_COUNT]; // the scatter's write cursors once binned
+	uint	layerDraws[PARTICLE_LAYER_COUNT * 4]; // vertexCount, instanceCount, firstVertex, firstInstance
+};
+
+struct gpu_particle_sim_constants_t
+{
+	uint	src; // which state buffer holds the live particles, the tick appends the survivors to the other one
+	uint	spawnCount;
+	uint	maxCount;
+	float	dt;
+	uint	binLayers; // set on the frame's last tick, which counts the survivors per layer
+	uint	windGridResolution;
+	uint	_pad0;
+	uint	_pad1;
+};
+
 #ifdef __STDC__
 _Static_assert(sizeof(gpu_draw_t) == 96, "");
 _Static_assert(sizeof(gpu_point_light_t) == 32, "");
-_Static_assert(sizeof(gpu_frame_uniforms_t) == 80, "");
+_Static_assert(sizeof(gpu_frame_uniforms_t) == 96, "");
 _Static_assert(sizeof(gpu_debug_renderer_uniforms_t) == 64, "");
 _Static_assert(sizeof(gpu_particle_t) == 16, "");
+_Static_assert(sizeof(gpu_foliage_instance_t) == 16, "");
+_Static_assert(sizeof(gpu_world_chunk_t) == 32, "");
+_Static_assert(sizeof(gpu_particle_state_t) == 32, "");
+_Static_assert(sizeof(gpu_particle_effect_t) == 32, "");
+_Static_assert(sizeof(gpu_particle_counters_t) == 352, "");
+_Static_assert(sizeof(gpu_particle_sim_constants_t) == 32, "");
 #endif
\ No newline at end of file
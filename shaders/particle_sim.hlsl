@@ -0,0 +1,130 @@
+#include "gpu_types.h"
+
+[[vk::push_constant]]	gpu_particle_sim_constants_t	g_constants;
+
+[[vk::binding(0)]]	ByteAddressBuffer	g_effects;
+[[vk::binding(1)]]	ByteAddressBuffer	g_spawns;
+[[vk::binding(2)]]	ByteAddressBuffer	g_windGrid;
+[[vk::binding(3)]]	RWByteAddressBuffer	g_counters;
+[[vk::binding(4)]]	RWByteAddressBuffer	g_srcState;
+[[vk::binding(5)]]	RWByteAddressBuffer	g_dstState;
+[[vk::binding(6)]]	RWByteAddressBuffer	g_particles;
+
+#include "wind_grid.hlsli"
+
+// Appends the frame's spawns to the live particles. Spawns past maxCount are counted but not written, and
+// cs_prepare clamps the count back down.
+[numthreads(PARTICLE_SIM_GROUP_SIZE, 1, 1)]
+void cs_spawn(uint3 threadId : SV_DispatchThreadID)
+{
+	if (threadId.x >= g_constants.spawnCount)
+	{
+		return;
+	}
+
+	uint index;
+	g_counters.InterlockedAdd(PARTICLE_COUNTERS_ALIVE_OFFSET(g_constants.src), 1, index);
+	if (index >= g_constants.maxCount)
+	{
+		return;
+	}
+
+	const gpu_particle_state_t state = g_spawns.Load<gpu_particle_state_t>(threadId.x * sizeof(gpu_particle_state_t));
+	g_srcState.Store<gpu_particle_state_t>(index * sizeof(gpu_particle_state_t), state);
+}
+
+// Sizes the tick dispatch to the live particles, and resets the counters the tick appends to.
+[numthreads(1, 1, 1)]
+void cs_prepare()
+{
+	const uint src = g_constants.src;
+	const uint aliveCount = min(g_counters.Load(PARTICLE_COUNTERS_ALIVE_OFFSET(src)), g_constants.maxCount);
+
+	g_counters.Store(PARTICLE_COUNTERS_ALIVE_OFFSET(src), aliveCount);
+	g_counters.Store(PARTICLE_COUNTERS_ALIVE_OFFSET(1 - src), 0);
+	g_counters.Store3(PARTICLE_COUNTERS_DISPATCH_OFFSET, uint3((aliveCount + PARTICLE_SIM_GROUP_SIZE - 1) / PARTICLE_SIM_GROUP_SIZE, 1, 1));
+
+	if (g_constants.binLayers)
+	{
+		for (uint layer = 0; layer < PARTICLE_LAYER_COUNT; ++layer)
+		{
+			g_counters.Store(PARTICLE_COUNTERS_LAYER_OFFSET(layer), 0);
+		}
+	}
+}
+
+// Moves every live particle the same way the cpu backend does, and appends the survivors to the other state
+// buffer, in no particular order. The frame's last tick also counts them per layer for the binning.
+[numthreads(PARTICLE_SIM_GROUP_SIZE, 1, 1)]
+void cs_tick(uint3 threadId : SV_DispatchThreadID)
+{
+	const uint src = g_constants.src;
+	if (threadId.x >= g_counters.Load(PARTICLE_COUNTERS_ALIVE_OFFSET(src)))
+	{
+		return;
+	}
+
+	gpu_particle_state_t state = g_srcState.Load<gpu_particle_state_t>(threadId.x * sizeof(gpu_particle_state_t));
+	const gpu_particle_effect_t effect = g_effects.Load<gpu_particle_effect_t>(state.effect * sizeof(gpu_particle_effect_t));
+
+	const float dt = g_constants.dt;
+	state.pos += sampleWindGrid(state.pos, g_constants.windGridResolution) * effect.windAmount;
+	state.pos.x += sin(state.age * effect.swayFrequency) * effect.swayAmplitude;
+	state.pos += state.vel * dt;
+	state.vel *= effect.damping;
+	state.age += dt;
+
+	if (state.age >= state.lifetime)
+	{
+		return;
+	}
+
+	uint index;
+	g_counters.InterlockedAdd(PARTICLE_COUNTERS_ALIVE_OFFSET(1 - src), 1, index);
+	g_dstState.Store<gpu_particle_state_t>(index * sizeof(gpu_particle_state_t), state);
+
+	if (g_constants.binLayers)
+	{
+		g_counters.InterlockedAdd(PARTICLE_COUNTERS_LAYER_OFFSET(effect.layer), 1);
+	}
+}
+
+// Turns the layer counts into back to front ranges of the particle buffer, with a draw per layer. The counts are
+// left as each range's start, for cs_bin_scatter to append at.
+[numthreads(1, 1, 1)]
+void cs_bin_scan()
+{
+	uint first = 0;
+	for (int layer = PARTICLE_LAYER_COUNT - 1; layer >= 0; --layer)
+	{
+		const uint count = g_counters.Load(PARTICLE_COUNTERS_LAYER_OFFSET(layer));
+		g_counters.Store4(PARTICLE_COUNTERS_DRAW_OFFSET(layer), uint4(count * 6, 1, first * 6, 0));
+		g_counters.Store(PARTICLE_COUNTERS_LAYER_OFFSET(layer), first);
+		first += count;
+	}
+}
+
+// Writes every live particle to its layer's range. Runs on the state the last tick wrote, so the dispatch sized
+// for that tick covers it.
+[numthreads(PARTICLE_SIM_GROUP_SIZE, 1, 1)]
+void cs_bin_scatter(uint3 threadId : SV_DispatchThreadID)
+{
+	if (threadId.x >= g_counters.Load(PARTICLE_COUNTERS_ALIVE_OFFSET(g_constants.src)))
+	{
+		return;
+	}
+
+	const gpu_particle_state_t state = g_srcState.Load<gpu_particle_state_t>(threadId.x * sizeof(gpu_particle_state_t));
+	const gpu_particle_effect_t effect = g_effects.Load<gpu_particle_effect_t>(state.effect * sizeof(gpu_particle_effect_t));
+
+	uint index;
+	g_counters.InterlockedAdd(PARTICLE_COUNTERS_LAYER_OFFSET(effect.layer), 1, index);
+
+	const float size = effect.size + (state.age / state.lifetime) * (effect.endSize - effect.size);
+
+	gpu_particle_t particle;
+	particle.center = state.pos;
+	particle.sizeAndLayer = uint(size * (float)0xffff) | (effect.layer << 16);
+	particle.color = effect.color;
+	g_particles.Store<gpu_particle_t>(index * sizeof(gpu_particle_t), particle);
+}
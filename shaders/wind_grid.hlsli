@@ -0,0 +1,40 @@
+#pragma once
+
+// Bilinear sample of the wind grid that wind_update uploads. Expects a ByteAddressBuffer g_windGrid to be
+// declared before this is included. resolution is the grid's, a power of two.
+
+float2 sampleWindGrid(float2 pos, uint resolution)
+{
+	const uint mask = resolution - 1;
+	const float2 floatGridPos = pos / WIND_GRID_CELL_SIZE;
+#if 0
+	const uint2 gridPos = uint2(floor(floatGridPos));
+	const uint index = gridPos.x + gridPos.y * resolution;
+	return g_windGrid.Load<float2>(index * sizeof(float2));
+#else
+	// cell centers are at half cells, so the cell to the bottom left is the one half a cell back
+	const float2 centerPos = floatGridPos - 0.5f;
+	const float2 bilinearFactors = frac(centerPos);
+	const int2 topLeft = int2(floor(centerPos));
+
+	const uint2 p00 = uint2(topLeft + int2(0, 0)) & mask;
+	const uint2 p10 = uint2(topLeft + int2(1, 0)) & mask;
+	const uint2 p01 = uint2(topLeft + int2(0, 1)) & mask;
+	const uint2 p11 = uint2(topLeft + int2(1, 1)) & mask;
+
+	const int i00 = p00.x + p00.y * resolution;
+	const int i10 = p10.x + p10.y * resolution;
+	const int i01 = p01.x + p01.y * resolution;
+	const int i11 = p11.x + p11.y * resolution;
+
+	const float2 v00 = g_windGrid.Load<float2>(i00 * sizeof(float2));
+	const float2 v10 = g_windGrid.Load<float2>(i10 * sizeof(float2));
+	const float2 v01 = g_windGrid.Load<float2>(i01 * sizeof(float2));
+	const float2 v11 = g_windGrid.Load<float2>(i11 * sizeof(float2));
+	
+	const float2 x0 = lerp(v00, v10, bilinearFactors.x);
+	const float2 x1 = lerp(v01, v11, bilinearFactors.x);
+	
+	return lerp(x0, x1, bilinearFactors.y);
+#endif
+}
@@ -4,10 +4,18 @@
 [[vk::binding(1)]]	ByteAddressBuffer						g_vertexPositionBuffer;
 [[vk::binding(2)]]	ByteAddressBuffer						g_vertexColorBuffer;
 [[vk::binding(3)]]	ByteAddressBuffer						g_windGrid;
+[[vk::binding(4)]]	ByteAddressBuffer						g_foliageInstanceBuffer;
+[[vk::binding(5)]]	ByteAddressBuffer						g_worldChunkBuffer;
+
+#include "wind_grid.hlsli"
+
+// below this many clip space units per world unit of plant height, foliage starts thinning out
+#define FOLIAGE_FULL_DENSITY_CLIP_HEIGHT (0.08f)
 
 struct VsInput
 {
 	uint vertexId : SV_VertexID;
+	uint chunk : SV_InstanceID; // firstInstance of the chunk's draw
 };
 
 struct VsOutput
@@ -41,49 +49,25 @@ float wind(float t)
 	return sin(t * 2.0f) * sin(t * 3.0f) * cos(t * 5.0f) * cos(t * 7.0f);
 }
 
-float2 sampleWindGrid(float2 pos)
+float3 animateVertex(float3 vertexPosition, float animationWeight)
 {
-	const float2 floatGridPos = pos / WIND_GRID_CELL_SIZE;
-#if 0
-	const uint2 gridPos = uint2(floor(floatGridPos));
-	const uint index = gridPos.x + gridPos.y * WIND_GRID_RESOLUTION;
-	return g_windGrid.Load<float2>(index * sizeof(float2));
-#else
-	const float2 bilinearFactors = frac(floatGridPos);
-	const int2 topLeft = int2(floor(floatGridPos - 0.5f));
-
-	const uint2 p00 = uint2(topLeft + int2(0, 0)) % WIND_GRID_RESOLUTION;
-	const uint2 p10 = uint2(topLeft + int2(1, 0)) % WIND_GRID_RESOLUTION;
-	const uint2 p01 = uint2(topLeft + int2(0, 1)) % WIND_GRID_RESOLUTION;
-	const uint2 p11 = uint2(topLeft + int2(1, 1)) % WIND_GRID_RESOLUTION;
-
-	const int i00 = p00.x + p00.y * WIND_GRID_RESOLUTION;
-	const int i10 = p10.x + p10.y * WIND_GRID_RESOLUTION;
-	const int i01 = p01.x + p01.y * WIND_GRID_RESOLUTION;
-	const int i11 = p11.x + p11.y * WIND_GRID_RESOLUTION;
-
-	const float2 v00 = g_windGrid.Load<float2>(i00 * sizeof(float2));
-	const float2 v10 = g_windGrid.Load<float2>(i10 * sizeof(float2));
-	const float2 v01 = g_windGrid.Load<float2>(i01 * sizeof(float2));
-	const float2 v11 = g_windGrid.Load<float2>(i11 * sizeof(float2));
-	
-	const float2 x0 = lerp(v00, v10, bilinearFactors.x);
-	const float2 x1 = lerp(v01, v11, bilinearFactors.x);
-	
-	return lerp(x0, x1, bilinearFactors.y);
-#endif
+	vertexPosition.xy += sampleWindGrid(vertexPosition.xy, g_frame.windGridResolution) * animationWeight * 0.4f;
+	vertexPosition.x += wind(g_frame.elapsedTime * 0.001f * 0.5f + vertexPosition.x * 0.8f) * animationWeight * 0.1f;
+	return vertexPosition;
 }
 
 VsOutput vs_main(VsInput input)
 {
 	VsOutput output = (VsOutput)0;
 
-	float3			vertexPosition			= g_vertexPositionBuffer.Load<float3>(input.vertexId * sizeof(float3));
+	const gpu_world_chunk_t chunk = g_worldChunkBuffer.Load<gpu_world_chunk_t>(input.chunk * sizeof(gpu_world_chunk_t));
+	const uint		vertexPositionPacked	= g_vertexPositionBuffer.Load(input.vertexId * sizeof(uint));
+	const float2	vertexQuantized			= float2(vertexPositionPacked & 0xffffu, vertexPositionPacked >> 16u);
+	float3			vertexPosition			= float3(chunk.origin + vertexQuantized * chunk.scale, chunk.layer * WORLD_LAYER_DEPTH_STEP);
 	const uint		vertexColorPacked		= g_vertexColorBuffer.Load(input.vertexId * sizeof(uint));
 	const float		vertexAnimationWeight	= (vertexColorPacked >> 24) / 255.0f;
 	
-	vertexPosition.xy += sampleWindGrid(vertexPosition.xy) * vertexAnimationWeight * 0.4f;
-	vertexPosition.x += wind(g_frame.elapsedTime * 0.001f * 0.5f + vertexPosition.x * 0.8f) * vertexAnimationWeight * 0.1f;
+	vertexPosition = animateVertex(vertexPosition, vertexAnimationWeight);
 
 	output.color	= unpackVertexColor(vertexColorPacked);
 	output.position	= mul(float4(vertexPosition, 1.0), g_frame.matViewProj);
@@ -93,6 +77,110 @@ VsOutput vs_main(VsInput input)
 	return output;
 }
 
+struct FoliageVsInput
+{
+	uint vertexId : SV_VertexID;
+	uint instanceId : SV_InstanceID;
+};
+
+float2 unpackSnorm16x2(uint packed)
+{
+	const int2 v = int2(int(packed << 16u) >> 16, int(packed) >> 16);
+	return max(float2(v) / 32767.0f, -1.0f);
+}
+
+uint hashFoliageSeed(uint x)
+{
+	x ^= x >> 16u;
+	x *= 0x7feb352du;
+	x ^= x >> 15u;
+	x *= 0x846ca68bu;
+	x ^= x >> 16u;
+	return x;
+}
+
+// Both plant types are drawn as FOLIAGE_VERTICES_PER_INSTANCE vertices of a triangle list. Grass only
+// needs the first triangle, the rest collapse onto its root.
+static const uint g_flowerCorners[FOLIAGE_VERTICES_PER_INSTANCE] = { 0, 1, 2, 2, 1, 3, 4, 5, 6, 6, 5, 7 };
+
+VsOutput vs_foliage(FoliageVsInput input)
+{
+	VsOutput output = (VsOutput)0;
+
+	const gpu_foliage_instance_t instance = g_foliageInstanceBuffer.Load<gpu_foliage_instance_t>(input.instanceId * sizeof(gpu_foliage_instance_t));
+
+	const float2	root	= instance.root;
+	const float2	tangent	= unpackSnorm16x2(instance.tangent);
+	const float		height	= (instance.params & 0xffu) / 255.0f * FOLIAGE_MAX_HEIGHT;
+	const uint		type	= (instance.params >> 8u) & 0x1u;
+	const uint		layer	= (instance.params >> 9u) & 0xfu;
+	const uint		seed	= instance.params >> 13u;
+	const float		depth	= layer * WORLD_LAYER_DEPTH_STEP;
+
+	// thin out plants that cover little of the screen, keeping the same subset regardless of the camera
+	const float4 clipRoot = mul(float4(root, depth, 1.0), g_frame.matViewProj);
+	const float4 clipTop = mul(float4(root.x, root.y + 1.0f, depth, 1.0), g_frame.matViewProj);
+	const float clipHeight = abs(clipTop.y / clipTop.w - clipRoot.y / clipRoot.w);
+	const float density = saturate(clipHeight / FOLIAGE_FULL_DENSITY_CLIP_HEIGHT);
+	const float rank = (seed >> 7u) / 4096.0f;
+
+	if (rank >= density)
+	{
+		return output;
+	}
+
+	float2 offset;
+	uint color;
+
+	if (type == FOLIAGE_TYPE_GRASS)
+	{
+		const float width = 0.025f;
+		const uint red = seed & 0x7fu;
+
+		switch (min(input.vertexId % FOLIAGE_VERTICES_PER_INSTANCE, 3u))
+		{
+			case 0: offset = float2(0.0f, height);	color = 0xff00a000u | red;			break;
+			case 1: offset = -width * tangent;		color = 0x00002000u | (red / 2u);	break;
+			case 2: offset = width * tangent;		color = 0x00002000u | (red / 2u);	break;
+			default: return output;
+		}
+	}
+	else
+	{
+		const float width = 0.01f;
+		const float headSize = 0.1f;
+		const uint red = seed & 0x1fu;
+
+		const uint headHash = hashFoliageSeed(seed);
+		const uint headColor = headHash & 0xffffffu;
+		const uint headDarkColor = (headColor >> 1u) & 0x7f7f7fu;
+
+		switch (g_flowerCorners[input.vertexId % FOLIAGE_VERTICES_PER_INSTANCE])
+		{
+			// stem
+			case 0: offset = float2(-width, height);	color = 0xff007000u | red;			break;
+			case 1: offset = float2(width, height);		color = 0xff007000u | red;			break;
+			case 2: offset = -width * tangent;			color = 0x00001000u | (red / 2u);	break;
+			case 3: offset = width * tangent;			color = 0x00001000u | (red / 2u);	break;
+			// head
+			case 4: offset = float2(-headSize * 0.5f, height + headSize * 0.5f);	color = 0xff000000u | headColor;		break;
+			case 5: offset = float2(headSize * 0.5f, height + headSize * 0.5f);		color = 0xff000000u | headColor;		break;
+			case 6: offset = float2(-headSize * 0.2f, height - headSize * 0.5f);	color = 0xff000000u | headDarkColor;	break;
+			default: offset = float2(headSize * 0.2f, height - headSize * 0.5f);	color = 0xff000000u | headDarkColor;	break;
+		}
+	}
+
+	const float animationWeight = (color >> 24) / 255.0f;
+	const float3 vertexPosition = animateVertex(float3(root + offset, depth), animationWeight);
+
+	output.color	= unpackVertexColor(color);
+	output.position	= mul(float4(vertexPosition, 1.0), g_frame.matViewProj);
+	output.depth	= vertexPosition.z;
+
+	output.position.y *= -1;
+	return output;
+}
+
 struct FsOutput
 {
 	float4 color : SV_Target0;
@@ -0,0 +1,855 @@
+#include "benchmarks.h"
+#include "triangulate.h"
+#include "foliage.h"
+#include "job_pool.h"
+#include "particle_soa.h"
+#include "wind_grid.h"
+#include "wind_solver.h"
+#include "collision.h"
+#include "physics.h"
+#include "world.h"
+#include "rng.h"
+#include "delta_time.h"
+#include "vec.h"
+#include "util.h"
+#include "common.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <assert.h>
+
+// The ear clipper that used to live in world.c, kept as the baseline. Every pass rescans the whole
+// working set and tests every other vertex, so it is roughly cubic in the vertex count.
+static void reference_ear_clipping(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount)
+{
+	*triangleCount = 0;
+
+	uint* workingSet = malloc(vertexCount * sizeof(uint));
+	assert(workingSet != NULL);
+	uint workingSetSize = vertexCount;
+
+	for (uint i = 0; i < vertexCount; ++i)
+	{
+		workingSet[i] = i;
+	}
+
+	while (workingSetSize > 3)
+	{
+		for (size_t i = 0; i < workingSetSize && workingSetSize > 3; ++i)
+		{
+			const size_t j = (i + 1) % workingSetSize;
+			const size_t k = (i + 2) % workingSetSize;
+
+			const uint i0 = workingSet[i];
+			const uint i1 = workingSet[j];
+			const uint i2 = workingSet[k];
+
+			const vec2 p0 = positions[i0];
+			const vec2 p1 = positions[i1];
+			const vec2 p2 = positions[i2];
+
+			const vec2 d0 = vec2_normalize(vec2_sub(p1, p0));
+			const vec2 d1 = vec2_normalize(vec2_sub(p2, p1));
+
+			const float a0 = atan2f(d0.y, d0.x);
+			const float a1 = atan2f(d1.y, d1.x);
+
+			float da = a1 - a0;
+			da = atan2f(sin(da), cos(da));
+
+			if (da >= 0.0f)
+			{
+				continue;
+			}
+
+			const vec2 edges[][2] = {
+				{p0, p1},
+				{p1, p2},
+				{p2, p0},
+			};
+
+			vec3 planes[3];
+			for (size_t edgeIndex = 0; edgeIndex < countof(edges); ++edgeIndex)
+			{
+				const vec2 a = edges[edgeIndex][0];
+				const vec2 b = edges[edgeIndex][1];
+				const vec2 d = vec2_normalize(vec2_sub(b, a));
+				const vec2 normal = {-d.y, d.x};
+				planes[edgeIndex] = (vec3){ normal.x, normal.y, vec2_dot(normal, a) };
+			}
+
+			bool shouldClip = true;
+
+			const uint insideTestCount = workingSetSize - 3;
+			for (uint testIndex = 0; testIndex < insideTestCount; ++testIndex)
+			{
+				const vec2 pos = positions[workingSet[(testIndex + k + 1) % workingSetSize]];
+
+				if (vec2_dot(vec3_xy(planes[0]), pos) - planes[0].z < 0.0f &&
+					vec2_dot(vec3_xy(planes[1]), pos) - planes[1].z < 0.0f &&
+					vec2_dot(vec3_xy(planes[2]), pos) - planes[2].z < 0.0f)
+				{
+					shouldClip = false;
+					break;
+				}
+			}
+
+			if (shouldClip)
+			{
+				triangle_t* triangle = &triangles[(*triangleCount)++];
+				triangle->i[0] = i0;
+				triangle->i[1] = i1;
+				triangle->i[2] = i2;
+
+				--workingSetSize;
+
+				for (uint del = j; del < workingSetSize; ++del)
+				{
+					workingSet[del] = workingSet[del + 1];
+				}
+			}
+		}
+	}
+
+	triangle_t* triangle = &triangles[(*triangleCount)++];
+	triangle->i[0] = workingSet[0];
+	triangle->i[1] = workingSet[1];
+	triangle->i[2] = workingSet[2];
+
+	free(workingSet);
+}
+
+// Clockwise star with a jagged rim, which gives plenty of reflex vertices for the ear tests.
+static void make_star_polygon(vec2* positions, uint vertexCount)
+{
+	for (uint i = 0; i < vertexCount; ++i)
+	{
+		const float angle = -6.28318530718f * i / vertexCount;
+		const float radius = (i & 1) ? 10.0f : 7.0f + 2.0f * sinf(angle * 7.0f);
+		positions[i] = (vec2){ cosf(angle) * radius, sinf(angle) * radius };
+	}
+}
+
+typedef void (*triangulate_fn_t)(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount);
+
+static double benchmark_triangulate(triangulate_fn_t fn, triangle_t* triangles, const vec2* positions, uint vertexCount, uint iterations)
+{
+	delta_timer_t timer;
+	delta_timer_reset(&timer);
+
+	for (uint i = 0; i < iterations; ++i)
+	{
+		size_t triangleCount;
+		fn(triangles, &triangleCount, positions, vertexCount);
+		assert(triangleCount == vertexCount - 2);
+	}
+
+	double deltaTime, elapsedTime;
+	delta_timer_capture(&deltaTime, &elapsedTime, &timer);
+	return elapsedTime / iterations;
+}
+
+static int benchmark_triangulation(void)
+{
+	printf("Benchmarking triangulation...\n");
+
+	const uint vertexCounts[] = { 64, 1024, 10 * 1024 };
+	const uint iterations[] = { 1000, 10, 1 };
+
+	for (size_t i = 0; i < countof(vertexCounts); ++i)
+	{
+		const uint vertexCount = vertexCounts[i];
+
+		vec2* positions = malloc(vertexCount * sizeof(vec2));
+		triangle_t* triangles = malloc(vertexCount * sizeof(triangle_t));
+		if (positions == NULL || triangles == NULL)
+		{
+			free(positions);
+			free(triangles);
+			return 1;
+		}
+
+		make_star_polygon(positions, vertexCount);
+
+		const double referenceMs	= benchmark_triangulate(reference_ear_clipping, triangles, positions, vertexCount, iterations[i]);
+		const double earMs			= benchmark_triangulate(polygon_triangulate_ear_clipping, triangles, positions, vertexCount, iterations[i]);
+		const double monotoneMs		= benchmark_triangulate(polygon_triangulate_monotone, triangles, positions, vertexCount, iterations[i]);
+
+		printf("  %6u vertices: reference %10.3f ms, ear clipping %8.3f ms, monotone %8.3f ms\n",
+			vertexCount, referenceMs, earMs, monotoneMs);
+
+		free(positions);
+		free(triangles);
+	}
+
+	printf("Done\n");
+	return 0;
+}
+
+static double benchmark_foliage_pass(job_pool_t* pool, foliage_job_t* jobs, uint jobCount, gpu_foliage_instance_t* instances)
+{
+	delta_timer_t timer;
+	delta_timer_reset(&timer);
+
+	foliage_generate(pool, jobs, jobCount, instances);
+
+	double deltaTime, elapsedTime;
+	delta_timer_capture(&deltaTime, &elapsedTime, &timer);
+	return elapsedTime;
+}
+
+static int benchmark_foliage(void)
+{
+	printf("Benchmarking foliage...\n");
+
+	// a large level: 16 layers worth of 4k vertex terrain
+	enum { VERTEX_COUNT = 64 * 1024 };
+
+	vec2* positions = malloc(VERTEX_COUNT * sizeof(vec2));
+	foliage_job_t* jobs = malloc(VERTEX_COUNT * sizeof(foliage_job_t));
+	if (positions == NULL || jobs == NULL)
+	{
+		free(positions);
+		free(jobs);
+		return 1;
+	}
+
+	for (uint i = 0; i < VERTEX_COUNT; ++i)
+	{
+		const float angle = -6.28318530718f * i / VERTEX_COUNT;
+		const float radius = 2000.0f + 4.0f * sinf(angle * 997.0f);
+		positions[i] = (vec2){ cosf(angle) * radius, sinf(angle) * radius };
+	}
+
+	const editor_polygon_t polygon = {
+		.vertexCount	= VERTEX_COUNT,
+		.vertexPosition	= positions,
+	};
+
+	const uint jobCount = foliage_add_polygon_jobs(jobs, &polygon, 0);
+	const uint32_t instanceCount = foliage_prefix_sum(jobs, jobCount, 0);
+
+	job_pool_t* serialPool = job_pool_create(1);
+	job_pool_t* pool = job_pool_create(0);
+
+	gpu_foliage_instance_t* instances = malloc(instanceCount * sizeof(gpu_foliage_instance_t));
+	if (instances != NULL)
+	{
+		// first touch of the output pages would otherwise be billed to whichever run goes first
+		benchmark_foliage_pass(serialPool, jobs, jobCount, instances);
+
+		const double serialMs = benchmark_foliage_pass(serialPool, jobs, jobCount, instances);
+		const double parallelMs = benchmark_foliage_pass(pool, jobs, jobCount, instances);
+
+		printf("  %u edges, %u instances (%zu KiB): 1 thread %8.3f ms, %u threads %8.3f ms\n",
+			jobCount, instanceCount, instanceCount * sizeof(gpu_foliage_instance_t) / 1024,
+			serialMs, job_pool_get_thread_count(pool), parallelMs);
+	}
+
+	free(instances);
+
+	job_pool_destroy(serialPool);
+	job_pool_destroy(pool);
+
+	free(positions);
+	free(jobs);
+
+	printf("Done\n");
+	return 0;
+}
+
+// The AoS particle and tick loop that particles.c used to have, kept as the baseline.
+typedef struct reference_particle
+{
+	vec2	pos;
+	vec2	vel;
+	float	lifetime;
+	float	age;
+} reference_particle_t;
+
+static void reference_particle_tick(reference_particle_t* particles, uint* count, float damping)
+{
+	for (uint i = 0; i < *count;)
+	{
+		reference_particle_t* p = &particles[i];
+		p->pos = vec2_add(p->pos, vec2_scale(p->vel, DELTA_TIME_MS));
+		p->pos.x += sinf(p->age * 0.0025f) * DELTA_TIME_MS * 0.0004f;
+		p->vel = vec2_scale(p->vel, damping);
+		p->age += DELTA_TIME_MS;
+
+		const bool isDead = p->age >= p->lifetime;
+		if (isDead)
+		{
+			particles[i] = particles[--(*count)];
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+static int benchmark_particles(void)
+{
+	printf("Benchmarking particles...\n");
+
+	// the GPU buffer limit in particles.c
+	enum { PARTICLE_COUNT = 64 * 1024, TICKS = 100 };
+
+	reference_particle_t* reference = malloc(PARTICLE_COUNT * sizeof(reference_particle_t));
+	particle_soa_t soa;
+	if (reference == NULL || !particle_soa_create(&soa, PARTICLE_COUNT))
+	{
+		free(reference);
+		return 1;
+	}
+
+	// lifetimes spread so that a few particles die every tick
+	uint rng = 1;
+	for (uint i = 0; i < PARTICLE_COUNT; ++i)
+	{
+		const vec2 pos = { lcg_randf_range(&rng, -50.0f, 50.0f), lcg_randf_range(&rng, -50.0f, 50.0f) };
+		const vec2 vel = { lcg_randf_range(&rng, -0.001f, 0.001f), lcg_randf_range(&rng, 0.0f, 0.001f) };
+		const float lifetime = lcg_randf_range(&rng, 500.0f, 100000.0f);
+
+		reference[i] = (reference_particle_t){ .pos = pos, .vel = vel, .lifetime = lifetime };
+		particle_soa_push(&soa, pos, vel, lifetime);
+	}
+
+	uint referenceCount = PARTICLE_COUNT;
+
+	delta_timer_t timer;
+	double deltaTime, referenceMs, soaMs;
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		reference_particle_tick(reference, &referenceCount, 0.9f);
+	}
+	delta_timer_capture(&deltaTime, &referenceMs, &timer);
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		particle_soa_sway(&soa, 0.0025f, DELTA_TIME_MS * 0.0004f);
+		particle_soa_integrate(&soa, DELTA_TIME_MS, 0.9f);
+		particle_soa_compact(&soa);
+	}
+	delta_timer_capture(&deltaTime, &soaMs, &timer);
+
+	assert(soa.count == referenceCount);
+
+	printf("  %u particles, %u ticks: AoS %8.3f ms/tick, SoA %8.3f ms/tick (%.1fx)\n",
+		PARTICLE_COUNT, TICKS, referenceMs / TICKS, soaMs / TICKS, referenceMs / soaMs);
+
+	particle_soa_destroy(&soa);
+	free(reference);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int benchmark_particle_write(void)
+{
+	printf("Benchmarking particle write...\n");
+
+	enum { PARTICLE_COUNT = 64 * 1024, TICKS = 100 };
+
+	particle_soa_t twoPass, fused;
+	gpu_particle_t* out = aligned_alloc(64, PARTICLE_COUNT * sizeof(gpu_particle_t));
+	if (out == NULL || !particle_soa_create(&twoPass, PARTICLE_COUNT) || !particle_soa_create(&fused, PARTICLE_COUNT))
+	{
+		free(out);
+		return 1;
+	}
+
+	uint rng = 1;
+	for (uint i = 0; i < PARTICLE_COUNT; ++i)
+	{
+		const vec2 pos = { lcg_randf_range(&rng, -50.0f, 50.0f), lcg_randf_range(&rng, -50.0f, 50.0f) };
+		const vec2 vel = { lcg_randf_range(&rng, -0.001f, 0.001f), lcg_randf_range(&rng, 0.0f, 0.001f) };
+		const float lifetime = lcg_randf_range(&rng, 500.0f, 100000.0f);
+		particle_soa_push(&twoPass, pos, vel, lifetime);
+		particle_soa_push(&fused, pos, vel, lifetime);
+	}
+
+	const particle_soa_style_t style = { .size = 0.2f, .layer = 0, .color = 0xff00222f };
+
+	delta_timer_t timer;
+	double deltaTime, twoPassMs, fusedMs;
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		particle_soa_integrate(&twoPass, DELTA_TIME_MS, 0.9f);
+		particle_soa_compact(&twoPass);
+		particle_soa_write(out, &twoPass, &style);
+	}
+	delta_timer_capture(&deltaTime, &twoPassMs, &timer);
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		particle_soa_integrate_write(&fused, DELTA_TIME_MS, 0.9f, out, &style);
+	}
+	delta_timer_capture(&deltaTime, &fusedMs, &timer);
+
+	assert(fused.count == twoPass.count);
+
+	printf("  %u particles, %u ticks: tick + write %8.3f ms/tick, fused %8.3f ms/tick (%.1fx)\n",
+		PARTICLE_COUNT, TICKS, twoPassMs / TICKS, fusedMs / TICKS, twoPassMs / fusedMs);
+
+	particle_soa_destroy(&twoPass);
+	particle_soa_destroy(&fused);
+	free(out);
+
+	printf("Done\n");
+	return 0;
+}
+
+#define BENCHMARK_WIND_RESOLUTION	WIND_GRID_DEFAULT_RESOLUTION
+#define BENCHMARK_WIND_CELL_COUNT	(BENCHMARK_WIND_RESOLUTION * BENCHMARK_WIND_RESOLUTION)
+
+// The scalar decay and injection that wind.c used to have, kept as the baseline.
+static void reference_wind_tick(vec2* grid, const wind_injection_t* injections, uint injectionCount)
+{
+	for (uint i = 0; i < BENCHMARK_WIND_CELL_COUNT; ++i)
+	{
+		grid[i] = vec2_scale(grid[i], 0.85f);
+	}
+
+	for (uint j = 0; j < injectionCount; ++j)
+	{
+		const wind_injection_t* injection = &injections[j];
+		const int xMin = (int)floorf(injection->aabbMin.x / WIND_GRID_CELL_SIZE);
+		const int yMin = (int)floorf(injection->aabbMin.y / WIND_GRID_CELL_SIZE);
+		const int xMax = (int)ceilf(injection->aabbMax.x / WIND_GRID_CELL_SIZE);
+		const int yMax = (int)ceilf(injection->aabbMax.y / WIND_GRID_CELL_SIZE);
+
+		for (int y = yMin; y < yMax; ++y)
+		{
+			for (int x = xMin; x < xMax; ++x)
+			{
+				const uint i = (((uint)x) % BENCHMARK_WIND_RESOLUTION) + (((uint)y) % BENCHMARK_WIND_RESOLUTION) * BENCHMARK_WIND_RESOLUTION;
+
+				vec2 vel = vec2_add(grid[i], vec2_scale(injection->vel, 1.5f));
+				if (vec2_length(vel) > 1.0f)
+				{
+					vel = vec2_normalize(vel);
+				}
+				grid[i] = vel;
+			}
+		}
+	}
+}
+
+static int benchmark_wind(void)
+{
+	printf("Benchmarking wind...\n");
+
+	// a crowd of characters plus a few explosion sized boxes
+	enum { INJECTION_COUNT = 64, TICKS = 1000 };
+
+	vec2* reference = aligned_alloc(16, BENCHMARK_WIND_CELL_COUNT * sizeof(vec2));
+	vec2* grid = aligned_alloc(16, BENCHMARK_WIND_CELL_COUNT * sizeof(vec2));
+	wind_injection_t* injections = malloc(INJECTION_COUNT * sizeof(wind_injection_t));
+	if (reference == NULL || grid == NULL || injections == NULL)
+	{
+		free(reference);
+		free(grid);
+		free(injections);
+		return 1;
+	}
+
+	for (uint i = 0; i < BENCHMARK_WIND_CELL_COUNT; ++i)
+	{
+		reference[i] = grid[i] = (vec2){ 0.0f, 0.0f };
+	}
+
+	uint rng = 1;
+	for (uint i = 0; i < INJECTION_COUNT; ++i)
+	{
+		const vec2 size = (i % 16 == 0) ? (vec2){ 4.0f, 4.0f } : (vec2){ 0.5f, 1.8f };
+		const vec2 pos = { lcg_randf_range(&rng, -10.0f, 10.0f), lcg_randf_range(&rng, -10.0f, 10.0f) };
+		injections[i] = (wind_injection_t){
+			.aabbMin	= pos,
+			.aabbMax	= vec2_add(pos, size),
+			.vel		= { lcg_randf_range(&rng, -0.2f, 0.2f), lcg_randf_range(&rng, -0.2f, 0.2f) },
+		};
+	}
+
+	delta_timer_t timer;
+	double deltaTime, referenceMs, kernelMs;
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		reference_wind_tick(reference, injections, INJECTION_COUNT);
+	}
+	delta_timer_capture(&deltaTime, &referenceMs, &timer);
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		wind_grid_decay(grid, BENCHMARK_WIND_CELL_COUNT, 0.85f);
+		for (uint j = 0; j < INJECTION_COUNT; ++j)
+		{
+			wind_grid_inject(grid, BENCHMARK_WIND_RESOLUTION, &injections[j], NULL);
+		}
+	}
+	delta_timer_capture(&deltaTime, &kernelMs, &timer);
+
+	for (uint i = 0; i < BENCHMARK_WIND_CELL_COUNT; ++i)
+	{
+		assert(grid[i].x == reference[i].x && grid[i].y == reference[i].y);
+	}
+
+	printf("  %u injections, %u ticks: scalar %8.4f ms/tick, SSE %8.4f ms/tick (%.1fx)\n",
+		INJECTION_COUNT, TICKS, referenceMs / TICKS, kernelMs / TICKS, referenceMs / kernelMs);
+
+	free(reference);
+	free(grid);
+	free(injections);
+
+	printf("Done\n");
+	return 0;
+}
+
+// The scalar wind_sample that wind.c used to have, kept as the baseline.
+static vec2 reference_wind_sample(const vec2* grid, vec2 pos)
+{
+	const vec2 floatGridPos = vec2_scale(pos, 1.0f / WIND_GRID_CELL_SIZE);
+	const vec2 bilinearFactors = vec2_frac(floatGridPos);
+	const int dx = (int)floorf(floatGridPos.x - 0.5f);
+	const int dy = (int)floorf(floatGridPos.y - 0.5f);
+
+	const int i00 = (((uint)(dx+0)) % BENCHMARK_WIND_RESOLUTION) + (((uint)(dy+0)) % BENCHMARK_WIND_RESOLUTION) * BENCHMARK_WIND_RESOLUTION;
+	const int i10 = (((uint)(dx+1)) % BENCHMARK_WIND_RESOLUTION) + (((uint)(dy+0)) % BENCHMARK_WIND_RESOLUTION) * BENCHMARK_WIND_RESOLUTION;
+	const int i01 = (((uint)(dx+0)) % BENCHMARK_WIND_RESOLUTION) + (((uint)(dy+1)) % BENCHMARK_WIND_RESOLUTION) * BENCHMARK_WIND_RESOLUTION;
+	const int i11 = (((uint)(dx+1)) % BENCHMARK_WIND_RESOLUTION) + (((uint)(dy+1)) % BENCHMARK_WIND_RESOLUTION) * BENCHMARK_WIND_RESOLUTION;
+
+	const vec2 x0 = vec2_lerp(grid[i00], grid[i10], bilinearFactors.x);
+	const vec2 x1 = vec2_lerp(grid[i01], grid[i11], bilinearFactors.x);
+	return vec2_lerp(x0, x1, bilinearFactors.y);
+}
+
+static int benchmark_wind_sample(void)
+{
+	printf("Benchmarking wind sampling...\n");
+
+	// the cpu particle limit
+	enum { SAMPLE_COUNT = 64 * 1024, TICKS = 100 };
+
+	vec2* grid = aligned_alloc(16, BENCHMARK_WIND_CELL_COUNT * sizeof(vec2));
+	float* xs = malloc(SAMPLE_COUNT * sizeof(float));
+	float* ys = malloc(SAMPLE_COUNT * sizeof(float));
+	float* outX = malloc(SAMPLE_COUNT * sizeof(float));
+	float* outY = malloc(SAMPLE_COUNT * sizeof(float));
+	if (grid == NULL || xs == NULL || ys == NULL || outX == NULL || outY == NULL)
+	{
+		free(grid);
+		free(xs);
+		free(ys);
+		free(outX);
+		free(outY);
+		return 1;
+	}
+
+	uint rng = 1;
+	for (uint i = 0; i < BENCHMARK_WIND_CELL_COUNT; ++i)
+	{
+		grid[i] = (vec2){ lcg_randf_range(&rng, -1.0f, 1.0f), lcg_randf_range(&rng, -1.0f, 1.0f) };
+	}
+	for (uint i = 0; i < SAMPLE_COUNT; ++i)
+	{
+		xs[i] = lcg_randf_range(&rng, 0.0f, 50.0f);
+		ys[i] = lcg_randf_range(&rng, 0.0f, 50.0f);
+	}
+
+	delta_timer_t timer;
+	double deltaTime, referenceMs, batchMs;
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		for (uint j = 0; j < SAMPLE_COUNT; ++j)
+		{
+			const vec2 v = reference_wind_sample(grid, (vec2){ xs[j], ys[j] });
+			outX[j] = v.x;
+			outY[j] = v.y;
+		}
+	}
+	delta_timer_capture(&deltaTime, &referenceMs, &timer);
+
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < TICKS; ++i)
+	{
+		wind_grid_sample(grid, BENCHMARK_WIND_RESOLUTION, xs, ys, outX, outY, SAMPLE_COUNT);
+	}
+	delta_timer_capture(&deltaTime, &batchMs, &timer);
+
+	printf("  %u samples: wind_sample %8.3f ms/tick, batched %8.3f ms/tick (%.1fx)\n",
+		SAMPLE_COUNT, referenceMs / TICKS, batchMs / TICKS, referenceMs / batchMs);
+
+	free(grid);
+	free(xs);
+	free(ys);
+	free(outX);
+	free(outY);
+
+	printf("Done\n");
+	return 0;
+}
+
+static double benchmark_wind_solver_steps(wind_solver_t* solver, vec2* grid, uint steps)
+{
+	delta_timer_t timer;
+	delta_timer_reset(&timer);
+	for (uint i = 0; i < steps; ++i)
+	{
+		wind_solver_step(solver, grid, NULL);
+	}
+	double deltaTime, elapsedTime;
+	delta_timer_capture(&deltaTime, &elapsedTime, &timer);
+	return elapsedTime / steps;
+}
+
+static int benchmark_wind_solver(void)
+{
+	printf("Benchmarking wind solver...\n");
+
+	enum { STEPS = 20 };
+
+	job_pool_t* serialPool = job_pool_create(1);
+	job_pool_t* pool = job_pool_create(0);
+	if (serialPool == NULL || pool == NULL)
+	{
+		return 1;
+	}
+
+	for (uint resolution = 64; resolution <= 512; resolution *= 2)
+	{
+		const wind_solver_desc_t desc = {
+			.resolution				= resolution,
+			.diffusionIterations	= 2,
+			.pressureIterations		= 16,
+			.viscosity				= 0.05f,
+			.damping				= 0.92f,
+		};
+		wind_solver_t* serial = wind_solver_create(&desc, serialPool);
+		wind_solver_t* parallel = wind_solver_create(&desc, pool);
+		vec2* grid = aligned_alloc(16, resolution * resolution * sizeof(vec2));
+		if (serial == NULL || parallel == NULL || grid == NULL)
+		{
+			return 1;
+		}
+
+		uint rng = 1;
+		for (uint i = 0; i < resolution * resolution; ++i)
+		{
+			grid[i] = (vec2){ lcg_randf_range(&rng, -0.5f, 0.5f), lcg_randf_range(&rng, -0.5f, 0.5f) };
+		}
+
+		const double serialMs = benchmark_wind_solver_steps(serial, grid, STEPS);
+		const double parallelMs = benchmark_wind_solver_steps(parallel, grid, STEPS);
+
+		printf("  %4ux%-4u: 1 thread %8.3f ms/tick, %u threads %8.3f ms/tick\n",
+			resolution, resolution, serialMs, job_pool_get_thread_count(pool), parallelMs);
+
+		wind_solver_destroy(serial);
+		wind_solver_destroy(parallel);
+		free(grid);
+	}
+
+	job_pool_destroy(serialPool);
+	job_pool_destroy(pool);
+
+	printf("Done\n");
+	return 0;
+}
+
+// Bodies walking over hilly ground, to check that the cost per body stays flat as the body count grows.
+static int benchmark_collision(void)
+{
+	printf("Benchmarking collision...\n");
+
+	enum { GROUND_SEGMENTS = 1024, TICKS = 16 };
+	const float segmentWidth = 0.5f;
+
+	collision_triangle_t* triangles = malloc(GROUND_SEGMENTS * 2 * sizeof(collision_triangle_t));
+	vec2* boundsMin = malloc(GROUND_SEGMENTS * 2 * sizeof(vec2));
+	vec2* boundsMax = malloc(GROUND_SEGMENTS * 2 * sizeof(vec2));
+	if (triangles == NULL || boundsMin == NULL || boundsMax == NULL)
+	{
+		return 1;
+	}
+
+	for (uint i = 0; i < GROUND_SEGMENTS; ++i)
+	{
+		const float x0 = i * segmentWidth;
+		const float x1 = x0 + segmentWidth;
+		const vec2 a = { x0, -2.0f };
+		const vec2 b = { x1, -2.0f };
+		const vec2 c = { x1, sinf(x1 * 0.7f) * 0.4f };
+		const vec2 d = { x0, sinf(x0 * 0.7f) * 0.4f };
+		collision_triangle_build(&triangles[i * 2 + 0], a, b, c);
+		collision_triangle_build(&triangles[i * 2 + 1], a, c, d);
+	}
+	for (uint i = 0; i < GROUND_SEGMENTS * 2; ++i)
+	{
+		boundsMin[i] = triangles[i].boundsMin;
+		boundsMax[i] = triangles[i].boundsMax;
+	}
+
+	collision_grid_t grid = {0};
+	if (collision_grid_build(&grid, boundsMin, boundsMax, GROUND_SEGMENTS * 2, 2.0f) != 0)
+	{
+		return 1;
+	}
+	const collision_world_t world = { triangles, &grid };
+	collision_scratch_t scratch = {0};
+
+	for (uint bodyCount = 256; bodyCount <= 65536; bodyCount *= 16)
+	{
+		collision_body_t* bodies = malloc(bodyCount * sizeof(collision_body_t));
+		if (bodies == NULL)
+		{
+			return 1;
+		}
+
+		uint rng = 1;
+		for (uint i = 0; i < bodyCount; ++i)
+		{
+			bodies[i] = (collision_body_t){
+				.center		= { lcg_randf_range(&rng, 1.0f, GROUND_SEGMENTS * segmentWidth - 10.0f), lcg_randf_range(&rng, 1.0f, 4.0f) },
+				.halfSize	= { 0.25f, 0.5f },
+			};
+		}
+
+		delta_timer_t timer;
+		delta_timer_reset(&timer);
+		for (uint tick = 0; tick < TICKS; ++tick)
+		{
+			for (uint i = 0; i < bodyCount; ++i)
+			{
+				bodies[i].delta = (vec2){ 0.1f, -0.2f };
+			}
+			collision_move_bodies(&world, &scratch, bodies, bodyCount);
+		}
+		double deltaTime, elapsedTime;
+		delta_timer_capture(&deltaTime, &elapsedTime, &timer);
+
+		printf("  %6u bodies: %8.3f ms/tick, %6.3f us/body\n",
+			bodyCount, elapsedTime / TICKS, elapsedTime * 1000.0 / TICKS / bodyCount);
+
+		free(bodies);
+	}
+
+	collision_scratch_destroy(&scratch);
+	collision_grid_destroy(&grid);
+	free(triangles);
+	free(boundsMin);
+	free(boundsMax);
+
+	printf("Done\n");
+	return 0;
+}
+
+// Boxes poured onto the ground in world.bin, with no GPU involved. Ticks a second of them settling at each
+// body count.
+static int benchmark_physics(void)
+{
+	printf("Benchmarking physics...\n");
+
+	enum { TICKS = 60 };
+
+	world_t* world = world_create(NULL, NULL, NULL);
+	if (world == NULL)
+	{
+		return 1;
+	}
+
+	if (world_load(world, "world.bin") != 0)
+	{
+		printf("No world.bin, skipping\n");
+		world_destroy(world);
+		return 0;
+	}
+	world_update_headless(world);
+
+	collision_world_t collisionWorld;
+	world_get_collision_world(&collisionWorld, world);
+
+	// in a band above the colliders
+	const collision_grid_t* grid = collisionWorld.grid;
+	const vec2 spawnMin = {
+		grid->origin.x,
+		grid->origin.y + grid->size.y * grid->cellSize,
+	};
+	const vec2 spawnMax = {
+		grid->origin.x + grid->size.x * grid->cellSize,
+		spawnMin.y + 16.0f,
+	};
+	printf("  %u colliders, spawning in (%.1f, %.1f) - (%.1f, %.1f)\n",
+		grid->itemCount, spawnMin.x, spawnMin.y, spawnMax.x, spawnMax.y);
+
+	for (uint bodyCount = 1000; bodyCount <= 16000; bodyCount *= 4)
+	{
+		physics_t* physics = physics_create(bodyCount, 0.00005f);
+		if (physics == NULL)
+		{
+			return 1;
+		}
+
+		uint rng = 1;
+		for (uint i = 0; i < bodyCount; ++i)
+		{
+			physics_add_body(physics, &(physics_body_desc_t){
+				.center			= { lcg_randf_range(&rng, spawnMin.x, spawnMax.x), lcg_randf_range(&rng, spawnMin.y, spawnMax.y) },
+				.halfSize		= { 0.1f, 0.1f },
+				.vel			= { lcg_randf_range(&rng, -0.005f, 0.005f), 0.0f },
+				.mass			= 1.0f,
+				.gravityScale	= 1.0f,
+			});
+		}
+
+		double worstMs = 0.0;
+		double totalMs = 0.0;
+		for (uint tick = 0; tick < TICKS; ++tick)
+		{
+			delta_timer_t timer;
+			delta_timer_reset(&timer);
+			physics_tick(physics, &collisionWorld, DELTA_TIME_MS);
+			double deltaTime, elapsedTime;
+			delta_timer_capture(&deltaTime, &elapsedTime, &timer);
+
+			totalMs += elapsedTime;
+			worstMs = elapsedTime > worstMs ? elapsedTime : worstMs;
+		}
+
+		printf("  %6u bodies: %8.3f ms/tick, %8.3f ms worst tick\n", bodyCount, totalMs / TICKS, worstMs);
+
+		physics_destroy(physics);
+	}
+
+	world_destroy(world);
+
+	printf("Done\n");
+	return 0;
+}
+
+int run_benchmarks(void)
+{
+	if (benchmark_triangulation()) return 1;
+	if (benchmark_foliage()) return 1;
+	if (benchmark_particles()) return 1;
+	if (benchmark_particle_write()) return 1;
+	if (benchmark_wind()) return 1;
+	if (benchmark_wind_sample()) return 1;
+	if (benchmark_wind_solver()) return 1;
+	if (benchmark_collision()) return 1;
+	if (benchmark_physics()) return 1;
+
+	return 0;
+}
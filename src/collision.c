@@ -0,0 +1,391 @@
+#include "collision.h"
+#include "vec.h"
+
+#include <math.h>
+#include <float.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+// Bodies are left this far from the surfaces they stop against, so the next sweep starts out of contact.
+#define COLLISION_SKIN				0.001f
+#define COLLISION_QUERY_MARGIN		0.01f
+#define COLLISION_MAX_SLIDES		4
+#define COLLISION_MAX_PUSHOUTS		4
+#define COLLISION_GROUND_NORMAL_Y	0.7f
+// how much better b's separating axis has to be before it's used over a's
+#define COLLISION_REFERENCE_BIAS	1e-3f
+
+float collision_polygon_find_max_separation(uint* edgeIndexA, const collision_polygon_t* a, const collision_polygon_t* b)
+{
+	float	maxSeparation = -FLT_MAX;
+	uint	maxIndex = 0;
+
+	for (size_t indexA = 0; indexA < a->size; ++indexA)
+	{
+		const vec2 posA = a->pos[indexA];
+		const vec2 normalA = a->normal[indexA];
+
+		float deepestDistance = FLT_MAX;
+		for (size_t indexB = 0; indexB < b->size; ++indexB)
+		{
+			const vec2 posB = b->pos[indexB];
+
+			const float d = vec2_dot(normalA, vec2_sub(posB, posA));
+			if (d < deepestDistance)
+			{
+				deepestDistance = d;
+			}
+		}
+
+		if (deepestDistance > maxSeparation)
+		{
+			maxSeparation	= deepestDistance;
+			maxIndex		= indexA;
+		}
+	}
+
+	*edgeIndexA = maxIndex;
+	return maxSeparation;
+}
+
+void collision_polygon_find_incident_edge(uint* incidentEdge, const collision_polygon_t* a, uint edgeA, const collision_polygon_t* b)
+{
+	const vec2 normalA = a->normal[edgeA];
+
+	uint minIndex = 0;
+	float minDot = FLT_MAX;
+
+	for (size_t i = 0; i < b->size; ++i)
+	{
+		const float d = vec2_dot(normalA, b->normal[i]);
+		if (d < minDot)
+		{
+			minDot		= d;
+			minIndex	= i;
+		}
+	}
+
+	*incidentEdge = minIndex;
+}
+
+bool collision_polygon_collide(collision_contact_t* contact, const collision_polygon_t* a, const collision_polygon_t* b)
+{
+	uint edgeA;
+	uint edgeB;
+	const float separationA = collision_polygon_find_max_separation(&edgeA, a, b);
+	if (separationA >= 0.0f)
+	{
+		return false;
+	}
+	const float separationB = collision_polygon_find_max_separation(&edgeB, b, a);
+	if (separationB >= 0.0f)
+	{
+		return false;
+	}
+
+	if (separationB > separationA + COLLISION_REFERENCE_BIAS)
+	{
+		contact->normal			= vec2_scale(b->normal[edgeB], -1.0f);
+		contact->depth			= -separationB;
+		contact->referenceIsB	= true;
+		contact->referenceEdge	= edgeB;
+		collision_polygon_find_incident_edge(&contact->incidentEdge, b, edgeB, a);
+	}
+	else
+	{
+		contact->normal			= a->normal[edgeA];
+		contact->depth			= -separationA;
+		contact->referenceIsB	= false;
+		contact->referenceEdge	= edgeA;
+		collision_polygon_find_incident_edge(&contact->incidentEdge, a, edgeA, b);
+	}
+
+	return true;
+}
+
+void collision_triangle_build(collision_triangle_t* triangle, vec2 a, vec2 b, vec2 c)
+{
+	const vec2 v[3] = { a, b, c };
+
+	// the left normal of each edge points into a counter clockwise triangle
+	const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	const float flip = area > 0.0f ? -1.0f : 1.0f;
+
+	for (uint i = 0; i < 3; ++i)
+	{
+		const vec2 p = v[i];
+		const vec2 q = v[(i + 1) % 3];
+		const vec2 opposite = v[(i + 2) % 3];
+
+		const vec2 d = vec2_sub(q, p);
+		const float len = vec2_length(d);
+
+		vec2 normal = { 0.0f, 0.0f };
+		if (area != 0.0f && len > 0.0f)
+		{
+			normal = (vec2){ -d.y * flip / len, d.x * flip / len };
+		}
+
+		triangle->normal[i]	= normal;
+		triangle->dist[i]	= vec2_dot(normal, p);
+		triangle->depth[i]	= vec2_dot(normal, opposite);
+	}
+
+	triangle->boundsMin = (vec2){ fminf(a.x, fminf(b.x, c.x)), fminf(a.y, fminf(b.y, c.y)) };
+	triangle->boundsMax = (vec2){ fmaxf(a.x, fmaxf(b.x, c.x)), fmaxf(a.y, fmaxf(b.y, c.y)) };
+}
+
+// The separating axes of a box against a triangle are the box's two and the triangle's three edge normals, each
+// with the box's and the triangle's extents along it.
+typedef struct collision_axis
+{
+	vec2	axis;
+	float	boxMin;
+	float	boxMax;
+	float	triangleMin;
+	float	triangleMax;
+} collision_axis_t;
+
+// The hot paths do their arithmetic inline rather than through vec.h, which isn't inlined across translation units.
+static void collision_get_axes(collision_axis_t axes[5], const collision_triangle_t* triangle, vec2 center, vec2 halfSize)
+{
+	axes[0] = (collision_axis_t){ { 1.0f, 0.0f }, center.x - halfSize.x, center.x + halfSize.x, triangle->boundsMin.x, triangle->boundsMax.x };
+	axes[1] = (collision_axis_t){ { 0.0f, 1.0f }, center.y - halfSize.y, center.y + halfSize.y, triangle->boundsMin.y, triangle->boundsMax.y };
+
+	for (uint i = 0; i < 3; ++i)
+	{
+		const vec2 n = triangle->normal[i];
+		const float c = n.x * center.x + n.y * center.y;
+		const float r = halfSize.x * fabsf(n.x) + halfSize.y * fabsf(n.y);
+		axes[2 + i] = (collision_axis_t){ n, c - r, c + r, triangle->depth[i], triangle->dist[i] };
+	}
+}
+
+// Sweeps the box along delta against the triangle. Returns true if it starts touching the triangle somewhere in
+// [0, 1] of the move, with the time and the triangle's normal there. A box that already overlaps the triangle
+// doesn't hit it.
+static bool collision_sweep_triangle(float* hitTime, vec2* hitNormal, const collision_triangle_t* triangle, vec2 center, vec2 halfSize, vec2 delta)
+{
+	// most candidates are rejected by the bounds of the sweep alone
+	const float sweepMinX = center.x - halfSize.x + (delta.x < 0.0f ? delta.x : 0.0f);
+	const float sweepMaxX = center.x + halfSize.x + (delta.x > 0.0f ? delta.x : 0.0f);
+	const float sweepMinY = center.y - halfSize.y + (delta.y < 0.0f ? delta.y : 0.0f);
+	const float sweepMaxY = center.y + halfSize.y + (delta.y > 0.0f ? delta.y : 0.0f);
+	if (sweepMaxX <= triangle->boundsMin.x || sweepMinX >= triangle->boundsMax.x ||
+		sweepMaxY <= triangle->boundsMin.y || sweepMinY >= triangle->boundsMax.y)
+	{
+		return false;
+	}
+
+	collision_axis_t axes[5];
+	collision_get_axes(axes, triangle, center, halfSize);
+
+	float enter = -FLT_MAX;
+	float exit = FLT_MAX;
+	vec2 normal = { 0.0f, 0.0f };
+
+	for (uint i = 0; i < 5; ++i)
+	{
+		const collision_axis_t* a = &axes[i];
+		const float speed = a->axis.x * delta.x + a->axis.y * delta.y;
+
+		if (speed == 0.0f)
+		{
+			if (a->boxMax <= a->triangleMin || a->boxMin >= a->triangleMax)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float axisEnter;
+		float axisExit;
+		vec2 axisNormal;
+		if (speed > 0.0f)
+		{
+			axisEnter	= (a->triangleMin - a->boxMax) / speed;
+			axisExit	= (a->triangleMax - a->boxMin) / speed;
+			axisNormal	= (vec2){ -a->axis.x, -a->axis.y };
+		}
+		else
+		{
+			axisEnter	= (a->triangleMax - a->boxMin) / speed;
+			axisExit	= (a->triangleMin - a->boxMax) / speed;
+			axisNormal	= a->axis;
+		}
+
+		if (axisEnter > enter)
+		{
+			enter	= axisEnter;
+			normal	= axisNormal;
+		}
+		if (axisExit < exit)
+		{
+			exit = axisExit;
+		}
+		if (enter >= exit || enter > 1.0f || exit <= 0.0f)
+		{
+			return false;
+		}
+	}
+
+	if (enter < 0.0f)
+	{
+		return false;
+	}
+
+	*hitTime	= enter;
+	*hitNormal	= normal;
+	return true;
+}
+
+// Returns true if the box overlaps the triangle, with the shortest way out of it.
+static bool collision_overlap_triangle(vec2* pushout, const collision_triangle_t* triangle, vec2 center, vec2 halfSize)
+{
+	if (center.x + halfSize.x <= triangle->boundsMin.x || center.x - halfSize.x >= triangle->boundsMax.x ||
+		center.y + halfSize.y <= triangle->boundsMin.y || center.y - halfSize.y >= triangle->boundsMax.y)
+	{
+		return false;
+	}
+
+	collision_axis_t axes[5];
+	collision_get_axes(axes, triangle, center, halfSize);
+
+	float minDepth = FLT_MAX;
+	for (uint i = 0; i < 5; ++i)
+	{
+		const collision_axis_t* a = &axes[i];
+		const float depthBelow = a->boxMax - a->triangleMin;
+		const float depthAbove = a->triangleMax - a->boxMin;
+		if (depthBelow <= 0.0f || depthAbove <= 0.0f)
+		{
+			return false;
+		}
+
+		if (depthBelow < minDepth)
+		{
+			minDepth	= depthBelow;
+			*pushout	= vec2_scale(a->axis, -depthBelow);
+		}
+		if (depthAbove < minDepth)
+		{
+			minDepth	= depthAbove;
+			*pushout	= vec2_scale(a->axis, depthAbove);
+		}
+	}
+
+	return true;
+}
+
+uint collision_contact_flags(vec2 normal)
+{
+	if (normal.y >= COLLISION_GROUND_NORMAL_Y)
+	{
+		return COLLISION_CONTACT_GROUND;
+	}
+	if (normal.y <= -COLLISION_GROUND_NORMAL_Y)
+	{
+		return COLLISION_CONTACT_CEILING;
+	}
+	return COLLISION_CONTACT_WALL;
+}
+
+void collision_scratch_destroy(collision_scratch_t* scratch)
+{
+	free(scratch->candidates);
+	*scratch = (collision_scratch_t){0};
+}
+
+static void collision_move_body(const collision_world_t* world, collision_scratch_t* scratch, collision_body_t* body)
+{
+	body->contacts = 0;
+
+	// sliding never moves a body further than its delta, so one query covers every step of the move
+	const float reach = vec2_length(body->delta) + COLLISION_QUERY_MARGIN;
+	const vec2 queryMin = { body->center.x - body->halfSize.x - reach, body->center.y - body->halfSize.y - reach };
+	const vec2 queryMax = { body->center.x + body->halfSize.x + reach, body->center.y + body->halfSize.y + reach };
+
+	uint candidateCount = collision_grid_query(world->grid, scratch->candidates, scratch->capacity, queryMin, queryMax);
+	if (candidateCount > scratch->capacity)
+	{
+		uint* candidates = realloc(scratch->candidates, candidateCount * sizeof(uint));
+		if (candidates == NULL)
+		{
+			// the body stays where it is rather than moving through triangles it can't test
+			return;
+		}
+		scratch->candidates	= candidates;
+		scratch->capacity	= candidateCount;
+		candidateCount = collision_grid_query(world->grid, scratch->candidates, scratch->capacity, queryMin, queryMax);
+	}
+	const uint* candidates = scratch->candidates;
+
+	for (uint pass = 0; pass < COLLISION_MAX_PUSHOUTS; ++pass)
+	{
+		bool overlapped = false;
+		for (uint i = 0; i < candidateCount; ++i)
+		{
+			vec2 pushout;
+			if (collision_overlap_triangle(&pushout, &world->triangles[candidates[i]], body->center, body->halfSize))
+			{
+				const vec2 normal = vec2_normalize(pushout);
+				body->center = vec2_add(body->center, vec2_add(pushout, vec2_scale(normal, COLLISION_SKIN)));
+				body->contacts |= collision_contact_flags(normal);
+				overlapped = true;
+			}
+		}
+
+		if (!overlapped)
+		{
+			break;
+		}
+	}
+
+	vec2 remaining = body->delta;
+	for (uint slide = 0; slide < COLLISION_MAX_SLIDES; ++slide)
+	{
+		if (remaining.x == 0.0f && remaining.y == 0.0f)
+		{
+			break;
+		}
+
+		float hitTime = FLT_MAX;
+		vec2 hitNormal = { 0.0f, 0.0f };
+		for (uint i = 0; i < candidateCount; ++i)
+		{
+			float t;
+			vec2 normal;
+			if (collision_sweep_triangle(&t, &normal, &world->triangles[candidates[i]], body->center, body->halfSize, remaining) && t < hitTime)
+			{
+				hitTime		= t;
+				hitNormal	= normal;
+			}
+		}
+
+		if (hitTime == FLT_MAX)
+		{
+			body->center = vec2_add(body->center, remaining);
+			break;
+		}
+
+		body->center = vec2_add(body->center, vec2_add(vec2_scale(remaining, hitTime), vec2_scale(hitNormal, COLLISION_SKIN)));
+		body->contacts |= collision_contact_flags(hitNormal);
+
+		// keep the part of the rest of the move that runs along the surface
+		remaining = vec2_scale(remaining, 1.0f - hitTime);
+		const float into = vec2_dot(remaining, hitNormal);
+		if (into < 0.0f)
+		{
+			remaining = vec2_sub(remaining, vec2_scale(hitNormal, into));
+		}
+	}
+}
+
+void collision_move_bodies(const collision_world_t* world, collision_scratch_t* scratch, collision_body_t* bodies, uint count)
+{
+	for (uint i = 0; i < count; ++i)
+	{
+		collision_move_body(world, scratch, &bodies[i]);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "types.h"
+#include "collision_grid.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// A triangle collider with its edge planes, built once when the colliders are. The normals point out of the
+// triangle whatever its winding, dot(normal[i], p) == dist[i] on edge i and the triangle spans [depth[i], dist[i]]
+// along normal[i]. A degenerate triangle has zero normals and never collides.
+typedef struct collision_triangle
+{
+	vec2	normal[3];
+	float	dist[3];
+	float	depth[3];
+	vec2	boundsMin;
+	vec2	boundsMax;
+} collision_triangle_t;
+
+_Static_assert(sizeof(collision_triangle_t) == 64);
+
+// The static geometry bodies move through. grid buckets the bounds of triangles, so its item indices index
+// into triangles.
+typedef struct collision_world
+{
+	const collision_triangle_t*	triangles;
+	const collision_grid_t*		grid;
+} collision_world_t;
+
+enum {
+	COLLISION_CONTACT_GROUND	= 1 << 0,
+	COLLISION_CONTACT_CEILING	= 1 << 1,
+	COLLISION_CONTACT_WALL		= 1 << 2,
+};
+
+// The COLLISION_CONTACT_* flag for a surface with this normal.
+uint collision_contact_flags(vec2 normal);
+
+typedef struct collision_body
+{
+	vec2	center;
+	vec2	halfSize;
+	vec2	delta;		// how far the body wants to move this tick
+	uint	contacts;	// COLLISION_CONTACT_* flags for the surfaces it hit, written by collision_move_bodies
+} collision_body_t;
+
+// A convex polygon with its outward edge normals, normal[i] belonging to the edge from pos[i] to pos[i + 1].
+typedef struct collision_polygon
+{
+	size_t		size;
+	const vec2*	pos;
+	const vec2*	normal;
+} collision_polygon_t;
+
+typedef struct collision_contact
+{
+	vec2	normal;			// from a to b
+	float	depth;
+	bool	referenceIsB;	// which polygon referenceEdge belongs to, incidentEdge is on the other
+	uint	referenceEdge;	// the edge the normal comes from
+	uint	incidentEdge;	// the edge on the other polygon facing it the most
+} collision_contact_t;
+
+// Returns the largest separation of b from any edge of a, which is negative when they overlap, and that edge.
+float collision_polygon_find_max_separation(uint* edgeIndexA, const collision_polygon_t* a, const collision_polygon_t* b);
+// Finds the edge of b whose normal faces edgeA of a the most.
+void collision_polygon_find_incident_edge(uint* incidentEdge, const collision_polygon_t* a, uint edgeA, const collision_polygon_t* b);
+// Returns true if the polygons overlap, with the axis of least penetration. The axis comes from a unless b's is
+// clearly better, so that it doesn't flip between the two when they're about the same.
+bool collision_polygon_collide(collision_contact_t* contact, const collision_polygon_t* a, const collision_polygon_t* b);
+
+void collision_triangle_build(collision_triangle_t* triangle, vec2 a, vec2 b, vec2 c);
+
+// The triangles a body's move is tested against, grown to fit the biggest grid query so far. Starts zeroed and is
+// kept from one call to collision_move_bodies to the next.
+typedef struct collision_scratch
+{
+	uint*	candidates;
+	uint	capacity;
+} collision_scratch_t;
+
+void collision_scratch_destroy(collision_scratch_t* scratch);
+
+// Moves each body by its delta, stopping where it first touches a triangle and sliding the rest of the way along
+// it. Bodies are swept, so they don't pass through geometry thinner than their step, and a body that starts inside
+// a triangle is first pushed out of it the shortest way. Bodies don't collide with each other.
+void collision_move_bodies(const collision_world_t* world, collision_scratch_t* scratch, collision_body_t* bodies, uint count);
@@ -0,0 +1,216 @@
+#include "collision_grid.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <assert.h>
+
+#define COLLISION_GRID_MAX_CELLS (1024 * 1024)
+
+static bool grow_array(void** array, uint* capacity, uint count, size_t elementSize)
+{
+	if (count <= *capacity)
+	{
+		return true;
+	}
+
+	uint newCapacity = *capacity > 0 ? *capacity : 64;
+	while (newCapacity < count)
+	{
+		newCapacity *= 2;
+	}
+
+	void* newArray = realloc(*array, newCapacity * elementSize);
+	if (newArray == NULL)
+	{
+		return false;
+	}
+
+	*array		= newArray;
+	*capacity	= newCapacity;
+	return true;
+}
+
+static int clampi(int min, int value, int max)
+{
+	if (value < min) value = min;
+	if (value > max) value = max;
+	return value;
+}
+
+static int2 collision_grid_cell(const collision_grid_t* grid, vec2 p)
+{
+	return (int2){
+		clampi(0, (int)floorf((p.x - grid->origin.x) / grid->cellSize), grid->size.x - 1),
+		clampi(0, (int)floorf((p.y - grid->origin.y) / grid->cellSize), grid->size.y - 1),
+	};
+}
+
+void collision_grid_destroy(collision_grid_t* grid)
+{
+	free(grid->itemMin);
+	free(grid->itemMax);
+	free(grid->cellStart);
+	free(grid->cellItems);
+	memset(grid, 0, sizeof(collision_grid_t));
+}
+
+int collision_grid_build(collision_grid_t* grid, const vec2* itemMin, const vec2* itemMax, uint itemCount, float cellSize)
+{
+	assert(cellSize > 0.0f);
+
+	grid->itemCount = 0;
+	grid->size		= (int2){0, 0};
+
+	if (itemCount == 0)
+	{
+		return 0;
+	}
+
+	// itemMin and itemMax grow in lockstep, so they share grid->itemCapacity
+	uint itemMinCapacity = grid->itemCapacity;
+	if (!grow_array((void**)&grid->itemMin, &itemMinCapacity, itemCount, sizeof(vec2)) ||
+		!grow_array((void**)&grid->itemMax, &grid->itemCapacity, itemCount, sizeof(vec2)))
+	{
+		return 1;
+	}
+
+	memcpy(grid->itemMin, itemMin, itemCount * sizeof(vec2));
+	memcpy(grid->itemMax, itemMax, itemCount * sizeof(vec2));
+	grid->itemCount = itemCount;
+
+	vec2 boundsMin = { FLT_MAX, FLT_MAX };
+	vec2 boundsMax = { -FLT_MAX, -FLT_MAX };
+	for (uint i = 0; i < itemCount; ++i)
+	{
+		boundsMin.x = fminf(boundsMin.x, itemMin[i].x);
+		boundsMin.y = fminf(boundsMin.y, itemMin[i].y);
+		boundsMax.x = fmaxf(boundsMax.x, itemMax[i].x);
+		boundsMax.y = fmaxf(boundsMax.y, itemMax[i].y);
+	}
+
+	// keep the cell count bounded for very large levels
+	const float extentX = boundsMax.x - boundsMin.x;
+	const float extentY = boundsMax.y - boundsMin.y;
+	while ((extentX / cellSize + 1.0f) * (extentY / cellSize + 1.0f) > COLLISION_GRID_MAX_CELLS)
+	{
+		cellSize *= 2.0f;
+	}
+
+	grid->origin	= boundsMin;
+	grid->cellSize	= cellSize;
+	grid->size.x	= (int)(extentX / cellSize) + 1;
+	grid->size.y	= (int)(extentY / cellSize) + 1;
+
+	const uint cellCount = grid->size.x * grid->size.y;
+	if (!grow_array((void**)&grid->cellStart, &grid->cellCapacity, cellCount + 1, sizeof(uint)))
+	{
+		grid->itemCount = 0;
+		return 1;
+	}
+	memset(grid->cellStart, 0, (cellCount + 1) * sizeof(uint));
+
+	// count items per cell
+	uint cellItemCount = 0;
+	for (uint i = 0; i < itemCount; ++i)
+	{
+		const int2 c0 = collision_grid_cell(grid, itemMin[i]);
+		const int2 c1 = collision_grid_cell(grid, itemMax[i]);
+
+		for (int y = c0.y; y <= c1.y; ++y)
+		{
+			for (int x = c0.x; x <= c1.x; ++x)
+			{
+				++grid->cellStart[x + y * grid->size.x + 1];
+			}
+		}
+
+		cellItemCount += (c1.x - c0.x + 1) * (c1.y - c0.y + 1);
+	}
+
+	if (!grow_array((void**)&grid->cellItems, &grid->cellItemCapacity, cellItemCount, sizeof(uint)))
+	{
+		grid->itemCount = 0;
+		return 1;
+	}
+
+	for (uint i = 0; i < cellCount; ++i)
+	{
+		grid->cellStart[i + 1] += grid->cellStart[i];
+	}
+
+	// scatter, using cellStart[cell] as the write cursor and restoring it afterwards
+	for (uint i = 0; i < itemCount; ++i)
+	{
+		const int2 c0 = collision_grid_cell(grid, itemMin[i]);
+		const int2 c1 = collision_grid_cell(grid, itemMax[i]);
+
+		for (int y = c0.y; y <= c1.y; ++y)
+		{
+			for (int x = c0.x; x <= c1.x; ++x)
+			{
+				grid->cellItems[grid->cellStart[x + y * grid->size.x]++] = i;
+			}
+		}
+	}
+
+	for (uint i = cellCount; i > 0; --i)
+	{
+		grid->cellStart[i] = grid->cellStart[i - 1];
+	}
+	grid->cellStart[0] = 0;
+
+	return 0;
+}
+
+uint collision_grid_query(const collision_grid_t* grid, uint* items, uint maxItems, vec2 aabbMin, vec2 aabbMax)
+{
+	if (grid->itemCount == 0)
+	{
+		return 0;
+	}
+
+	const int2 q0 = collision_grid_cell(grid, aabbMin);
+	const int2 q1 = collision_grid_cell(grid, aabbMax);
+
+	uint count = 0;
+
+	for (int y = q0.y; y <= q1.y; ++y)
+	{
+		for (int x = q0.x; x <= q1.x; ++x)
+		{
+			const uint cellIndex = x + y * grid->size.x;
+
+			for (uint j = grid->cellStart[cellIndex]; j < grid->cellStart[cellIndex + 1]; ++j)
+			{
+				const uint item = grid->cellItems[j];
+				const vec2 itemMin = grid->itemMin[item];
+				const vec2 itemMax = grid->itemMax[item];
+
+				if (itemMin.x > aabbMax.x || itemMax.x < aabbMin.x ||
+					itemMin.y > aabbMax.y || itemMax.y < aabbMin.y)
+				{
+					continue;
+				}
+
+				// an item spanning several queried cells is only reported from the first cell of the overlap
+				const int2 c0 = collision_grid_cell(grid, itemMin);
+				if (x != (c0.x > q0.x ? c0.x : q0.x) ||
+					y != (c0.y > q0.y ? c0.y : q0.y))
+				{
+					continue;
+				}
+
+				if (count < maxItems)
+				{
+					items[count] = item;
+				}
+				++count;
+			}
+		}
+	}
+
+	return count;
+}
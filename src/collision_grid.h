@@ -0,0 +1,30 @@
+#pragma once
+
+#include "types.h"
+
+// Uniform grid over axis-aligned bounding boxes. Items are bucketed into every
+// cell their bounds overlap and stored in one flat array indexed by cellStart.
+typedef struct collision_grid
+{
+	vec2	origin;
+	float	cellSize;
+	int2	size;
+
+	uint	itemCount;
+	uint	itemCapacity;
+	vec2*	itemMin;
+	vec2*	itemMax;
+
+	uint	cellCapacity;
+	uint*	cellStart;		// size.x * size.y + 1 entries
+	uint	cellItemCapacity;
+	uint*	cellItems;
+} collision_grid_t;
+
+void collision_grid_destroy(collision_grid_t* grid);
+
+int collision_grid_build(collision_grid_t* grid, const vec2* itemMin, const vec2* itemMax, uint itemCount, float cellSize);
+
+// Writes up to maxItems indices of items whose bounds overlap [aabbMin, aabbMax], each at most once.
+// Returns the total number of overlapping items, which may exceed maxItems.
+uint collision_grid_query(const collision_grid_t* grid, uint* items, uint maxItems, vec2 aabbMin, vec2 aabbMax);
@@ -11,7 +11,7 @@ int descriptor_set_cache_create(descriptor_set_cache_t* cache, VkDescriptorPool
 	cache->pool = pool;
 	cache->capacity = maxEntries;
 
-	cache->frameIds = malloc(maxEntries * sizeof(uint32_t));
+	cache->frameIds = malloc(maxEntries * sizeof(uint64_t));
 	cache->layouts = malloc(maxEntries * sizeof(VkDescriptorSetLayout));
 	cache->sets = malloc(maxEntries * sizeof(VkDescriptorSet));
 
@@ -125,7 +125,7 @@ void editor_window_event(editor_t* editor, const window_event_t* event)
 			{
 				if (editor->closestPolygon != NULL)
 				{
-					if (editor->insertMode)
+					if (editor->insertMode && editor_polygon_reserve(editor->closestPolygon, editor->closestPolygon->vertexCount + 1))
 					{
 						for (int i = editor->closestPolygon->vertexCount - 1; i > editor->closestVertex; --i)
 						{
@@ -136,6 +136,8 @@ void editor_window_event(editor_t* editor, const window_event_t* event)
 
 						editor->editPolygon	= editor->closestPolygon;
 						editor->editVertex	= editor->closestVertex + 1;
+
+						world_mark_polygon_dirty(editor->world, editor->editPolygon);
 					}
 					else
 					{
@@ -186,6 +188,8 @@ void editor_window_event(editor_t* editor, const window_event_t* event)
 				assert(hit);
 				const vec3 hitPosition = vec3_add(origin, vec3_scale(direction, hitDistance));
 				editor->editPolygon->vertexPosition[editor->editVertex] = vec3_xy(hitPosition);
+
+				world_mark_polygon_dirty(editor->world, editor->editPolygon);
 			}
 			break;
 		case WINDOW_EVENT_KEY_DOWN:
@@ -203,6 +207,7 @@ void editor_window_event(editor_t* editor, const window_event_t* event)
 						editor->editPolygon->vertexPosition[i] = editor->editPolygon->vertexPosition[i + 1];
 					}
 
+					world_mark_polygon_dirty(editor->world, editor->editPolygon);
 					editor->editPolygon = NULL;
 				}
 			}
@@ -241,7 +246,7 @@ void editor_window_event(editor_t* editor, const window_event_t* event)
 	}
 }
 
-void editor_render(scb_t* scb, editor_t* editor, uint2 resolution)
+void editor_update(editor_t* editor, uint2 resolution)
 {
 	editor->resolution = resolution;
 
@@ -254,21 +259,25 @@ void editor_render(scb_t* scb, editor_t* editor, uint2 resolution)
 	uint32_t visibleLayerMask = 0xffffffffu;
 	visibleLayerMask &= ~((1 << editor->firstVisibleLayer) - 1);
 	world_set_visible_layers(editor->world, visibleLayerMask);
+	world_set_focus(editor->world, editor->camera.pos);
 
 	editor->closestPolygon = NULL;
 	float closestDistance = FLT_MAX;
 
-	for (int polygonIndex = editor->firstVisibleLayer; polygonIndex < worldInfo.polygonCount; ++polygonIndex)
+	for (int polygonIndex = 0; polygonIndex < worldInfo.polygonCount; ++polygonIndex)
 	{
 		editor_polygon_t* polygon = worldInfo.polygons[polygonIndex];
+		if ((int)polygon->layer < editor->firstVisibleLayer)
+		{
+			continue;
+		}
 		const float polygonDepth = world_get_parallax_layer_depth(polygon->layer);
 		
 		const vec2 mouseUv = { editor->mousePos.x / (float)resolution.x, editor->mousePos.y / (float)resolution.y };
 		const editor_camera_t* camera = &editor->camera;
 
-		triangle_t triangles[256];
 		size_t triangleCount;
-		editor_polygon_triangulate(triangles, &triangleCount, polygon);
+		const triangle_t* triangles = editor_polygon_get_triangles(polygon, &triangleCount);
 
 		bool isMouseInsideTriangle = false;
 
@@ -385,6 +394,17 @@ void editor_render(scb_t* scb, editor_t* editor, uint2 resolution)
 		}
 	}
 
+	if (editor->mouseDragging)
+	{
+		const vec2 dragDelta = vec2_sub(editor->mouseDragOrigin, editor->mouseDragTarget);
+		editor->camera.pos = vec2_add(editor->camera.origin, dragDelta);
+	}
+}
+
+void editor_render(scb_t* scb, editor_t* editor, uint2 resolution)
+{
+	editor_update(editor, resolution);
+
 	if (editor->editPolygon != NULL)
 	{
 		editor_polygon_debug_draw(editor->editPolygon);
@@ -414,12 +434,6 @@ void editor_render(scb_t* scb, editor_t* editor, uint2 resolution)
 		}
 	}
 
-	if (editor->mouseDragging)
-	{
-		const vec2 dragDelta = vec2_sub(editor->mouseDragOrigin, editor->mouseDragTarget);
-		editor->camera.pos = vec2_add(editor->camera.origin, dragDelta);
-	}
-	
 	DrawDebugPoint((debug_vertex_t){.x = editor->mouseDragOrigin.x, .y = editor->mouseDragOrigin.y, .color = 0xff0000ff});
 
 	calculate_camera(scb_set_camera(scb), &editor->camera);
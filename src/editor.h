@@ -10,4 +10,7 @@ editor_t* editor_create(world_t* world);
 void editor_destroy(editor_t* editor);
 
 void editor_window_event(editor_t* editor, const window_event_t* event);
+// Picks the polygon under the mouse and points the world's streaming at the camera, once a frame. editor_render
+// does this first, so it's only needed on its own when nothing is drawn.
+void editor_update(editor_t* editor, uint2 resolution);
 void editor_render(scb_t* scb, editor_t* editor, uint2 resolution);
\ No newline at end of file
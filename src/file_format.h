@@ -37,4 +37,75 @@ typedef struct FILEFORMAT_game_resource_header
 typedef struct FILEFORMAT_game_resource_model_entry
 {
 	uint64_t	headerOffset;
-} FILEFORMAT_game_resource_model_entry_t;
\ No newline at end of file
+} FILEFORMAT_game_resource_model_entry_t;
+
+// world.bin: a header, then a table with one entry per chunk, then the chunk data. Every chunk's data is a
+// run of FILEFORMAT_world_polygon_t, each followed by vertexCount vec2 positions. Offsets are in bytes from
+// the start of the file, and all checksums are fnv1a64.
+#define FILEFORMAT_world_MAGIC		0x444c5257u // "WRLD"
+#define FILEFORMAT_world_VERSION	1
+
+typedef struct FILEFORMAT_world_header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	chunkCount;
+	uint32_t	polygonCount;
+	uint64_t	fileSize;
+	uint64_t	chunkTableChecksum;
+	uint64_t	headerChecksum; // of everything above
+} FILEFORMAT_world_header_t;
+
+typedef struct FILEFORMAT_world_chunk
+{
+	uint32_t	layer;
+	int32_t		cellX;
+	int32_t		cellY;
+	uint32_t	polygonCount;
+	vec2		boundsMin;
+	vec2		boundsMax;
+	uint64_t	dataOffset;
+	uint64_t	dataSize;
+	uint64_t	checksum;
+} FILEFORMAT_world_chunk_t;
+
+typedef struct FILEFORMAT_world_polygon
+{
+	uint32_t	vertexCount;
+} FILEFORMAT_world_polygon_t;
+
+_Static_assert(sizeof(FILEFORMAT_world_header_t) == 40, "");
+_Static_assert(sizeof(FILEFORMAT_world_chunk_t) == 56, "");
+
+// A recording of the input the game and editor were fed and of when the fixed ticks and frames ran, so a session
+// can be replayed exactly. A header, then the records back to back, each a tag byte followed by its payload. Ints
+// in payloads are LEB128 varints, zigzag encoded when signed.
+#define FILEFORMAT_replay_MAGIC		0x594c5052u // "RPLY"
+#define FILEFORMAT_replay_VERSION	1
+
+enum
+{
+	// a frame, after as many ticks as the tag's value. Most frames run a tick or two, so they take a byte.
+	FILEFORMAT_replay_TAG_FRAME			= 0x00,
+	FILEFORMAT_replay_TAG_FRAME_MAX		= 0x7f,
+	// varint tick count, for ticks that aren't followed by a frame right away
+	FILEFORMAT_replay_TAG_TICKS			= 0x80,
+	// varint width and height the following ticks and frames ran at
+	FILEFORMAT_replay_TAG_RESOLUTION	= 0x81,
+	// ORed with the window_event_type, followed by the event's fields: the key code, the button and its position,
+	// the mouse position and delta, the scroll delta or the size
+	FILEFORMAT_replay_TAG_EVENT			= 0x90,
+};
+
+typedef struct FILEFORMAT_replay_header
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	tickCount;
+	uint32_t	frameCount;
+	uint64_t	fileSize;
+	uint64_t	recordChecksum; // of everything after the header
+	uint64_t	headerChecksum; // of everything above
+} FILEFORMAT_replay_header_t;
+
+_Static_assert(sizeof(FILEFORMAT_replay_header_t) == 40, "");
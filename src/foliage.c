@@ -0,0 +1,133 @@
+#include "foliage.h"
+#include "vec.h"
+#include "rng.h"
+#include "util.h"
+
+#include <math.h>
+#include <assert.h>
+
+#define FOLIAGE_PLANT_DENSITY 40.0f
+
+_Static_assert(PARALLAX_LAYER_COUNT <= 16, "gpu_foliage_instance_t stores the layer in 4 bits");
+
+static uint32_t pack_snorm16x2(vec2 v)
+{
+	const int32_t x = (int32_t)lrintf(clampf(-1.0f, v.x, 1.0f) * 32767.0f);
+	const int32_t y = (int32_t)lrintf(clampf(-1.0f, v.y, 1.0f) * 32767.0f);
+	return ((uint32_t)x & 0xffffu) | ((uint32_t)y << 16);
+}
+
+static uint32_t pack_foliage_params(float height, uint type, uint layer, uint seed)
+{
+	const uint32_t packedHeight = (uint32_t)lrintf(clampf(0.0f, height / FOLIAGE_MAX_HEIGHT, 1.0f) * 255.0f);
+	return packedHeight | (type << 8) | (layer << 9) | (seed << 13);
+}
+
+static uint32_t foliage_plant_count(vec2 p0, vec2 p1)
+{
+	const float len = vec2_length(vec2_sub(p1, p0));
+	return (uint32_t)(len * FOLIAGE_PLANT_DENSITY);
+}
+
+uint foliage_add_polygon_jobs(foliage_job_t* jobs, const editor_polygon_t* polygon, uint layer)
+{
+	uint jobCount = 0;
+
+	for (uint i = 0; i < polygon->vertexCount; ++i)
+	{
+		const uint j = (i + 1) % polygon->vertexCount;
+
+		const vec2 p0 = polygon->vertexPosition[i];
+		const vec2 p1 = polygon->vertexPosition[j];
+
+		const vec2 d = vec2_normalize(vec2_sub(p1, p0));
+		const vec2 n = {-d.y, d.x};
+		
+		if (n.y <= 0.0f)
+		{
+			continue;
+		}
+
+		// seeded from the edge itself, so editing one vertex only reshuffles the plants on its two edges
+		uint64_t hash = FNV1A64_OFFSET_BASIS;
+		hash = fnv1a64(&p0, sizeof(p0), hash);
+		hash = fnv1a64(&p1, sizeof(p1), hash);
+		hash = fnv1a64(&layer, sizeof(layer), hash);
+
+		jobs[jobCount++] = (foliage_job_t){
+			.p0				= p0,
+			.p1				= p1,
+			.layer			= layer,
+			.seed			= (uint)(hash ^ (hash >> 32)),
+			.instanceCount	= foliage_plant_count(p0, p1),
+		};
+	}
+
+	return jobCount;
+}
+
+uint32_t foliage_count_instances(const foliage_job_t* jobs, uint jobCount)
+{
+	uint32_t instanceCount = 0;
+	for (uint i = 0; i < jobCount; ++i)
+	{
+		instanceCount += jobs[i].instanceCount;
+	}
+	return instanceCount;
+}
+
+uint32_t foliage_prefix_sum(foliage_job_t* jobs, uint jobCount, uint32_t firstInstance)
+{
+	for (uint i = 0; i < jobCount; ++i)
+	{
+		jobs[i].firstInstance = firstInstance;
+		firstInstance += jobs[i].instanceCount;
+	}
+	return firstInstance;
+}
+
+typedef struct foliage_generate_context
+{
+	const foliage_job_t*	jobs;
+	gpu_foliage_instance_t*	instances;
+} foliage_generate_context_t;
+
+static void foliage_generate_job(void* userData, uint jobIndex)
+{
+	const foliage_generate_context_t* gen = userData;
+	const foliage_job_t* job = &gen->jobs[jobIndex];
+
+	gpu_foliage_instance_t* instances = gen->instances + job->firstInstance;
+
+	const vec2 d = vec2_normalize(vec2_sub(job->p1, job->p0));
+	const uint32_t tangent = pack_snorm16x2(d);
+
+	uint rng = job->seed;
+
+	for (uint32_t i = 0; i < job->instanceCount; ++i)
+	{
+		const float t = lcg_randf(&rng);
+
+		// the top bit, since the low bits of an lcg alternate
+		const uint type = lcg_rand(&rng) >> 31 ? FOLIAGE_TYPE_FLOWER : FOLIAGE_TYPE_GRASS;
+		const float height = type == FOLIAGE_TYPE_GRASS
+			? 0.1f + lcg_randf(&rng) * 0.5f
+			: 0.3f + lcg_randf(&rng) * 0.5f;
+		const uint seed = lcg_rand(&rng) >> 13;
+
+		instances[i] = (gpu_foliage_instance_t){
+			.root		= vec2_lerp(job->p0, job->p1, t),
+			.tangent	= tangent,
+			.params		= pack_foliage_params(height, type, job->layer, seed),
+		};
+	}
+}
+
+void foliage_generate(job_pool_t* pool, const foliage_job_t* jobs, uint jobCount, gpu_foliage_instance_t* instances)
+{
+	foliage_generate_context_t gen = {
+		.jobs		= jobs,
+		.instances	= instances,
+	};
+	job_pool_run(pool, foliage_generate_job, &gen, jobCount);
+}
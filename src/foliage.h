@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+#include "world.h"
+#include "job_pool.h"
+#include "../shaders/gpu_types.h"
+
+// One polygon edge worth of plants. Each job owns its random sequence, so jobs can run in any order on any
+// thread and still produce the same instances.
+typedef struct foliage_job
+{
+	vec2		p0;
+	vec2		p1;
+	uint		layer;
+	uint		seed;
+	uint32_t	instanceCount;
+
+	// filled in by foliage_prefix_sum
+	uint32_t	firstInstance;
+} foliage_job_t;
+
+// Appends a job for every upward facing edge of the polygon. jobs must have room for polygon->vertexCount
+// entries. Returns the number of jobs written.
+uint foliage_add_polygon_jobs(foliage_job_t* jobs, const editor_polygon_t* polygon, uint layer);
+
+uint32_t foliage_count_instances(const foliage_job_t* jobs, uint jobCount);
+
+// Lays the jobs out back to back starting at firstInstance, and returns the end of the range.
+uint32_t foliage_prefix_sum(foliage_job_t* jobs, uint jobCount, uint32_t firstInstance);
+
+// Writes every job's plants to instances[job->firstInstance...]. The world vertex shader expands them.
+void foliage_generate(job_pool_t* pool, const foliage_job_t* jobs, uint jobCount, gpu_foliage_instance_t* instances);
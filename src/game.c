@@ -5,6 +5,7 @@
 #include "rng.h"
 #include "intersection.h"
 #include "vec.h"
+#include "physics.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -16,11 +17,11 @@
 
 #define PLAYER_SPEED		0.006f
 #define PLAYER_SPEED_BOOST	4.0f
-#define PLAYER_GRAVITY		0.00005f
-//#define PLAYER_GRAVITY		0.000f
 #define PLAYER_JUMP_VEL		0.015f
 
-#define COLLISION_EPSILON	0.01f
+#define GAME_GRAVITY		0.00005f
+//#define GAME_GRAVITY		0.000f
+#define GAME_MAX_BODIES		1024
 
 typedef struct camera {
 	vec2	pos;
@@ -28,8 +29,8 @@ typedef struct camera {
 } camera_t;
 
 typedef struct player {
-	vec2	pos;
-	vec2	vel;
+	uint	body;
+	vec2	pos;	// bottom center, copied out of the body every tick
 	vec2	size;
 	bool	isGrounded;
 	vec2	lastFootstep;
@@ -44,6 +45,7 @@ typedef struct game {
 	world_t*				world;
 	wind_t*					wind;
 	particles_t*			particles;
+	physics_t*				physics;
 	window_t*				window;
 	const model_loader_t*	modelLoader;
 	int						state;
@@ -72,11 +74,24 @@ game_t* game_create(window_t* window, const model_loader_t* modelLoader, world_t
 	game->window		= window;
 	game->modelLoader	= modelLoader;
 
+	game->physics = physics_create(GAME_MAX_BODIES, GAME_GRAVITY);
+	if (game->physics == NULL) {
+		free(game);
+		return NULL;
+	}
+
 	game->player = (player_t){
 		.pos = {2.0f, 0.1f},
 		.size = {0.5f, 1.0f},
 	};
 
+	game->player.body = physics_add_body(game->physics, &(physics_body_desc_t){
+		.center			= {game->player.pos.x, game->player.pos.y + game->player.size.y * 0.5f},
+		.halfSize		= vec2_scale(game->player.size, 0.5f),
+		.mass			= 1.0f,
+		.gravityScale	= 1.0f,
+	});
+
 	game->camera = (camera_t){
 		.height = 8.0f,
 	};
@@ -86,6 +101,7 @@ game_t* game_create(window_t* window, const model_loader_t* modelLoader, world_t
 
 void game_destroy(game_t* game)
 {
+	physics_destroy(game->physics);
 	free(game);
 }
 
@@ -152,14 +168,12 @@ static void TickPlayerMovement(game_t* game, float deltaTime)
 		speed *= PLAYER_SPEED_BOOST;
 	}
 
-	game->player.pos.x += moveX * speed;
-	game->player.pos.y += moveY * speed;
-
-	game->player.vel.x = moveX * speed;
+	physics_move(game->physics, game->player.body, (vec2){moveX * speed, moveY * speed});
 
 	if (game->keystate[KEY_SPACE] && game->player.isGrounded)
 	{
-		game->player.vel.y = PLAYER_JUMP_VEL;
+		const vec2 vel = physics_get_vel(game->physics, game->player.body);
+		physics_set_vel(game->physics, game->player.body, (vec2){vel.x, PLAYER_JUMP_VEL});
 	}
 }
 
@@ -188,66 +202,6 @@ static float fsign(float x)
 	else return -1.0f;
 }
 
-typedef struct collision_polygon
-{
-	size_t		size;
-	const vec2*	pos;
-	const vec2*	normal;
-} collision_polygon_t;
-
-static float collision_polygon_find_max_separation(uint* edgeIndexA, const collision_polygon_t* a, const collision_polygon_t* b)
-{
-	float	maxSeparation = -FLT_MAX;
-	uint	maxIndex;
-	
-	for (size_t indexA = 0; indexA < a->size; ++indexA)
-	{
-		const vec2 posA = a->pos[indexA];
-		const vec2 normalA = a->normal[indexA];
-		
-		float deepestDistance = FLT_MAX;
-		for (size_t indexB = 0; indexB < b->size; ++indexB)
-		{
-			const vec2 posB = b->pos[indexB];
-			
-			const float d = vec2_dot(normalA, vec2_sub(posB, posA));
-			if (d < deepestDistance)
-			{
-				deepestDistance = d;
-			}
-		}
-
-		if (deepestDistance > maxSeparation)
-		{
-			maxSeparation	= deepestDistance;
-			maxIndex		= indexA;
-		}
-	}
-
-	*edgeIndexA = maxIndex;
-	return maxSeparation;
-}
-
-static void collision_polygon_find_incident_edge(uint* incidentEdge, const collision_polygon_t* a, uint edgeA, const collision_polygon_t* b)
-{
-	const vec2 normalA = a->normal[edgeA];
-	
-	uint minIndex;
-	float minDot = FLT_MAX;
-
-	for (size_t i = 0; i < b->size; ++i)
-	{
-		const float d = vec2_dot(normalA, b->normal[i]);
-		if (d < minDot)
-		{
-			minDot		= d;
-			minIndex	= i;
-		}
-	}
-	
-	*incidentEdge = minIndex;
-}
-
 void game_tick(game_t* game, uint2 resolution)
 {
 	int r;
@@ -284,250 +238,20 @@ void game_tick(game_t* game, uint2 resolution)
 	{
 		player_t* player = &game->player;
 
-		player->isGrounded = false;
-
-		player->vel.y -= PLAYER_GRAVITY * DELTA_TIME_MS;
-		//player->pos = vec2_add(player->pos, vec2_scale(player->vel, deltaTime));
-		player->pos.y = player->pos.y + player->vel.y * DELTA_TIME_MS;
-
-		world_collision_info_t worldCollision;
-		world_get_collision_info(&worldCollision, game->world);
-		
-#if 0
-		const vec2 playerCorners[4] =
-		{
-			{player->pos.x - player->size.x * 0.5f, player->pos.y + player->size.y},
-			{player->pos.x + player->size.x * 0.5f, player->pos.y + player->size.y},
-			{player->pos.x + player->size.x * 0.5f, player->pos.y},
-			{player->pos.x - player->size.x * 0.5f, player->pos.y},
-		};
-		
-		const vec2 playerNormals[4] =
-		{
-			{0.0f,  1.0f},
-			{1.0f,  0.0f},
-			{0.0f, -1.0f},
-			{-1.0f, 0.0f},
-		};
-		
-		const collision_polygon_t playerPolygon = {
-			.size = 4,
-			.pos = playerCorners,
-			.normal = playerNormals,
-		};
-		
-		for (uint triangleIndex = 0; triangleIndex < worldCollision.triangleCount; ++triangleIndex)
-		{
-			const triangle_collider_t* triangle = &worldCollision.triangles[triangleIndex];
-
-			const vec2 triangleEdges[][2] = {
-				{triangle->a, triangle->b},
-				{triangle->b, triangle->c},
-				{triangle->c, triangle->a},
-			};
-
-			vec2 triangleNormals[3];
-			//vec3 planes[3];
-			
-			for (size_t i = 0; i < countof(triangleEdges); ++i)
-			{
-				const vec2 a = triangleEdges[i][0];
-				const vec2 b = triangleEdges[i][1];
-
-				const vec2 d = vec2_normalize(vec2_sub(b, a));
-				const vec2 normal = {-d.y, d.x};
-				
-#if 0
-				const vec2 center = vec2_scale(vec2_add(a, b), 0.5f);
-				DrawDebugLine(
-					(debug_vertex_t){.x = center.x, .y = center.y, .color = 0xffff00ff},
-					(debug_vertex_t){.x = center.x + normal.x * 0.3f, .y = center.y + normal.y * 0.3f, .color = 0xffff00ff}
-				);
-#endif
-
-				//planes[i] = (vec3){ normal.x, normal.y, vec2_dot(normal, a) };
-				triangleNormals[i] = normal;
-			}
-
-			const collision_polygon_t trianglePolygon = {
-				.size = 3,
-				.pos = &triangle->a,
-				.normal = triangleNormals,
-			};
-
-			uint separationIndexA;
-			uint separationIndexB;
-			const float separationA = collision_polygon_find_max_separation(&separationIndexA, &playerPolygon, &trianglePolygon);
-			const float separationB = collision_polygon_find_max_separation(&separationIndexB, &trianglePolygon, &playerPolygon);
-
-			if (separationA > COLLISION_EPSILON || separationB > COLLISION_EPSILON)
-			{
-				continue;
-			}
-			
-			const collision_polygon_t* poly1;	// reference polygon
-			const collision_polygon_t* poly2;	// incident polygon
-			uint edge1;							// reference edge
-
-			if (separationB > separationA + 1e-3)
-			{
-				poly1 = &trianglePolygon;
-				poly2 = &playerPolygon;
-				edge1 = separationIndexB;
-			}
-			else
-			{
-				poly1 = &playerPolygon;
-				poly2 = &trianglePolygon;
-				edge1 = separationIndexA;
-			}
-			
-			uint incidentEdge;
-			collision_polygon_find_incident_edge(&incidentEdge, poly1, edge1, poly2);
-
-#if 1
-			{
-				const vec2 a = poly2->pos[incidentEdge];
-				const vec2 b = poly2->pos[(incidentEdge + 1) % poly2->size];
-
-				DrawDebugPoint((debug_vertex_t){.x = a.x, .y = a.y, .color = 0xff0000ff});
-				DrawDebugPoint((debug_vertex_t){.x = b.x, .y = b.y, .color = 0xff0000ff});
-			}
-
-			{
-				const vec2 a = playerPolygon.pos[separationIndexA];
-				const vec2 b = playerPolygon.pos[(separationIndexA + 1) % playerPolygon.size];
-
-				DrawDebugLine(
-					(debug_vertex_t){.x = a.x, .y = a.y, .color = 0xffffff00},
-					(debug_vertex_t){.x = b.x, .y = b.y, .color = 0xffffff00}
-				);
-			}
-			{
-				const vec2 a = trianglePolygon.pos[separationIndexB];
-				const vec2 b = trianglePolygon.pos[(separationIndexB + 1) % trianglePolygon.size];
-
-				DrawDebugLine(
-					(debug_vertex_t){.x = a.x, .y = a.y, .color = 0xffff00ff},
-					(debug_vertex_t){.x = b.x, .y = b.y, .color = 0xffff00ff}
-				);
-			}
-#endif
-		}
-
-#else
-		for (size_t triangleIndex = 0; triangleIndex < worldCollision.triangleCount; ++triangleIndex)
-		{
-			const triangle_collider_t* triangle = &worldCollision.triangles[triangleIndex];
-
-			const vec2 corners[4] = 
-			{
-				{player->pos.x - player->size.x * 0.5f, player->pos.y},
-				{player->pos.x + player->size.x * 0.5f, player->pos.y},
-				{player->pos.x - player->size.x * 0.5f, player->pos.y + player->size.y},
-				{player->pos.x + player->size.x * 0.5f, player->pos.y + player->size.y},
-			};
-			
-			const vec2 playerCenter = {player->pos.x, player->pos.y + player->size.y * 0.5f};
-			DrawDebugPoint((debug_vertex_t){.x = playerCenter.x, .y = playerCenter.y, .color = 0xffffff00});
-			
-			const vec2 edges[][2] = {
-				{triangle->a, triangle->b},
-				{triangle->b, triangle->c},
-				{triangle->c, triangle->a},
-			};
-
-			vec3 planes[3];
-			
-			for (size_t edgeIndex = 0; edgeIndex < countof(edges); ++edgeIndex)
-			{
-				const vec2 a = edges[edgeIndex][0];
-				const vec2 b = edges[edgeIndex][1];
-
-				const vec2 d = vec2_normalize(vec2_sub(b, a));
-				const vec2 normal = {-d.y, d.x};
-				
-#if 0
-				const vec2 center = vec2_scale(vec2_add(a, b), 0.5f);
-				DrawDebugLine(
-					(debug_vertex_t){.x = center.x, .y = center.y, .color = 0xffff00ff},
-					(debug_vertex_t){.x = center.x + normal.x * 0.3f, .y = center.y + normal.y * 0.3f, .color = 0xffff00ff}
-				);
-#endif
+		collision_world_t collisionWorld;
+		world_get_collision_world(&collisionWorld, game->world);
+		physics_tick(game->physics, &collisionWorld, DELTA_TIME_MS);
 
-				planes[edgeIndex] = (vec3){ normal.x, normal.y, vec2_dot(normal, a) };
-			}
-			
-			vec2 maxPushout;
-			float maxPushoutDistance = FLT_MAX;
-			
-			for (size_t cornerIndex = 0; cornerIndex < 4; ++cornerIndex)
-			{
-				const vec2 corner = corners[cornerIndex];
-				
-				float maxDistance = -FLT_MAX;
-				uint32_t closestEdge = 0;
-				
-				uint32_t intersectionCount = 0;
-				for (size_t edgeIndex = 0; edgeIndex < countof(edges); ++edgeIndex)
-				{
-					const vec3 plane = planes[edgeIndex];
-					const float d = vec2_dot(vec3_xy(plane), corner) - plane.z;
-					if (d < 0.0f)
-					{
-						++intersectionCount;
-
-						const float playerCenterDistance = vec2_dot(vec3_xy(plane), playerCenter) - plane.z;
-
-						if (d > maxDistance && playerCenterDistance > 0.0f)
-						{
-							maxDistance	= d;
-							closestEdge	= edgeIndex;
-						}
-					}
-				}
-
-				bool hasCollision = intersectionCount == 3;
-
-				const uint32_t color = hasCollision ? 0xff0000ff : 0xff00ffff;
-				//DrawDebugPoint((debug_vertex_t){.x = corner.x, .y = corner.y, .color = color});
-				
-				if (hasCollision)
-				{
-					assert(maxDistance != -FLT_MAX);
-
-					const vec3 plane = planes[closestEdge];
-					const vec2 n = vec3_xy(plane);
-					const vec2 pushout = vec2_scale(n, -maxDistance);
-					const vec2 target = vec2_add(corner, pushout);
-
-					DrawDebugLine(
-						(debug_vertex_t){.x = corner.x, .y = corner.y, .color = 0xff0000ff},
-						(debug_vertex_t){.x = target.x, .y = target.y, .color = 0xff0000ff}
-					);
-
-					DrawDebugPoint((debug_vertex_t){.x = target.x, .y = target.y, .color = color});
-
-					if (maxDistance < maxPushoutDistance)
-					{
-						maxPushoutDistance	= maxDistance;
-						maxPushout			= pushout;
-					}
-				}
-			}
-
-			if (maxPushoutDistance != FLT_MAX)
-			{
-				player->pos			= vec2_add(player->pos, maxPushout);
-				player->vel.y		= 0.0f;
-				player->isGrounded	= true;
-			}
-		}
-#endif
+		const vec2 center = physics_get_center(game->physics, player->body);
+		player->pos			= (vec2){center.x, center.y - player->size.y * 0.5f};
+		player->isGrounded	= (physics_get_contacts(game->physics, player->body) & COLLISION_CONTACT_GROUND) != 0;
 	}
 
 	game->camera.pos = vec2_lerp(game->camera.pos, (vec2){game->player.pos.x, game->player.pos.y + game->player.size.y * 0.5f}, 0.1f);
 
+	// set every tick rather than when rendering, so a game that's only ticked streams its chunks the same way
+	world_set_focus(game->world, game->camera.pos);
+
 	{
 		const vec2 vel = vec2_sub(game->player.pos, prevPlayerPos);
 
@@ -545,6 +269,24 @@ void game_tick(game_t* game, uint2 resolution)
 	return;
 }
 
+vec2 game_get_player_pos(const game_t* game)
+{
+	return game->player.pos;
+}
+
+uint64_t game_hash_state(const game_t* game, uint64_t hash)
+{
+	const player_t* player = &game->player;
+	const vec2 center = physics_get_center(game->physics, player->body);
+	const vec2 vel = physics_get_vel(game->physics, player->body);
+
+	hash = fnv1a64(&center, sizeof(center), hash);
+	hash = fnv1a64(&vel, sizeof(vel), hash);
+	hash = fnv1a64(&player->isGrounded, sizeof(player->isGrounded), hash);
+	hash = fnv1a64(&player->lastFootstep, sizeof(player->lastFootstep), hash);
+	return fnv1a64(&game->camera, sizeof(game->camera), hash);
+}
+
 int game_render(scb_t* scb, game_t* game)
 {
 	scb_point_light_t* point_light;
@@ -8,9 +8,14 @@
 
 typedef struct game game_t;
 
+// window and modelLoader may be NULL for a game that's only ticked, never rendered.
 game_t* game_create(window_t* window, const model_loader_t* modelLoader, world_t* world, wind_t* wind, particles_t* particles);
 void game_destroy(game_t* game);
 
 int game_window_event(game_t* game, const window_event_t* event);
 void game_tick(game_t* game, uint2 resolution);
+// Where the player's feet are.
+vec2 game_get_player_pos(const game_t* game);
+// Continues an fnv1a64 hash with the player and camera, for checking that two runs simulated the same thing.
+uint64_t game_hash_state(const game_t* game, uint64_t hash);
 int game_render(scb_t* scb, game_t* game);
@@ -0,0 +1,324 @@
+#include "headless.h"
+#include "world.h"
+#include "game.h"
+#include "wind.h"
+#include "particles.h"
+#include "editor.h"
+#include "window.h"
+#include "delta_time.h"
+#include "common.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define KEY_BIT(Key) (1u << (Key))
+
+// Keys held down for a number of ticks. The script repeats once it runs out, and walks as far left as right so
+// the player wanders around where it starts instead of off the end of the world.
+typedef struct headless_input_step
+{
+	uint	tickCount;
+	uint	keys;
+} headless_input_step_t;
+
+static const headless_input_step_t g_headlessScript[] = {
+	{ 30,	0 },
+	{ 60,	KEY_BIT(KEY_A) },
+	{ 20,	KEY_BIT(KEY_A) | KEY_BIT(KEY_SPACE) },
+	{ 60,	KEY_BIT(KEY_D) },
+	{ 20,	KEY_BIT(KEY_D) | KEY_BIT(KEY_SPACE) },
+	{ 8,	KEY_BIT(KEY_A) | KEY_BIT(KEY_SHIFT) },
+	{ 8,	KEY_BIT(KEY_D) | KEY_BIT(KEY_SHIFT) },
+};
+
+static const char* g_headlessSubsystemNames[HEADLESS_SUBSYSTEM_COUNT] = {
+	"world_update",
+	"world_tick",
+	"game_tick",
+	"wind_tick",
+	"particles_tick",
+	"editor_update",
+};
+
+static uint headless_script_keys(uint tick)
+{
+	uint scriptLength = 0;
+	for (uint i = 0; i < countof(g_headlessScript); ++i)
+	{
+		scriptLength += g_headlessScript[i].tickCount;
+	}
+
+	tick %= scriptLength;
+	for (uint i = 0; i < countof(g_headlessScript); ++i)
+	{
+		if (tick < g_headlessScript[i].tickCount)
+		{
+			return g_headlessScript[i].keys;
+		}
+		tick -= g_headlessScript[i].tickCount;
+	}
+
+	assert(false);
+	return 0;
+}
+
+typedef struct headless_sim
+{
+	world_t*			world;
+	game_t*				game;
+	editor_t*			editor;
+	wind_t*				wind;
+	particles_t*		particles;
+	bool				editing;
+	replay_writer_t*	record;
+	headless_result_t*	result;
+	delta_timer_t		timer;
+} headless_sim_t;
+
+static void headless_capture(headless_sim_t* sim, headless_subsystem_t subsystem)
+{
+	double deltaTime, elapsedTime;
+	delta_timer_capture(&deltaTime, &elapsedTime, &sim->timer);
+
+	headless_result_t* result = sim->result;
+	result->totalMs[subsystem] += deltaTime;
+	if (deltaTime > result->worstMs[subsystem])
+	{
+		result->worstMs[subsystem] = deltaTime;
+	}
+}
+
+// Routes the event the way the main loop does, where F1 switches between the game and the editor.
+static void headless_event(headless_sim_t* sim, const window_event_t* event)
+{
+	if (sim->record != NULL)
+	{
+		replay_writer_event(sim->record, event);
+	}
+
+	if (event->type == WINDOW_EVENT_KEY_DOWN && event->data.key.code == KEY_F1)
+	{
+		sim->editing = !sim->editing;
+	}
+
+	if (sim->editing)
+	{
+		editor_window_event(sim->editor, event);
+	}
+	else
+	{
+		game_window_event(sim->game, event);
+	}
+}
+
+// Sends the key events that take the game from the keys held last tick to this tick's.
+static void headless_send_keys(headless_sim_t* sim, uint prevKeys, uint keys)
+{
+	for (uint key = 0; key < 32; ++key)
+	{
+		const uint bit = KEY_BIT(key);
+		if ((prevKeys ^ keys) & bit)
+		{
+			const window_event_t event = {
+				.type = (keys & bit) ? WINDOW_EVENT_KEY_DOWN : WINDOW_EVENT_KEY_UP,
+				.data.key.code = key,
+			};
+			headless_event(sim, &event);
+		}
+	}
+}
+
+static void headless_tick(headless_sim_t* sim, uint2 resolution)
+{
+	if (sim->record != NULL)
+	{
+		replay_writer_tick(sim->record, resolution);
+	}
+
+	delta_timer_reset(&sim->timer);
+
+	world_tick(sim->world);
+	headless_capture(sim, HEADLESS_WORLD_TICK);
+
+	if (!sim->editing)
+	{
+		game_tick(sim->game, resolution);
+		headless_capture(sim, HEADLESS_GAME_TICK);
+	}
+
+	wind_tick(sim->wind);
+	headless_capture(sim, HEADLESS_WIND_TICK);
+
+	particles_tick(sim->particles);
+	headless_capture(sim, HEADLESS_PARTICLES_TICK);
+
+	++sim->result->tickCount;
+}
+
+// What the main loop does once a frame besides drawing.
+static void headless_frame(headless_sim_t* sim, uint2 resolution)
+{
+	if (sim->record != NULL)
+	{
+		replay_writer_frame(sim->record, resolution);
+	}
+
+	delta_timer_reset(&sim->timer);
+
+	world_update_headless(sim->world);
+	headless_capture(sim, HEADLESS_WORLD_UPDATE);
+
+	if (sim->editing)
+	{
+		editor_update(sim->editor, resolution);
+		headless_capture(sim, HEADLESS_EDITOR_UPDATE);
+	}
+}
+
+int headless_simulate(headless_result_t* result, const headless_desc_t* desc)
+{
+	*result = (headless_result_t){};
+
+	headless_sim_t sim = {
+		.record	= desc->record,
+		.result	= result,
+	};
+	sim.wind		= wind_create(NULL, desc->jobPool, desc->windResolution);
+	sim.particles	= particles_create(NULL, sim.wind, PARTICLES_BACKEND_CPU);
+	sim.world		= world_create(NULL, sim.particles, desc->jobPool);
+	sim.game		= game_create(NULL, NULL, sim.world, sim.wind, sim.particles);
+	sim.editor		= editor_create(sim.world);
+
+	int r = 0;
+	if (sim.wind == NULL || sim.particles == NULL || sim.world == NULL || sim.game == NULL || sim.editor == NULL)
+	{
+		r = 1;
+		goto done;
+	}
+
+	world_load(sim.world, desc->worldPath);
+
+	if (desc->replay != NULL)
+	{
+		replay_record_t record;
+		while (replay_reader_next(desc->replay, &record))
+		{
+			switch (record.type)
+			{
+				case REPLAY_RECORD_EVENT:
+					headless_event(&sim, &record.event);
+					break;
+				case REPLAY_RECORD_TICK:
+					headless_tick(&sim, record.resolution);
+					break;
+				case REPLAY_RECORD_FRAME:
+					headless_frame(&sim, record.resolution);
+					break;
+			}
+		}
+	}
+	else
+	{
+		// a frame for every tick
+		const uint2 resolution = {1920, 1080};
+		uint keys = 0;
+
+		for (uint tick = 0; tick < desc->tickCount; ++tick)
+		{
+			const uint nextKeys = headless_script_keys(tick);
+			headless_send_keys(&sim, keys, nextKeys);
+			keys = nextKeys;
+
+			headless_tick(&sim, resolution);
+			headless_frame(&sim, resolution);
+		}
+	}
+
+	uint64_t hash = FNV1A64_OFFSET_BASIS;
+	hash = world_hash_state(sim.world, hash);
+	hash = game_hash_state(sim.game, hash);
+	hash = wind_hash_state(sim.wind, hash);
+	hash = particles_hash_state(sim.particles, hash);
+	result->hash = hash;
+
+done:
+	if (sim.editor != NULL)
+	{
+		editor_destroy(sim.editor);
+	}
+	if (sim.game != NULL)
+	{
+		game_destroy(sim.game);
+	}
+	if (sim.world != NULL)
+	{
+		world_destroy(sim.world);
+	}
+	if (sim.particles != NULL)
+	{
+		particles_destroy(sim.particles);
+	}
+	if (sim.wind != NULL)
+	{
+		wind_destroy(sim.wind);
+	}
+	return r;
+}
+
+int run_headless(uint tickCount, uint windResolution, const char* replayPath)
+{
+	replay_reader_t replay;
+	if (replayPath != NULL)
+	{
+		if (replay_reader_open(&replay, replayPath) != 0)
+		{
+			return 1;
+		}
+		printf("Replaying %u ticks of %s headless...\n", replay.header.tickCount, replayPath);
+	}
+	else
+	{
+		printf("Simulating %u ticks headless...\n", tickCount);
+	}
+
+	job_pool_t* jobPool = job_pool_create(0);
+
+	const headless_desc_t desc = {
+		.worldPath		= "world.bin",
+		.tickCount		= tickCount,
+		.windResolution	= windResolution,
+		.jobPool		= jobPool,
+		.replay			= replayPath != NULL ? &replay : NULL,
+	};
+	headless_result_t result;
+	const int r = headless_simulate(&result, &desc);
+
+	job_pool_destroy(jobPool);
+	if (replayPath != NULL)
+	{
+		replay_reader_close(&replay);
+	}
+
+	if (r != 0)
+	{
+		fprintf(stderr, "Failed to set up the simulation\n");
+		return 1;
+	}
+
+	// per tick of simulated time, so the world and editor updates are spread over the ticks of their frame
+	const uint ticks = result.tickCount > 0 ? result.tickCount : 1;
+
+	double totalMs = 0.0;
+	for (uint i = 0; i < HEADLESS_SUBSYSTEM_COUNT; ++i)
+	{
+		printf("  %-16s %8.4f ms/tick, %8.4f ms worst\n",
+			g_headlessSubsystemNames[i], result.totalMs[i] / ticks, result.worstMs[i]);
+		totalMs += result.totalMs[i];
+	}
+	printf("  %-16s %8.4f ms/tick\n", "total", totalMs / ticks);
+	printf("State hash: %016llx\n", (unsigned long long)result.hash);
+
+	return 0;
+}
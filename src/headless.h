@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.h"
+#include "job_pool.h"
+#include "replay.h"
+
+#include <stdint.h>
+
+// The fixed tick loop without a window or a gpu: the world, game, editor, wind and (cpu) particles, driven by a
+// scripted input stream or a replay instead of the window's events, so two runs tick exactly the same way.
+
+typedef enum headless_subsystem
+{
+	HEADLESS_WORLD_UPDATE,
+	HEADLESS_WORLD_TICK,
+	HEADLESS_GAME_TICK,
+	HEADLESS_WIND_TICK,
+	HEADLESS_PARTICLES_TICK,
+	HEADLESS_EDITOR_UPDATE,
+	HEADLESS_SUBSYSTEM_COUNT,
+} headless_subsystem_t;
+
+typedef struct headless_desc
+{
+	const char*			worldPath; // may be missing, for an empty world
+	uint				tickCount; // of the scripted input
+	uint				windResolution;
+	job_pool_t*			jobPool; // may be NULL
+	// when set, its events, ticks and frames are run instead of the script, to the end of the replay. The
+	// world is updated once a frame rather than once a tick, the way the main loop does it.
+	replay_reader_t*	replay;
+	// when set, everything that's run is written to it, whether it comes from the script or a replay
+	replay_writer_t*	record;
+} headless_desc_t;
+
+typedef struct headless_result
+{
+	uint		tickCount;
+	double		totalMs[HEADLESS_SUBSYSTEM_COUNT];
+	double		worstMs[HEADLESS_SUBSYSTEM_COUNT];
+	uint64_t	hash; // of the world, game, wind and particles after the last tick
+} headless_result_t;
+
+// Returns nonzero if the simulation couldn't be set up.
+int headless_simulate(headless_result_t* result, const headless_desc_t* desc);
+
+// headless_simulate on world.bin, printing the timings and the hash. replayPath may be NULL for the script.
+int run_headless(uint tickCount, uint windResolution, const char* replayPath);
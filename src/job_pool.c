@@ -0,0 +1,177 @@
+#include "job_pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define JOB_POOL_MAX_THREADS 64
+
+typedef struct job_pool
+{
+	uint			threadCount;
+	pthread_t		threads[JOB_POOL_MAX_THREADS];
+
+	pthread_mutex_t	mutex;
+	pthread_cond_t	batchReady;
+	pthread_cond_t	batchDone;
+	uint64_t		batchId;
+	uint			activeWorkers;
+	bool			quit;
+
+	// current batch
+	job_func_t		func;
+	void*			userData;
+	uint			jobCount;
+	atomic_uint		nextJob;
+} job_pool_t;
+
+static void job_pool_work(job_pool_t* pool)
+{
+	for (;;)
+	{
+		const uint jobIndex = atomic_fetch_add_explicit(&pool->nextJob, 1, memory_order_relaxed);
+		if (jobIndex >= pool->jobCount)
+		{
+			break;
+		}
+		pool->func(pool->userData, jobIndex);
+	}
+}
+
+static void* job_pool_thread(void* arg)
+{
+	job_pool_t* pool = arg;
+	uint64_t seenBatchId = 0;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (;;)
+	{
+		while (!pool->quit && pool->batchId == seenBatchId)
+		{
+			pthread_cond_wait(&pool->batchReady, &pool->mutex);
+		}
+
+		if (pool->quit)
+		{
+			break;
+		}
+
+		seenBatchId = pool->batchId;
+		pthread_mutex_unlock(&pool->mutex);
+
+		job_pool_work(pool);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (--pool->activeWorkers == 0)
+		{
+			pthread_cond_signal(&pool->batchDone);
+		}
+	}
+
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+job_pool_t* job_pool_create(uint threadCount)
+{
+	if (threadCount == 0)
+	{
+		const long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+		threadCount = cpuCount > 0 ? (uint)cpuCount : 1;
+	}
+	if (threadCount > JOB_POOL_MAX_THREADS)
+	{
+		threadCount = JOB_POOL_MAX_THREADS;
+	}
+
+	job_pool_t* pool = calloc(1, sizeof(job_pool_t));
+	if (pool == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->batchReady, NULL);
+	pthread_cond_init(&pool->batchDone, NULL);
+	atomic_init(&pool->nextJob, 0);
+
+	// slot 0 is the thread that calls job_pool_run
+	pool->threadCount = 1;
+	for (uint i = 1; i < threadCount; ++i)
+	{
+		if (pthread_create(&pool->threads[i], NULL, job_pool_thread, pool) != 0)
+		{
+			break;
+		}
+		++pool->threadCount;
+	}
+
+	return pool;
+}
+
+void job_pool_destroy(job_pool_t* pool)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->batchReady);
+	pthread_mutex_unlock(&pool->mutex);
+
+	for (uint i = 1; i < pool->threadCount; ++i)
+	{
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&pool->batchDone);
+	pthread_cond_destroy(&pool->batchReady);
+	pthread_mutex_destroy(&pool->mutex);
+
+	free(pool);
+}
+
+uint job_pool_get_thread_count(const job_pool_t* pool)
+{
+	return pool->threadCount;
+}
+
+void job_pool_run(job_pool_t* pool, job_func_t func, void* userData, uint jobCount)
+{
+	if (jobCount == 0)
+	{
+		return;
+	}
+
+	// not worth waking anyone up for
+	if (jobCount == 1 || pool->threadCount == 1)
+	{
+		for (uint i = 0; i < jobCount; ++i)
+		{
+			func(userData, i);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+	assert(pool->activeWorkers == 0);
+	pool->func			= func;
+	pool->userData		= userData;
+	pool->jobCount		= jobCount;
+	atomic_store_explicit(&pool->nextJob, 0, memory_order_relaxed);
+	pool->activeWorkers	= pool->threadCount - 1;
+	++pool->batchId;
+	pthread_cond_broadcast(&pool->batchReady);
+	pthread_mutex_unlock(&pool->mutex);
+
+	job_pool_work(pool);
+
+	// workers may still be finishing the last jobs they grabbed
+	pthread_mutex_lock(&pool->mutex);
+	while (pool->activeWorkers > 0)
+	{
+		pthread_cond_wait(&pool->batchDone, &pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "types.h"
+
+typedef struct job_pool job_pool_t;
+
+typedef void (*job_func_t)(void* userData, uint jobIndex);
+
+// threadCount includes the calling thread; 0 picks one per online CPU
+job_pool_t* job_pool_create(uint threadCount);
+void job_pool_destroy(job_pool_t* pool);
+
+uint job_pool_get_thread_count(const job_pool_t* pool);
+
+// Calls func once for every index in [0, jobCount) spread across the pool, and returns once all of them
+// have finished. The calling thread works on the batch too. Not reentrant: jobs must not call back into
+// the pool.
+void job_pool_run(job_pool_t* pool, job_func_t func, void* userData, uint jobCount);
@@ -14,6 +14,10 @@
 #include "composite.h"
 #include "delta_time.h"
 #include "tests.h"
+#include "benchmarks.h"
+#include "headless.h"
+#include "replay.h"
+#include "job_pool.h"
 #include "model_loader.h"
 #include "game_resource.h"
 #include "content.h"
@@ -173,6 +177,16 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugMessageCallback(
 int main(int argc, char **argv)
 {
 	bool runTests = false;
+	bool runBenchmarks = false;
+	bool runHeadless = false;
+	uint headlessTicks = 600;
+	const char* recordPath = NULL;
+	const char* replayPath = NULL;
+	particles_backend_t particlesBackend = PARTICLES_BACKEND_CPU;
+	bool particlesTestOrbit = false;
+	// the last tick of a frame writes the particles' gpu buffer as it goes, so they aren't walked again to render
+	bool fuseParticleWrite = true;
+	uint windResolution = WIND_GRID_DEFAULT_RESOLUTION;
 
 	for (int i = 0; i < argc; ++i)
 	{
@@ -180,6 +194,47 @@ int main(int argc, char **argv)
 		{
 			runTests = true;
 		}
+		if (strcmp(argv[i], "--bench") == 0)
+		{
+			runBenchmarks = true;
+		}
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			runHeadless = true;
+		}
+		if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+		{
+			headlessTicks = (uint)strtoul(argv[++i], NULL, 10);
+		}
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			recordPath = argv[++i];
+		}
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayPath = argv[++i];
+		}
+		if (strcmp(argv[i], "--gpu-particles") == 0)
+		{
+			particlesBackend = PARTICLES_BACKEND_GPU;
+		}
+		if (strcmp(argv[i], "--test-orbit") == 0)
+		{
+			particlesTestOrbit = true;
+		}
+		if (strcmp(argv[i], "--no-fused-particle-write") == 0)
+		{
+			fuseParticleWrite = false;
+		}
+		if (strcmp(argv[i], "--wind-resolution") == 0 && i + 1 < argc)
+		{
+			windResolution = (uint)strtoul(argv[++i], NULL, 10);
+			if (windResolution < 2 || (windResolution & (windResolution - 1)) != 0)
+			{
+				fprintf(stderr, "--wind-resolution has to be a power of two\n");
+				return 1;
+			}
+		}
 	}
 
 	if (runTests)
@@ -187,7 +242,25 @@ int main(int argc, char **argv)
 		return run_tests();
 	}
 
-	srand(time(NULL));
+	if (runBenchmarks)
+	{
+		return run_benchmarks();
+	}
+
+	if (runHeadless)
+	{
+		if (particlesBackend == PARTICLES_BACKEND_GPU)
+		{
+			fprintf(stderr, "--gpu-particles needs a gpu, and --headless doesn't have one\n");
+			return 1;
+		}
+		if (recordPath != NULL)
+		{
+			fprintf(stderr, "--record needs a window to record, and --headless doesn't have one\n");
+			return 1;
+		}
+		return run_headless(headlessTicks, windResolution, replayPath);
+	}
 
 	app_t app = {};
 
@@ -336,18 +409,13 @@ int main(int argc, char **argv)
 	composite_t* composite = composite_create(&vulkan);
 	model_loader_t* modelLoader = model_loader_create(&vulkan, &gameResource, &content);
 	//terrain_t* terrain = terrain_create(&vulkan);
-	wind_t* wind = wind_create(&vulkan);
-	particles_t* particles = particles_create(&vulkan, wind);
-	world_t* world = world_create(&vulkan, particles);
+	job_pool_t* jobPool = job_pool_create(0);
+	wind_t* wind = wind_create(&vulkan, jobPool, windResolution);
+	particles_t* particles = particles_create(&vulkan, wind, particlesBackend);
+	particles_set_test_orbit(particles, particlesTestOrbit);
+	world_t* world = world_create(&vulkan, particles, jobPool);
 
-	{
-		FILE* f = fopen("world.bin", "rb");
-		if (f != NULL)
-		{
-			world_deserialize(world, f);
-			fclose(f);
-		}
-	}
+	world_load(world, "world.bin");
 
 	staging_memory_allocator_t staging_allocator;
 	ResetStagingMemoryAllocator(&staging_allocator, &vulkan);
@@ -365,6 +433,30 @@ int main(int argc, char **argv)
 	game_t* game = game_create(window, modelLoader, world, wind, particles);
 	editor_t* editor = editor_create(world);
 
+	// a replay stands in for the window's events and the clock, so the same ticks and frames run every time
+	replay_reader_t replay;
+	replay_reader_t* replayReader = NULL;
+	if (replayPath != NULL)
+	{
+		if (replay_reader_open(&replay, replayPath) != 0)
+		{
+			return 1;
+		}
+		replayReader = &replay;
+	}
+
+	replay_writer_t recording;
+	FILE* recordFile = NULL;
+	if (recordPath != NULL)
+	{
+		recordFile = fopen(recordPath, "wb");
+		if (recordFile == NULL || replay_writer_begin(&recording, recordFile) != 0)
+		{
+			fprintf(stderr, "Can't record to %s\n", recordPath);
+			return 1;
+		}
+	}
+
 	delta_timer_t deltaTimer;
 	delta_timer_reset(&deltaTimer);
 
@@ -389,8 +481,24 @@ int main(int argc, char **argv)
 		// ---- poll events ----
 		//
 		window_event_t event;
-		while (window_poll(&event, window))
+		for (;;)
 		{
+			replay_record_t replayRecord;
+			if (!window_poll(&event, window))
+			{
+				// the replay's events up to its next tick or frame
+				if (replayReader == NULL || !replay_reader_peek(replayReader, &replayRecord) || replayRecord.type != REPLAY_RECORD_EVENT)
+				{
+					break;
+				}
+				replay_reader_next(replayReader, &replayRecord);
+				event = replayRecord.event;
+			}
+			else if (replayReader != NULL && event.type != WINDOW_EVENT_DESTROY)
+			{
+				continue;
+			}
+
 			if (event.type == WINDOW_EVENT_NULL)
 			{
 				continue;
@@ -403,6 +511,11 @@ int main(int argc, char **argv)
 				break;
 			}
 
+			if (recordFile != NULL)
+			{
+				replay_writer_event(&recording, &event);
+			}
+
 			if (event.type == WINDOW_EVENT_KEY_DOWN)
 			{
 				if (event.data.key.code == KEY_F1)
@@ -420,12 +533,12 @@ int main(int argc, char **argv)
 				{
 					holdingCtrl = true;
 				}
-				else if (event.data.key.code == KEY_S)
+				else if (event.data.key.code == KEY_S && replayReader == NULL)
 				{
-					FILE* f = fopen("world.bin", "wb");
-					assert(f != NULL);
-					world_serialize(world, f);
-					fclose(f);
+					if (world_save_async(world, "world.bin") != 0)
+					{
+						printf("Can't save while another save is in progress\n");
+					}
 				}
 				else if (event.data.key.code == KEY_PAUSE)
 				{
@@ -456,6 +569,12 @@ int main(int argc, char **argv)
 			break;
 		}
 
+		int saveResult;
+		if (world_poll_save(world, &saveResult))
+		{
+			printf(saveResult == 0 ? "Saved world.bin\n" : "Failed to save world.bin\n");
+		}
+
 		//
 		// --- maybe render ---
 		//
@@ -501,30 +620,94 @@ int main(int argc, char **argv)
 			tickAccumulator += deltaTime;
 		}
 
+		uint tickCount = 0;
+		if (replayReader != NULL)
+		{
+			// as many ticks as the recorded frame ran, however long this one took. They're read one by one in the
+			// tick loop, which runs each at the resolution it was recorded at rather than the window's.
+			replay_reader_t lookahead = *replayReader;
+			replay_record_t replayRecord;
+			while (replay_reader_next(&lookahead, &replayRecord) && replayRecord.type == REPLAY_RECORD_TICK)
+			{
+				++tickCount;
+			}
+		}
+		else
+		{
+			while (tickAccumulator >= DELTA_TIME_MS)
+			{
+				tickAccumulator -= DELTA_TIME_MS;
+				++tickCount;
+			}
+		}
+
 		debug_renderer_clear_buffer(debugRenderer, DEBUG_RENDERER_BUFFER_FRAME);
 		debug_renderer_set_current_buffer(debugRenderer, DEBUG_RENDERER_BUFFER_TICK);
 
-		while (tickAccumulator >= DELTA_TIME_MS)
+		for (uint tick = 0; tick < tickCount; ++tick)
 		{
-			tickAccumulator -= DELTA_TIME_MS;
-
 			PROFILER_BEGIN(tick);
 
 			debug_renderer_clear_buffer(debugRenderer, DEBUG_RENDERER_BUFFER_TICK);
 
+			uint2 tickResolution = resolution;
+			if (replayReader != NULL)
+			{
+				replay_record_t replayRecord;
+				replay_reader_next(replayReader, &replayRecord);
+				assert(replayRecord.type == REPLAY_RECORD_TICK);
+				tickResolution = replayRecord.resolution;
+			}
+
+			if (recordFile != NULL)
+			{
+				replay_writer_tick(&recording, tickResolution);
+			}
+
 			world_tick(world);
 
 			if (appMode == APP_MODE_GAME)
 			{
-				game_tick(game, resolution);
+				game_tick(game, tickResolution);
 			}
 
 			wind_tick(wind);
-			particles_tick(particles);
+
+			// the frame's fence has been waited on above, so its particle buffer is free to write
+			if (fuseParticleWrite && tick + 1 == tickCount)
+			{
+				particles_tick_and_write(particles, app.currentFrame);
+			}
+			else
+			{
+				particles_tick(particles);
+			}
 
 			PROFILER_END();
 		}
 
+		// the editor picks with the resolution too, so it's given the recorded one like the game's ticks are
+		uint2 frameResolution = resolution;
+		if (replayReader != NULL)
+		{
+			replay_record_t replayRecord;
+			if (!replay_reader_peek(replayReader, &replayRecord))
+			{
+				printf("Replay finished\n");
+				shutdown = true;
+			}
+			else if (replayRecord.type == REPLAY_RECORD_FRAME)
+			{
+				replay_reader_next(replayReader, &replayRecord);
+				frameResolution = replayRecord.resolution;
+			}
+		}
+
+		if (recordFile != NULL)
+		{
+			replay_writer_frame(&recording, frameResolution);
+		}
+
 		debug_renderer_set_current_buffer(debugRenderer, DEBUG_RENDERER_BUFFER_FRAME);
 
 		//
@@ -547,7 +730,7 @@ int main(int argc, char **argv)
 		else if (appMode == APP_MODE_EDIT)
 		{
 			PROFILER_BEGIN(editor_render);
-			editor_render(scb, editor, resolution);
+			editor_render(scb, editor, frameResolution);
 			PROFILER_END();
 		}
 		
@@ -580,8 +763,8 @@ int main(int argc, char **argv)
 			wind_update(cb, wind, &rc);
 			PROFILER_END();
 
-			PROFILER_BEGIN(particles_render);
-			particles_render(particles, &rc);
+			PROFILER_BEGIN(particles_update);
+			particles_update(particles, cb, &rc);
 			PROFILER_END();
 		}
 		PROFILER_END();
@@ -778,6 +961,23 @@ int main(int argc, char **argv)
 
 	vkDeviceWaitIdle(vulkan.device);
 
+	if (recordFile != NULL)
+	{
+		const bool recorded = replay_writer_end(&recording) == 0;
+		if (fclose(recordFile) != 0 || !recorded)
+		{
+			fprintf(stderr, "Failed to write %s\n", recordPath);
+		}
+		else
+		{
+			printf("Recorded %u ticks to %s\n", recording.header.tickCount, recordPath);
+		}
+	}
+	if (replayReader != NULL)
+	{
+		replay_reader_close(replayReader);
+	}
+
 	window_destroy(window);
 
 	DestroySwapchain(&swapchain, &vulkan);
@@ -793,8 +993,10 @@ int main(int argc, char **argv)
 	game_destroy(game);
 	editor_destroy(editor);
 
+	particles_destroy(particles);
 	wind_destroy(wind);
 	world_destroy(world);
+	job_pool_destroy(jobPool);
 	//terrain_destroy(terrain);
 	model_loader_destroy(modelLoader);
 	debug_renderer_destroy(debugRenderer, &vulkan);
@@ -152,7 +152,14 @@ static uint32_t insertNodeIntoBin(offset_allocator_t* allocator, uint32_t size,
 #ifdef DEBUG_VERBOSE
 	printf("Getting node %u from freelist[%u]\n", nodeIndex, m_freeOffset + 1);
 #endif
-	allocator->m_nodes[nodeIndex] = (offset_allocator_node_t){.dataOffset = dataOffset, .dataSize = size, .binListNext = topNodeIndex};
+	allocator->m_nodes[nodeIndex] = (offset_allocator_node_t){
+		.dataOffset		= dataOffset,
+		.dataSize		= size,
+		.binListPrev	= NODE_UNUSED,
+		.binListNext	= topNodeIndex,
+		.neighborPrev	= NODE_UNUSED,
+		.neighborNext	= NODE_UNUSED,
+	};
 	if (topNodeIndex != NODE_UNUSED)
 	{
 		allocator->m_nodes[topNodeIndex].binListPrev = nodeIndex;
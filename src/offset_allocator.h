@@ -1,6 +1,8 @@
 // (C) Sebastian Aaltonen 2023
 // MIT License (see file: LICENSE)
 
+#pragma once
+
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -0,0 +1,298 @@
+#include "particle_soa.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define PARTICLE_SOA_FIELD_COUNT 6
+
+#define PARTICLE_PI			3.14159265358979f
+#define PARTICLE_INV_TWO_PI	0.159154943091895f
+// 2pi split in two, so k * 2pi can be subtracted without losing the low bits of x
+#define PARTICLE_TWO_PI_HI	6.28125f
+#define PARTICLE_TWO_PI_LO	0.00193530717958647f
+
+bool particle_soa_create(particle_soa_t* soa, uint capacity)
+{
+	capacity = alignUp(capacity, PARTICLE_SOA_WIDTH);
+
+	const size_t size = PARTICLE_SOA_FIELD_COUNT * capacity * sizeof(float);
+	float* mem = aligned_alloc(16, size > 0 ? size : 16);
+	if (mem == NULL)
+	{
+		return false;
+	}
+	memset(mem, 0, size);
+
+	*soa = (particle_soa_t){
+		.capacity	= capacity,
+		.posX		= mem + 0 * capacity,
+		.posY		= mem + 1 * capacity,
+		.velX		= mem + 2 * capacity,
+		.velY		= mem + 3 * capacity,
+		.age		= mem + 4 * capacity,
+		.lifetime	= mem + 5 * capacity,
+	};
+	return true;
+}
+
+void particle_soa_destroy(particle_soa_t* soa)
+{
+	free(soa->posX);
+	*soa = (particle_soa_t){0};
+}
+
+bool particle_soa_push(particle_soa_t* soa, vec2 pos, vec2 vel, float lifetime)
+{
+	if (soa->count == soa->capacity)
+	{
+		return false;
+	}
+
+	const uint i = soa->count++;
+	soa->posX[i]		= pos.x;
+	soa->posY[i]		= pos.y;
+	soa->velX[i]		= vel.x;
+	soa->velY[i]		= vel.y;
+	soa->age[i]			= 0.0f;
+	soa->lifetime[i]	= lifetime;
+	return true;
+}
+
+void particle_soa_integrate(particle_soa_t* soa, float dt, float damping)
+{
+#ifdef __SSE2__
+	const __m128 vdt		= _mm_set1_ps(dt);
+	const __m128 vdamping	= _mm_set1_ps(damping);
+
+	for (uint i = 0; i < soa->count; i += PARTICLE_SOA_WIDTH)
+	{
+		const __m128 velX = _mm_load_ps(soa->velX + i);
+		const __m128 velY = _mm_load_ps(soa->velY + i);
+		_mm_store_ps(soa->posX + i, _mm_add_ps(_mm_load_ps(soa->posX + i), _mm_mul_ps(velX, vdt)));
+		_mm_store_ps(soa->posY + i, _mm_add_ps(_mm_load_ps(soa->posY + i), _mm_mul_ps(velY, vdt)));
+		_mm_store_ps(soa->velX + i, _mm_mul_ps(velX, vdamping));
+		_mm_store_ps(soa->velY + i, _mm_mul_ps(velY, vdamping));
+		_mm_store_ps(soa->age + i, _mm_add_ps(_mm_load_ps(soa->age + i), vdt));
+	}
+#else
+	for (uint i = 0; i < soa->count; ++i)
+	{
+		soa->posX[i] += soa->velX[i] * dt;
+		soa->posY[i] += soa->velY[i] * dt;
+		soa->velX[i] *= damping;
+		soa->velY[i] *= damping;
+		soa->age[i] += dt;
+	}
+#endif
+}
+
+// Taylor series up to x^9, which is within 4e-6 of sin on [0, pi/2]
+#define PARTICLE_SIN_C3 (-1.0f / 6.0f)
+#define PARTICLE_SIN_C5 (1.0f / 120.0f)
+#define PARTICLE_SIN_C7 (-1.0f / 5040.0f)
+#define PARTICLE_SIN_C9 (1.0f / 362880.0f)
+
+float particle_sinf(float x)
+{
+	// reduce to [-pi, pi], then fold |x| onto [0, pi/2] using sin(x) = sin(pi - x)
+	const float k = (float)(int)(x * PARTICLE_INV_TWO_PI + (x < 0.0f ? -0.5f : 0.5f));
+	const float r = (x - k * PARTICLE_TWO_PI_HI) - k * PARTICLE_TWO_PI_LO;
+	float a = r < 0.0f ? -r : r;
+	a = a < PARTICLE_PI - a ? a : PARTICLE_PI - a;
+
+	const float a2 = a * a;
+	const float s = a * (1.0f + a2 * (PARTICLE_SIN_C3 + a2 * (PARTICLE_SIN_C5 + a2 * (PARTICLE_SIN_C7 + a2 * PARTICLE_SIN_C9))));
+	return r < 0.0f ? -s : s;
+}
+
+void particle_soa_sway(particle_soa_t* soa, float frequency, float amplitude)
+{
+#ifdef __SSE2__
+	const __m128 vfrequency	= _mm_set1_ps(frequency);
+	const __m128 vamplitude	= _mm_set1_ps(amplitude);
+	const __m128 signMask	= _mm_set1_ps(-0.0f);
+	const __m128 pi			= _mm_set1_ps(PARTICLE_PI);
+
+	for (uint i = 0; i < soa->count; i += PARTICLE_SOA_WIDTH)
+	{
+		const __m128 x = _mm_mul_ps(_mm_load_ps(soa->age + i), vfrequency);
+
+		// same steps as particle_sinf, cvtps rounds to nearest
+		const __m128 k = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(PARTICLE_INV_TWO_PI))));
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(PARTICLE_TWO_PI_HI)));
+		r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(PARTICLE_TWO_PI_LO)));
+
+		const __m128 sign = _mm_and_ps(r, signMask);
+		__m128 a = _mm_andnot_ps(signMask, r);
+		a = _mm_min_ps(a, _mm_sub_ps(pi, a));
+
+		const __m128 a2 = _mm_mul_ps(a, a);
+		__m128 s = _mm_add_ps(_mm_set1_ps(PARTICLE_SIN_C7), _mm_mul_ps(a2, _mm_set1_ps(PARTICLE_SIN_C9)));
+		s = _mm_add_ps(_mm_set1_ps(PARTICLE_SIN_C5), _mm_mul_ps(a2, s));
+		s = _mm_add_ps(_mm_set1_ps(PARTICLE_SIN_C3), _mm_mul_ps(a2, s));
+		s = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(a2, s));
+		s = _mm_xor_ps(_mm_mul_ps(a, s), sign);
+
+		_mm_store_ps(soa->posX + i, _mm_add_ps(_mm_load_ps(soa->posX + i), _mm_mul_ps(s, vamplitude)));
+	}
+#else
+	for (uint i = 0; i < soa->count; ++i)
+	{
+		soa->posX[i] += particle_sinf(soa->age[i] * frequency) * amplitude;
+	}
+#endif
+}
+
+void particle_soa_compact(particle_soa_t* soa)
+{
+	uint i = 0;
+
+#ifdef __SSE2__
+	// most ticks nothing dies, so skip ahead to the first vector with a dead lane before moving anything
+	for (; i + PARTICLE_SOA_WIDTH <= soa->count; i += PARTICLE_SOA_WIDTH)
+	{
+		const __m128 dead = _mm_cmpge_ps(_mm_load_ps(soa->age + i), _mm_load_ps(soa->lifetime + i));
+		if (_mm_movemask_ps(dead) != 0)
+		{
+			break;
+		}
+	}
+#endif
+
+	// every particle is written to the end of the survivors, which only advances if it's alive
+	uint count = i;
+	for (; i < soa->count; ++i)
+	{
+		soa->posX[count]		= soa->posX[i];
+		soa->posY[count]		= soa->posY[i];
+		soa->velX[count]		= soa->velX[i];
+		soa->velY[count]		= soa->velY[i];
+		soa->age[count]			= soa->age[i];
+		soa->lifetime[count]	= soa->lifetime[i];
+		count += soa->age[i] < soa->lifetime[i];
+	}
+
+	soa->count = count;
+}
+
+static uint particle_soa_pack_size_and_layer(float age, float lifetime, const particle_soa_style_t* style)
+{
+	const float size = style->size + (age / lifetime) * (style->endSize - style->size);
+	return (uint)(size * (float)0xffff) | (style->layer << 16);
+}
+
+void particle_soa_write(gpu_particle_t* out, const particle_soa_t* soa, const particle_soa_style_t* style)
+{
+	for (uint i = 0; i < soa->count; ++i)
+	{
+		out[i] = (gpu_particle_t){
+			.center = { soa->posX[i], soa->posY[i] },
+			.sizeAndLayer = particle_soa_pack_size_and_layer(soa->age[i], soa->lifetime[i], style),
+			.color = style->color,
+		};
+	}
+}
+
+void particle_soa_integrate_write(particle_soa_t* soa, float dt, float damping, gpu_particle_t* out, const particle_soa_style_t* style)
+{
+	assert(((uintptr_t)out & 15) == 0);
+	_Static_assert(sizeof(gpu_particle_t) == 4 * sizeof(float), "a particle is written as one vector");
+
+#ifdef __SSE2__
+	const __m128 vdt		= _mm_set1_ps(dt);
+	const __m128 vdamping	= _mm_set1_ps(damping);
+	const __m128 vsize		= _mm_set1_ps(style->size);
+	const __m128 vsizeDelta	= _mm_set1_ps(style->endSize - style->size);
+	const __m128i vlayer	= _mm_set1_epi32(style->layer << 16);
+	const __m128 vcolor		= _mm_castsi128_ps(_mm_set1_epi32(style->color));
+	const __m128i vcount	= _mm_set1_epi32(soa->count);
+	const __m128i laneIndex	= _mm_setr_epi32(0, 1, 2, 3);
+
+	uint count = 0;
+	for (uint i = 0; i < soa->count; i += PARTICLE_SOA_WIDTH)
+	{
+		__m128 velX		= _mm_load_ps(soa->velX + i);
+		__m128 velY		= _mm_load_ps(soa->velY + i);
+		__m128 posX		= _mm_add_ps(_mm_load_ps(soa->posX + i), _mm_mul_ps(velX, vdt));
+		__m128 posY		= _mm_add_ps(_mm_load_ps(soa->posY + i), _mm_mul_ps(velY, vdt));
+		velX			= _mm_mul_ps(velX, vdamping);
+		velY			= _mm_mul_ps(velY, vdamping);
+		const __m128 age		= _mm_add_ps(_mm_load_ps(soa->age + i), vdt);
+		const __m128 lifetime	= _mm_load_ps(soa->lifetime + i);
+
+		// lanes past count are dead too
+		const __m128 inRange = _mm_castsi128_ps(_mm_cmplt_epi32(_mm_add_epi32(_mm_set1_epi32(i), laneIndex), vcount));
+		const int alive = _mm_movemask_ps(_mm_and_ps(_mm_cmplt_ps(age, lifetime), inRange));
+
+		// same math as particle_soa_pack_size_and_layer
+		const __m128 size = _mm_add_ps(vsize, _mm_mul_ps(_mm_div_ps(age, lifetime), vsizeDelta));
+		const __m128i sizeAndLayer = _mm_or_si128(_mm_cvttps_epi32(_mm_mul_ps(size, _mm_set1_ps((float)0xffff))), vlayer);
+
+		// transposed into one gpu_particle_t per vector
+		__m128 particle0 = posX;
+		__m128 particle1 = posY;
+		__m128 particle2 = _mm_castsi128_ps(sizeAndLayer);
+		__m128 particle3 = vcolor;
+		_MM_TRANSPOSE4_PS(particle0, particle1, particle2, particle3);
+
+		if (alive == 0xf)
+		{
+			_mm_storeu_ps(soa->posX + count, posX);
+			_mm_storeu_ps(soa->posY + count, posY);
+			_mm_storeu_ps(soa->velX + count, velX);
+			_mm_storeu_ps(soa->velY + count, velY);
+			_mm_storeu_ps(soa->age + count, age);
+			_mm_storeu_ps(soa->lifetime + count, lifetime);
+
+			_mm_stream_ps((float*)(out + count + 0), particle0);
+			_mm_stream_ps((float*)(out + count + 1), particle1);
+			_mm_stream_ps((float*)(out + count + 2), particle2);
+			_mm_stream_ps((float*)(out + count + 3), particle3);
+			count += PARTICLE_SOA_WIDTH;
+			continue;
+		}
+
+		_Alignas(16) float lanes[6][PARTICLE_SOA_WIDTH];
+		_mm_store_ps(lanes[0], posX);
+		_mm_store_ps(lanes[1], posY);
+		_mm_store_ps(lanes[2], velX);
+		_mm_store_ps(lanes[3], velY);
+		_mm_store_ps(lanes[4], age);
+		_mm_store_ps(lanes[5], lifetime);
+		const __m128 particles[PARTICLE_SOA_WIDTH] = { particle0, particle1, particle2, particle3 };
+
+		for (uint lane = 0; lane < PARTICLE_SOA_WIDTH; ++lane)
+		{
+			if ((alive & (1 << lane)) == 0)
+			{
+				continue;
+			}
+
+			soa->posX[count]		= lanes[0][lane];
+			soa->posY[count]		= lanes[1][lane];
+			soa->velX[count]		= lanes[2][lane];
+			soa->velY[count]		= lanes[3][lane];
+			soa->age[count]			= lanes[4][lane];
+			soa->lifetime[count]	= lanes[5][lane];
+			_mm_stream_ps((float*)(out + count), particles[lane]);
+			++count;
+		}
+	}
+
+	soa->count = count;
+
+	// non-temporal stores aren't ordered with the ones that follow, so fence before the buffer is handed to the gpu
+	_mm_sfence();
+#else
+	particle_soa_integrate(soa, dt, damping);
+	particle_soa_compact(soa);
+	particle_soa_write(out, soa, style);
+#endif
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.h"
+#include "../shaders/gpu_types.h"
+
+#include <stdbool.h>
+
+// Kernels process this many particles at a time, and array capacities are rounded up to a multiple of it.
+#define PARTICLE_SOA_WIDTH 4
+
+// Particle state as a structure of arrays, so the tick kernels can load a vector's worth of one field at a
+// time. The arrays are 16 byte aligned. Lanes past count hold garbage that the kernels are free to update.
+typedef struct particle_soa
+{
+	uint	count;
+	uint	capacity;
+
+	float*	posX;
+	float*	posY;
+	float*	velX;
+	float*	velY;
+	float*	age;
+	float*	lifetime;
+} particle_soa_t;
+
+bool particle_soa_create(particle_soa_t* soa, uint capacity);
+void particle_soa_destroy(particle_soa_t* soa);
+
+// Appends a particle with an age of zero. Returns false when the arrays are full.
+bool particle_soa_push(particle_soa_t* soa, vec2 pos, vec2 vel, float lifetime);
+
+// pos += vel * dt, then vel *= damping, then age += dt
+void particle_soa_integrate(particle_soa_t* soa, float dt, float damping);
+
+// posX += sin(age * frequency) * amplitude
+void particle_soa_sway(particle_soa_t* soa, float frequency, float amplitude);
+
+// Removes every particle that reached its lifetime, keeping the survivors in order.
+void particle_soa_compact(particle_soa_t* soa);
+
+// How particles are packed into gpu_particle_t. The size goes linearly from size to endSize over a particle's
+// lifetime.
+typedef struct particle_soa_style
+{
+	float	size; // [0, 1]
+	float	endSize; // [0, 1]
+	uint	layer;
+	uint	color;
+} particle_soa_style_t;
+
+void particle_soa_write(gpu_particle_t* out, const particle_soa_t* soa, const particle_soa_style_t* style);
+
+// particle_soa_integrate, particle_soa_compact and particle_soa_write in a single pass over the arrays. out is
+// written with non-temporal stores since it's meant to be mapped write-combined memory, and has to be 16 byte
+// aligned.
+void particle_soa_integrate_write(particle_soa_t* soa, float dt, float damping, gpu_particle_t* out, const particle_soa_style_t* style);
+
+// The sine the sway kernel uses, for testing. Accurate to about 1e-5 for |x| < 100, drifting further out.
+float particle_sinf(float x);
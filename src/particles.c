@@ -1,76 +1,69 @@
 #include "particles.h"
 #include "common.h"
+#include "util.h"
 #include "vec.h"
 #include "rng.h"
+#include "particle_soa.h"
+#include "particles_gpu.h"
 #include "../shaders/gpu_types.h"
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #define MAX_PARTICLE_COUNT (64 * 1024)
 #define PARTICLE_BUFFER_SIZE (MAX_PARTICLE_COUNT * sizeof(gpu_particle_t))
+#define MAX_GPU_PARTICLE_COUNT (2 * 1024 * 1024)
+#define MAX_GPU_SPAWN_COUNT (64 * 1024)
+#define TEST_ORBIT_COUNT 64
+// particles sampled from the wind per batch
+#define WIND_SAMPLE_BATCH_SIZE 256
 
-typedef struct particle_effect_state particle_effect_state_t;
-
-typedef struct particle_tick_external_state
-{
-	const wind_t*	wind;
-} particle_tick_external_state_t;
-
-typedef struct footstep_dust_particle
-{
-	vec2	pos;
-	vec2	vel;
-	float	lifetime;
-	float	age;
-} footstep_dust_particle_t;
-static void particles_footstep_dust_spawn(particle_effect_state_t* state, particle_spawn_t spawn);
-static void particles_footstep_dust_tick(particle_effect_state_t* state, const particle_tick_external_state_t* external);
-static void particles_footstep_dust_render(gpu_particle_t* gpuParticles, const particle_effect_state_t* state);
-
-typedef struct ambient_pollen_particle
-{
-	vec2	pos;
-	vec2	vel;
-	float	lifetime;
-	float	age;
-} ambient_pollen_particle_t;
-static void particles_ambient_pollen_spawn(particle_effect_state_t* state, particle_spawn_t spawn);
-static void particles_ambient_pollen_tick(particle_effect_state_t* state, const particle_tick_external_state_t* external);
-static void particles_ambient_pollen_render(gpu_particle_t* gpuParticles, const particle_effect_state_t* state);
-
-typedef void(particles_spawn_function)(particle_effect_state_t* state, particle_spawn_t spawn);
-typedef void(particles_tick_function)(particle_effect_state_t* state, const particle_tick_external_state_t* external);
-typedef void(particles_render_function)(gpu_particle_t* gpuParticles, const particle_effect_state_t* state);
-
+// An effect's desc compiled down to what the spawn and tick code takes.
 typedef struct particle_effect_info
 {
-	uint						maxCount;
-	size_t						particleStateSize;
-	
-	particles_spawn_function*	spawn;
-	particles_tick_function*	tick;
-	particles_render_function*	render;
+	particle_effect_desc_t	desc;
+	float					windAmount; // per tick
+	float					swayAmplitude; // per tick
+	particle_soa_style_t	style;
 } particle_effect_info_t;
 
-static const particle_effect_info_t g_particleEffectInfo[PARTICLE_EFFECT_COUNT] =
+static const particle_effect_desc_t g_builtinParticleEffects[PARTICLE_EFFECT_BUILTIN_COUNT] =
 {
 	[PARTICLE_EFFECT_FOOTSTEP_DUST] = {
-		1024,
-		sizeof(footstep_dust_particle_t),
-		particles_footstep_dust_spawn,
-		particles_footstep_dust_tick,
-		particles_footstep_dust_render,
+		.maxCount		= 1024,
+		.minBurst		= 5,
+		.maxBurst		= 9,
+		.minLifetime	= 1000.0f,
+		.maxLifetime	= 1000.0f,
+		.spreadX		= 0.1f,
+		.spreadVelX		= 0.001f,
+		.minVelY		= 0.0005f,
+		.maxVelY		= 0.001f,
+		.damping		= 0.9f,
+		.size			= 0.2f,
+		.layer			= 0,
+		.color			= 0xff00222f,
 	},
 	[PARTICLE_EFFECT_AMBIENT_POLLEN] = {
-		4 * 1024,
-		sizeof(ambient_pollen_particle_t),
-		particles_ambient_pollen_spawn,
-		particles_ambient_pollen_tick,
-		particles_ambient_pollen_render,
+		.maxCount		= 4 * 1024,
+		.minBurst		= 1,
+		.maxBurst		= 1,
+		.minLifetime	= 10000.0f,
+		.maxLifetime	= 15000.0f,
+		.spreadVelX		= 0.0001f,
+		.minVelY		= 0.00005f,
+		.maxVelY		= 0.0003f,
+		.damping		= 1.0f,
+		.windCoupling	= 0.004f,
+		.swayFrequency	= 0.0025f,
+		.swayAmplitude	= 0.0004f,
+		.size			= 0.08f,
+		.layer			= 1,
+		.color			= 0xffffffff,
 	},
 };
 
@@ -79,25 +72,58 @@ typedef struct particles_frame
 	VkBuffer	particleBuffer;
 	void*		particleBufferMemory;
 	uint		gpuParticleCount;
+	uint		layerFirst[PARTICLE_LAYER_COUNT];
+	uint		layerCount[PARTICLE_LAYER_COUNT];
+	uint		generation; // particles->generation when particleBufferMemory was last written
 } particles_frame_t;
 
+// Particles circling the origin on layer 0, drawn after the effects. Only the orbits' phase changes over time.
+typedef struct particles_test_orbit
+{
+	bool	enabled;
+	vec2	radius[TEST_ORBIT_COUNT];
+	float	speed[TEST_ORBIT_COUNT];
+	uint	sizeAndLayer[TEST_ORBIT_COUNT];
+	uint	color[TEST_ORBIT_COUNT];
+} particles_test_orbit_t;
+
 typedef struct particle_effect_state
 {
-	uint	rng;
-	uint	count;
-	void*	particles;
+	uint			rng;
+	particle_soa_t	particles;
 } particle_effect_state_t;
 
+// Spawns the leading spawns that fit in the effect's particles and returns how many that was. A spawn either gets
+// all of its particles or none.
+static uint particles_spawn_effect(const particle_effect_info_t* info, particle_effect_state_t* state, const particle_spawn_t* spawns, uint count);
+// When gpuParticles isn't NULL the tick also writes the effect's particles to it, as particle_soa_write would.
+static void particles_tick_effect(const particle_effect_info_t* info, particle_effect_state_t* state, const wind_t* wind, gpu_particle_t* gpuParticles);
+
 typedef struct particles
 {
 	vulkan_t*			vulkan;
 	wind_t*				wind;
+	particles_backend_t	backend;
 	particles_frame_t	frames[FRAME_COUNT];
 	float				elapsedTime;
+	uint				generation; // bumped whenever the particles change
+	uint				droppedSpawnCount;
 
 	uint				rng;
 
-	particle_effect_state_t	effectState[PARTICLE_EFFECT_COUNT];
+	particles_test_orbit_t	testOrbit;
+
+	// with the gpu backend the effects' particle arrays only queue up spawns for the next particles_update
+	uint					effectCount;
+	uint					particleCapacity; // summed over the effects
+	particle_effect_info_t	effectInfo[PARTICLES_MAX_EFFECT_COUNT];
+	uint					effectOrder[PARTICLES_MAX_EFFECT_COUNT]; // effects by layer, back to front
+	particle_effect_state_t	effectState[PARTICLES_MAX_EFFECT_COUNT];
+	gpu_particle_effect_t	gpuEffects[PARTICLES_MAX_EFFECT_COUNT];
+
+	particles_gpu_t*		gpu;
+	uint					gpuTickCount; // ticks since the last particles_update
+	gpu_particle_state_t*	gpuSpawns;
 } particles_t;
 
 static uint pack_size_and_layer(float size, uint layer)
@@ -107,7 +133,7 @@ static uint pack_size_and_layer(float size, uint layer)
 	return (uint)(size * (float)0xffff) | (layer << 16);
 }
 
-particles_t* particles_create(vulkan_t* vulkan, wind_t* wind)
+particles_t* particles_create(vulkan_t* vulkan, wind_t* wind, particles_backend_t backend)
 {
 	particles_t* particles = calloc(1, sizeof(particles_t));
 	if (particles == NULL)
@@ -117,12 +143,24 @@ particles_t* particles_create(vulkan_t* vulkan, wind_t* wind)
 
 	particles->vulkan	= vulkan;
 	particles->wind		= wind;
+	particles->backend	= backend;
+	particles->generation	= 1;
 	
-	for (int i = 0; i < PARTICLE_EFFECT_COUNT; ++i)
+	if (backend == PARTICLES_BACKEND_GPU)
 	{
-		const particle_effect_info_t* info = &g_particleEffectInfo[i];
-		particles->effectState[i].particles = calloc(info->maxCount, info->particleStateSize);
-		assert(particles->effectState[i].particles != NULL);
+		particles->gpuSpawns = malloc(MAX_GPU_SPAWN_COUNT * sizeof(gpu_particle_state_t));
+		particles->gpu = particles_gpu_create(vulkan, MAX_GPU_PARTICLE_COUNT, MAX_GPU_SPAWN_COUNT);
+		if (particles->gpuSpawns == NULL || particles->gpu == NULL)
+		{
+			particles_destroy(particles);
+			return NULL;
+		}
+	}
+
+	for (int i = 0; i < PARTICLE_EFFECT_BUILTIN_COUNT; ++i)
+	{
+		const particle_effect_t effect = particles_register_effect(particles, &g_builtinParticleEffects[i]);
+		assert(effect == i);
 	}
 
 	return particles;
@@ -130,11 +168,111 @@ particles_t* particles_create(vulkan_t* vulkan, wind_t* wind)
 
 void particles_destroy(particles_t* particles)
 {
-	
+	for (uint i = 0; i < particles->effectCount; ++i)
+	{
+		particle_soa_destroy(&particles->effectState[i].particles);
+	}
+	if (particles->gpu != NULL)
+	{
+		particles_gpu_destroy(particles->gpu);
+	}
+	free(particles->gpuSpawns);
+	free(particles);
+}
+
+// Counting sort of the effects by layer, highest first, keeping the registration order within a layer.
+static void particles_sort_effects(particles_t* particles)
+{
+	uint layerFirst[PARTICLE_LAYER_COUNT] = {};
+	for (uint i = 0; i < particles->effectCount; ++i)
+	{
+		++layerFirst[particles->effectInfo[i].style.layer];
+	}
+
+	uint first = 0;
+	for (int layer = PARTICLE_LAYER_COUNT - 1; layer >= 0; --layer)
+	{
+		const uint count = layerFirst[layer];
+		layerFirst[layer] = first;
+		first += count;
+	}
+
+	for (uint i = 0; i < particles->effectCount; ++i)
+	{
+		particles->effectOrder[layerFirst[particles->effectInfo[i].style.layer]++] = i;
+	}
+}
+
+particle_effect_t particles_register_effect(particles_t* particles, const particle_effect_desc_t* desc)
+{
+	assert(desc->minBurst <= desc->maxBurst);
+	assert(desc->minLifetime > 0.0f && desc->minLifetime <= desc->maxLifetime);
+	assert(desc->size >= 0.0f && desc->size <= 1.0f);
+	assert(desc->endSize >= 0.0f && desc->endSize <= 1.0f);
+	assert(desc->layer < PARTICLE_LAYER_COUNT);
+
+	if (particles->effectCount == PARTICLES_MAX_EFFECT_COUNT)
+	{
+		return PARTICLE_EFFECT_INVALID;
+	}
+
+	const particle_effect_t effect = particles->effectCount;
+	particle_effect_state_t* state = &particles->effectState[effect];
+
+	if (!particle_soa_create(&state->particles, desc->maxCount))
+	{
+		return PARTICLE_EFFECT_INVALID;
+	}
+
+	// the cpu backend writes every effect's particles to the frame's buffer, after the test orbit
+	if (particles->backend == PARTICLES_BACKEND_CPU &&
+		particles->particleCapacity + state->particles.capacity > MAX_PARTICLE_COUNT - TEST_ORBIT_COUNT)
+	{
+		particle_soa_destroy(&state->particles);
+		return PARTICLE_EFFECT_INVALID;
+	}
+
+	particles->particleCapacity += state->particles.capacity;
+	state->rng = effect;
+
+	// the tick constants are per tick, the desc's are per millisecond
+	particles->effectInfo[effect] = (particle_effect_info_t){
+		.desc			= *desc,
+		.windAmount		= desc->windCoupling * DELTA_TIME_MS,
+		.swayAmplitude	= desc->swayAmplitude * DELTA_TIME_MS,
+		.style			= {
+			.size		= desc->size,
+			.endSize	= desc->endSize,
+			.layer		= desc->layer,
+			.color		= desc->color,
+		},
+	};
+
+	const particle_effect_info_t* info = &particles->effectInfo[effect];
+	particles->gpuEffects[effect] = (gpu_particle_effect_t){
+		.damping		= desc->damping,
+		.windAmount		= info->windAmount,
+		.swayFrequency	= desc->swayFrequency,
+		.swayAmplitude	= info->swayAmplitude,
+		.size			= desc->size,
+		.layer			= desc->layer,
+		.color			= desc->color,
+		.endSize		= desc->endSize,
+	};
+
+	++particles->effectCount;
+	particles_sort_effects(particles);
+	return effect;
 }
 
 void particles_alloc_staging_mem(staging_memory_allocator_t* allocator, particles_t* particles)
 {
+	if (particles->backend == PARTICLES_BACKEND_GPU)
+	{
+		particles_gpu_alloc_staging_mem(allocator, particles->gpu);
+		return;
+	}
+
 	for (int i = 0; i < FRAME_COUNT; ++i)
 	{
 		particles_frame_t* frame = &particles->frames[i];
@@ -149,210 +287,363 @@ void particles_alloc_staging_mem(staging_memory_allocator_t* allocator, particle
 	}
 }
 
-void particles_tick(particles_t* particles)
+static void particles_frame_reset(particles_frame_t* frame, uint generation)
 {
-	particles->elapsedTime += DELTA_TIME_MS;
+	frame->gpuParticleCount = 0;
+	memset(frame->layerFirst, 0, sizeof(frame->layerFirst));
+	memset(frame->layerCount, 0, sizeof(frame->layerCount));
+	frame->generation = generation;
+}
 
-	const particle_tick_external_state_t external = {
-		.wind = particles->wind,
-	};
-	
-	for (int effectIndex = 0; effectIndex < PARTICLE_EFFECT_COUNT; ++effectIndex)
+// Accounts for count more particles of layer written to the frame. Writing the effects in effectOrder keeps every
+// layer in one range.
+static void particles_frame_append(particles_frame_t* frame, uint layer, uint count)
+{
+	if (frame->layerCount[layer] == 0)
 	{
-		const particle_effect_info_t* info = &g_particleEffectInfo[effectIndex];
-		particle_effect_state_t* state = &particles->effectState[effectIndex];
-
-		(*info->tick)(state, &external);
-		
-#if 0
-		printf("particle count [%d]: %u\n", effectIndex, state->count);
-#endif
+		frame->layerFirst[layer] = frame->gpuParticleCount;
 	}
+	frame->layerCount[layer] += count;
+	frame->gpuParticleCount += count;
 }
 
-void particles_render(particles_t* particles, const render_context_t* rc)
+void particles_set_test_orbit(particles_t* particles, bool enabled)
 {
-	particles_frame_t* frame = &particles->frames[rc->frameIndex];
+	particles_test_orbit_t* orbit = &particles->testOrbit;
+	if (orbit->enabled == enabled)
+	{
+		return;
+	}
 
-	frame->gpuParticleCount = 0;
-	
-	gpu_particle_t* gpuParticles = (gpu_particle_t*)frame->particleBufferMemory;
+	orbit->enabled = enabled;
+	++particles->generation;
 
-#if 1
-	srand(42);
-	for (int i = 0; i < 64; ++i)
+	// the same orbits every time
+	uint rng = 42;
+	for (int i = 0; i < TEST_ORBIT_COUNT; ++i)
 	{
-		const float x = rand() / (float)RAND_MAX;
-		const float y = rand() / (float)RAND_MAX;
-		const float t = (rand() / (float)RAND_MAX) / 100.0f + 0.001f;
-		const float s = (rand() / (float)RAND_MAX) * 3.14f;
+		const float x = lcg_randf(&rng);
+		const float y = lcg_randf(&rng);
+		const float t = lcg_randf(&rng) / 100.0f + 0.001f;
+		const float s = lcg_randf(&rng) * 3.14f;
 		const float sr = sinf(t + s);
 		const float r = (sr * 0.5f + 0.5f);
+
+		orbit->radius[i]		= (vec2){ x, y };
+		orbit->speed[i]			= t;
+		orbit->sizeAndLayer[i]	= pack_size_and_layer(0.05f + sr * 0.05f, 0);
+		orbit->color[i]			= 0xff000000 | (int)(r * 255.0f) | ((int)((1.0f - r) * 255.0f) << 8);
+	}
+}
+
+static uint particles_write_test_orbit(gpu_particle_t* gpuParticles, const particles_test_orbit_t* orbit, float elapsedTime)
+{
+	for (int i = 0; i < TEST_ORBIT_COUNT; ++i)
+	{
+		const float t = orbit->speed[i];
 		gpuParticles[i] = (gpu_particle_t){
-			.center.x = sinf(particles->elapsedTime * t) * x,
-			.center.y = cosf(particles->elapsedTime * t) * y,
-			.sizeAndLayer = pack_size_and_layer(0.05f + sr * 0.05f, 0),
-			.color = 0xff000000 | (int)(r * 255.0f) | ((int)((1.0f - r) * 255.0f) << 8),
+			.center.x = sinf(elapsedTime * t) * orbit->radius[i].x,
+			.center.y = cosf(elapsedTime * t) * orbit->radius[i].y,
+			.sizeAndLayer = orbit->sizeAndLayer[i],
+			.color = orbit->color[i],
 		};
 	}
-	gpuParticles += 64;
-	frame->gpuParticleCount += 64;
-#endif
+	return TEST_ORBIT_COUNT;
+}
+
+static void particles_tick_internal(particles_t* particles, particles_frame_t* frame)
+{
+	particles->elapsedTime += DELTA_TIME_MS;
+	++particles->generation;
+
+	if (particles->backend == PARTICLES_BACKEND_GPU)
+	{
+		++particles->gpuTickCount;
+		return;
+	}
+
+	gpu_particle_t* gpuParticles = NULL;
+	if (frame != NULL)
+	{
+		gpuParticles = (gpu_particle_t*)frame->particleBufferMemory;
+		particles_frame_reset(frame, particles->generation);
+	}
 	
-	for (int effectIndex = 0; effectIndex < PARTICLE_EFFECT_COUNT; ++effectIndex)
+	for (uint i = 0; i < particles->effectCount; ++i)
 	{
-		const particle_effect_info_t* info = &g_particleEffectInfo[effectIndex];
+		const uint effectIndex = particles->effectOrder[i];
+		const particle_effect_info_t* info = &particles->effectInfo[effectIndex];
 		particle_effect_state_t* state = &particles->effectState[effectIndex];
+		if (state->particles.count == 0)
+		{
+			continue;
+		}
 
-		(*info->render)(gpuParticles, state);
+		particles_tick_effect(info, state, particles->wind, gpuParticles);
 
-		gpuParticles += state->count;
-		frame->gpuParticleCount += state->count;
+		if (gpuParticles != NULL)
+		{
+			gpuParticles += state->particles.count;
+			particles_frame_append(frame, info->style.layer, state->particles.count);
+		}
+		
+#if 0
+		printf("particle count [%d]: %u\n", effectIndex, state->particles.count);
+#endif
 	}
-}
 
+	if (gpuParticles != NULL && particles->testOrbit.enabled)
+	{
+		const uint orbitCount = particles_write_test_orbit(gpuParticles, &particles->testOrbit, particles->elapsedTime);
+		particles_frame_append(frame, 0, orbitCount);
+	}
+}
 
-void particles_spawn(particles_t* particles, particle_effect_t effect, particle_spawn_t spawn)
+void particles_tick(particles_t* particles)
 {
-	const particle_effect_info_t* info = &g_particleEffectInfo[effect];
-	particle_effect_state_t* state = &particles->effectState[effect];
+	particles_tick_internal(particles, NULL);
+}
 
-	(*info->spawn)(state, spawn);
+void particles_tick_and_write(particles_t* particles, uint frameIndex)
+{
+	particles_tick_internal(particles, &particles->frames[frameIndex]);
 }
 
-void particles_get_render_info(particles_render_info_t* info, particles_t* particles, uint frameIndex)
+static void particles_update_gpu(particles_t* particles, VkCommandBuffer cb, const render_context_t* rc)
 {
-	particles_frame_t* frame = &particles->frames[frameIndex];
+	uint spawnCount = 0;
 
-	info->particleCount		= frame->gpuParticleCount;
-	info->particleBuffer	= (VkDescriptorBufferInfo){frame->particleBuffer, 0, info->particleCount * sizeof(gpu_particle_t)};
+	for (uint effectIndex = 0; effectIndex < particles->effectCount; ++effectIndex)
+	{
+		particle_soa_t* spawns = &particles->effectState[effectIndex].particles;
+
+		// whatever doesn't fit waits for the next frame, taken from the back so the rest stays put
+		const uint room = MAX_GPU_SPAWN_COUNT - spawnCount;
+		const uint count = spawns->count < room ? spawns->count : room;
+
+		for (uint i = spawns->count - count; i < spawns->count; ++i)
+		{
+			particles->gpuSpawns[spawnCount++] = (gpu_particle_state_t){
+				.pos		= { spawns->posX[i], spawns->posY[i] },
+				.vel		= { spawns->velX[i], spawns->velY[i] },
+				.age		= spawns->age[i],
+				.lifetime	= spawns->lifetime[i],
+				.effect		= effectIndex,
+			};
+		}
+		spawns->count -= count;
+	}
+
+	wind_render_info_t windInfo;
+	wind_get_render_info(&windInfo, particles->wind);
+
+	const particles_gpu_update_t update = {
+		.tickCount			= particles->gpuTickCount,
+		.dt					= DELTA_TIME_MS,
+		.windGrid			= windInfo.gridBuffer,
+		.windGridResolution	= windInfo.gridResolution,
+		.effectCount		= particles->effectCount,
+		.effects			= particles->gpuEffects,
+		.spawnCount			= spawnCount,
+		.spawns				= particles->gpuSpawns,
+	};
+	particles_gpu_update(cb, particles->gpu, rc, &update);
+
+	particles->gpuTickCount = 0;
 }
 
-static void particles_footstep_dust_spawn(particle_effect_state_t* state, particle_spawn_t spawn)
+void particles_update(particles_t* particles, VkCommandBuffer cb, const render_context_t* rc)
 {
-	const uint spawnCount = 5 + (lcg_rand(&state->rng) % 5);
-	
-	footstep_dust_particle_t* spawnParticles = (footstep_dust_particle_t*)state->particles + state->count;
-	for (uint i = 0; i < spawnCount; ++i)
-	{
-		const float x = lcg_randf(&state->rng) * 2.0f - 1.0f;
-		spawnParticles[i] = (footstep_dust_particle_t){
-			.lifetime = 1000.0f,
-			.pos.x = spawn.pos.x + x * 0.1f,
-			.pos.y = spawn.pos.y,
-			.vel.x = x * 0.001f,
-			.vel.y = lcg_randf_range(&state->rng, 0.0005f, 0.001f),
-		};
+	if (particles->backend == PARTICLES_BACKEND_GPU)
+	{
+		particles_update_gpu(particles, cb, rc);
+		return;
+	}
+
+	particles_frame_t* frame = &particles->frames[rc->frameIndex];
+
+	// already written by particles_tick_and_write, and nothing has changed since
+	if (frame->generation == particles->generation)
+	{
+		return;
 	}
+
+	particles_frame_reset(frame, particles->generation);
 	
-	state->count += spawnCount;
-}
+	gpu_particle_t* gpuParticles = (gpu_particle_t*)frame->particleBufferMemory;
 
-static void particles_footstep_dust_tick(particle_effect_state_t* state, const particle_tick_external_state_t* external)
-{
-	footstep_dust_particle_t* particles = (footstep_dust_particle_t*)state->particles;
+	for (uint i = 0; i < particles->effectCount; ++i)
+	{
+		const uint effectIndex = particles->effectOrder[i];
+		const particle_effect_info_t* info = &particles->effectInfo[effectIndex];
+		particle_effect_state_t* state = &particles->effectState[effectIndex];
+
+		particle_soa_write(gpuParticles, &state->particles, &info->style);
 
-	for (uint i = 0; i < state->count;)
+		gpuParticles += state->particles.count;
+		particles_frame_append(frame, info->style.layer, state->particles.count);
+	}
+
+	if (particles->testOrbit.enabled)
 	{
-		footstep_dust_particle_t* p = &particles[i];
-		p->pos = vec2_add(p->pos, vec2_scale(p->vel, DELTA_TIME_MS));
-		p->vel = vec2_scale(p->vel, 0.9f);
-		p->age += DELTA_TIME_MS;
-		
-		const bool isDead = p->age >= p->lifetime;
-		if (isDead)
-		{
-			particles[i] = particles[--state->count];
-		}
-		else
-		{
-			++i;
-		}
+		const uint orbitCount = particles_write_test_orbit(gpuParticles, &particles->testOrbit, particles->elapsedTime);
+		particles_frame_append(frame, 0, orbitCount);
 	}
 }
 
-static void particles_footstep_dust_render(gpu_particle_t* gpuParticles, const particle_effect_state_t* state)
+void particles_spawn(particles_t* particles, particle_effect_t effect, particle_spawn_t spawn)
+{
+	particles_spawn_many(particles, effect, &spawn, 1);
+}
+
+uint particles_spawn_many(particles_t* particles, particle_effect_t effect, const particle_spawn_t* spawns, uint count)
 {
-	const footstep_dust_particle_t* particles = (footstep_dust_particle_t*)state->particles;
+	assert(effect < particles->effectCount);
+	const particle_effect_info_t* info = &particles->effectInfo[effect];
+	particle_effect_state_t* state = &particles->effectState[effect];
 
-	for (uint i = 0; i < state->count; ++i)
+	const uint spawned = particles_spawn_effect(info, state, spawns, count);
+	if (spawned > 0)
 	{
-		const footstep_dust_particle_t* p = &particles[i];
+		++particles->generation;
+	}
+
+	const uint dropped = count - spawned;
+	particles->droppedSpawnCount += dropped;
+	return dropped;
+}
 
-		const float tage = p->age / p->lifetime;
+uint particles_get_dropped_spawn_count(const particles_t* particles)
+{
+	return particles->droppedSpawnCount;
+}
 
-		gpuParticles[i] = (gpu_particle_t){
-			.center = p->pos,
-			.color = 0xff00222f,
-			.sizeAndLayer = pack_size_and_layer(lerpf(0.2f, 0.0f, tage), 0),
-		};
+uint64_t particles_hash_state(const particles_t* particles, uint64_t hash)
+{
+	hash = fnv1a64(&particles->droppedSpawnCount, sizeof(particles->droppedSpawnCount), hash);
+
+	for (uint i = 0; i < particles->effectCount; ++i)
+	{
+		const particle_effect_state_t* state = &particles->effectState[i];
+		const particle_soa_t* soa = &state->particles;
+		const size_t size = soa->count * sizeof(float);
+
+		hash = fnv1a64(&state->rng, sizeof(state->rng), hash);
+		hash = fnv1a64(&soa->count, sizeof(soa->count), hash);
+		hash = fnv1a64(soa->posX, size, hash);
+		hash = fnv1a64(soa->posY, size, hash);
+		hash = fnv1a64(soa->velX, size, hash);
+		hash = fnv1a64(soa->velY, size, hash);
+		hash = fnv1a64(soa->age, size, hash);
+		hash = fnv1a64(soa->lifetime, size, hash);
 	}
+
+	return hash;
 }
 
-static void particles_ambient_pollen_spawn(particle_effect_state_t* state, particle_spawn_t spawn)
+uint particles_get_count(const particles_t* particles, uint frameIndex)
 {
-	const uint spawnCount = 1;
-	
-	ambient_pollen_particle_t* spawnParticles = (ambient_pollen_particle_t*)state->particles + state->count;
-	for (uint i = 0; i < spawnCount; ++i)
-	{
-		const float x = lcg_randf(&state->rng) * 2.0f - 1.0f;
-		spawnParticles[i] = (ambient_pollen_particle_t){
-			.lifetime = lcg_randf_range(&state->rng, 10000.0f, 15000.0f),
-			.pos.x = spawn.pos.x,
-			.pos.y = spawn.pos.y,
-			.vel.x = x * 0.0001f,
-			.vel.y = lcg_randf_range(&state->rng, 0.00005f, 0.0003f),
-		};
+	if (particles->backend == PARTICLES_BACKEND_GPU)
+	{
+		return particles_gpu_get_count(particles->gpu, frameIndex);
 	}
-	
-	state->count += spawnCount;
+
+	uint count = 0;
+	for (uint effectIndex = 0; effectIndex < particles->effectCount; ++effectIndex)
+	{
+		count += particles->effectState[effectIndex].particles.count;
+	}
+	return count;
 }
 
-static void particle_sample_wind(vec2* pos, float amount, const particle_tick_external_state_t* external)
+void particles_get_render_info(particles_render_info_t* info, particles_t* particles, uint frameIndex)
 {
-	*pos = vec2_add(*pos, vec2_scale(wind_sample(external->wind, *pos), amount * DELTA_TIME_MS));
+	if (particles->backend == PARTICLES_BACKEND_GPU)
+	{
+		particles_gpu_get_render_info(info, particles->gpu);
+		return;
+	}
+
+	particles_frame_t* frame = &particles->frames[frameIndex];
+
+	info->particleCount		= frame->gpuParticleCount;
+	info->particleBuffer	= (VkDescriptorBufferInfo){frame->particleBuffer, 0, info->particleCount * sizeof(gpu_particle_t)};
+	memcpy(info->layerFirst, frame->layerFirst, sizeof(info->layerFirst));
+	memcpy(info->layerCount, frame->layerCount, sizeof(info->layerCount));
+	info->drawBuffer		= VK_NULL_HANDLE;
+	info->drawOffset		= 0;
 }
 
-static void particles_ambient_pollen_tick(particle_effect_state_t* state, const particle_tick_external_state_t* external)
+static uint particles_spawn_effect(const particle_effect_info_t* info, particle_effect_state_t* state, const particle_spawn_t* spawns, uint count)
 {
-	ambient_pollen_particle_t* particles = (ambient_pollen_particle_t*)state->particles;
+	const particle_effect_desc_t* desc = &info->desc;
+	particle_soa_t* soa = &state->particles;
 
-	for (uint i = 0; i < state->count;)
+	for (uint spawnIndex = 0; spawnIndex < count; ++spawnIndex)
 	{
-		ambient_pollen_particle_t* p = &particles[i];
-		particle_sample_wind(&p->pos, 0.004f, external);
-		p->pos = vec2_add(p->pos, vec2_scale(p->vel, DELTA_TIME_MS));
-		p->pos.x += sinf(p->age * 0.0025f) * DELTA_TIME_MS * 0.0004f;
-		p->age += DELTA_TIME_MS;
-		
-		const bool isDead = p->age >= p->lifetime;
-		if (isDead)
+		const vec2 spawnPos = spawns[spawnIndex].pos;
+
+		uint particleCount = desc->minBurst;
+		if (desc->maxBurst > desc->minBurst)
+		{
+			particleCount += lcg_rand(&state->rng) % (desc->maxBurst - desc->minBurst + 1);
+		}
+
+		if (soa->capacity - soa->count < particleCount)
 		{
-			particles[i] = particles[--state->count];
+			return spawnIndex;
 		}
-		else
+
+		for (uint i = 0; i < particleCount; ++i)
 		{
-			++i;
+			const float x = lcg_randf(&state->rng) * 2.0f - 1.0f;
+			float lifetime = desc->minLifetime;
+			if (desc->maxLifetime > desc->minLifetime)
+			{
+				lifetime = lcg_randf_range(&state->rng, desc->minLifetime, desc->maxLifetime);
+			}
+			const vec2 pos = { spawnPos.x + x * desc->spreadX, spawnPos.y };
+			const vec2 vel = { x * desc->spreadVelX, lcg_randf_range(&state->rng, desc->minVelY, desc->maxVelY) };
+			particle_soa_push(soa, pos, vel, lifetime);
 		}
 	}
+	return count;
 }
 
-static void particles_ambient_pollen_render(gpu_particle_t* gpuParticles, const particle_effect_state_t* state)
+static void particles_tick_effect(const particle_effect_info_t* info, particle_effect_state_t* state, const wind_t* wind, gpu_particle_t* gpuParticles)
 {
-	const ambient_pollen_particle_t* particles = (ambient_pollen_particle_t*)state->particles;
+	particle_soa_t* particles = &state->particles;
 
-	for (uint i = 0; i < state->count; ++i)
+	if (info->windAmount != 0.0f)
 	{
-		const ambient_pollen_particle_t* p = &particles[i];
+		float windX[WIND_SAMPLE_BATCH_SIZE];
+		float windY[WIND_SAMPLE_BATCH_SIZE];
 
-		const float tage = p->age / p->lifetime;
+		for (uint i = 0; i < particles->count; i += WIND_SAMPLE_BATCH_SIZE)
+		{
+			const uint count = (particles->count - i) < WIND_SAMPLE_BATCH_SIZE ? (particles->count - i) : WIND_SAMPLE_BATCH_SIZE;
+			wind_sample_many(wind, particles->posX + i, particles->posY + i, windX, windY, count);
+
+			for (uint j = 0; j < count; ++j)
+			{
+				particles->posX[i + j] += windX[j] * info->windAmount;
+				particles->posY[i + j] += windY[j] * info->windAmount;
+			}
+		}
+	}
 
-		gpuParticles[i] = (gpu_particle_t){
-			.center = p->pos,
-			.color = 0xffffffff,
-			.sizeAndLayer = pack_size_and_layer(lerpf(0.08f, 0.0f, tage), 1),
-			//.size = 0.05f,
-		};
+	// sways with the age from before this tick, so it has to go ahead of integrate
+	if (info->swayAmplitude != 0.0f)
+	{
+		particle_soa_sway(particles, info->desc.swayFrequency, info->swayAmplitude);
 	}
-}
\ No newline at end of file
+
+	if (gpuParticles != NULL)
+	{
+		particle_soa_integrate_write(particles, DELTA_TIME_MS, info->desc.damping, gpuParticles, &info->style);
+		return;
+	}
+
+	particle_soa_integrate(particles, DELTA_TIME_MS, info->desc.damping);
+	particle_soa_compact(particles);
+}
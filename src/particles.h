@@ -5,23 +5,81 @@
 #include "staging_memory.h"
 #include "render_context.h"
 #include "wind.h"
+#include "../shaders/gpu_types.h"
+
+#include <stdbool.h>
 
 typedef struct particles particles_t;
 
-particles_t* particles_create(vulkan_t* vulkan, wind_t* wind);
+typedef enum particles_backend
+{
+	// simulated on the cpu, and uploaded every frame
+	PARTICLES_BACKEND_CPU,
+	// simulated by compute shaders in device local memory, and drawn indirectly. Spawns are uploaded once per
+	// frame and ticked along with the particles already alive, so a spawn can age up to a frame's worth of ticks
+	// early. The test orbit isn't drawn.
+	PARTICLES_BACKEND_GPU,
+} particles_backend_t;
+
+particles_t* particles_create(vulkan_t* vulkan, wind_t* wind, particles_backend_t backend);
 void particles_destroy(particles_t* particles);
 
 void particles_alloc_staging_mem(staging_memory_allocator_t* allocator, particles_t* particles);
 
+// Draws a fixed set of particles circling the origin on top of the effects, to check the particle path works
+// without spawning anything. Off by default.
+void particles_set_test_orbit(particles_t* particles, bool enabled);
+
 void particles_tick(particles_t* particles);
-void particles_render(particles_t* particles, const render_context_t* rc);
+// particles_tick, writing frameIndex's gpu particles on the way instead of leaving it to particles_update. Meant for
+// the last tick before a frame is rendered, and the frame's buffer has to be out of use by the gpu.
+void particles_tick_and_write(particles_t* particles, uint frameIndex);
+// Writes the frame's gpu particles, or with the gpu backend records the frame's spawns and ticks. Has to come after
+// wind_update.
+void particles_update(particles_t* particles, VkCommandBuffer cb, const render_context_t* rc);
 
-typedef enum particle_effect
+#define PARTICLES_MAX_EFFECT_COUNT 256
+#define PARTICLE_EFFECT_INVALID (~0u)
+
+// An effect registered with particles_register_effect. The built in ones are registered by particles_create.
+typedef uint particle_effect_t;
+
+enum
 {
 	PARTICLE_EFFECT_FOOTSTEP_DUST,
 	PARTICLE_EFFECT_AMBIENT_POLLEN,
-	PARTICLE_EFFECT_COUNT,
-} particle_effect_t;
+	PARTICLE_EFFECT_BUILTIN_COUNT,
+};
+
+// An effect as plain data, all of it run by the same spawn and tick code. Times are in milliseconds, and each
+// particle picks its random values uniformly from the min to max ranges.
+typedef struct particle_effect_desc
+{
+	uint	maxCount; // live particles, spawns past it are dropped
+
+	uint	minBurst; // particles per spawn
+	uint	maxBurst;
+	float	minLifetime;
+	float	maxLifetime;
+	float	spreadX; // particles start up to this far either side of the spawn position
+	float	spreadVelX; // and drift sideways at up to this speed, away from it
+	float	minVelY;
+	float	maxVelY;
+
+	float	damping; // velocity multiplier applied every tick
+	float	windCoupling; // fraction of the wind velocity the particles move with
+	float	swayFrequency; // radians per millisecond of age
+	float	swayAmplitude; // sideways speed at the peak of the sway
+
+	float	size; // [0, 1], changing linearly to endSize over the lifetime
+	float	endSize;
+	uint	layer;
+	uint	color;
+} particle_effect_desc_t;
+
+// Returns PARTICLE_EFFECT_INVALID when out of effects, or when the cpu backend has no room left for maxCount more
+// particles in its frame buffers. Effects live as long as particles does.
+particle_effect_t particles_register_effect(particles_t* particles, const particle_effect_desc_t* desc);
 
 typedef struct particle_spawn
 {
@@ -29,11 +87,32 @@ typedef struct particle_spawn
 } particle_spawn_t;
 
 void particles_spawn(particles_t* particles, particle_effect_t effect, particle_spawn_t spawn);
+// Spawns in order until the effect is full and drops the rest, returning how many were dropped. With the gpu
+// backend this only bounds the spawns queued up for the next particles_update.
+uint particles_spawn_many(particles_t* particles, particle_effect_t effect, const particle_spawn_t* spawns, uint count);
+// Total dropped by particles_spawn and particles_spawn_many since creation.
+uint particles_get_dropped_spawn_count(const particles_t* particles);
+
+// Continues an fnv1a64 hash with the cpu side particle state, for checking that two runs simulated the same thing.
+// With the gpu backend that's only the spawns queued up for the next particles_update.
+uint64_t particles_hash_state(const particles_t* particles, uint64_t hash);
+
+// Number of live particles. The gpu backend reads it back, so it's the count as of frameIndex's last
+// particles_update and is only valid once the gpu has finished that frame.
+uint particles_get_count(const particles_t* particles, uint frameIndex);
 
+// The particles are binned by layer, back to front, so each layer is one draw and blending comes out right
+// without sorting. Layer l is layerCount[l] particles from layerFirst[l].
 typedef struct particles_render_info
 {
 	uint					particleCount;
 	VkDescriptorBufferInfo	particleBuffer;
+	uint					layerFirst[PARTICLE_LAYER_COUNT];
+	uint					layerCount[PARTICLE_LAYER_COUNT];
+	// when set, layer l is instead drawn with vkCmdDrawIndirect from drawOffset + l * sizeof(VkDrawIndirectCommand),
+	// the layer ranges are unknown and particleCount is only an upper bound
+	VkBuffer				drawBuffer;
+	VkDeviceSize			drawOffset;
 } particles_render_info_t;
 
-void particles_get_render_info(particles_render_info_t* info, particles_t* particles, uint frameIndex);
\ No newline at end of file
+void particles_get_render_info(particles_render_info_t* info, particles_t* particles, uint frameIndex);
@@ -0,0 +1,401 @@
+#include "particles_gpu.h"
+#include "shaders.h"
+#include "descriptors.h"
+#include "common.h"
+#include "util.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+_Static_assert(offsetof(gpu_particle_counters_t, aliveCount0) == PARTICLE_COUNTERS_ALIVE_OFFSET(0), "");
+_Static_assert(offsetof(gpu_particle_counters_t, aliveCount1) == PARTICLE_COUNTERS_ALIVE_OFFSET(1), "");
+_Static_assert(offsetof(gpu_particle_counters_t, dispatchX) == PARTICLE_COUNTERS_DISPATCH_OFFSET, "");
+_Static_assert(offsetof(gpu_particle_counters_t, layerCount) == PARTICLE_COUNTERS_LAYER_OFFSET(0), "");
+_Static_assert(offsetof(gpu_particle_counters_t, layerDraws) == PARTICLE_COUNTERS_DRAW_OFFSET(0), "");
+_Static_assert(PARTICLE_COUNTERS_DRAW_OFFSET(1) - PARTICLE_COUNTERS_DRAW_OFFSET(0) == sizeof(VkDrawIndirectCommand), "");
+
+typedef struct particles_gpu_frame
+{
+	VkBuffer					effectBuffer;
+	gpu_particle_effect_t*		effectMemory;
+	VkBuffer					spawnBuffer;
+	gpu_particle_state_t*		spawnMemory;
+	VkBuffer					readbackBuffer;
+	gpu_particle_counters_t*	readbackMemory;
+	uint						readbackSrc; // the state buffer that was live when the counters were read back
+} particles_gpu_frame_t;
+
+typedef struct particles_gpu
+{
+	vulkan_t*				vulkan;
+	uint					maxCount;
+	uint					maxSpawnCount;
+
+	VkDescriptorSetLayout	descriptorSetLayout;
+	VkPipelineLayout		pipelineLayout;
+	VkPipeline				spawnPipeline;
+	VkPipeline				preparePipeline;
+	VkPipeline				tickPipeline;
+	VkPipeline				binScanPipeline;
+	VkPipeline				binScatterPipeline;
+
+	VkBuffer				stateBuffers[2];
+	VkDeviceMemory			stateBufferMemory[2];
+	VkBuffer				particleBuffer;
+	VkDeviceMemory			particleBufferMemory;
+	VkBuffer				counterBuffer;
+	VkDeviceMemory			counterBufferMemory;
+	bool					countersCleared;
+	uint					src; // which of stateBuffers holds the live particles
+
+	particles_gpu_frame_t	frames[FRAME_COUNT];
+} particles_gpu_t;
+
+static int particles_gpu_create_pipelines(particles_gpu_t* gpu, vulkan_t* vulkan)
+{
+	const VkDescriptorSetLayoutBinding bindings[] = {
+		{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+		{ 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
+	};
+	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = {
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = countof(bindings),
+		.pBindings = bindings,
+	};
+	if (vkCreateDescriptorSetLayout(vulkan->device, &descriptorSetLayoutInfo, NULL, &gpu->descriptorSetLayout) != VK_SUCCESS) {
+		return 1;
+	}
+	SetDescriptorSetLayoutName(vulkan, gpu->descriptorSetLayout, "Particle Simulation");
+
+	const VkPushConstantRange pushConstantRange = {
+		VK_SHADER_STAGE_COMPUTE_BIT,
+		0,
+		sizeof(gpu_particle_sim_constants_t),
+	};
+	const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &gpu->descriptorSetLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange,
+	};
+	if (vkCreatePipelineLayout(vulkan->device, &pipelineLayoutInfo, NULL, &gpu->pipelineLayout) != VK_SUCCESS) {
+		return 1;
+	}
+	SetPipelineLayoutName(vulkan, gpu->pipelineLayout, "Particle Simulation");
+
+	const struct
+	{
+		VkPipeline*	pipeline;
+		enum shader	shader;
+		const char*	entryPoint;
+		const char*	name;
+	} pipelines[] = {
+		{ &gpu->spawnPipeline, SHADER_PARTICLE_SPAWN_COMP, "cs_spawn", "Particle Spawn" },
+		{ &gpu->preparePipeline, SHADER_PARTICLE_PREPARE_COMP, "cs_prepare", "Particle Prepare" },
+		{ &gpu->tickPipeline, SHADER_PARTICLE_TICK_COMP, "cs_tick", "Particle Tick" },
+		{ &gpu->binScanPipeline, SHADER_PARTICLE_BIN_SCAN_COMP, "cs_bin_scan", "Particle Bin Scan" },
+		{ &gpu->binScatterPipeline, SHADER_PARTICLE_BIN_SCATTER_COMP, "cs_bin_scatter", "Particle Bin Scatter" },
+	};
+
+	for (int i = 0; i < countof(pipelines); ++i)
+	{
+		const VkComputePipelineCreateInfo createInfo = {
+			VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = {
+				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = g_shaders.modules[pipelines[i].shader],
+				.pName = pipelines[i].entryPoint,
+			},
+			.layout = gpu->pipelineLayout,
+		};
+		if (vkCreateComputePipelines(vulkan->device, NULL, 1, &createInfo, NULL, pipelines[i].pipeline) != VK_SUCCESS) {
+			return 1;
+		}
+		SetPipelineName(vulkan, *pipelines[i].pipeline, pipelines[i].name);
+	}
+
+	return 0;
+}
+
+particles_gpu_t* particles_gpu_create(vulkan_t* vulkan, uint maxCount, uint maxSpawnCount)
+{
+	particles_gpu_t* gpu = calloc(1, sizeof(particles_gpu_t));
+	if (gpu == NULL)
+	{
+		return NULL;
+	}
+
+	gpu->vulkan			= vulkan;
+	gpu->maxCount		= maxCount;
+	gpu->maxSpawnCount	= maxSpawnCount;
+
+	if (particles_gpu_create_pipelines(gpu, vulkan) != 0)
+	{
+		fprintf(stderr, "Failed to create the particle simulation pipelines\n");
+		particles_gpu_destroy(gpu);
+		return NULL;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		gpu->stateBuffers[i] = CreateBuffer(
+			&gpu->stateBufferMemory[i],
+			vulkan,
+			maxCount * sizeof(gpu_particle_state_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		SetBufferName(vulkan, gpu->stateBuffers[i], "Particle State");
+	}
+
+	gpu->particleBuffer = CreateBuffer(
+		&gpu->particleBufferMemory,
+		vulkan,
+		maxCount * sizeof(gpu_particle_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	SetBufferName(vulkan, gpu->particleBuffer, "Particles");
+
+	gpu->counterBuffer = CreateBuffer(
+		&gpu->counterBufferMemory,
+		vulkan,
+		sizeof(gpu_particle_counters_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	SetBufferName(vulkan, gpu->counterBuffer, "Particle Counters");
+
+	return gpu;
+}
+
+void particles_gpu_destroy(particles_gpu_t* gpu)
+{
+	vulkan_t* vulkan = gpu->vulkan;
+
+	vkDestroyPipeline(vulkan->device, gpu->spawnPipeline, NULL);
+	vkDestroyPipeline(vulkan->device, gpu->preparePipeline, NULL);
+	vkDestroyPipeline(vulkan->device, gpu->tickPipeline, NULL);
+	vkDestroyPipeline(vulkan->device, gpu->binScanPipeline, NULL);
+	vkDestroyPipeline(vulkan->device, gpu->binScatterPipeline, NULL);
+	vkDestroyPipelineLayout(vulkan->device, gpu->pipelineLayout, NULL);
+	vkDestroyDescriptorSetLayout(vulkan->device, gpu->descriptorSetLayout, NULL);
+
+	for (int i = 0; i < 2; ++i)
+	{
+		vkDestroyBuffer(vulkan->device, gpu->stateBuffers[i], NULL);
+		vkFreeMemory(vulkan->device, gpu->stateBufferMemory[i], NULL);
+	}
+	vkDestroyBuffer(vulkan->device, gpu->particleBuffer, NULL);
+	vkFreeMemory(vulkan->device, gpu->particleBufferMemory, NULL);
+	vkDestroyBuffer(vulkan->device, gpu->counterBuffer, NULL);
+	vkFreeMemory(vulkan->device, gpu->counterBufferMemory, NULL);
+
+	for (int i = 0; i < FRAME_COUNT; ++i)
+	{
+		vkDestroyBuffer(vulkan->device, gpu->frames[i].effectBuffer, NULL);
+		vkDestroyBuffer(vulkan->device, gpu->frames[i].spawnBuffer, NULL);
+		vkDestroyBuffer(vulkan->device, gpu->frames[i].readbackBuffer, NULL);
+	}
+
+	free(gpu);
+}
+
+void particles_gpu_alloc_staging_mem(staging_memory_allocator_t* allocator, particles_gpu_t* gpu)
+{
+	for (int i = 0; i < FRAME_COUNT; ++i)
+	{
+		particles_gpu_frame_t* frame = &gpu->frames[i];
+
+		PushStagingBufferAllocation(
+			allocator,
+			&frame->effectBuffer,
+			(void**)&frame->effectMemory,
+			PARTICLES_GPU_MAX_EFFECT_COUNT * sizeof(gpu_particle_effect_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			"Particle Effects");
+
+		PushStagingBufferAllocation(
+			allocator,
+			&frame->spawnBuffer,
+			(void**)&frame->spawnMemory,
+			gpu->maxSpawnCount * sizeof(gpu_particle_state_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			"Particle Spawns");
+
+		PushStagingBufferAllocation(
+			allocator,
+			&frame->readbackBuffer,
+			(void**)&frame->readbackMemory,
+			sizeof(gpu_particle_counters_t),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			"Particle Counters Readback");
+	}
+}
+
+static void particles_gpu_barrier(VkCommandBuffer cb, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	const VkMemoryBarrier memoryBarrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = srcAccess,
+		.dstAccessMask = dstAccess,
+	};
+	vkCmdPipelineBarrier(cb, srcStage, dstStage, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+}
+
+void particles_gpu_update(VkCommandBuffer cb, particles_gpu_t* gpu, const render_context_t* rc, const particles_gpu_update_t* update)
+{
+	particles_gpu_frame_t* frame = &gpu->frames[rc->frameIndex];
+
+	assert(update->effectCount <= PARTICLES_GPU_MAX_EFFECT_COUNT);
+	assert(update->spawnCount <= gpu->maxSpawnCount);
+
+	memcpy(frame->effectMemory, update->effects, update->effectCount * sizeof(gpu_particle_effect_t));
+	PushStagingMemoryFlush(rc->stagingMemory, frame->effectMemory, update->effectCount * sizeof(gpu_particle_effect_t));
+
+	if (update->spawnCount > 0)
+	{
+		memcpy(frame->spawnMemory, update->spawns, update->spawnCount * sizeof(gpu_particle_state_t));
+		PushStagingMemoryFlush(rc->stagingMemory, frame->spawnMemory, update->spawnCount * sizeof(gpu_particle_state_t));
+	}
+
+	if (!gpu->countersCleared)
+	{
+		vkCmdFillBuffer(cb, gpu->counterBuffer, 0, VK_WHOLE_SIZE, 0);
+		gpu->countersCleared = true;
+	}
+
+	// waits for the wind grid upload and the counter clear, and for earlier frames to be done drawing the particles
+	// before they're overwritten
+	particles_gpu_barrier(cb,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	// one set per direction the state can flow in
+	VkDescriptorSet descriptorSets[2];
+	for (uint src = 0; src < 2; ++src)
+	{
+		descriptor_allocator_begin(rc->dsalloc, gpu->descriptorSetLayout, "Particle Simulation");
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 0, (VkDescriptorBufferInfo){ frame->effectBuffer, 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 1, (VkDescriptorBufferInfo){ frame->spawnBuffer, 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 2, (VkDescriptorBufferInfo){ update->windGrid, 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 3, (VkDescriptorBufferInfo){ gpu->counterBuffer, 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 4, (VkDescriptorBufferInfo){ gpu->stateBuffers[src], 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 5, (VkDescriptorBufferInfo){ gpu->stateBuffers[1 - src], 0, VK_WHOLE_SIZE });
+		descriptor_allocator_set_storage_buffer(rc->dsalloc, 6, (VkDescriptorBufferInfo){ gpu->particleBuffer, 0, VK_WHOLE_SIZE });
+		descriptorSets[src] = descriptor_allocator_end(rc->dsalloc);
+	}
+
+	gpu_particle_sim_constants_t constants = {
+		.src				= gpu->src,
+		.spawnCount			= update->spawnCount,
+		.maxCount			= gpu->maxCount,
+		.dt					= update->dt,
+		.windGridResolution	= update->windGridResolution,
+	};
+
+	if (update->spawnCount > 0)
+	{
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->pipelineLayout, 0, 1, &descriptorSets[constants.src], 0, NULL);
+		vkCmdPushConstants(cb, gpu->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->spawnPipeline);
+		vkCmdDispatch(cb, (update->spawnCount + PARTICLE_SIM_GROUP_SIZE - 1) / PARTICLE_SIM_GROUP_SIZE, 1, 1);
+
+		particles_gpu_barrier(cb,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+	}
+
+	for (uint i = 0; i < update->tickCount; ++i)
+	{
+		constants.binLayers = i + 1 == update->tickCount;
+
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->pipelineLayout, 0, 1, &descriptorSets[constants.src], 0, NULL);
+		vkCmdPushConstants(cb, gpu->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->preparePipeline);
+		vkCmdDispatch(cb, 1, 1, 1);
+
+		particles_gpu_barrier(cb,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->tickPipeline);
+		vkCmdDispatchIndirect(cb, gpu->counterBuffer, PARTICLE_COUNTERS_DISPATCH_OFFSET);
+
+		// the next prepare rewrites the dispatch arguments the tick was launched with
+		particles_gpu_barrier(cb,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		constants.src = 1 - constants.src;
+	}
+
+	gpu->src = constants.src;
+
+	// bins the survivors of the last tick by layer, which is all the particle buffer and the draws need to change
+	// for. Without a tick they stay as they were.
+	if (update->tickCount > 0)
+	{
+		constants.binLayers = 0;
+
+		vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->pipelineLayout, 0, 1, &descriptorSets[constants.src], 0, NULL);
+		vkCmdPushConstants(cb, gpu->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->binScanPipeline);
+		vkCmdDispatch(cb, 1, 1, 1);
+
+		particles_gpu_barrier(cb,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, gpu->binScatterPipeline);
+		vkCmdDispatchIndirect(cb, gpu->counterBuffer, PARTICLE_COUNTERS_DISPATCH_OFFSET);
+	}
+
+	particles_gpu_barrier(cb,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+	const VkBufferCopy copyRegion = {
+		.size = sizeof(gpu_particle_counters_t),
+	};
+	vkCmdCopyBuffer(cb, gpu->counterBuffer, frame->readbackBuffer, 1, &copyRegion);
+	frame->readbackSrc = gpu->src;
+
+	particles_gpu_barrier(cb,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
+
+uint particles_gpu_get_count(const particles_gpu_t* gpu, uint frameIndex)
+{
+	const particles_gpu_frame_t* frame = &gpu->frames[frameIndex];
+	const gpu_particle_counters_t* counters = frame->readbackMemory;
+
+	// staging memory is never invalidated, which is fine on the coherent host visible memory every desktop driver
+	// picks first. Spawns past maxCount are only clamped away by the next tick.
+	const uint count = frame->readbackSrc == 0 ? counters->aliveCount0 : counters->aliveCount1;
+	return count < gpu->maxCount ? count : gpu->maxCount;
+}
+
+void particles_gpu_get_render_info(particles_render_info_t* info, const particles_gpu_t* gpu)
+{
+	info->particleCount		= gpu->maxCount;
+	info->particleBuffer	= (VkDescriptorBufferInfo){ gpu->particleBuffer, 0, VK_WHOLE_SIZE };
+	memset(info->layerFirst, 0, sizeof(info->layerFirst));
+	memset(info->layerCount, 0, sizeof(info->layerCount));
+	info->drawBuffer		= gpu->counterBuffer;
+	info->drawOffset		= PARTICLE_COUNTERS_DRAW_OFFSET(0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.h"
+#include "vulkan.h"
+#include "staging_memory.h"
+#include "render_context.h"
+#include "particles.h"
+#include "../shaders/gpu_types.h"
+
+#define PARTICLES_GPU_MAX_EFFECT_COUNT PARTICLES_MAX_EFFECT_COUNT
+
+// Particle state in two device local buffers that the tick ping-pongs between. Each tick is a compute pass
+// that appends the survivors to the other buffer and to an indirect draw, so nothing on the cpu scales with
+// the particle count.
+typedef struct particles_gpu particles_gpu_t;
+
+particles_gpu_t* particles_gpu_create(vulkan_t* vulkan, uint maxCount, uint maxSpawnCount);
+void particles_gpu_destroy(particles_gpu_t* gpu);
+
+void particles_gpu_alloc_staging_mem(staging_memory_allocator_t* allocator, particles_gpu_t* gpu);
+
+typedef struct particles_gpu_update
+{
+	uint							tickCount;
+	float							dt;
+	VkBuffer						windGrid;
+	uint							windGridResolution;
+	uint							effectCount;
+	const gpu_particle_effect_t*	effects;
+	uint							spawnCount;
+	const gpu_particle_state_t*		spawns;
+} particles_gpu_update_t;
+
+// Records the spawns followed by tickCount ticks. The wind grid may have been written by a transfer earlier in
+// cb, and the particles are ready to draw afterwards.
+void particles_gpu_update(VkCommandBuffer cb, particles_gpu_t* gpu, const render_context_t* rc, const particles_gpu_update_t* update);
+
+// See particles_get_count.
+uint particles_gpu_get_count(const particles_gpu_t* gpu, uint frameIndex);
+void particles_gpu_get_render_info(particles_render_info_t* info, const particles_gpu_t* gpu);
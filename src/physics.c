@@ -0,0 +1,404 @@
+#include "physics.h"
+#include "vec.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <assert.h>
+
+// A body's entry in the sweep and prune order, with its x extent this tick.
+typedef struct physics_sweep
+{
+	float	minX;
+	float	maxX;
+	uint	index;
+} physics_sweep_t;
+
+struct physics
+{
+	uint				capacity;
+	uint				count;
+	float				gravity;
+
+	// bodies, dense in [0, count) in no particular order
+	vec2*				center;
+	vec2*				halfSize;
+	vec2*				vel;
+	vec2*				move;
+	vec2*				delta;
+	float*				invMass;
+	float*				gravityScale;
+	uint*				contacts;
+	bool*				supported;	// stood on something last tick
+	uint*				handle;
+
+	// handle -> dense index, or the next free handle for free ones
+	uint*				slot;
+	uint				freeHandle;
+
+	// sorted by minX, and kept in order from one tick to the next so that sorting it again is cheap
+	physics_sweep_t*	sweep;
+	bool				sweepDirty;
+
+	// scratch for collision_move_bodies
+	collision_body_t*	moves;
+	uint*				moveIndices;
+	collision_scratch_t	collisionScratch;
+};
+
+static const vec2 physicsBoxNormals[4] =
+{
+	{0.0f, -1.0f},
+	{1.0f, 0.0f},
+	{0.0f, 1.0f},
+	{-1.0f, 0.0f},
+};
+
+physics_t* physics_create(uint capacity, float gravity)
+{
+	physics_t* physics = calloc(1, sizeof(physics_t));
+	if (physics == NULL)
+	{
+		return NULL;
+	}
+
+	physics->capacity		= capacity;
+	physics->gravity		= gravity;
+	physics->center			= malloc(capacity * sizeof(vec2));
+	physics->halfSize		= malloc(capacity * sizeof(vec2));
+	physics->vel			= malloc(capacity * sizeof(vec2));
+	physics->move			= malloc(capacity * sizeof(vec2));
+	physics->delta			= malloc(capacity * sizeof(vec2));
+	physics->invMass		= malloc(capacity * sizeof(float));
+	physics->gravityScale	= malloc(capacity * sizeof(float));
+	physics->contacts		= malloc(capacity * sizeof(uint));
+	physics->supported		= malloc(capacity * sizeof(bool));
+	physics->handle			= malloc(capacity * sizeof(uint));
+	physics->slot			= malloc(capacity * sizeof(uint));
+	physics->sweep			= malloc(capacity * sizeof(physics_sweep_t));
+	physics->moves			= malloc(capacity * sizeof(collision_body_t));
+	physics->moveIndices	= malloc(capacity * sizeof(uint));
+
+	if (physics->center == NULL || physics->halfSize == NULL || physics->vel == NULL || physics->move == NULL ||
+		physics->delta == NULL || physics->invMass == NULL || physics->gravityScale == NULL || physics->contacts == NULL ||
+		physics->supported == NULL || physics->handle == NULL || physics->slot == NULL || physics->sweep == NULL || physics->moves == NULL ||
+		physics->moveIndices == NULL)
+	{
+		physics_destroy(physics);
+		return NULL;
+	}
+
+	for (uint i = 0; i < capacity; ++i)
+	{
+		physics->slot[i] = i + 1;
+	}
+	physics->freeHandle = 0;
+
+	return physics;
+}
+
+void physics_destroy(physics_t* physics)
+{
+	free(physics->center);
+	free(physics->halfSize);
+	free(physics->vel);
+	free(physics->move);
+	free(physics->delta);
+	free(physics->invMass);
+	free(physics->gravityScale);
+	free(physics->contacts);
+	free(physics->supported);
+	free(physics->handle);
+	free(physics->slot);
+	free(physics->sweep);
+	free(physics->moves);
+	free(physics->moveIndices);
+	collision_scratch_destroy(&physics->collisionScratch);
+	free(physics);
+}
+
+uint physics_add_body(physics_t* physics, const physics_body_desc_t* desc)
+{
+	if (physics->count == physics->capacity)
+	{
+		return PHYSICS_INVALID_BODY;
+	}
+
+	const uint body = physics->freeHandle;
+	physics->freeHandle = physics->slot[body];
+
+	const uint i = physics->count++;
+	physics->slot[body]			= i;
+	physics->handle[i]			= body;
+	physics->center[i]			= desc->center;
+	physics->halfSize[i]		= desc->halfSize;
+	physics->vel[i]				= desc->vel;
+	physics->move[i]			= (vec2){ 0.0f, 0.0f };
+	physics->invMass[i]			= desc->mass > 0.0f ? 1.0f / desc->mass : 0.0f;
+	physics->gravityScale[i]	= desc->gravityScale;
+	physics->contacts[i]		= 0;
+	physics->supported[i]		= false;
+
+	physics->sweepDirty = true;
+	return body;
+}
+
+void physics_remove_body(physics_t* physics, uint body)
+{
+	assert(body < physics->capacity);
+
+	// the last body moves into the hole
+	const uint i = physics->slot[body];
+	const uint last = --physics->count;
+	assert(i <= last && physics->handle[i] == body);
+
+	physics->center[i]			= physics->center[last];
+	physics->halfSize[i]		= physics->halfSize[last];
+	physics->vel[i]				= physics->vel[last];
+	physics->move[i]			= physics->move[last];
+	physics->invMass[i]			= physics->invMass[last];
+	physics->gravityScale[i]	= physics->gravityScale[last];
+	physics->contacts[i]		= physics->contacts[last];
+	physics->supported[i]		= physics->supported[last];
+	physics->handle[i]			= physics->handle[last];
+	physics->slot[physics->handle[i]] = i;
+
+	physics->slot[body]	= physics->freeHandle;
+	physics->freeHandle	= body;
+
+	physics->sweepDirty = true;
+}
+
+uint physics_get_body_count(const physics_t* physics)
+{
+	return physics->count;
+}
+
+vec2 physics_get_center(const physics_t* physics, uint body)
+{
+	return physics->center[physics->slot[body]];
+}
+
+vec2 physics_get_vel(const physics_t* physics, uint body)
+{
+	return physics->vel[physics->slot[body]];
+}
+
+void physics_set_vel(physics_t* physics, uint body, vec2 vel)
+{
+	physics->vel[physics->slot[body]] = vel;
+}
+
+uint physics_get_contacts(const physics_t* physics, uint body)
+{
+	return physics->contacts[physics->slot[body]];
+}
+
+void physics_move(physics_t* physics, uint body, vec2 move)
+{
+	const uint i = physics->slot[body];
+	physics->move[i] = vec2_add(physics->move[i], move);
+}
+
+static int physics_sweep_compare(const void* a, const void* b)
+{
+	const float ma = ((const physics_sweep_t*)a)->minX;
+	const float mb = ((const physics_sweep_t*)b)->minX;
+	return (ma > mb) - (ma < mb);
+}
+
+static void physics_sort_sweep(physics_t* physics)
+{
+	physics_sweep_t* sweep = physics->sweep;
+
+	if (physics->sweepDirty)
+	{
+		for (uint i = 0; i < physics->count; ++i)
+		{
+			sweep[i].index = i;
+		}
+	}
+
+	for (uint i = 0; i < physics->count; ++i)
+	{
+		const uint index = sweep[i].index;
+		const float x = physics->center[index].x + physics->delta[index].x;
+		sweep[i].minX = x - physics->halfSize[index].x;
+		sweep[i].maxX = x + physics->halfSize[index].x;
+	}
+
+	if (physics->sweepDirty)
+	{
+		qsort(sweep, physics->count, sizeof(physics_sweep_t), physics_sweep_compare);
+		physics->sweepDirty = false;
+		return;
+	}
+
+	// bodies don't move far in a tick, so this is close to linear
+	for (uint i = 1; i < physics->count; ++i)
+	{
+		const physics_sweep_t entry = sweep[i];
+		uint j = i;
+		while (j > 0 && sweep[j - 1].minX > entry.minX)
+		{
+			sweep[j] = sweep[j - 1];
+			--j;
+		}
+		sweep[j] = entry;
+	}
+}
+
+static void physics_get_box(vec2 corners[4], vec2 center, vec2 halfSize)
+{
+	corners[0] = (vec2){ center.x - halfSize.x, center.y - halfSize.y };
+	corners[1] = (vec2){ center.x + halfSize.x, center.y - halfSize.y };
+	corners[2] = (vec2){ center.x + halfSize.x, center.y + halfSize.y };
+	corners[3] = (vec2){ center.x - halfSize.x, center.y + halfSize.y };
+}
+
+static void physics_resolve_pair(physics_t* physics, uint a, uint b)
+{
+	if (physics->invMass[a] == 0.0f && physics->invMass[b] == 0.0f)
+	{
+		return;
+	}
+
+	vec2 cornersA[4];
+	vec2 cornersB[4];
+	physics_get_box(cornersA, vec2_add(physics->center[a], physics->delta[a]), physics->halfSize[a]);
+	physics_get_box(cornersB, vec2_add(physics->center[b], physics->delta[b]), physics->halfSize[b]);
+
+	const collision_polygon_t polygonA = { .size = 4, .pos = cornersA, .normal = physicsBoxNormals };
+	const collision_polygon_t polygonB = { .size = 4, .pos = cornersB, .normal = physicsBoxNormals };
+
+	collision_contact_t contact;
+	if (!collision_polygon_collide(&contact, &polygonA, &polygonB))
+	{
+		return;
+	}
+
+	const vec2 n = contact.normal;
+	const uint flagsA = collision_contact_flags(vec2_scale(n, -1.0f));
+	const uint flagsB = collision_contact_flags(n);
+	physics->contacts[a] |= flagsA;
+	physics->contacts[b] |= flagsB;
+
+	// a body that's standing on something doesn't give way to one landing on it. Otherwise its share of the
+	// push would be taken back out by the ground, and stacks would sink into themselves.
+	float invMassA = physics->invMass[a];
+	float invMassB = physics->invMass[b];
+	if (flagsB == COLLISION_CONTACT_GROUND && physics->supported[a])
+	{
+		invMassA = 0.0f;
+	}
+	else if (flagsA == COLLISION_CONTACT_GROUND && physics->supported[b])
+	{
+		invMassB = 0.0f;
+	}
+
+	const float invMassSum = invMassA + invMassB;
+	if (invMassSum == 0.0f)
+	{
+		return;
+	}
+
+	physics->delta[a] = vec2_sub(physics->delta[a], vec2_scale(n, contact.depth * invMassA / invMassSum));
+	physics->delta[b] = vec2_add(physics->delta[b], vec2_scale(n, contact.depth * invMassB / invMassSum));
+
+	// stop them closing on each other, without any bounce
+	const float closing = vec2_dot(vec2_sub(physics->vel[b], physics->vel[a]), n);
+	if (closing < 0.0f)
+	{
+		const float impulse = -closing / invMassSum;
+		physics->vel[a] = vec2_sub(physics->vel[a], vec2_scale(n, impulse * invMassA));
+		physics->vel[b] = vec2_add(physics->vel[b], vec2_scale(n, impulse * invMassB));
+	}
+}
+
+// Sweeps every body with a nonzero delta through the world and stops its velocity into whatever it hits.
+static void physics_move_through_world(physics_t* physics, const collision_world_t* world)
+{
+	uint moveCount = 0;
+	for (uint i = 0; i < physics->count; ++i)
+	{
+		if (physics->delta[i].x == 0.0f && physics->delta[i].y == 0.0f)
+		{
+			continue;
+		}
+
+		physics->moves[moveCount] = (collision_body_t){
+			.center		= physics->center[i],
+			.halfSize	= physics->halfSize[i],
+			.delta		= physics->delta[i],
+		};
+		physics->moveIndices[moveCount++] = i;
+	}
+
+	collision_move_bodies(world, &physics->collisionScratch, physics->moves, moveCount);
+
+	for (uint m = 0; m < moveCount; ++m)
+	{
+		const uint i = physics->moveIndices[m];
+		const uint contacts = physics->moves[m].contacts;
+		physics->center[i] = physics->moves[m].center;
+		physics->contacts[i] |= contacts;
+
+		if ((contacts & COLLISION_CONTACT_GROUND) && physics->vel[i].y < 0.0f)
+		{
+			physics->vel[i].y = 0.0f;
+		}
+		if ((contacts & COLLISION_CONTACT_CEILING) && physics->vel[i].y > 0.0f)
+		{
+			physics->vel[i].y = 0.0f;
+		}
+		if (contacts & COLLISION_CONTACT_WALL)
+		{
+			physics->vel[i].x = 0.0f;
+		}
+	}
+}
+
+void physics_tick(physics_t* physics, const collision_world_t* world, float dt)
+{
+	const uint count = physics->count;
+
+	for (uint i = 0; i < count; ++i)
+	{
+		physics->vel[i].y -= physics->gravity * physics->gravityScale[i] * dt;
+		physics->delta[i] = vec2_add(vec2_scale(physics->vel[i], dt), physics->move[i]);
+		physics->move[i] = (vec2){ 0.0f, 0.0f };
+		physics->supported[i] = (physics->contacts[i] & COLLISION_CONTACT_GROUND) != 0;
+		physics->contacts[i] = 0;
+	}
+
+	physics_move_through_world(physics, world);
+
+	// the pushes between bodies are collected in delta
+	for (uint i = 0; i < count; ++i)
+	{
+		physics->delta[i] = (vec2){ 0.0f, 0.0f };
+	}
+
+	physics_sort_sweep(physics);
+
+	const physics_sweep_t* sweep = physics->sweep;
+	for (uint i = 0; i < count; ++i)
+	{
+		const uint a = sweep[i].index;
+
+		for (uint j = i + 1; j < count && sweep[j].minX < sweep[i].maxX; ++j)
+		{
+			const uint b = sweep[j].index;
+
+			if (fabsf(physics->center[a].y - physics->center[b].y) >= physics->halfSize[a].y + physics->halfSize[b].y)
+			{
+				continue;
+			}
+
+			physics_resolve_pair(physics, a, b);
+		}
+	}
+
+	// so that bodies can't push each other into the world
+	physics_move_through_world(physics, world);
+}
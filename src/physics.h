@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.h"
+#include "collision.h"
+
+// Dynamic boxes that fall under gravity, push each other apart and move through the world's triangles. A tick:
+//
+//  1. applies gravity and moves every body through the world with collision_move_bodies, which has a grid of
+//     its own
+//  2. finds the pairs of bodies that now overlap with a sweep and prune along x, and pushes each pair apart
+//     along its axis of least penetration, weighted by their masses
+//  3. moves the bodies that were pushed through the world again, so they can't be pushed into it
+//
+// Bodies are only pushed apart where they end up, not swept against each other, so two fast enough bodies can
+// pass through each other. They can't pass through the world.
+typedef struct physics physics_t;
+
+#define PHYSICS_INVALID_BODY (~0u)
+
+typedef struct physics_body_desc
+{
+	vec2	center;
+	vec2	halfSize;
+	vec2	vel;			// in world units per ms
+	float	mass;			// zero for a body the others can't push
+	float	gravityScale;
+} physics_body_desc_t;
+
+physics_t* physics_create(uint capacity, float gravity);
+void physics_destroy(physics_t* physics);
+
+// Returns a handle that stays valid until the body is removed, or PHYSICS_INVALID_BODY when the pool is full.
+uint physics_add_body(physics_t* physics, const physics_body_desc_t* desc);
+void physics_remove_body(physics_t* physics, uint body);
+uint physics_get_body_count(const physics_t* physics);
+
+vec2 physics_get_center(const physics_t* physics, uint body);
+vec2 physics_get_vel(const physics_t* physics, uint body);
+void physics_set_vel(physics_t* physics, uint body, vec2 vel);
+// COLLISION_CONTACT_* flags for everything the body touched during the last tick, other bodies included.
+uint physics_get_contacts(const physics_t* physics, uint body);
+
+// Moves the body by move during the next tick, on top of what its velocity moves it. For walking, which
+// shouldn't carry over into the next tick the way velocity does.
+void physics_move(physics_t* physics, uint body, vec2 move);
+
+void physics_tick(physics_t* physics, const collision_world_t* world, float dt);
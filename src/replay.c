@@ -0,0 +1,454 @@
+#include "replay.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static uint64_t replay_header_checksum(const FILEFORMAT_replay_header_t* header)
+{
+	return fnv1a64(header, offsetof(FILEFORMAT_replay_header_t, headerChecksum), FNV1A64_OFFSET_BASIS);
+}
+
+static void replay_write(replay_writer_t* writer, const void* data, size_t size)
+{
+	if (fwrite(data, 1, size, writer->f) != size)
+	{
+		writer->failed = true;
+	}
+}
+
+static void replay_write_record(replay_writer_t* writer, const uint8_t* data, size_t size)
+{
+	replay_write(writer, data, size);
+	writer->header.fileSize += size;
+	writer->header.recordChecksum = fnv1a64(data, size, writer->header.recordChecksum);
+}
+
+static size_t replay_put_varint(uint8_t* out, uint64_t value)
+{
+	size_t size = 0;
+	while (value >= 0x80)
+	{
+		out[size++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = (uint8_t)value;
+	return size;
+}
+
+static size_t replay_put_signed(uint8_t* out, int value)
+{
+	const int64_t v = value;
+	return replay_put_varint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void replay_flush_ticks(replay_writer_t* writer)
+{
+	if (writer->pendingTicks == 0)
+	{
+		return;
+	}
+
+	uint8_t record[16];
+	size_t size = 0;
+	record[size++] = FILEFORMAT_replay_TAG_TICKS;
+	size += replay_put_varint(record + size, writer->pendingTicks);
+	replay_write_record(writer, record, size);
+
+	writer->pendingTicks = 0;
+}
+
+static void replay_set_resolution(replay_writer_t* writer, uint2 resolution)
+{
+	if (writer->resolution.x == resolution.x && writer->resolution.y == resolution.y)
+	{
+		return;
+	}
+
+	// the ticks so far ran at the old resolution
+	replay_flush_ticks(writer);
+
+	uint8_t record[32];
+	size_t size = 0;
+	record[size++] = FILEFORMAT_replay_TAG_RESOLUTION;
+	size += replay_put_varint(record + size, resolution.x);
+	size += replay_put_varint(record + size, resolution.y);
+	replay_write_record(writer, record, size);
+
+	writer->resolution = resolution;
+}
+
+int replay_writer_begin(replay_writer_t* writer, FILE* f)
+{
+	*writer = (replay_writer_t){
+		.f		= f,
+		.header	= {
+			.magic			= FILEFORMAT_replay_MAGIC,
+			.version		= FILEFORMAT_replay_VERSION,
+			.fileSize		= sizeof(FILEFORMAT_replay_header_t),
+			.recordChecksum	= FNV1A64_OFFSET_BASIS,
+		},
+	};
+
+	// a placeholder, filled in by replay_writer_end
+	replay_write(writer, &writer->header, sizeof(FILEFORMAT_replay_header_t));
+	return writer->failed ? 1 : 0;
+}
+
+void replay_writer_event(replay_writer_t* writer, const window_event_t* event)
+{
+	if (event->type == WINDOW_EVENT_NULL)
+	{
+		return;
+	}
+
+	replay_flush_ticks(writer);
+
+	uint8_t record[64];
+	size_t size = 0;
+	record[size++] = FILEFORMAT_replay_TAG_EVENT | event->type;
+
+	switch (event->type)
+	{
+		case WINDOW_EVENT_KEY_DOWN:
+		case WINDOW_EVENT_KEY_UP:
+			size += replay_put_varint(record + size, event->data.key.code);
+			break;
+		case WINDOW_EVENT_BUTTON_DOWN:
+		case WINDOW_EVENT_BUTTON_UP:
+			size += replay_put_varint(record + size, event->data.button.button);
+			size += replay_put_signed(record + size, event->data.button.pos.x);
+			size += replay_put_signed(record + size, event->data.button.pos.y);
+			break;
+		case WINDOW_EVENT_MOUSE_MOVE:
+			size += replay_put_signed(record + size, event->data.mouse.pos.x);
+			size += replay_put_signed(record + size, event->data.mouse.pos.y);
+			size += replay_put_signed(record + size, event->data.mouse.delta.x);
+			size += replay_put_signed(record + size, event->data.mouse.delta.y);
+			break;
+		case WINDOW_EVENT_MOUSE_SCROLL:
+			size += replay_put_signed(record + size, event->data.scroll.delta);
+			break;
+		case WINDOW_EVENT_SIZE:
+			size += replay_put_varint(record + size, event->data.size.size.x);
+			size += replay_put_varint(record + size, event->data.size.size.y);
+			break;
+		default:
+			break;
+	}
+
+	replay_write_record(writer, record, size);
+}
+
+void replay_writer_tick(replay_writer_t* writer, uint2 resolution)
+{
+	replay_set_resolution(writer, resolution);
+
+	++writer->pendingTicks;
+	++writer->header.tickCount;
+}
+
+void replay_writer_frame(replay_writer_t* writer, uint2 resolution)
+{
+	replay_set_resolution(writer, resolution);
+
+	if (writer->pendingTicks > FILEFORMAT_replay_TAG_FRAME_MAX)
+	{
+		replay_flush_ticks(writer);
+	}
+
+	const uint8_t record = (uint8_t)(FILEFORMAT_replay_TAG_FRAME + writer->pendingTicks);
+	replay_write_record(writer, &record, 1);
+
+	writer->pendingTicks = 0;
+	++writer->header.frameCount;
+}
+
+int replay_writer_end(replay_writer_t* writer)
+{
+	replay_flush_ticks(writer);
+
+	FILEFORMAT_replay_header_t* header = &writer->header;
+	header->headerChecksum = replay_header_checksum(header);
+
+	if (fseek(writer->f, 0, SEEK_SET) != 0)
+	{
+		writer->failed = true;
+	}
+	else
+	{
+		replay_write(writer, header, sizeof(FILEFORMAT_replay_header_t));
+	}
+
+	if (fflush(writer->f) != 0)
+	{
+		writer->failed = true;
+	}
+
+	return writer->failed ? 1 : 0;
+}
+
+int replay_reader_parse(replay_reader_t* reader, const uint8_t* mem, size_t len)
+{
+	*reader = (replay_reader_t){
+		.mem	= mem,
+		.len	= len,
+		.offset	= sizeof(FILEFORMAT_replay_header_t),
+	};
+
+	if (len < sizeof(FILEFORMAT_replay_header_t))
+	{
+		fprintf(stderr, "Replay file is truncated.\n");
+		return 1;
+	}
+
+	FILEFORMAT_replay_header_t* header = &reader->header;
+	memcpy(header, mem, sizeof(FILEFORMAT_replay_header_t));
+
+	if (header->magic != FILEFORMAT_replay_MAGIC)
+	{
+		fprintf(stderr, "Not a replay file.\n");
+		return 1;
+	}
+	if (header->version != FILEFORMAT_replay_VERSION)
+	{
+		fprintf(stderr, "Unsupported replay file version %u.\n", header->version);
+		return 1;
+	}
+	if (header->headerChecksum != replay_header_checksum(header) || header->fileSize != len)
+	{
+		fprintf(stderr, "Replay file header is corrupt or the file is truncated.\n");
+		return 1;
+	}
+
+	const size_t recordSize = len - sizeof(FILEFORMAT_replay_header_t);
+	if (header->recordChecksum != fnv1a64(mem + sizeof(FILEFORMAT_replay_header_t), recordSize, FNV1A64_OFFSET_BASIS))
+	{
+		fprintf(stderr, "Replay file is corrupt.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+int replay_reader_open(replay_reader_t* reader, const char* path)
+{
+	*reader = (replay_reader_t){};
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Can't open %s\n", path);
+		return 1;
+	}
+
+	uint8_t* data = NULL;
+	long len = -1;
+	if (fseek(f, 0, SEEK_END) == 0)
+	{
+		len = ftell(f);
+	}
+	if (len > 0 && fseek(f, 0, SEEK_SET) == 0)
+	{
+		data = malloc(len);
+		if (data != NULL && fread(data, 1, len, f) != (size_t)len)
+		{
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+
+	if (data == NULL)
+	{
+		fprintf(stderr, "Can't read %s\n", path);
+		return 1;
+	}
+
+	if (replay_reader_parse(reader, data, len) != 0)
+	{
+		free(data);
+		return 1;
+	}
+
+	reader->fileData = data;
+	return 0;
+}
+
+void replay_reader_close(replay_reader_t* reader)
+{
+	free(reader->fileData);
+	*reader = (replay_reader_t){};
+}
+
+bool replay_reader_peek(replay_reader_t* reader, replay_record_t* record)
+{
+	// past the end or a malformed record there's nothing to read again
+	const replay_reader_t saved = *reader;
+	if (!replay_reader_next(reader, record))
+	{
+		return false;
+	}
+	*reader = saved;
+	return true;
+}
+
+static bool replay_get_varint(replay_reader_t* reader, uint64_t* value)
+{
+	*value = 0;
+	for (uint shift = 0; shift < 64; shift += 7)
+	{
+		if (reader->offset == reader->len)
+		{
+			return false;
+		}
+
+		const uint8_t byte = reader->mem[reader->offset++];
+		*value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool replay_get_uint(replay_reader_t* reader, uint* value)
+{
+	uint64_t v;
+	if (!replay_get_varint(reader, &v) || v > UINT32_MAX)
+	{
+		return false;
+	}
+	*value = (uint)v;
+	return true;
+}
+
+static bool replay_get_signed(replay_reader_t* reader, int* value)
+{
+	uint64_t v;
+	if (!replay_get_varint(reader, &v))
+	{
+		return false;
+	}
+
+	const int64_t s = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	if (s < INT32_MIN || s > INT32_MAX)
+	{
+		return false;
+	}
+	*value = (int)s;
+	return true;
+}
+
+static bool replay_get_event(replay_reader_t* reader, window_event_t* event, uint type)
+{
+	*event = (window_event_t){ .type = type };
+
+	uint code;
+	switch (type)
+	{
+		case WINDOW_EVENT_KEY_DOWN:
+		case WINDOW_EVENT_KEY_UP:
+			// the game keeps a flag per key code in a table this big
+			if (!replay_get_uint(reader, &code) || code >= 256)
+			{
+				return false;
+			}
+			event->data.key.code = code;
+			return true;
+		case WINDOW_EVENT_BUTTON_DOWN:
+		case WINDOW_EVENT_BUTTON_UP:
+			if (!replay_get_uint(reader, &code) || code > BUTTON_RIGHT)
+			{
+				return false;
+			}
+			event->data.button.button = code;
+			return
+				replay_get_signed(reader, &event->data.button.pos.x) &&
+				replay_get_signed(reader, &event->data.button.pos.y);
+		case WINDOW_EVENT_MOUSE_MOVE:
+			return
+				replay_get_signed(reader, &event->data.mouse.pos.x) &&
+				replay_get_signed(reader, &event->data.mouse.pos.y) &&
+				replay_get_signed(reader, &event->data.mouse.delta.x) &&
+				replay_get_signed(reader, &event->data.mouse.delta.y);
+		case WINDOW_EVENT_MOUSE_SCROLL:
+			return replay_get_signed(reader, &event->data.scroll.delta);
+		case WINDOW_EVENT_SIZE:
+			return
+				replay_get_uint(reader, &event->data.size.size.x) &&
+				replay_get_uint(reader, &event->data.size.size.y);
+		case WINDOW_EVENT_DESTROY:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool replay_reader_next(replay_reader_t* reader, replay_record_t* record)
+{
+	for (;;)
+	{
+		if (reader->pendingTicks > 0)
+		{
+			--reader->pendingTicks;
+			*record = (replay_record_t){ .type = REPLAY_RECORD_TICK, .resolution = reader->resolution };
+			return true;
+		}
+		if (reader->pendingFrame)
+		{
+			reader->pendingFrame = false;
+			*record = (replay_record_t){ .type = REPLAY_RECORD_FRAME, .resolution = reader->resolution };
+			return true;
+		}
+
+		if (reader->offset == reader->len)
+		{
+			return false;
+		}
+
+		const size_t recordOffset = reader->offset;
+		const uint8_t tag = reader->mem[reader->offset++];
+
+		bool valid;
+		if (tag <= FILEFORMAT_replay_TAG_FRAME_MAX)
+		{
+			reader->pendingTicks = tag - FILEFORMAT_replay_TAG_FRAME;
+			reader->pendingFrame = true;
+			valid = true;
+		}
+		else if (tag == FILEFORMAT_replay_TAG_TICKS)
+		{
+			valid = replay_get_uint(reader, &reader->pendingTicks);
+		}
+		else if (tag == FILEFORMAT_replay_TAG_RESOLUTION)
+		{
+			valid =
+				replay_get_uint(reader, &reader->resolution.x) &&
+				replay_get_uint(reader, &reader->resolution.y);
+		}
+		else if ((tag & 0xf0) == FILEFORMAT_replay_TAG_EVENT)
+		{
+			record->type = REPLAY_RECORD_EVENT;
+			record->resolution = reader->resolution;
+			valid = replay_get_event(reader, &record->event, tag & 0x0f);
+			if (valid)
+			{
+				return true;
+			}
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			fprintf(stderr, "Replay record at %zu is malformed.\n", recordOffset);
+			reader->offset = reader->len;
+			return false;
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "types.h"
+#include "file_format.h"
+#include "window.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Records the window events handed to the game and editor along with the fixed ticks and frames between them, see
+// FILEFORMAT_replay_header_t. A frame's events come before its ticks, which is how the main loop runs them, and
+// a replay that's fed back in the same order ticks exactly the same way.
+
+typedef struct replay_writer
+{
+	FILE*						f;
+	FILEFORMAT_replay_header_t	header;
+	uint						pendingTicks; // not written yet, in case a frame follows them
+	uint2						resolution;
+	bool						failed;
+} replay_writer_t;
+
+// replay_writer_end fills in the header, so f has to be seekable.
+int replay_writer_begin(replay_writer_t* writer, FILE* f);
+void replay_writer_event(replay_writer_t* writer, const window_event_t* event);
+void replay_writer_tick(replay_writer_t* writer, uint2 resolution);
+void replay_writer_frame(replay_writer_t* writer, uint2 resolution);
+// Returns nonzero if anything failed to write.
+int replay_writer_end(replay_writer_t* writer);
+
+typedef enum replay_record_type
+{
+	REPLAY_RECORD_EVENT,
+	REPLAY_RECORD_TICK,
+	REPLAY_RECORD_FRAME,
+} replay_record_type_t;
+
+typedef struct replay_record
+{
+	replay_record_type_t	type;
+	window_event_t			event;		// for REPLAY_RECORD_EVENT
+	uint2					resolution;	// what the tick or frame ran at
+} replay_record_t;
+
+typedef struct replay_reader
+{
+	const uint8_t*				mem;
+	size_t						len;
+	uint8_t*					fileData; // mem, when the reader was opened from a file
+	FILEFORMAT_replay_header_t	header;
+	size_t						offset;
+	uint						pendingTicks;
+	bool						pendingFrame; // after pendingTicks
+	uint2						resolution;
+} replay_reader_t;
+
+// Checks the header and the record checksum, and reads records from mem, which has to outlive the reader.
+int replay_reader_parse(replay_reader_t* reader, const uint8_t* mem, size_t len);
+int replay_reader_open(replay_reader_t* reader, const char* path);
+void replay_reader_close(replay_reader_t* reader);
+
+// Returns false at the end of the replay, or at a malformed record.
+bool replay_reader_next(replay_reader_t* reader, replay_record_t* record);
+// replay_reader_next, leaving the record to be read again.
+bool replay_reader_peek(replay_reader_t* reader, replay_record_t* record);
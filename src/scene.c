@@ -69,6 +69,7 @@ typedef struct scene
 	VkDescriptorSetLayout	worldDescriptorSetLayout;
 	VkPipelineLayout		worldPipelineLayout;
 	VkPipeline				worldPipeline;
+	VkPipeline				worldFoliagePipeline;
 
 	VkDescriptorSetLayout	particleDescriptorSetLayout;
 	VkPipelineLayout		particlePipelineLayout;
@@ -221,6 +222,8 @@ static int scene_create_world_pipeline(scene_t* scene, vulkan_t* vulkan)
 		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },
 		{ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },
 		{ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },
+		{ 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },
+		{ 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT },
 	};
 	const VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = {
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
@@ -346,6 +349,27 @@ static int scene_create_world_pipeline(scene_t* scene, vulkan_t* vulkan)
 		return 1;
 	}
 	SetPipelineName(vulkan, scene->worldPipeline, "World");
+
+	// foliage shares the world layout and fragment shader, only the vertex stage differs
+	const VkPipelineShaderStageCreateInfo foliageStages[] = {
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = g_shaders.modules[SHADER_WORLD_FOLIAGE_VERT],
+			.pName = "vs_foliage",
+		},
+		stages[1],
+	};
+
+	VkGraphicsPipelineCreateInfo foliageCreateInfo = createInfo;
+	foliageCreateInfo.stageCount = countof(foliageStages);
+	foliageCreateInfo.pStages = foliageStages;
+
+	if (vkCreateGraphicsPipelines(vulkan->device, NULL, 1, &foliageCreateInfo, NULL, &scene->worldFoliagePipeline) != VK_SUCCESS) {
+		fprintf(stderr, "vkCreateGraphicsPipelines failed\n");
+		return 1;
+	}
+	SetPipelineName(vulkan, scene->worldFoliagePipeline, "World Foliage");
 }
 
 static int scene_create_particle_pipeline(scene_t* scene, vulkan_t* vulkan)
@@ -674,6 +698,7 @@ void scene_destroy(scene_t *scene)
 	vkDestroyDescriptorSetLayout(vulkan->device, scene->modelDescriptorSetLayout, NULL);
 
 	vkDestroyPipeline(vulkan->device, scene->worldPipeline, NULL);
+	vkDestroyPipeline(vulkan->device, scene->worldFoliagePipeline, NULL);
 	vkDestroyPipelineLayout(vulkan->device, scene->worldPipelineLayout, NULL);
 	vkDestroyDescriptorSetLayout(vulkan->device, scene->worldDescriptorSetLayout, NULL);
 
@@ -810,12 +835,16 @@ void scene_draw(
 		ptr += sizeof(scb_command_header_t) + header->count * cmdsize;
 	}
 
+	wind_render_info_t windInfo;
+	wind_get_render_info(&windInfo, src->wind);
+
 	(*frame->uniforms) = (gpu_frame_uniforms_t){
 		.matViewProj		= scb->camera.viewProjectionMatrix,
 		.pointLightCount	= gpuPointLightCount,
 		.spotLightCount		= gpuSpotLightCount,
 		.drawCount			= gpuDrawCount,
 		.elapsedTime		= src->elapsedTime,
+		.windGridResolution	= windInfo.gridResolution,
 	};
 
 	PushStagingMemoryFlush(rc->stagingMemory, frame->uniforms, sizeof(gpu_frame_uniforms_t));
@@ -888,9 +917,6 @@ void scene_draw(
 			model_loader_info_t modelLoaderInfo;
 			model_loader_get_info(&modelLoaderInfo, src->modelLoader);
 
-			wind_render_info_t windInfo;
-			wind_get_render_info(&windInfo, src->wind);
-
 			if (gpuDrawCount > 0)
 			{
 				descriptor_allocator_begin(rc->dsalloc, scene->modelDescriptorSetLayout, "SceneModel");
@@ -906,19 +932,37 @@ void scene_draw(
 			}
 
 			world_render_info_t worldInfo;
-			if (world_get_render_info(&worldInfo, src->world))
+			if (world_get_render_info(&worldInfo, src->world, rc->frameIndex))
 			{
 				descriptor_allocator_begin(rc->dsalloc, scene->worldDescriptorSetLayout, "World");
 				descriptor_allocator_set_uniform_buffer(rc->dsalloc, 0, frameUniformBuffer);
 				descriptor_allocator_set_storage_buffer(rc->dsalloc, 1, (VkDescriptorBufferInfo){ worldInfo.vertexPositionBuffer, 0, VK_WHOLE_SIZE });
 				descriptor_allocator_set_storage_buffer(rc->dsalloc, 2, (VkDescriptorBufferInfo){ worldInfo.vertexColorBuffer, 0, VK_WHOLE_SIZE });
 				descriptor_allocator_set_storage_buffer(rc->dsalloc, 3, (VkDescriptorBufferInfo){ windInfo.gridBuffer, 0, VK_WHOLE_SIZE });
+				descriptor_allocator_set_storage_buffer(rc->dsalloc, 4, (VkDescriptorBufferInfo){ worldInfo.foliageBuffer, 0, VK_WHOLE_SIZE });
+				descriptor_allocator_set_storage_buffer(rc->dsalloc, 5, (VkDescriptorBufferInfo){ worldInfo.chunkBuffer, 0, VK_WHOLE_SIZE });
 				const VkDescriptorSet descriptorSet = descriptor_allocator_end(rc->dsalloc);
 
 				vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, scene->worldPipelineLayout, 0, 1, &descriptorSet, 0, NULL);
 				vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, scene->worldPipeline);
 				vkCmdBindIndexBuffer(cb, worldInfo.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-				vkCmdDrawIndexed(cb, worldInfo.indexCount, 1, 0, 0, 0);
+
+				for (uint32_t i = 0; i < worldInfo.drawCount; ++i)
+				{
+					const world_draw_t* draw = &worldInfo.draws[i];
+					vkCmdDrawIndexed(cb, draw->indexCount, 1, draw->firstIndex, draw->vertexOffset, draw->chunk);
+				}
+
+				vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, scene->worldFoliagePipeline);
+
+				for (uint32_t i = 0; i < worldInfo.drawCount; ++i)
+				{
+					const world_draw_t* draw = &worldInfo.draws[i];
+					if (draw->instanceCount > 0)
+					{
+						vkCmdDraw(cb, FOLIAGE_VERTICES_PER_INSTANCE, draw->instanceCount, 0, draw->firstInstance);
+					}
+				}
 			}
 
 			particles_render_info_t particleInfo;
@@ -933,7 +977,20 @@ void scene_draw(
 
 				vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, scene->particlePipelineLayout, 0, 1, &descriptorSet, 0, NULL);
 				vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, scene->particlePipeline);
-				vkCmdDraw(cb, 6 * particleInfo.particleCount, 1, 0, 0);
+
+				// back to front, a draw per layer
+				for (int layer = PARTICLE_LAYER_COUNT - 1; layer >= 0; --layer)
+				{
+					if (particleInfo.drawBuffer != VK_NULL_HANDLE)
+					{
+						const VkDeviceSize drawOffset = particleInfo.drawOffset + layer * sizeof(VkDrawIndirectCommand);
+						vkCmdDrawIndirect(cb, particleInfo.drawBuffer, drawOffset, 1, 0);
+					}
+					else if (particleInfo.layerCount[layer] > 0)
+					{
+						vkCmdDraw(cb, 6 * particleInfo.layerCount[layer], 1, 6 * particleInfo.layerFirst[layer], 0);
+					}
+				}
 			}
 
 			debug_renderer_flush(
@@ -16,11 +16,17 @@ SHADER_BLOB(debug_fs);
 SHADER_BLOB(composite_vs);
 SHADER_BLOB(composite_fs);
 SHADER_BLOB(world_vs);
+SHADER_BLOB(world_foliage_vs);
 SHADER_BLOB(world_fs);
 SHADER_BLOB(model_vs);
 SHADER_BLOB(model_fs);
 SHADER_BLOB(particle_vs);
 SHADER_BLOB(particle_fs);
+SHADER_BLOB(particle_spawn_cs);
+SHADER_BLOB(particle_prepare_cs);
+SHADER_BLOB(particle_tick_cs);
+SHADER_BLOB(particle_bin_scan_cs);
+SHADER_BLOB(particle_bin_scatter_cs);
 
 shader_library_t g_shaders = {};
 
@@ -53,11 +59,17 @@ int InitShaderLibrary(vulkan_t* vulkan)
 	g_shaders.modules[SHADER_COMPOSITE_VERT] = createShaderModule(vulkan, SHADER_ARG_HELPER(composite_vs));
 	g_shaders.modules[SHADER_COMPOSITE_FRAG] = createShaderModule(vulkan, SHADER_ARG_HELPER(composite_fs));
 	g_shaders.modules[SHADER_WORLD_VERT] = createShaderModule(vulkan, SHADER_ARG_HELPER(world_vs));
+	g_shaders.modules[SHADER_WORLD_FOLIAGE_VERT] = createShaderModule(vulkan, SHADER_ARG_HELPER(world_foliage_vs));
 	g_shaders.modules[SHADER_WORLD_FRAG] = createShaderModule(vulkan, SHADER_ARG_HELPER(world_fs));
 	g_shaders.modules[SHADER_MODEL_VERT] = createShaderModule(vulkan, SHADER_ARG_HELPER(model_vs));
 	g_shaders.modules[SHADER_MODEL_FRAG] = createShaderModule(vulkan, SHADER_ARG_HELPER(model_fs));
 	g_shaders.modules[SHADER_PARTICLE_VERT] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_vs));
 	g_shaders.modules[SHADER_PARTICLE_FRAG] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_fs));
+	g_shaders.modules[SHADER_PARTICLE_SPAWN_COMP] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_spawn_cs));
+	g_shaders.modules[SHADER_PARTICLE_PREPARE_COMP] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_prepare_cs));
+	g_shaders.modules[SHADER_PARTICLE_TICK_COMP] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_tick_cs));
+	g_shaders.modules[SHADER_PARTICLE_BIN_SCAN_COMP] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_bin_scan_cs));
+	g_shaders.modules[SHADER_PARTICLE_BIN_SCATTER_COMP] = createShaderModule(vulkan, SHADER_ARG_HELPER(particle_bin_scatter_cs));
 	return 0;
 }
 
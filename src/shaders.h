@@ -9,11 +9,17 @@ enum shader
 	SHADER_COMPOSITE_VERT,
 	SHADER_COMPOSITE_FRAG,
 	SHADER_WORLD_VERT,
+	SHADER_WORLD_FOLIAGE_VERT,
 	SHADER_WORLD_FRAG,
 	SHADER_MODEL_VERT,
 	SHADER_MODEL_FRAG,
 	SHADER_PARTICLE_VERT,
 	SHADER_PARTICLE_FRAG,
+	SHADER_PARTICLE_SPAWN_COMP,
+	SHADER_PARTICLE_PREPARE_COMP,
+	SHADER_PARTICLE_TICK_COMP,
+	SHADER_PARTICLE_BIN_SCAN_COMP,
+	SHADER_PARTICLE_BIN_SCATTER_COMP,
 	SHADER_COUNT,
 };
 
@@ -1,7 +1,32 @@
 #include "offset_allocator.h"
+#include "collision_grid.h"
+#include "collision.h"
+#include "physics.h"
+#include "triangulate.h"
+#include "world.h"
+#include "world_file.h"
+#include "foliage.h"
+#include "job_pool.h"
+#include "util.h"
+#include "rng.h"
+#include "vec.h"
+#include "particle_soa.h"
+#include "particles.h"
+#include "wind.h"
+#include "wind_grid.h"
+#include "wind_solver.h"
+#include "headless.h"
+#include "replay.h"
+#include "game.h"
+#include "shaders.h"
+#include "descriptors.h"
+#include "staging_memory.h"
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
 
 static int test_offset_allocator(void)
 {
@@ -34,6 +59,1895 @@ static int test_offset_allocator(void)
 
 	offset_allocator_destroy(&allocator);
 
+	// freeing in any order must coalesce back into one region
+	offset_allocator_create(&allocator, 64, 8);
+
+	for (uint i = 0; i < countof(allocs); ++i)
+	{
+		r = offset_allocator_alloc(&allocs[i], &allocator, 16);
+		assert(r == true);
+	}
+	offset_allocator_free(&allocator, allocs[0]);
+	offset_allocator_free(&allocator, allocs[1]);
+	offset_allocator_free(&allocator, allocs[3]);
+	offset_allocator_free(&allocator, allocs[2]);
+	r = offset_allocator_alloc(&allocs[0], &allocator, 64);
+	assert(r == true);
+	assert(allocs[0].offset == 0);
+
+	offset_allocator_destroy(&allocator);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_collision_grid(void)
+{
+	printf("Testing collision grid...\n");
+
+	int r;
+	uint n;
+	uint items[8];
+
+	const vec2 itemMin[] = {
+		{0.0f, 0.0f},
+		{5.0f, 5.0f},
+		{-3.0f, 1.0f},	// spans many cells
+	};
+	const vec2 itemMax[] = {
+		{1.0f, 1.0f},
+		{6.0f, 6.0f},
+		{9.0f, 1.5f},
+	};
+
+	collision_grid_t grid = {0};
+
+	r = collision_grid_build(&grid, itemMin, itemMax, 3, 1.0f);
+	assert(r == 0);
+
+	n = collision_grid_query(&grid, items, 8, (vec2){0.5f, 0.5f}, (vec2){0.6f, 0.6f});
+	assert(n == 1 && items[0] == 0);
+
+	n = collision_grid_query(&grid, items, 8, (vec2){4.0f, 4.0f}, (vec2){5.5f, 5.5f});
+	assert(n == 1 && items[0] == 1);
+
+	// every overlapped cell contains item 2, but it's only reported once
+	n = collision_grid_query(&grid, items, 8, (vec2){-10.0f, -10.0f}, (vec2){10.0f, 10.0f});
+	assert(n == 3);
+
+	n = collision_grid_query(&grid, items, 1, (vec2){-10.0f, -10.0f}, (vec2){10.0f, 10.0f});
+	assert(n == 3);
+
+	n = collision_grid_query(&grid, items, 8, (vec2){2.0f, 3.0f}, (vec2){3.0f, 4.0f});
+	assert(n == 0);
+
+	collision_grid_destroy(&grid);
+
+	printf("Done\n");
+	return 0;
+}
+
+#define TEST_COLLISION_MAX_TRIANGLES 512
+
+typedef struct test_collision_scene
+{
+	uint					triangleCount;
+	collision_triangle_t	triangles[TEST_COLLISION_MAX_TRIANGLES];
+	vec2					boundsMin[TEST_COLLISION_MAX_TRIANGLES];
+	vec2					boundsMax[TEST_COLLISION_MAX_TRIANGLES];
+	collision_grid_t		grid;
+	collision_world_t		world;
+	collision_scratch_t		scratch;
+} test_collision_scene_t;
+
+static void test_collision_add_triangle(test_collision_scene_t* scene, vec2 a, vec2 b, vec2 c)
+{
+	assert(scene->triangleCount < TEST_COLLISION_MAX_TRIANGLES);
+	const uint t = scene->triangleCount++;
+	collision_triangle_build(&scene->triangles[t], a, b, c);
+	scene->boundsMin[t] = scene->triangles[t].boundsMin;
+	scene->boundsMax[t] = scene->triangles[t].boundsMax;
+}
+
+// Splits the box into two triangles, wound one way or the other.
+static void test_collision_add_box(test_collision_scene_t* scene, vec2 min, vec2 max, bool clockwise)
+{
+	const vec2 corners[4] = { min, {max.x, min.y}, max, {min.x, max.y} };
+	if (clockwise)
+	{
+		test_collision_add_triangle(scene, corners[0], corners[2], corners[1]);
+		test_collision_add_triangle(scene, corners[0], corners[3], corners[2]);
+	}
+	else
+	{
+		test_collision_add_triangle(scene, corners[0], corners[1], corners[2]);
+		test_collision_add_triangle(scene, corners[0], corners[2], corners[3]);
+	}
+}
+
+static void test_collision_build(test_collision_scene_t* scene)
+{
+	int r = collision_grid_build(&scene->grid, scene->boundsMin, scene->boundsMax, scene->triangleCount, 2.0f);
+	assert(r == 0);
+	(void)r;
+
+	scene->world = (collision_world_t){ scene->triangles, &scene->grid };
+}
+
+static void test_collision_destroy(test_collision_scene_t* scene)
+{
+	collision_scratch_destroy(&scene->scratch);
+	collision_grid_destroy(&scene->grid);
+	free(scene);
+}
+
+static collision_body_t test_collision_move(test_collision_scene_t* scene, vec2 center, vec2 delta)
+{
+	collision_body_t body = {
+		.center		= center,
+		.halfSize	= {0.25f, 0.5f},
+		.delta		= delta,
+	};
+	collision_move_bodies(&scene->world, &scene->scratch, &body, 1);
+	return body;
+}
+
+static int test_collision(void)
+{
+	printf("Testing collision...\n");
+
+	// normals point out of the triangle whichever way it's wound
+	{
+		const vec2 a = {0.0f, 0.0f};
+		const vec2 b = {2.0f, 0.0f};
+		const vec2 c = {0.5f, 1.0f};
+		const vec2 centroid = {2.5f / 3.0f, 1.0f / 3.0f};
+
+		collision_triangle_t triangles[2];
+		collision_triangle_build(&triangles[0], a, b, c);
+		collision_triangle_build(&triangles[1], a, c, b);
+
+		for (uint t = 0; t < 2; ++t)
+		{
+			for (uint i = 0; i < 3; ++i)
+			{
+				assert(fabsf(vec2_length(triangles[t].normal[i]) - 1.0f) < 1e-6f);
+				assert(vec2_dot(triangles[t].normal[i], centroid) < triangles[t].dist[i]);
+				assert(triangles[t].depth[i] < triangles[t].dist[i]);
+			}
+		}
+
+		collision_triangle_t degenerate;
+		collision_triangle_build(&degenerate, a, b, (vec2){1.0f, 0.0f});
+		for (uint i = 0; i < 3; ++i)
+		{
+			assert(degenerate.normal[i].x == 0.0f && degenerate.normal[i].y == 0.0f);
+		}
+	}
+
+	test_collision_scene_t* scene = calloc(1, sizeof(test_collision_scene_t));
+	assert(scene != NULL);
+
+	// a floor along y = 0 split into unit boxes, a wall at x = 12 and a thin slab up at y = 20
+	for (int x = -10; x < 10; ++x)
+	{
+		test_collision_add_box(scene, (vec2){(float)x, -1.0f}, (vec2){(float)x + 1.0f, 0.0f}, (x & 1) != 0);
+	}
+	test_collision_add_box(scene, (vec2){12.0f, -1.0f}, (vec2){13.0f, 10.0f}, false);
+	test_collision_add_box(scene, (vec2){-4.0f, 20.0f}, (vec2){4.0f, 20.005f}, true);
+	// a 45 degree ramp going up from x = -9
+	test_collision_add_triangle(scene, (vec2){-9.0f, 0.0f}, (vec2){-7.0f, 0.0f}, (vec2){-7.0f, 2.0f});
+	test_collision_build(scene);
+
+	// a fast fall lands on the floor instead of going through it
+	{
+		const collision_body_t body = test_collision_move(scene, (vec2){0.3f, 6.0f}, (vec2){0.0f, -50.0f});
+		const float bottom = body.center.y - body.halfSize.y;
+		assert(bottom >= 0.0f && bottom < 0.01f);
+		assert(body.center.x == 0.3f);
+		assert(body.contacts == COLLISION_CONTACT_GROUND);
+	}
+
+	// the slab is thinner than a tick's move in both directions
+	{
+		collision_body_t body = test_collision_move(scene, (vec2){0.0f, 25.0f}, (vec2){0.0f, -10.0f});
+		assert(body.center.y - body.halfSize.y >= 20.005f && body.center.y - body.halfSize.y < 20.015f);
+		assert(body.contacts == COLLISION_CONTACT_GROUND);
+
+		body = test_collision_move(scene, (vec2){0.0f, 15.0f}, (vec2){0.0f, 30.0f});
+		assert(body.center.y + body.halfSize.y <= 20.0f && body.center.y + body.halfSize.y > 19.99f);
+		assert(body.contacts == COLLISION_CONTACT_CEILING);
+	}
+
+	// walking over the seams between the floor's triangles doesn't snag
+	{
+		vec2 center = {-5.5f, 0.501f};
+		for (uint tick = 0; tick < 200; ++tick)
+		{
+			const collision_body_t body = test_collision_move(scene, center, (vec2){0.05f, -0.01f});
+			assert(body.contacts == COLLISION_CONTACT_GROUND);
+			assert(body.center.y - body.halfSize.y >= 0.0f && body.center.y - body.halfSize.y < 0.01f);
+			center = body.center;
+		}
+		assert(fabsf(center.x - 4.5f) < 1e-3f);
+	}
+
+	// running into the wall stops at it and slides down it
+	{
+		const collision_body_t body = test_collision_move(scene, (vec2){11.0f, 3.0f}, (vec2){2.0f, -0.5f});
+		assert(body.center.x + body.halfSize.x <= 12.0f && body.center.x + body.halfSize.x > 11.99f);
+		assert(fabsf(body.center.y - 2.5f) < 1e-4f);
+		assert(body.contacts == COLLISION_CONTACT_WALL);
+	}
+
+	// walking into the ramp climbs it, and 45 degrees is still ground
+	{
+		const collision_body_t body = test_collision_move(scene, (vec2){-9.5f, 0.501f}, (vec2){1.0f, 0.0f});
+		assert(body.center.y > 0.6f);
+		assert(body.center.x > -9.0f && body.center.x < -8.5f);
+		assert(body.contacts == COLLISION_CONTACT_GROUND);
+	}
+
+	// a body that starts in the floor is pushed out the shortest way
+	{
+		const collision_body_t body = test_collision_move(scene, (vec2){2.5f, 0.3f}, (vec2){0.0f, 0.0f});
+		assert(body.center.y - body.halfSize.y >= 0.0f && body.center.y - body.halfSize.y < 0.01f);
+		assert(body.center.x == 2.5f);
+		assert(body.contacts == COLLISION_CONTACT_GROUND);
+	}
+
+	// every body in a batch lands
+	{
+		collision_body_t bodies[64];
+		for (uint i = 0; i < countof(bodies); ++i)
+		{
+			bodies[i] = (collision_body_t){
+				.center		= {-8.0f + i * 0.25f, 2.5f + i * 0.25f},
+				.halfSize	= {0.1f, 0.1f},
+				.delta		= {0.0f, -4.0f - i * 2.0f},
+			};
+		}
+		collision_move_bodies(&scene->world, &scene->scratch, bodies, countof(bodies));
+
+		for (uint i = 0; i < countof(bodies); ++i)
+		{
+			const float bottom = bodies[i].center.y - bodies[i].halfSize.y;
+			const float x = -8.0f + i * 0.25f;
+			if (x - 0.1f < -7.0f)
+			{
+				// over the ramp
+				assert(bodies[i].contacts & COLLISION_CONTACT_GROUND);
+				assert(bottom >= 0.0f);
+			}
+			else
+			{
+				assert(bodies[i].contacts == COLLISION_CONTACT_GROUND);
+				assert(bottom >= 0.0f && bottom < 0.01f);
+			}
+		}
+	}
+
+	test_collision_destroy(scene);
+
+	// hundreds of overlapping triangles under one body, all of them flush with y = 0
+	{
+		scene = calloc(1, sizeof(test_collision_scene_t));
+		assert(scene != NULL);
+
+		for (uint i = 0; i < 300; ++i)
+		{
+			const float spread = i * 0.01f;
+			test_collision_add_triangle(scene, (vec2){-2.0f - spread, 0.0f}, (vec2){0.0f, -1.0f - spread}, (vec2){2.0f + spread, 0.0f});
+		}
+		test_collision_build(scene);
+
+		const collision_body_t body = test_collision_move(scene, (vec2){0.0f, 3.0f}, (vec2){0.0f, -10.0f});
+		assert(scene->scratch.capacity >= 300);
+		assert(body.center.y - body.halfSize.y >= 0.0f && body.center.y - body.halfSize.y < 0.01f);
+		assert(body.contacts == COLLISION_CONTACT_GROUND);
+
+		test_collision_destroy(scene);
+	}
+
+	printf("Done\n");
+	return 0;
+}
+
+static bool test_boxes_overlap(vec2 centerA, vec2 halfSizeA, vec2 centerB, vec2 halfSizeB, float tolerance)
+{
+	return
+		fabsf(centerA.x - centerB.x) < halfSizeA.x + halfSizeB.x - tolerance &&
+		fabsf(centerA.y - centerB.y) < halfSizeA.y + halfSizeB.y - tolerance;
+}
+
+static int test_physics(void)
+{
+	printf("Testing physics...\n");
+
+	const float gravity = 0.00005f;
+	const float dt = 1000.0f / 60.0f;
+
+	// contacts come out along the axis of least penetration
+	{
+		static const vec2 normals[4] = { {0.0f, -1.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}, {-1.0f, 0.0f} };
+		const vec2 cornersA[4] = { {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f} };
+		const vec2 cornersB[4] = { {0.8f, 0.1f}, {1.8f, 0.1f}, {1.8f, 1.1f}, {0.8f, 1.1f} };
+		const vec2 cornersC[4] = { {1.5f, 0.0f}, {2.5f, 0.0f}, {2.5f, 1.0f}, {1.5f, 1.0f} };
+		const collision_polygon_t a = { .size = 4, .pos = cornersA, .normal = normals };
+		const collision_polygon_t b = { .size = 4, .pos = cornersB, .normal = normals };
+		const collision_polygon_t c = { .size = 4, .pos = cornersC, .normal = normals };
+
+		collision_contact_t contact;
+		bool hit = collision_polygon_collide(&contact, &a, &b);
+		assert(hit);
+		assert(contact.normal.x == 1.0f && contact.normal.y == 0.0f);
+		assert(fabsf(contact.depth - 0.2f) < 1e-5f);
+		assert(!contact.referenceIsB && contact.referenceEdge == 1 && contact.incidentEdge == 3);
+
+		hit = collision_polygon_collide(&contact, &b, &a);
+		assert(hit);
+		assert(contact.normal.x == -1.0f && contact.normal.y == 0.0f);
+
+		hit = collision_polygon_collide(&contact, &a, &c);
+		assert(!hit);
+		(void)hit;
+	}
+
+	// handles survive other bodies being removed
+	{
+		physics_t* physics = physics_create(3, gravity);
+		assert(physics != NULL);
+
+		uint bodies[3];
+		for (uint i = 0; i < 3; ++i)
+		{
+			bodies[i] = physics_add_body(physics, &(physics_body_desc_t){ .center = {(float)i, 0.0f}, .halfSize = {0.1f, 0.1f}, .mass = 1.0f });
+			assert(bodies[i] != PHYSICS_INVALID_BODY);
+		}
+		assert(physics_add_body(physics, &(physics_body_desc_t){ .mass = 1.0f }) == PHYSICS_INVALID_BODY);
+
+		physics_remove_body(physics, bodies[0]);
+		assert(physics_get_body_count(physics) == 2);
+		assert(physics_get_center(physics, bodies[1]).x == 1.0f);
+		assert(physics_get_center(physics, bodies[2]).x == 2.0f);
+
+		const uint body = physics_add_body(physics, &(physics_body_desc_t){ .center = {5.0f, 0.0f}, .mass = 1.0f });
+		assert(body == bodies[0]);
+		assert(physics_get_center(physics, body).x == 5.0f);
+		assert(physics_get_center(physics, bodies[2]).x == 2.0f);
+
+		physics_destroy(physics);
+	}
+
+	test_collision_scene_t* scene = calloc(1, sizeof(test_collision_scene_t));
+	assert(scene != NULL);
+
+	// a pit with a floor at y = 0 and walls at x = -4 and x = 4
+	test_collision_add_box(scene, (vec2){-8.0f, -1.0f}, (vec2){8.0f, 0.0f}, false);
+	test_collision_add_box(scene, (vec2){-5.0f, 0.0f}, (vec2){-4.0f, 20.0f}, true);
+	test_collision_add_box(scene, (vec2){4.0f, 0.0f}, (vec2){5.0f, 20.0f}, false);
+	test_collision_build(scene);
+
+	// a box dropped on another settles on top of it
+	{
+		physics_t* physics = physics_create(2, gravity);
+		assert(physics != NULL);
+
+		const vec2 halfSize = {0.5f, 0.5f};
+		const uint bottom = physics_add_body(physics, &(physics_body_desc_t){ .center = {0.0f, 0.6f}, .halfSize = halfSize, .mass = 1.0f, .gravityScale = 1.0f });
+		const uint top = physics_add_body(physics, &(physics_body_desc_t){ .center = {0.2f, 3.0f}, .halfSize = halfSize, .mass = 1.0f, .gravityScale = 1.0f });
+
+		for (uint tick = 0; tick < 300; ++tick)
+		{
+			physics_tick(physics, &scene->world, dt);
+		}
+
+		const vec2 bottomCenter = physics_get_center(physics, bottom);
+		const vec2 topCenter = physics_get_center(physics, top);
+		assert(bottomCenter.y - halfSize.y >= 0.0f && bottomCenter.y - halfSize.y < 0.01f);
+		assert(fabsf(topCenter.y - bottomCenter.y - 1.0f) < 0.01f);
+		assert(physics_get_contacts(physics, bottom) & COLLISION_CONTACT_GROUND);
+		assert(physics_get_contacts(physics, bottom) & COLLISION_CONTACT_CEILING);
+		assert(physics_get_contacts(physics, top) == COLLISION_CONTACT_GROUND);
+
+		physics_destroy(physics);
+	}
+
+	// two boxes walking into each other stop where they meet
+	{
+		physics_t* physics = physics_create(2, gravity);
+		assert(physics != NULL);
+
+		const vec2 halfSize = {0.25f, 0.5f};
+		const uint left = physics_add_body(physics, &(physics_body_desc_t){ .center = {-2.0f, 0.501f}, .halfSize = halfSize, .mass = 1.0f, .gravityScale = 1.0f });
+		const uint right = physics_add_body(physics, &(physics_body_desc_t){ .center = {2.0f, 0.501f}, .halfSize = halfSize, .mass = 1.0f, .gravityScale = 1.0f });
+
+		for (uint tick = 0; tick < 120; ++tick)
+		{
+			physics_move(physics, left, (vec2){0.05f, 0.0f});
+			physics_move(physics, right, (vec2){-0.05f, 0.0f});
+			physics_tick(physics, &scene->world, dt);
+
+			assert(!test_boxes_overlap(physics_get_center(physics, left), halfSize, physics_get_center(physics, right), halfSize, 0.01f));
+		}
+
+		assert(fabsf(physics_get_center(physics, left).x + 0.25f) < 0.01f);
+		assert(fabsf(physics_get_center(physics, right).x - 0.25f) < 0.01f);
+		assert(physics_get_contacts(physics, left) == (COLLISION_CONTACT_GROUND | COLLISION_CONTACT_WALL));
+
+		physics_destroy(physics);
+	}
+
+	// a crowd poured into the pit stays in it
+	{
+		enum { BODY_COUNT = 400 };
+
+		physics_t* physics = physics_create(BODY_COUNT, gravity);
+		assert(physics != NULL);
+
+		uint rng = 1;
+		for (uint i = 0; i < BODY_COUNT; ++i)
+		{
+			const uint body = physics_add_body(physics, &(physics_body_desc_t){
+				.center			= {lcg_randf_range(&rng, -3.8f, 3.8f), lcg_randf_range(&rng, 1.0f, 19.0f)},
+				.halfSize		= {0.1f, 0.1f},
+				.vel			= {lcg_randf_range(&rng, -0.01f, 0.01f), 0.0f},
+				.mass			= lcg_randf_range(&rng, 0.5f, 2.0f),
+				.gravityScale	= 1.0f,
+			});
+			assert(body == i);
+		}
+
+		for (uint tick = 0; tick < 600; ++tick)
+		{
+			physics_tick(physics, &scene->world, dt);
+		}
+
+		for (uint i = 0; i < BODY_COUNT; ++i)
+		{
+			const vec2 center = physics_get_center(physics, i);
+			assert(center.y - 0.1f >= 0.0f);
+			assert(center.x - 0.1f >= -4.0f && center.x + 0.1f <= 4.0f);
+		}
+
+		physics_destroy(physics);
+	}
+
+	test_collision_destroy(scene);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_triangulate_polygon(const vec2* positions, uint vertexCount, float area)
+{
+	triangle_t* triangles = malloc(vertexCount * sizeof(triangle_t));
+	assert(triangles != NULL);
+
+	for (int algorithm = 0; algorithm < 2; ++algorithm)
+	{
+		size_t triangleCount;
+		if (algorithm == 0)	polygon_triangulate_ear_clipping(triangles, &triangleCount, positions, vertexCount);
+		else				polygon_triangulate_monotone(triangles, &triangleCount, positions, vertexCount);
+
+		assert(triangleCount == vertexCount - 2);
+
+		float triangleArea = 0.0f;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			const vec2 a = positions[triangles[i].i[0]];
+			const vec2 b = positions[triangles[i].i[1]];
+			const vec2 c = positions[triangles[i].i[2]];
+			const float cross = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+			assert(cross <= 0.0f);
+			triangleArea += -0.5f * cross;
+		}
+
+		assert(fabsf(triangleArea - area) < area * 1e-3f);
+	}
+
+	free(triangles);
+	return 0;
+}
+
+static int test_triangulate(void)
+{
+	printf("Testing triangulation...\n");
+
+	// clockwise comb with teeth pointing up and down, which needs split and merge diagonals
+	enum { TEETH = 50 };
+	vec2 comb[7 * TEETH + 2];
+	uint n = 0;
+
+	for (uint i = 0; i < TEETH; ++i)
+	{
+		comb[n++] = (vec2){ i * 2.0f, 3.0f };
+		comb[n++] = (vec2){ i * 2.0f + 1.0f, 3.0f };
+		comb[n++] = (vec2){ i * 2.0f + 1.0f, 1.0f };
+		comb[n++] = (vec2){ i * 2.0f + 2.0f, 1.0f };
+	}
+	comb[n++] = (vec2){ TEETH * 2.0f, -3.0f };
+	for (uint i = TEETH; i-- > 0;)
+	{
+		comb[n++] = (vec2){ i * 2.0f + 1.0f, -1.0f };
+		comb[n++] = (vec2){ i * 2.0f, -1.0f };
+		if (i > 0) comb[n++] = (vec2){ i * 2.0f, -3.0f };
+	}
+	comb[n++] = (vec2){ -1.0f, -3.0f };
+	comb[n++] = (vec2){ -1.0f, 3.0f };
+	assert(n <= countof(comb));
+
+	float area = 0.0f;
+	for (uint i = 0, j = n - 1; i < n; j = i++)
+	{
+		area += comb[i].x * comb[j].y - comb[j].x * comb[i].y;
+	}
+	area *= 0.5f;
+	assert(area > 0.0f);
+
+	if (test_triangulate_polygon(comb, n, area)) return 1;
+
+	// jagged clockwise star
+	enum { STAR_VERTICES = 1000 };
+	vec2* star = malloc(STAR_VERTICES * sizeof(vec2));
+	assert(star != NULL);
+	area = 0.0f;
+	for (uint i = 0; i < STAR_VERTICES; ++i)
+	{
+		const float angle = -6.28318530718f * i / STAR_VERTICES;
+		const float radius = (i & 1) ? 10.0f : 5.0f;
+		star[i] = (vec2){ cosf(angle) * radius, sinf(angle) * radius };
+	}
+	for (uint i = 0, j = STAR_VERTICES - 1; i < STAR_VERTICES; j = i++)
+	{
+		area += star[i].x * star[j].y - star[j].x * star[i].y;
+	}
+	area *= 0.5f;
+
+	if (test_triangulate_polygon(star, STAR_VERTICES, area)) return 1;
+	free(star);
+
+	// a circle snapped to whole units, which repeats most of its vertices, in both windings
+	enum { CIRCLE_VERTICES = 200 };
+	vec2 circle[CIRCLE_VERTICES];
+	uint duplicateCount = 0;
+	for (uint i = 0; i < CIRCLE_VERTICES; ++i)
+	{
+		const float angle = 6.28318530718f * i / CIRCLE_VERTICES;
+		circle[i] = (vec2){ roundf(cosf(angle) * 8.0f), roundf(sinf(angle) * 8.0f) };
+		if (i > 0 && circle[i].x == circle[i - 1].x && circle[i].y == circle[i - 1].y) ++duplicateCount;
+	}
+	assert(duplicateCount > 100);
+
+	area = 0.0f;
+	for (uint i = 0, j = CIRCLE_VERTICES - 1; i < CIRCLE_VERTICES; j = i++)
+	{
+		area += circle[i].x * circle[j].y - circle[j].x * circle[i].y;
+	}
+	area = fabsf(area * 0.5f);
+
+	if (test_triangulate_polygon(circle, CIRCLE_VERTICES, area)) return 1;
+	for (uint i = 0; i < CIRCLE_VERTICES / 2; ++i)
+	{
+		const vec2 tmp = circle[i];
+		circle[i] = circle[CIRCLE_VERTICES - 1 - i];
+		circle[CIRCLE_VERTICES - 1 - i] = tmp;
+	}
+	if (test_triangulate_polygon(circle, CIRCLE_VERTICES, area)) return 1;
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_triangulation_cache(void)
+{
+	printf("Testing triangulation cache...\n");
+
+	editor_polygon_t polygon = {0};
+	bool r = editor_polygon_reserve(&polygon, 5);
+	assert(r == true);
+
+	polygon.vertexPosition[polygon.vertexCount++] = (vec2){ 0.0f, 0.0f };
+	polygon.vertexPosition[polygon.vertexCount++] = (vec2){ 0.0f, 1.0f };
+	polygon.vertexPosition[polygon.vertexCount++] = (vec2){ 1.0f, 1.0f };
+	polygon.vertexPosition[polygon.vertexCount++] = (vec2){ 1.0f, 0.0f };
+
+	size_t triangleCount;
+	const triangle_t* triangles = editor_polygon_get_triangles(&polygon, &triangleCount);
+	assert(triangles != NULL && triangleCount == 2);
+
+	const uint64_t hash = polygon.triangleHash;
+	triangles = editor_polygon_get_triangles(&polygon, &triangleCount);
+	assert(triangleCount == 2 && polygon.triangleHash == hash);
+
+	// moving a vertex invalidates the cache
+	polygon.vertexPosition[2] = (vec2){ 2.0f, 2.0f };
+	triangles = editor_polygon_get_triangles(&polygon, &triangleCount);
+	assert(triangleCount == 2 && polygon.triangleHash != hash);
+
+	polygon.vertexPosition[polygon.vertexCount++] = (vec2){ 0.5f, -1.0f };
+	triangles = editor_polygon_get_triangles(&polygon, &triangleCount);
+	assert(triangleCount == 3);
+
+	free(polygon.vertexPosition);
+	free(polygon.triangles);
+
+	printf("Done\n");
+	return 0;
+}
+
+static gpu_foliage_instance_t* generate_test_foliage(uint32_t* instanceCount, const editor_polygon_t* polygon, uint threadCount)
+{
+	job_pool_t* pool = job_pool_create(threadCount);
+	assert(pool != NULL);
+
+	foliage_job_t* jobs = malloc(polygon->vertexCount * sizeof(foliage_job_t));
+	assert(jobs != NULL);
+
+	const uint jobCount = foliage_add_polygon_jobs(jobs, polygon, 1);
+	*instanceCount = foliage_count_instances(jobs, jobCount);
+	const uint32_t end = foliage_prefix_sum(jobs, jobCount, 0);
+	assert(end == *instanceCount);
+
+	gpu_foliage_instance_t* instances = calloc(*instanceCount, sizeof(gpu_foliage_instance_t));
+	assert(instances != NULL);
+
+	foliage_generate(pool, jobs, jobCount, instances);
+
+	free(jobs);
+	job_pool_destroy(pool);
+	return instances;
+}
+
+static int test_foliage(void)
+{
+	printf("Testing foliage...\n");
+
+	enum { VERTEX_COUNT = 256 };
+	vec2 positions[VERTEX_COUNT];
+	for (uint i = 0; i < VERTEX_COUNT; ++i)
+	{
+		const float angle = -6.28318530718f * i / VERTEX_COUNT;
+		const float radius = (i & 1) ? 20.0f : 15.0f;
+		positions[i] = (vec2){ cosf(angle) * radius, sinf(angle) * radius };
+	}
+
+	const editor_polygon_t polygon = {
+		.vertexCount	= VERTEX_COUNT,
+		.vertexPosition	= positions,
+	};
+
+	// output has to be bit-identical no matter how the jobs are spread across threads
+	uint32_t referenceInstanceCount;
+	gpu_foliage_instance_t* reference = generate_test_foliage(&referenceInstanceCount, &polygon, 1);
+	assert(referenceInstanceCount > 0);
+
+	for (uint i = 0; i < referenceInstanceCount; ++i)
+	{
+		const uint32_t params = reference[i].params;
+		assert(((params >> 9) & 0xf) == 1);
+		assert((params & 0xff) > 0);
+	}
+
+	const uint threadCounts[] = { 2, 7 };
+	for (size_t i = 0; i < countof(threadCounts); ++i)
+	{
+		uint32_t instanceCount;
+		gpu_foliage_instance_t* instances = generate_test_foliage(&instanceCount, &polygon, threadCounts[i]);
+
+		assert(instanceCount == referenceInstanceCount);
+		assert(memcmp(instances, reference, instanceCount * sizeof(gpu_foliage_instance_t)) == 0);
+
+		free(instances);
+	}
+
+	free(reference);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_world_quantization(void)
+{
+	printf("Testing world vertex quantization...\n");
+
+	enum { VERTEX_COUNT = 1024 };
+	vec2 positions[VERTEX_COUNT];
+	uint rng = 1;
+	for (uint i = 0; i < VERTEX_COUNT; ++i)
+	{
+		positions[i] = (vec2){ lcg_randf_range(&rng, -700.0f, 300.0f), lcg_randf_range(&rng, -20.0f, 80.0f) };
+	}
+
+	const gpu_world_chunk_t chunk = world_chunk_quantization((vec2){ -700.0f, -20.0f }, (vec2){ 300.0f, 80.0f }, 3);
+	assert(chunk.layer == 3);
+
+	// half a step, plus float rounding of the decode
+	const float maxErrorX = chunk.scale.x * 0.5f + 1e-4f;
+	const float maxErrorY = chunk.scale.y * 0.5f + 1e-4f;
+
+	for (uint i = 0; i < VERTEX_COUNT; ++i)
+	{
+		const vec2 p = world_dequantize_position(&chunk, world_quantize_position(&chunk, positions[i]));
+		assert(fabsf(p.x - positions[i].x) <= maxErrorX);
+		assert(fabsf(p.y - positions[i].y) <= maxErrorY);
+	}
+
+	// a degenerate chunk collapses onto its origin
+	const vec2 point = { 3.0f, 4.0f };
+	const gpu_world_chunk_t pointChunk = world_chunk_quantization(point, point, 0);
+	assert(world_quantize_position(&pointChunk, point) == 0);
+	const vec2 decoded = world_dequantize_position(&pointChunk, 0);
+	assert(decoded.x == point.x && decoded.y == point.y);
+
+	printf("Done\n");
+	return 0;
+}
+
+static uint8_t* read_test_file(size_t* len, FILE* f)
+{
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	uint8_t* mem = malloc(*len);
+	assert(mem != NULL);
+	rewind(f);
+	const size_t r = fread(mem, 1, *len, f);
+	assert(r == *len);
+	return mem;
+}
+
+static int test_world_file(void)
+{
+	printf("Testing world file...\n");
+
+	int r;
+
+	const vec2 square[] = { {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f} };
+	const vec2 triangle[] = { {40.0f, 0.0f}, {41.0f, 2.0f}, {42.0f, 0.0f} };
+
+	FILE* f = tmpfile();
+	assert(f != NULL);
+
+	world_file_writer_t writer;
+	r = world_file_writer_begin(&writer, f, 2);
+	assert(r == 0);
+	world_file_writer_begin_chunk(&writer, 0, (int2){ 0, 0 }, (vec2){ 0.0f, 0.0f }, (vec2){ 1.0f, 1.0f });
+	world_file_writer_add_polygon(&writer, square, countof(square));
+	world_file_writer_add_polygon(&writer, square, countof(square));
+	world_file_writer_begin_chunk(&writer, 5, (int2){ 1, 0 }, (vec2){ 40.0f, 0.0f }, (vec2){ 42.0f, 2.0f });
+	world_file_writer_add_polygon(&writer, triangle, countof(triangle));
+	r = world_file_writer_end(&writer);
+	assert(r == 0);
+
+	size_t len;
+	uint8_t* mem = read_test_file(&len, f);
+	fclose(f);
+
+	world_file_t file;
+	r = world_file_parse(&file, mem, len);
+	assert(r == 0);
+	assert(file.header->chunkCount == 2 && file.header->polygonCount == 3);
+	assert(file.chunks[1].layer == 5 && file.chunks[1].cellX == 1);
+
+	world_file_polygon_t polygons[2];
+	r = world_file_read_chunk(polygons, &file, 0);
+	assert(r == 0);
+	assert(polygons[1].vertexCount == 4 && memcmp(polygons[1].positions, square, sizeof(square)) == 0);
+	r = world_file_read_chunk(polygons, &file, 1);
+	assert(r == 0);
+	assert(polygons[0].vertexCount == 3 && memcmp(polygons[0].positions, triangle, sizeof(triangle)) == 0);
+
+	// a copied chunk comes out byte for byte
+	f = tmpfile();
+	assert(f != NULL);
+	r = world_file_writer_begin(&writer, f, 2);
+	assert(r == 0);
+	world_file_writer_copy_chunk(&writer, &file, 0);
+	world_file_writer_copy_chunk(&writer, &file, 1);
+	r = world_file_writer_end(&writer);
+	assert(r == 0);
+
+	size_t copyLen;
+	uint8_t* copy = read_test_file(&copyLen, f);
+	fclose(f);
+	assert(copyLen == len && memcmp(copy, mem, len) == 0);
+	free(copy);
+
+	// a snapshot mixes chunks copied from the source with chunks of its own
+	world_file_snapshot_t snapshot;
+	bool allocated = world_file_snapshot_alloc(&snapshot, 2, 1, countof(triangle));
+	assert(allocated);
+	snapshot.source = &file;
+	snapshot.chunks[0] = (world_file_snapshot_chunk_t){ .fromSource = true, .sourceChunk = 0 };
+	snapshot.chunks[1] = (world_file_snapshot_chunk_t){
+		.layer			= 2,
+		.boundsMin		= { 40.0f, 0.0f },
+		.boundsMax		= { 42.0f, 2.0f },
+		.polygonCount	= 1,
+	};
+	snapshot.polygonVertexCounts[0] = countof(triangle);
+	memcpy(snapshot.positions, triangle, sizeof(triangle));
+
+	f = tmpfile();
+	assert(f != NULL);
+	r = world_file_write_snapshot(f, &snapshot);
+	assert(r == 0);
+	world_file_snapshot_free(&snapshot);
+
+	copy = read_test_file(&copyLen, f);
+	fclose(f);
+
+	world_file_t snapshotFile;
+	r = world_file_parse(&snapshotFile, copy, copyLen);
+	assert(r == 0);
+	assert(snapshotFile.header->polygonCount == 3 && snapshotFile.chunks[1].layer == 2);
+	r = world_file_read_chunk(polygons, &snapshotFile, 0);
+	assert(r == 0 && polygons[0].vertexCount == 4);
+	r = world_file_read_chunk(polygons, &snapshotFile, 1);
+	assert(r == 0 && memcmp(polygons[0].positions, triangle, sizeof(triangle)) == 0);
+	free(copy);
+
+	printf("Corrupting world file, expect errors...\n");
+
+	// a flipped bit in chunk data only fails that chunk
+	mem[len - 1] ^= 0x10;
+	r = world_file_parse(&file, mem, len);
+	assert(r == 0);
+	r = world_file_read_chunk(polygons, &file, 1);
+	assert(r == 1);
+	r = world_file_read_chunk(polygons, &file, 0);
+	assert(r == 0);
+	mem[len - 1] ^= 0x10;
+
+	// the chunk table is checked up front
+	mem[sizeof(FILEFORMAT_world_header_t) + offsetof(FILEFORMAT_world_chunk_t, dataSize)] ^= 0x80;
+	r = world_file_parse(&file, mem, len);
+	assert(r == 1);
+	mem[sizeof(FILEFORMAT_world_header_t) + offsetof(FILEFORMAT_world_chunk_t, dataSize)] ^= 0x80;
+
+	r = world_file_parse(&file, mem, len - 4);
+	assert(r == 1);
+
+	// anything else isn't a world file at all
+	r = world_file_parse(&file, mem + 4, len - 4);
+	assert(r == 1);
+
+	r = world_file_parse(&file, mem, len);
+	assert(r == 0);
+
+	free(mem);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_particle_soa(void)
+{
+	printf("Testing particle kernels...\n");
+
+	for (float x = -100.0f; x < 100.0f; x += 0.01f)
+	{
+		assert(fabsf(particle_sinf(x) - sinf(x)) < 1e-5f);
+	}
+
+	// not a multiple of the vector width, so the tail lanes get exercised
+	enum { PARTICLE_COUNT = 103 };
+	particle_soa_t soa;
+	bool r = particle_soa_create(&soa, PARTICLE_COUNT);
+	assert(r);
+	assert(soa.capacity % PARTICLE_SOA_WIDTH == 0);
+
+	for (uint i = 0; i < PARTICLE_COUNT; ++i)
+	{
+		r = particle_soa_push(&soa, (vec2){ (float)i, 0.0f }, (vec2){ 1.0f, -2.0f }, (i % 3 == 0) ? 1.5f : 10.0f);
+		assert(r);
+	}
+	while (soa.count < soa.capacity)
+	{
+		particle_soa_push(&soa, (vec2){ 0.0f, 0.0f }, (vec2){ 0.0f, 0.0f }, 0.0f);
+	}
+	r = particle_soa_push(&soa, (vec2){ 0.0f, 0.0f }, (vec2){ 0.0f, 0.0f }, 1.0f);
+	assert(!r);
+	soa.count = PARTICLE_COUNT;
+
+	particle_soa_integrate(&soa, 1.0f, 0.5f);
+	assert(soa.posX[7] == 8.0f && soa.posY[7] == -2.0f);
+	assert(soa.velX[7] == 0.5f && soa.velY[7] == -1.0f);
+	assert(soa.age[7] == 1.0f);
+
+	particle_soa_sway(&soa, 0.5f, 2.0f);
+	assert(fabsf(soa.posX[7] - (8.0f + sinf(0.5f) * 2.0f)) < 1e-5f);
+
+	// nothing reached its lifetime yet
+	particle_soa_compact(&soa);
+	assert(soa.count == PARTICLE_COUNT);
+
+	// every third particle dies, and the rest keep their order
+	particle_soa_integrate(&soa, 1.0f, 1.0f);
+	particle_soa_compact(&soa);
+	assert(soa.count == PARTICLE_COUNT - (PARTICLE_COUNT + 2) / 3);
+	for (uint i = 0; i < soa.count; ++i)
+	{
+		const uint original = i / 2 * 3 + i % 2 + 1;
+		assert(soa.lifetime[i] == 10.0f);
+		assert(fabsf(soa.posX[i] - (original + 1.5f + sinf(0.5f) * 2.0f)) < 1e-4f);
+	}
+
+	particle_soa_destroy(&soa);
+
+	// the fused kernel has to match integrate + compact + write exactly, with deaths spread over the vectors
+	particle_soa_t fused, separate;
+	r = particle_soa_create(&fused, PARTICLE_COUNT);
+	assert(r);
+	r = particle_soa_create(&separate, PARTICLE_COUNT);
+	assert(r);
+	uint rng = 1;
+	for (uint i = 0; i < PARTICLE_COUNT; ++i)
+	{
+		const vec2 pos = { lcg_randf(&rng), lcg_randf(&rng) };
+		const vec2 vel = { lcg_randf(&rng) - 0.5f, lcg_randf(&rng) - 0.5f };
+		const float lifetime = (float)(1 + lcg_rand(&rng) % 8);
+		particle_soa_push(&fused, pos, vel, lifetime);
+		particle_soa_push(&separate, pos, vel, lifetime);
+	}
+
+	const particle_soa_style_t style = { .size = 0.3f, .layer = 5, .color = 0xff00ff00 };
+	_Alignas(16) gpu_particle_t fusedOut[PARTICLE_COUNT];
+	gpu_particle_t separateOut[PARTICLE_COUNT];
+	while (separate.count > 0)
+	{
+		particle_soa_integrate_write(&fused, 1.0f, 0.9f, fusedOut, &style);
+		particle_soa_integrate(&separate, 1.0f, 0.9f);
+		particle_soa_compact(&separate);
+		particle_soa_write(separateOut, &separate, &style);
+
+		assert(fused.count == separate.count);
+		for (uint i = 0; i < fused.count; ++i)
+		{
+			assert(fused.posX[i] == separate.posX[i] && fused.posY[i] == separate.posY[i]);
+			assert(fused.velX[i] == separate.velX[i] && fused.velY[i] == separate.velY[i]);
+			assert(fused.age[i] == separate.age[i] && fused.lifetime[i] == separate.lifetime[i]);
+		}
+		assert(memcmp(fusedOut, separateOut, fused.count * sizeof(gpu_particle_t)) == 0);
+	}
+
+	particle_soa_destroy(&fused);
+	particle_soa_destroy(&separate);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_particles_spawn(void)
+{
+	printf("Testing particle spawning...\n");
+
+	// spawning and counting doesn't touch vulkan or the wind
+	particles_t* particles = particles_create(NULL, NULL, PARTICLES_BACKEND_CPU);
+	assert(particles != NULL);
+
+	enum { SPAWN_COUNT = 5000 };
+	particle_spawn_t* spawns = malloc(SPAWN_COUNT * sizeof(particle_spawn_t));
+	assert(spawns != NULL);
+	for (uint i = 0; i < SPAWN_COUNT; ++i)
+	{
+		spawns[i] = (particle_spawn_t){ .pos = { (float)i, 0.0f } };
+	}
+
+	// pollen is one particle per spawn, with room for 4096
+	uint dropped = particles_spawn_many(particles, PARTICLE_EFFECT_AMBIENT_POLLEN, spawns, SPAWN_COUNT);
+	assert(dropped == SPAWN_COUNT - 4096);
+	assert(particles_get_count(particles, 0) == 4096);
+	assert(particles_get_dropped_spawn_count(particles) == dropped);
+
+	// dust is 5 to 9 particles per spawn, with room for 1024, and a spawn that doesn't fit whole is dropped
+	const uint dustDropped = particles_spawn_many(particles, PARTICLE_EFFECT_FOOTSTEP_DUST, spawns, 200);
+	const uint dustCount = particles_get_count(particles, 0) - 4096;
+	assert(dustDropped > 0 && dustDropped < 200);
+	assert(dustCount <= 1024 && dustCount > 1024 - 9);
+	assert(dustCount >= (200 - dustDropped) * 5 && dustCount <= (200 - dustDropped) * 9);
+	assert(particles_get_dropped_spawn_count(particles) == dropped + dustDropped);
+
+	particles_spawn(particles, PARTICLE_EFFECT_AMBIENT_POLLEN, spawns[0]);
+	assert(particles_get_dropped_spawn_count(particles) == dropped + dustDropped + 1);
+
+	free(spawns);
+	particles_destroy(particles);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_particle_effects(void)
+{
+	printf("Testing particle effect registry...\n");
+
+	particles_t* particles = particles_create(NULL, NULL, PARTICLES_BACKEND_CPU);
+	assert(particles != NULL);
+
+	// no wind coupling, so ticking doesn't need a wind
+	const particle_effect_desc_t desc = {
+		.maxCount		= 100,
+		.minBurst		= 3,
+		.maxBurst		= 3,
+		.minLifetime	= 90.0f,
+		.maxLifetime	= 90.0f,
+		.spreadX		= 1.0f,
+		.damping		= 1.0f,
+		.size			= 0.1f,
+		.endSize		= 0.5f,
+		.layer			= 2,
+		.color			= 0xff123456,
+	};
+	const particle_effect_t effect = particles_register_effect(particles, &desc);
+	assert(effect == PARTICLE_EFFECT_BUILTIN_COUNT);
+
+	particle_spawn_t spawns[40] = {};
+	assert(particles_spawn_many(particles, effect, spawns, countof(spawns)) == 40 - 100 / 3);
+	assert(particles_get_count(particles, 0) == 99);
+
+	// 90ms is between 5 and 6 ticks
+	for (int i = 0; i < 5; ++i)
+	{
+		particles_tick(particles);
+	}
+	assert(particles_get_count(particles, 0) == 99);
+	particles_tick(particles);
+	assert(particles_get_count(particles, 0) == 0);
+
+	// more than the cpu frame buffers hold
+	const particle_effect_desc_t huge = { .maxCount = 64 * 1024, .minLifetime = 1.0f, .maxLifetime = 1.0f };
+	assert(particles_register_effect(particles, &huge) == PARTICLE_EFFECT_INVALID);
+
+	uint effectCount = PARTICLE_EFFECT_BUILTIN_COUNT + 1;
+	while (particles_register_effect(particles, &desc) != PARTICLE_EFFECT_INVALID)
+	{
+		++effectCount;
+	}
+	assert(effectCount == PARTICLES_MAX_EFFECT_COUNT);
+
+	particles_destroy(particles);
+
+	printf("Done\n");
+	return 0;
+}
+
+// Submits the recorded particle work for frameIndex and waits for it.
+// The scalar injection wind.c used to have, which the kernel has to match exactly for boxes smaller than the grid.
+static void reference_wind_inject(vec2* grid, uint resolution, const wind_injection_t* injection)
+{
+	if (injection->vel.x == 0.0f &&
+		injection->vel.y == 0.0f)
+	{
+		return;
+	}
+
+	const int xMin = (int)floorf(injection->aabbMin.x / WIND_GRID_CELL_SIZE);
+	const int yMin = (int)floorf(injection->aabbMin.y / WIND_GRID_CELL_SIZE);
+	const int xMax = (int)ceilf(injection->aabbMax.x / WIND_GRID_CELL_SIZE);
+	const int yMax = (int)ceilf(injection->aabbMax.y / WIND_GRID_CELL_SIZE);
+
+	for (int y = yMin; y < yMax; ++y)
+	{
+		for (int x = xMin; x < xMax; ++x)
+		{
+			const uint i = (((uint)x) % resolution) + (((uint)y) % resolution) * resolution;
+
+			vec2 vel = vec2_add(grid[i], vec2_scale(injection->vel, 1.5f));
+			if (vec2_length(vel) > 1.0f)
+			{
+				vel = vec2_normalize(vel);
+			}
+			grid[i] = vel;
+		}
+	}
+}
+
+static int test_wind_grid(void)
+{
+	printf("Testing wind grid kernels...\n");
+
+	// not the default resolution, which is all wind.c used to support
+	enum { RESOLUTION = 32, CELL_COUNT = RESOLUTION * RESOLUTION };
+
+	vec2* grid = aligned_alloc(16, CELL_COUNT * sizeof(vec2));
+	vec2* reference = aligned_alloc(16, CELL_COUNT * sizeof(vec2));
+	assert(grid != NULL && reference != NULL);
+
+	uint rng = 7;
+	for (uint i = 0; i < CELL_COUNT; ++i)
+	{
+		grid[i] = (vec2){ lcg_randf_range(&rng, -0.7f, 0.7f), lcg_randf_range(&rng, -0.7f, 0.7f) };
+		reference[i] = grid[i];
+	}
+
+	// boxes of odd and even widths, on both sides of the origin and across the wrap in both axes
+	const float gridSize = RESOLUTION * WIND_GRID_CELL_SIZE;
+	for (uint i = 0; i < 500; ++i)
+	{
+		const vec2 aabbMin = { lcg_randf_range(&rng, -2.0f * gridSize, 2.0f * gridSize), lcg_randf_range(&rng, -2.0f * gridSize, 2.0f * gridSize) };
+		const vec2 size = { lcg_randf_range(&rng, 0.0f, 0.9f * gridSize), lcg_randf_range(&rng, 0.0f, 0.9f * gridSize) };
+		const wind_injection_t injection = {
+			.aabbMin	= aabbMin,
+			.aabbMax	= vec2_add(aabbMin, size),
+			.vel		= { lcg_randf_range(&rng, -0.5f, 0.5f), lcg_randf_range(&rng, -0.5f, 0.5f) },
+		};
+
+		wind_grid_inject(grid, RESOLUTION, &injection, NULL);
+		reference_wind_inject(reference, RESOLUTION, &injection);
+
+		if ((i % 50) == 0)
+		{
+			wind_grid_decay(grid, CELL_COUNT, 0.85f);
+			for (uint j = 0; j < CELL_COUNT; ++j)
+			{
+				reference[j] = vec2_scale(reference[j], 0.85f);
+			}
+		}
+	}
+
+	for (uint i = 0; i < CELL_COUNT; ++i)
+	{
+		assert(grid[i].x == reference[i].x && grid[i].y == reference[i].y);
+		assert(vec2_length(grid[i]) <= 1.0001f);
+	}
+
+	// a box bigger than the grid touches every cell once
+	for (uint i = 0; i < CELL_COUNT; ++i)
+	{
+		grid[i] = (vec2){ 0.0f, 0.0f };
+	}
+	const wind_injection_t everywhere = {
+		.aabbMin	= { -3.0f * gridSize, -1.5f * gridSize },
+		.aabbMax	= { 0.5f * gridSize, 1.5f * gridSize },
+		.vel		= { 0.1f, 0.0f },
+	};
+	wind_grid_inject(grid, RESOLUTION, &everywhere, NULL);
+	for (uint i = 0; i < CELL_COUNT; ++i)
+	{
+		assert(grid[i].x == 0.1f * 1.5f && grid[i].y == 0.0f);
+	}
+
+	// sampling, across the wrap and on both sides of the origin, in batches that leave a remainder
+	enum { SAMPLE_COUNT = 1003 };
+	float* xs = malloc(SAMPLE_COUNT * sizeof(float));
+	float* ys = malloc(SAMPLE_COUNT * sizeof(float));
+	float* batchX = malloc(SAMPLE_COUNT * sizeof(float));
+	float* batchY = malloc(SAMPLE_COUNT * sizeof(float));
+	assert(xs != NULL && ys != NULL && batchX != NULL && batchY != NULL);
+
+	for (uint i = 0; i < CELL_COUNT; ++i)
+	{
+		grid[i] = (vec2){ lcg_randf_range(&rng, -1.0f, 1.0f), lcg_randf_range(&rng, -1.0f, 1.0f) };
+	}
+	for (uint i = 0; i < SAMPLE_COUNT; ++i)
+	{
+		xs[i] = lcg_randf_range(&rng, -3.0f * gridSize, 3.0f * gridSize);
+		ys[i] = lcg_randf_range(&rng, -3.0f * gridSize, 3.0f * gridSize);
+	}
+	wind_grid_sample(grid, RESOLUTION, xs, ys, batchX, batchY, SAMPLE_COUNT);
+
+	for (uint i = 0; i < SAMPLE_COUNT; ++i)
+	{
+		float x, y;
+		wind_grid_sample(grid, RESOLUTION, &xs[i], &ys[i], &x, &y, 1);
+		assert(x == batchX[i] && y == batchY[i]);
+
+		// bilinear between the cell centers, in double
+		const double gx = xs[i] / (double)WIND_GRID_CELL_SIZE - 0.5;
+		const double gy = ys[i] / (double)WIND_GRID_CELL_SIZE - 0.5;
+		const double tx = gx - floor(gx);
+		const double ty = gy - floor(gy);
+		const uint x0 = (uint)(int)floor(gx) & (RESOLUTION - 1);
+		const uint y0 = (uint)(int)floor(gy) & (RESOLUTION - 1);
+		const uint x1 = (x0 + 1) & (RESOLUTION - 1);
+		const uint y1 = (y0 + 1) & (RESOLUTION - 1);
+		const vec2 v00 = grid[x0 + y0 * RESOLUTION];
+		const vec2 v10 = grid[x1 + y0 * RESOLUTION];
+		const vec2 v01 = grid[x0 + y1 * RESOLUTION];
+		const vec2 v11 = grid[x1 + y1 * RESOLUTION];
+		const double ex = (v00.x * (1.0 - tx) + v10.x * tx) * (1.0 - ty) + (v01.x * (1.0 - tx) + v11.x * tx) * ty;
+		const double ey = (v00.y * (1.0 - tx) + v10.y * tx) * (1.0 - ty) + (v01.y * (1.0 - tx) + v11.y * tx) * ty;
+		assert(fabs(x - ex) < 1e-4 && fabs(y - ey) < 1e-4);
+	}
+
+	// the center of a cell samples that cell
+	for (uint i = 0; i < CELL_COUNT; i += 37)
+	{
+		const vec2 center = { ((i % RESOLUTION) + 0.5f) * WIND_GRID_CELL_SIZE, ((i / RESOLUTION) + 0.5f) * WIND_GRID_CELL_SIZE };
+		float x, y;
+		wind_grid_sample(grid, RESOLUTION, &center.x, &center.y, &x, &y, 1);
+		assert(fabsf(x - grid[i].x) < 1e-4f && fabsf(y - grid[i].y) < 1e-4f);
+	}
+
+	free(xs);
+	free(ys);
+	free(batchX);
+	free(batchY);
+	free(grid);
+	free(reference);
+
+	printf("Done\n");
+	return 0;
+}
+
+// Sum of |central difference divergence| over a grid, the quantity the projection drives down.
+static float test_wind_divergence(const vec2* grid, uint resolution)
+{
+	const uint mask = resolution - 1;
+	float sum = 0.0f;
+	for (uint y = 0; y < resolution; ++y)
+	{
+		for (uint x = 0; x < resolution; ++x)
+		{
+			const float dx = grid[((x + 1) & mask) + y * resolution].x - grid[((x - 1) & mask) + y * resolution].x;
+			const float dy = grid[x + ((y + 1) & mask) * resolution].y - grid[x + ((y - 1) & mask) * resolution].y;
+			sum += fabsf(0.5f * (dx + dy));
+		}
+	}
+	return sum;
+}
+
+static int test_wind_solver(void)
+{
+	printf("Testing wind solver...\n");
+
+	enum { RESOLUTION = 128, CELL_COUNT = RESOLUTION * RESOLUTION };
+
+	vec2* grid = aligned_alloc(16, CELL_COUNT * sizeof(vec2));
+	vec2* threaded = aligned_alloc(16, CELL_COUNT * sizeof(vec2));
+	assert(grid != NULL && threaded != NULL);
+
+	wind_solver_desc_t desc = {
+		.resolution				= RESOLUTION,
+		.diffusionIterations	= 3,
+		.pressureIterations		= 40,
+		.viscosity				= 0.1f,
+		.damping				= 1.0f,
+	};
+
+	// a uniform wind stays as it is
+	{
+		wind_solver_t* solver = wind_solver_create(&desc, NULL);
+		assert(solver != NULL);
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			grid[i] = (vec2){ 0.25f, -0.125f };
+		}
+		for (uint i = 0; i < 10; ++i)
+		{
+			wind_solver_step(solver, grid, NULL);
+		}
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			assert(fabsf(grid[i].x - 0.25f) < 1e-5f && fabsf(grid[i].y + 0.125f) < 1e-5f);
+		}
+		wind_solver_destroy(solver);
+	}
+
+	// a burst blowing outwards from a point is mostly divergence, and a converged projection removes most of it.
+	// Jacobi is slow to converge over distances like the burst's, so this needs many more iterations than a tick.
+	{
+		wind_solver_desc_t convergedDesc = desc;
+		convergedDesc.pressureIterations = 400;
+		wind_solver_t* solver = wind_solver_create(&convergedDesc, NULL);
+		assert(solver != NULL);
+		for (uint y = 0; y < RESOLUTION; ++y)
+		{
+			for (uint x = 0; x < RESOLUTION; ++x)
+			{
+				const vec2 d = { (float)x - 40.0f, (float)y - 60.0f };
+				const float falloff = expf(-vec2_dot(d, d) / 50.0f);
+				grid[x + y * RESOLUTION] = vec2_scale(d, 0.02f * falloff);
+			}
+		}
+		const float before = test_wind_divergence(grid, RESOLUTION);
+		wind_solver_step(solver, grid, NULL);
+		const float after = test_wind_divergence(grid, RESOLUTION);
+		assert(after < before * 0.25f);
+		wind_solver_destroy(solver);
+	}
+
+	// a gust is carried downwind
+	{
+		wind_solver_t* solver = wind_solver_create(&desc, NULL);
+		assert(solver != NULL);
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			grid[i] = (vec2){ 0.0f, 0.0f };
+		}
+		const wind_injection_t gust = {
+			.aabbMin	= { 20.0f * WIND_GRID_CELL_SIZE, 50.0f * WIND_GRID_CELL_SIZE },
+			.aabbMax	= { 30.0f * WIND_GRID_CELL_SIZE, 60.0f * WIND_GRID_CELL_SIZE },
+			.vel		= { 0.2f, 0.0f },
+		};
+		wind_grid_inject(grid, RESOLUTION, &gust, NULL);
+
+		for (uint i = 0; i < 10; ++i)
+		{
+			wind_solver_step(solver, grid, NULL);
+		}
+
+		// the speed weighted center of the gust, which started at x = 25
+		float weight = 0.0f, center = 0.0f;
+		for (uint y = 0; y < RESOLUTION; ++y)
+		{
+			for (uint x = 0; x < RESOLUTION; ++x)
+			{
+				const float speed = vec2_length(grid[x + y * RESOLUTION]);
+				weight += speed;
+				center += speed * (float)x;
+			}
+		}
+		assert(weight > 0.0f);
+		assert(center / weight > 30.0f);
+		wind_solver_destroy(solver);
+	}
+
+	// a gust only changes the rows it can reach in a step, and dies down to exactly zero
+	{
+		wind_solver_desc_t dampedDesc = desc;
+		dampedDesc.damping = 0.9f;
+		wind_solver_t* solver = wind_solver_create(&dampedDesc, NULL);
+		assert(solver != NULL);
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			grid[i] = (vec2){ 0.0f, 0.0f };
+		}
+
+		// the solver can't know what the grid held before its first step, so that one reports every row
+		uint8_t changedRows[RESOLUTION] = {0};
+		bool isMoving = wind_solver_step(solver, grid, changedRows);
+		assert(!isMoving);
+		for (uint y = 0; y < RESOLUTION; ++y)
+		{
+			assert(changedRows[y]);
+			changedRows[y] = 0;
+		}
+
+		const wind_injection_t gust = {
+			.aabbMin	= { 20.0f * WIND_GRID_CELL_SIZE, 50.0f * WIND_GRID_CELL_SIZE },
+			.aabbMax	= { 30.0f * WIND_GRID_CELL_SIZE, 60.0f * WIND_GRID_CELL_SIZE },
+			.vel		= { 0.2f, 0.0f },
+		};
+		wind_grid_inject(grid, RESOLUTION, &gust, changedRows);
+		for (uint y = 0; y < RESOLUTION; ++y)
+		{
+			assert(changedRows[y] == (y >= 50 && y < 60));
+		}
+
+		// a step reaches a row further per Jacobi iteration, plus a couple for the advection and differences
+		isMoving = wind_solver_step(solver, grid, changedRows);
+		assert(isMoving);
+		const uint reach = desc.diffusionIterations + desc.pressureIterations + 4;
+		// the rows between the far side of the gust and its near side, around the wrap
+		for (uint y = 60 + reach; y < RESOLUTION + 50 - reach; ++y)
+		{
+			assert(!changedRows[y % RESOLUTION]);
+		}
+
+		uint steps = 0;
+		while (isMoving && steps < 1000)
+		{
+			isMoving = wind_solver_step(solver, grid, NULL);
+			++steps;
+		}
+		assert(!isMoving);
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			assert(grid[i].x == 0.0f && grid[i].y == 0.0f);
+		}
+		wind_solver_destroy(solver);
+	}
+
+	// the job pool splits the passes into bands, which mustn't change the result
+	{
+		job_pool_t* pool = job_pool_create(4);
+		assert(pool != NULL);
+		wind_solver_t* serial = wind_solver_create(&desc, NULL);
+		wind_solver_t* parallel = wind_solver_create(&desc, pool);
+		assert(serial != NULL && parallel != NULL);
+
+		uint rng = 3;
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			grid[i] = (vec2){ lcg_randf_range(&rng, -0.5f, 0.5f), lcg_randf_range(&rng, -0.5f, 0.5f) };
+			threaded[i] = grid[i];
+		}
+		for (uint i = 0; i < 5; ++i)
+		{
+			wind_solver_step(serial, grid, NULL);
+			wind_solver_step(parallel, threaded, NULL);
+		}
+		for (uint i = 0; i < CELL_COUNT; ++i)
+		{
+			assert(grid[i].x == threaded[i].x && grid[i].y == threaded[i].y);
+		}
+
+		wind_solver_destroy(serial);
+		wind_solver_destroy(parallel);
+		job_pool_destroy(pool);
+	}
+
+	free(grid);
+	free(threaded);
+
+	printf("Done\n");
+	return 0;
+}
+
+static int test_headless(void)
+{
+	printf("Testing headless simulation...\n");
+
+	enum { TICKS = 300 };
+
+	job_pool_t* pool = job_pool_create(4);
+	assert(pool != NULL);
+
+	// the same ticks come out the same, with or without threads
+	headless_desc_t desc = {
+		.worldPath		= "world.bin",
+		.tickCount		= TICKS,
+		.windResolution	= WIND_GRID_DEFAULT_RESOLUTION,
+	};
+	headless_result_t serial, parallel, shorter;
+	int r = headless_simulate(&serial, &desc);
+	assert(r == 0);
+	assert(serial.tickCount == TICKS);
+
+	desc.jobPool = pool;
+	r = headless_simulate(&parallel, &desc);
+	assert(r == 0);
+	assert(serial.hash == parallel.hash);
+
+	// and a tick less doesn't
+	desc.tickCount = TICKS - 1;
+	r = headless_simulate(&shorter, &desc);
+	assert(r == 0);
+	assert(shorter.hash != serial.hash);
+
+	job_pool_destroy(pool);
+
+	// a floor a chunk per cell out to x = 256, which the player runs along until it's well past where the chunks
+	// around the start are streamed
+	{
+		char path[] = "/tmp/test_world_XXXXXX";
+		const int fd = mkstemp(path);
+		assert(fd >= 0);
+		FILE* f = fdopen(fd, "w+b");
+		assert(f != NULL);
+
+		enum { FIRST_CELL = -1, LAST_CELL = 7 };
+		world_file_writer_t writer;
+		r = world_file_writer_begin(&writer, f, LAST_CELL - FIRST_CELL + 1);
+		assert(r == 0);
+		for (int cell = FIRST_CELL; cell <= LAST_CELL; ++cell)
+		{
+			const float x0 = cell * 32.0f;
+			const float x1 = x0 + 32.0f;
+			const vec2 floor[] = { {x0, -1.0f}, {x0, 0.0f}, {x1, 0.0f}, {x1, -1.0f} };
+			world_file_writer_begin_chunk(&writer, 0, (int2){ cell, -1 }, floor[0], floor[2]);
+			world_file_writer_add_polygon(&writer, floor, countof(floor));
+		}
+		r = world_file_writer_end(&writer);
+		assert(r == 0);
+		fclose(f);
+
+		wind_t* wind			= wind_create(NULL, NULL, WIND_GRID_DEFAULT_RESOLUTION);
+		particles_t* particles	= particles_create(NULL, wind, PARTICLES_BACKEND_CPU);
+		world_t* world			= world_create(NULL, particles, NULL);
+		game_t* game			= game_create(NULL, NULL, world, wind, particles);
+		assert(wind != NULL && particles != NULL && world != NULL && game != NULL);
+
+		r = world_load(world, path);
+		assert(r == 0);
+		remove(path);
+
+		game_window_event(game, &(window_event_t){ .type = WINDOW_EVENT_KEY_DOWN, .data.key.code = KEY_D });
+		game_window_event(game, &(window_event_t){ .type = WINDOW_EVENT_KEY_DOWN, .data.key.code = KEY_SHIFT });
+
+		const uint2 resolution = {1920, 1080};
+		for (uint tick = 0; tick < 500; ++tick)
+		{
+			world_update_headless(world);
+			game_tick(game, resolution);
+		}
+
+		const vec2 pos = game_get_player_pos(game);
+		assert(pos.x > 150.0f && pos.x < 256.0f);
+		assert(pos.y > -0.01f && pos.y < 0.01f);
+
+		game_destroy(game);
+		world_destroy(world);
+		particles_destroy(particles);
+		wind_destroy(wind);
+	}
+
+	printf("Done\n");
+	return 0;
+}
+
+static void test_replay_next(replay_reader_t* reader, replay_record_type_t type, uint2 resolution)
+{
+	replay_record_t record;
+	const bool read = replay_reader_next(reader, &record);
+	assert(read && record.type == type);
+	assert(record.resolution.x == resolution.x && record.resolution.y == resolution.y);
+}
+
+static void test_replay_next_event(replay_reader_t* reader, const window_event_t* event)
+{
+	replay_record_t record;
+	const bool read = replay_reader_next(reader, &record);
+	assert(read && record.type == REPLAY_RECORD_EVENT && record.event.type == event->type);
+	assert(memcmp(&record.event.data, &event->data, sizeof(event->data)) == 0);
+}
+
+// Runs a replay headless and returns the hash it ends on.
+static uint64_t test_replay_simulate(const uint8_t* mem, size_t len)
+{
+	replay_reader_t reader;
+	int r = replay_reader_parse(&reader, mem, len);
+	assert(r == 0);
+
+	const headless_desc_t desc = {
+		.worldPath		= "world.bin",
+		.windResolution	= WIND_GRID_DEFAULT_RESOLUTION,
+		.replay			= &reader,
+	};
+	headless_result_t result;
+	r = headless_simulate(&result, &desc);
+	assert(r == 0);
+	assert(result.tickCount == reader.header.tickCount);
+	return result.hash;
+}
+
+// Clicks in the editor at from, drags to to and lets go, a frame apart, when drag is set. Otherwise the mouse only
+// moves.
+static uint8_t* test_replay_edit_session(size_t* len, int2 from, int2 to, bool drag)
+{
+	const uint2 resolution = {1280, 720};
+
+	FILE* f = tmpfile();
+	assert(f != NULL);
+
+	replay_writer_t writer;
+	int r = replay_writer_begin(&writer, f);
+	assert(r == 0);
+
+	for (uint i = 0; i < 30; ++i)
+	{
+		replay_writer_tick(&writer, resolution);
+		replay_writer_frame(&writer, resolution);
+	}
+
+	replay_writer_event(&writer, &(window_event_t){ .type = WINDOW_EVENT_KEY_DOWN, .data.key.code = KEY_F1 });
+	replay_writer_event(&writer, &(window_event_t){ .type = WINDOW_EVENT_MOUSE_MOVE, .data.mouse.pos = from });
+	replay_writer_tick(&writer, resolution);
+	replay_writer_frame(&writer, resolution);
+
+	if (drag)
+	{
+		replay_writer_event(&writer, &(window_event_t){ .type = WINDOW_EVENT_BUTTON_DOWN, .data.button = { BUTTON_LEFT, from } });
+	}
+	replay_writer_tick(&writer, resolution);
+	replay_writer_frame(&writer, resolution);
+
+	replay_writer_event(&writer, &(window_event_t){ .type = WINDOW_EVENT_MOUSE_MOVE, .data.mouse.pos = to });
+	if (drag)
+	{
+		replay_writer_event(&writer, &(window_event_t){ .type = WINDOW_EVENT_BUTTON_UP, .data.button = { BUTTON_LEFT, to } });
+	}
+	replay_writer_tick(&writer, resolution);
+	replay_writer_frame(&writer, resolution);
+
+	r = replay_writer_end(&writer);
+	assert(r == 0);
+
+	uint8_t* mem = read_test_file(len, f);
+	fclose(f);
+	return mem;
+}
+
+static int test_replay(void)
+{
+	printf("Testing replay...\n");
+
+	int r;
+
+	const uint2 small = {640, 480};
+	const uint2 large = {1920, 1080};
+	const window_event_t events[] = {
+		{ .type = WINDOW_EVENT_KEY_DOWN, .data.key.code = KEY_SPACE },
+		{ .type = WINDOW_EVENT_MOUSE_MOVE, .data.mouse = { .pos = { 700, -3 }, .delta = { -400, 12 } } },
+		{ .type = WINDOW_EVENT_BUTTON_DOWN, .data.button = { BUTTON_RIGHT, { 5, 6 } } },
+		{ .type = WINDOW_EVENT_MOUSE_SCROLL, .data.scroll.delta = -1 },
+		{ .type = WINDOW_EVENT_SIZE, .data.size.size = { 800, 600 } },
+	};
+
+	FILE* f = tmpfile();
+	assert(f != NULL);
+
+	replay_writer_t writer;
+	r = replay_writer_begin(&writer, f);
+	assert(r == 0);
+	replay_writer_frame(&writer, small);
+	replay_writer_event(&writer, &events[0]);
+	replay_writer_tick(&writer, small);
+	replay_writer_tick(&writer, small);
+	replay_writer_frame(&writer, small);
+	replay_writer_event(&writer, &events[1]);
+	for (uint i = 0; i < 200; ++i)
+	{
+		replay_writer_tick(&writer, small);
+	}
+	replay_writer_frame(&writer, large);
+	replay_writer_event(&writer, &events[2]);
+	replay_writer_event(&writer, &events[3]);
+	replay_writer_event(&writer, &events[4]);
+	replay_writer_tick(&writer, large);
+	r = replay_writer_end(&writer);
+	assert(r == 0);
+
+	size_t len;
+	uint8_t* mem = read_test_file(&len, f);
+	fclose(f);
+
+	// a frame of ticks without events is a byte
+	assert(len < sizeof(FILEFORMAT_replay_header_t) + 64);
+
+	replay_reader_t reader;
+	r = replay_reader_parse(&reader, mem, len);
+	assert(r == 0);
+	assert(reader.header.tickCount == 203 && reader.header.frameCount == 3);
+
+	test_replay_next(&reader, REPLAY_RECORD_FRAME, small);
+	test_replay_next_event(&reader, &events[0]);
+	test_replay_next(&reader, REPLAY_RECORD_TICK, small);
+	test_replay_next(&reader, REPLAY_RECORD_TICK, small);
+	test_replay_next(&reader, REPLAY_RECORD_FRAME, small);
+	test_replay_next_event(&reader, &events[1]);
+	for (uint i = 0; i < 200; ++i)
+	{
+		test_replay_next(&reader, REPLAY_RECORD_TICK, small);
+	}
+	test_replay_next(&reader, REPLAY_RECORD_FRAME, large);
+
+	replay_record_t record;
+	bool read = replay_reader_peek(&reader, &record);
+	assert(read && record.type == REPLAY_RECORD_EVENT);
+	test_replay_next_event(&reader, &events[2]);
+	test_replay_next_event(&reader, &events[3]);
+	test_replay_next_event(&reader, &events[4]);
+	test_replay_next(&reader, REPLAY_RECORD_TICK, large);
+	read = replay_reader_next(&reader, &record);
+	assert(!read);
+
+	printf("Corrupting replay file, expect errors...\n");
+
+	mem[len - 2] ^= 0x04;
+	r = replay_reader_parse(&reader, mem, len);
+	assert(r == 1);
+	mem[len - 2] ^= 0x04;
+
+	r = replay_reader_parse(&reader, mem, len - 1);
+	assert(r == 1);
+
+	free(mem);
+
+	// the script recorded headless replays to the same state
+	f = tmpfile();
+	assert(f != NULL);
+	r = replay_writer_begin(&writer, f);
+	assert(r == 0);
+
+	const headless_desc_t desc = {
+		.worldPath		= "world.bin",
+		.tickCount		= 200,
+		.windResolution	= WIND_GRID_DEFAULT_RESOLUTION,
+		.record			= &writer,
+	};
+	headless_result_t result;
+	r = headless_simulate(&result, &desc);
+	assert(r == 0);
+	r = replay_writer_end(&writer);
+	assert(r == 0);
+
+	mem = read_test_file(&len, f);
+	fclose(f);
+	assert(test_replay_simulate(mem, len) == result.hash);
+	free(mem);
+
+	// and an editor session edits the world the same way every time. The mouse starts out just below the middle
+	// of the screen, over the ground.
+	size_t dragLen, moveLen;
+	uint8_t* drag = test_replay_edit_session(&dragLen, (int2){ 640, 420 }, (int2){ 600, 300 }, true);
+	uint8_t* move = test_replay_edit_session(&moveLen, (int2){ 640, 420 }, (int2){ 600, 300 }, false);
+
+	const uint64_t dragHash = test_replay_simulate(drag, dragLen);
+	assert(test_replay_simulate(drag, dragLen) == dragHash);
+	assert(test_replay_simulate(move, moveLen) != dragHash);
+
+	free(drag);
+	free(move);
+
+	printf("Done\n");
+	return 0;
+}
+
+static void test_particles_gpu_frame(vulkan_t* vulkan, particles_t* cpu, particles_t* gpu, wind_t* wind, const staging_memory_allocation_t* stagingAllocation, descriptor_allocator_t* dsalloc, uint frameIndex)
+{
+	VkResult vkr;
+
+	descriptor_set_cache_update(dsalloc->cache, frameIndex);
+
+	staging_memory_context_t stagingMemoryContext;
+	ResetStagingMemoryContext(&stagingMemoryContext, stagingAllocation);
+
+	const render_context_t rc = {
+		.frameIndex = frameIndex,
+		.vulkan = vulkan,
+		.stagingMemory = &stagingMemoryContext,
+		.dsalloc = dsalloc,
+	};
+
+	const VkCommandBufferAllocateInfo allocateInfo = {
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = vulkan->commandPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+	VkCommandBuffer cb;
+	vkr = vkAllocateCommandBuffers(vulkan->device, &allocateInfo, &cb);
+	assert(vkr == VK_SUCCESS);
+
+	const VkCommandBufferBeginInfo beginInfo = {
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+	};
+	vkr = vkBeginCommandBuffer(cb, &beginInfo);
+	assert(vkr == VK_SUCCESS);
+
+	wind_update(cb, wind, &rc);
+	particles_update(cpu, cb, &rc);
+	particles_update(gpu, cb, &rc);
+
+	vkr = vkEndCommandBuffer(cb);
+	assert(vkr == VK_SUCCESS);
+
+	vkr = FlushStagingMemory(&stagingMemoryContext, vulkan);
+	assert(vkr == VK_SUCCESS);
+
+	const VkSubmitInfo submitInfo = {
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &cb,
+	};
+	vkr = vkQueueSubmit(vulkan->mainQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	assert(vkr == VK_SUCCESS);
+	vkr = vkQueueWaitIdle(vulkan->mainQueue);
+	assert(vkr == VK_SUCCESS);
+
+	vkFreeCommandBuffers(vulkan->device, vulkan->commandPool, 1, &cb);
+}
+
+static void test_particles_spawn_both(particles_t* a, particles_t* b, particle_effect_t effect, uint count)
+{
+	for (uint i = 0; i < count; ++i)
+	{
+		const particle_spawn_t spawn = { .pos = { i * 0.1f, 0.0f } };
+		particles_spawn(a, effect, spawn);
+		particles_spawn(b, effect, spawn);
+	}
+}
+
+static int test_particles_gpu(void)
+{
+	printf("Testing gpu particles...\n");
+
+	VkResult vkr;
+	int r;
+
+	// runs on any vulkan 1.3 device, including lavapipe when nothing else is around
+	const VkApplicationInfo appInfo = {
+		VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.apiVersion = VK_API_VERSION_1_3,
+	};
+	const VkInstanceCreateInfo instanceInfo = {
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pApplicationInfo = &appInfo,
+	};
+	VkInstance instance;
+	if (vkCreateInstance(&instanceInfo, NULL, &instance) != VK_SUCCESS)
+	{
+		printf("No vulkan instance, skipping\n");
+		return 0;
+	}
+
+	vulkan_t vulkan = {};
+	if (CreateVulkanContext(&vulkan, instance, VK_NULL_HANDLE) != 0)
+	{
+		printf("No vulkan device, skipping\n");
+		vkDestroyInstance(instance, NULL);
+		return 0;
+	}
+
+	r = InitShaderLibrary(&vulkan);
+	assert(r == 0);
+
+	wind_t* wind = wind_create(&vulkan, NULL, WIND_GRID_DEFAULT_RESOLUTION);
+	particles_t* cpu = particles_create(&vulkan, wind, PARTICLES_BACKEND_CPU);
+	particles_t* gpu = particles_create(&vulkan, wind, PARTICLES_BACKEND_GPU);
+	assert(wind != NULL && cpu != NULL && gpu != NULL);
+
+	staging_memory_allocator_t stagingAllocator;
+	ResetStagingMemoryAllocator(&stagingAllocator, &vulkan);
+	wind_alloc_staging_mem(&stagingAllocator, wind);
+	particles_alloc_staging_mem(&stagingAllocator, cpu);
+	particles_alloc_staging_mem(&stagingAllocator, gpu);
+
+	staging_memory_allocation_t stagingAllocation;
+	FinalizeStagingMemoryAllocator(&stagingAllocation, &stagingAllocator);
+
+	const VkDescriptorPoolSize descriptorPoolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 64 },
+	};
+	const VkDescriptorPoolCreateInfo descriptorPoolInfo = {
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.maxSets = 8,
+		.poolSizeCount = countof(descriptorPoolSizes),
+		.pPoolSizes = descriptorPoolSizes,
+	};
+	VkDescriptorPool descriptorPool;
+	vkr = vkCreateDescriptorPool(vulkan.device, &descriptorPoolInfo, NULL, &descriptorPool);
+	assert(vkr == VK_SUCCESS);
+
+	descriptor_set_cache_t dscache;
+	descriptor_set_cache_create(&dscache, descriptorPool, 8);
+	descriptor_allocator_t dsalloc;
+	descriptor_allocator_create(&dsalloc, &dscache, &vulkan, 16);
+
+	// dust lives for 60 ticks and pollen for at least 600, so the first dust is gone by the end and the second
+	// isn't. Spawns only go in at frame boundaries, where the gpu backend agrees with the cpu one.
+	test_particles_spawn_both(cpu, gpu, PARTICLE_EFFECT_FOOTSTEP_DUST, 20);
+	test_particles_spawn_both(cpu, gpu, PARTICLE_EFFECT_AMBIENT_POLLEN, 100);
+	for (int i = 0; i < 50; ++i)
+	{
+		particles_tick(cpu);
+		particles_tick(gpu);
+	}
+	test_particles_gpu_frame(&vulkan, cpu, gpu, wind, &stagingAllocation, &dsalloc, 0);
+	assert(particles_get_count(gpu, 0) == particles_get_count(cpu, 0));
+
+	test_particles_spawn_both(cpu, gpu, PARTICLE_EFFECT_FOOTSTEP_DUST, 20);
+	for (int i = 0; i < 40; ++i)
+	{
+		particles_tick(cpu);
+		particles_tick(gpu);
+	}
+	test_particles_gpu_frame(&vulkan, cpu, gpu, wind, &stagingAllocation, &dsalloc, 1);
+	assert(particles_get_count(cpu, 1) > 100);
+	assert(particles_get_count(gpu, 1) == particles_get_count(cpu, 1));
+
+	// binned back to front: the pollen on layer 1, then the dust on layer 0
+	particles_render_info_t renderInfo;
+	particles_get_render_info(&renderInfo, cpu, 1);
+	assert(renderInfo.layerFirst[1] == 0 && renderInfo.layerCount[1] == 100);
+	assert(renderInfo.layerFirst[0] == 100 && renderInfo.layerFirst[0] + renderInfo.layerCount[0] == renderInfo.particleCount);
+	assert(renderInfo.particleCount == particles_get_count(cpu, 1));
+
+	descriptor_set_cache_destroy(&dscache, &vulkan);
+	vkDestroyDescriptorPool(vulkan.device, descriptorPool, NULL);
+	particles_destroy(gpu);
+	particles_destroy(cpu);
+	wind_destroy(wind);
+	vkUnmapMemory(vulkan.device, stagingAllocation.memory);
+	vkFreeMemory(vulkan.device, stagingAllocation.memory, NULL);
+	DeinitShaderLibrary(&vulkan);
+	DestroyVulkanContext(&vulkan);
+	vkDestroyInstance(instance, NULL);
+
 	printf("Done\n");
 	return 0;
 }
@@ -41,6 +1955,22 @@ static int test_offset_allocator(void)
 int run_tests(void)
 {
 	if (test_offset_allocator()) return 1;
+	if (test_collision_grid()) return 1;
+	if (test_collision()) return 1;
+	if (test_physics()) return 1;
+	if (test_triangulate()) return 1;
+	if (test_triangulation_cache()) return 1;
+	if (test_foliage()) return 1;
+	if (test_world_quantization()) return 1;
+	if (test_world_file()) return 1;
+	if (test_particle_soa()) return 1;
+	if (test_particles_spawn()) return 1;
+	if (test_particle_effects()) return 1;
+	if (test_wind_grid()) return 1;
+	if (test_wind_solver()) return 1;
+	if (test_headless()) return 1;
+	if (test_replay()) return 1;
+	if (test_particles_gpu()) return 1;
 
 	printf("All tests passed!\n");
 	return 0;
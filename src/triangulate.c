@@ -0,0 +1,821 @@
+#include "triangulate.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+// > 0 when a, b, c wind counter-clockwise
+static float orient(vec2 a, vec2 b, vec2 c)
+{
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static float polygon_signed_area(const vec2* positions, uint vertexCount)
+{
+	float area = 0.0f;
+	for (uint i = 0, j = vertexCount - 1; i < vertexCount; j = i++)
+	{
+		area += positions[j].x * positions[i].y - positions[i].x * positions[j].y;
+	}
+	return area * 0.5f;
+}
+
+static void emit_triangle(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint i0, uint i1, uint i2)
+{
+	// the world and its colliders expect clockwise triangles
+	if (orient(positions[i0], positions[i1], positions[i2]) > 0.0f)
+	{
+		const uint tmp = i1;
+		i1 = i2;
+		i2 = tmp;
+	}
+
+	triangle_t* triangle = &triangles[(*triangleCount)++];
+	triangle->i[0] = i0;
+	triangle->i[1] = i1;
+	triangle->i[2] = i2;
+}
+
+static bool vec2_equal(vec2 a, vec2 b)
+{
+	return a.x == b.x && a.y == b.y;
+}
+
+static void* carve(uint8_t** cursor, size_t size)
+{
+	void* ptr = *cursor;
+	*cursor += (size + 7) & ~(size_t)7;
+	return ptr;
+}
+
+void polygon_triangulate(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount)
+{
+	if (vertexCount > TRIANGULATE_MONOTONE_THRESHOLD)
+	{
+		polygon_triangulate_monotone(triangles, triangleCount, positions, vertexCount);
+	}
+	else
+	{
+		polygon_triangulate_ear_clipping(triangles, triangleCount, positions, vertexCount);
+	}
+}
+
+//
+// ear clipping
+//
+
+// https://www.geometrictools.com/Documentation/TriangulationByEarClipping.pdf
+void polygon_triangulate_ear_clipping(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint n)
+{
+	*triangleCount = 0;
+
+	if (n < 3)
+	{
+		return;
+	}
+
+	// flips every orientation test so the rest of the function can assume counter-clockwise winding
+	const float s = polygon_signed_area(positions, n) < 0.0f ? -1.0f : 1.0f;
+
+	uint8_t* mem = malloc(n * (4 * sizeof(uint) + sizeof(bool)) + 64);
+	assert(mem != NULL);
+	uint8_t* cursor = mem;
+
+	uint* prev			= carve(&cursor, n * sizeof(uint));
+	uint* next			= carve(&cursor, n * sizeof(uint));
+	uint* reflexPrev	= carve(&cursor, n * sizeof(uint));
+	uint* reflexNext	= carve(&cursor, n * sizeof(uint));
+	bool* isReflex		= carve(&cursor, n * sizeof(bool));
+
+	const uint NIL = 0xffffffffu;
+	uint reflexHead = NIL;
+
+	for (uint i = 0; i < n; ++i)
+	{
+		prev[i] = (i + n - 1) % n;
+		next[i] = (i + 1) % n;
+	}
+
+	// only reflex vertices can lie inside a candidate ear, so those are the only ones tested
+	for (uint i = n; i-- > 0;)
+	{
+		isReflex[i] = s * orient(positions[prev[i]], positions[i], positions[next[i]]) <= 0.0f;
+		if (isReflex[i])
+		{
+			reflexPrev[i] = NIL;
+			reflexNext[i] = reflexHead;
+			if (reflexHead != NIL)
+			{
+				reflexPrev[reflexHead] = i;
+			}
+			reflexHead = i;
+		}
+	}
+
+	uint remaining = n;
+	uint v = 0;
+	uint attempts = 0;
+
+	while (remaining > 3)
+	{
+		const uint p = prev[v];
+		const uint nx = next[v];
+
+		const vec2 a = positions[p];
+		const vec2 b = positions[v];
+		const vec2 c = positions[nx];
+
+		bool isEar = !isReflex[v];
+
+		for (uint r = reflexHead; isEar && r != NIL; r = reflexNext[r])
+		{
+			if (r == p || r == v || r == nx)
+			{
+				continue;
+			}
+
+			// points on the boundary count as inside, otherwise a vertex sitting on the new diagonal
+			// would end up outside the clipped polygon. A repeat of a corner doesn't, or no ear next to it
+			// would ever be clipped.
+			const vec2 q = positions[r];
+			if (vec2_equal(q, a) || vec2_equal(q, b) || vec2_equal(q, c))
+			{
+				continue;
+			}
+			if (s * orient(a, b, q) >= 0.0f &&
+				s * orient(b, c, q) >= 0.0f &&
+				s * orient(c, a, q) >= 0.0f)
+			{
+				isEar = false;
+			}
+		}
+
+		// a full lap without an ear means the input isn't simple; clip anyway so we always terminate
+		if (!isEar && ++attempts <= remaining)
+		{
+			v = nx;
+			continue;
+		}
+
+		emit_triangle(triangles, triangleCount, positions, p, v, nx);
+
+		next[p] = nx;
+		prev[nx] = p;
+		--remaining;
+		attempts = 0;
+
+		if (isReflex[v])
+		{
+			isReflex[v] = false;
+			if (reflexPrev[v] != NIL) reflexNext[reflexPrev[v]] = reflexNext[v];
+			else reflexHead = reflexNext[v];
+			if (reflexNext[v] != NIL) reflexPrev[reflexNext[v]] = reflexPrev[v];
+		}
+
+		// clipping an ear can only make its neighbours convex
+		const uint neighbours[2] = {p, nx};
+		for (uint i = 0; i < 2; ++i)
+		{
+			const uint w = neighbours[i];
+			if (isReflex[w] && s * orient(positions[prev[w]], positions[w], positions[next[w]]) > 0.0f)
+			{
+				isReflex[w] = false;
+				if (reflexPrev[w] != NIL) reflexNext[reflexPrev[w]] = reflexNext[w];
+				else reflexHead = reflexNext[w];
+				if (reflexNext[w] != NIL) reflexPrev[reflexNext[w]] = reflexPrev[w];
+			}
+		}
+
+		v = nx;
+	}
+
+	emit_triangle(triangles, triangleCount, positions, prev[v], v, next[v]);
+
+	free(mem);
+}
+
+//
+// monotone decomposition
+//
+// Computational Geometry: Algorithms and Applications (de Berg et al.), chapter 3.
+// The sweep runs top to bottom over a counter-clockwise copy of the polygon. The sweep status is a
+// sorted array of the edges crossing the sweep line, searched with binary search. Inserts and removes
+// shift the tail of the array, but that is a memmove and stays cheap next to the search.
+//
+
+typedef enum monotone_vertex_type
+{
+	MONOTONE_VERTEX_START,
+	MONOTONE_VERTEX_END,
+	MONOTONE_VERTEX_SPLIT,
+	MONOTONE_VERTEX_MERGE,
+	MONOTONE_VERTEX_REGULAR,
+} monotone_vertex_type_t;
+
+typedef enum monotone_chain
+{
+	MONOTONE_CHAIN_LEFT,
+	MONOTONE_CHAIN_RIGHT,
+} monotone_chain_t;
+
+typedef struct monotone_context
+{
+	uint			n;
+	const vec2*		positions;	// original polygon
+	const uint*		index;		// counter-clockwise vertex -> original vertex
+	vec2*			p;			// counter-clockwise positions
+
+	uint8_t*		type;
+	uint*			helper;
+	uint*			status;
+	uint8_t*		inStatus;
+	uint			statusCount;
+
+	uint*			diagA;
+	uint*			diagB;
+	uint			diagCount;
+
+	uint*			sorted;
+	uint*			tmp;
+	uint8_t*		chain;
+	uint*			stack;
+
+	triangle_t*		triangles;
+	size_t*			triangleCount;
+} monotone_context_t;
+
+// sweep order: higher y first, ties broken by lower x
+static bool is_above(const monotone_context_t* ctx, uint a, uint b)
+{
+	const vec2 pa = ctx->p[a];
+	const vec2 pb = ctx->p[b];
+	return pa.y > pb.y || (pa.y == pb.y && pa.x < pb.x);
+}
+
+static void sort_by_sweep_order(const monotone_context_t* ctx, uint* items, uint* tmp, uint count)
+{
+	for (uint width = 1; width < count; width *= 2)
+	{
+		for (uint lo = 0; lo < count; lo += 2 * width)
+		{
+			const uint mid = lo + width < count ? lo + width : count;
+			const uint hi = lo + 2 * width < count ? lo + 2 * width : count;
+
+			uint i = lo, j = mid, k = lo;
+			while (i < mid && j < hi) tmp[k++] = is_above(ctx, items[j], items[i]) ? items[j++] : items[i++];
+			while (i < mid) tmp[k++] = items[i++];
+			while (j < hi) tmp[k++] = items[j++];
+		}
+
+		uint* swap = items;
+		for (uint i = 0; i < count; ++i) swap[i] = tmp[i];
+	}
+}
+
+static void monotone_add_diagonal(monotone_context_t* ctx, uint a, uint b)
+{
+	ctx->diagA[ctx->diagCount] = a;
+	ctx->diagB[ctx->diagCount] = b;
+	++ctx->diagCount;
+}
+
+// x of the edge where it crosses the horizontal line through vertex v
+static float monotone_edge_x(const monotone_context_t* ctx, uint edge, uint v)
+{
+	const vec2 pv = ctx->p[v];
+	const vec2 a = ctx->p[edge];
+	const vec2 b = ctx->p[(edge + 1) % ctx->n];
+
+	if (edge == v || (edge + 1) % ctx->n == v)
+	{
+		return pv.x;
+	}
+
+	if (a.y == b.y)
+	{
+		return a.x;
+	}
+
+	return a.x + (pv.y - a.y) * (b.x - a.x) / (b.y - a.y);
+}
+
+// number of status edges strictly left of vertex v
+static uint monotone_status_rank(const monotone_context_t* ctx, uint v)
+{
+	const float x = ctx->p[v].x;
+
+	uint lo = 0;
+	uint hi = ctx->statusCount;
+	while (lo < hi)
+	{
+		const uint mid = (lo + hi) / 2;
+		if (monotone_edge_x(ctx, ctx->status[mid], v) < x)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+// edge starts at vertex edge, so it is inserted where that vertex sits on the sweep line
+static void monotone_status_insert(monotone_context_t* ctx, uint edge, uint helper)
+{
+	const uint pos = monotone_status_rank(ctx, edge);
+	memmove(&ctx->status[pos + 1], &ctx->status[pos], (ctx->statusCount - pos) * sizeof(uint));
+	ctx->status[pos] = edge;
+	++ctx->statusCount;
+
+	ctx->inStatus[edge] = true;
+	ctx->helper[edge] = helper;
+}
+
+// edges are removed at their lower vertex v
+static void monotone_status_remove(monotone_context_t* ctx, uint edge, uint v)
+{
+	uint pos = monotone_status_rank(ctx, v);
+	if (pos >= ctx->statusCount || ctx->status[pos] != edge)
+	{
+		// rounding put the edge somewhere else; fall back to a scan
+		for (pos = 0; pos < ctx->statusCount && ctx->status[pos] != edge; ++pos);
+		if (pos == ctx->statusCount)
+		{
+			return;
+		}
+	}
+
+	--ctx->statusCount;
+	memmove(&ctx->status[pos], &ctx->status[pos + 1], (ctx->statusCount - pos) * sizeof(uint));
+	ctx->inStatus[edge] = false;
+}
+
+// the status edge directly left of vertex v
+static int monotone_status_find_left(const monotone_context_t* ctx, uint v)
+{
+	const uint rank = monotone_status_rank(ctx, v);
+	return rank > 0 ? (int)ctx->status[rank - 1] : -1;
+}
+
+static void monotone_fix_up(monotone_context_t* ctx, uint v, uint edge)
+{
+	if (ctx->type[ctx->helper[edge]] == MONOTONE_VERTEX_MERGE)
+	{
+		monotone_add_diagonal(ctx, v, ctx->helper[edge]);
+	}
+}
+
+static void monotone_make_monotone(monotone_context_t* ctx)
+{
+	const uint n = ctx->n;
+
+	for (uint v = 0; v < n; ++v)
+	{
+		const uint prev = (v + n - 1) % n;
+		const uint next = (v + 1) % n;
+
+		const bool prevBelow = is_above(ctx, v, prev);
+		const bool nextBelow = is_above(ctx, v, next);
+		const bool isConvex = orient(ctx->p[prev], ctx->p[v], ctx->p[next]) > 0.0f;
+
+		if (prevBelow && nextBelow)			ctx->type[v] = isConvex ? MONOTONE_VERTEX_START : MONOTONE_VERTEX_SPLIT;
+		else if (!prevBelow && !nextBelow)	ctx->type[v] = isConvex ? MONOTONE_VERTEX_END : MONOTONE_VERTEX_MERGE;
+		else								ctx->type[v] = MONOTONE_VERTEX_REGULAR;
+
+		ctx->inStatus[v] = false;
+		ctx->sorted[v] = v;
+	}
+
+	sort_by_sweep_order(ctx, ctx->sorted, ctx->tmp, n);
+
+	// edge e runs from vertex e to vertex e + 1
+	for (uint i = 0; i < n; ++i)
+	{
+		const uint v = ctx->sorted[i];
+		const uint prevEdge = (v + n - 1) % n;
+
+		switch (ctx->type[v])
+		{
+			case MONOTONE_VERTEX_START:
+			{
+				monotone_status_insert(ctx, v, v);
+				break;
+			}
+
+			case MONOTONE_VERTEX_END:
+			{
+				if (ctx->inStatus[prevEdge])
+				{
+					monotone_fix_up(ctx, v, prevEdge);
+					monotone_status_remove(ctx, prevEdge, v);
+				}
+				break;
+			}
+
+			case MONOTONE_VERTEX_SPLIT:
+			{
+				const int left = monotone_status_find_left(ctx, v);
+				if (left >= 0)
+				{
+					monotone_add_diagonal(ctx, v, ctx->helper[left]);
+					ctx->helper[left] = v;
+				}
+				monotone_status_insert(ctx, v, v);
+				break;
+			}
+
+			case MONOTONE_VERTEX_MERGE:
+			{
+				if (ctx->inStatus[prevEdge])
+				{
+					monotone_fix_up(ctx, v, prevEdge);
+					monotone_status_remove(ctx, prevEdge, v);
+				}
+
+				const int left = monotone_status_find_left(ctx, v);
+				if (left >= 0)
+				{
+					monotone_fix_up(ctx, v, left);
+					ctx->helper[left] = v;
+				}
+				break;
+			}
+
+			case MONOTONE_VERTEX_REGULAR:
+			{
+				// the interior lies to the right when the boundary runs downwards through v
+				if (is_above(ctx, prevEdge, v))
+				{
+					if (ctx->inStatus[prevEdge])
+					{
+						monotone_fix_up(ctx, v, prevEdge);
+						monotone_status_remove(ctx, prevEdge, v);
+					}
+					monotone_status_insert(ctx, v, v);
+				}
+				else
+				{
+					const int left = monotone_status_find_left(ctx, v);
+					if (left >= 0)
+					{
+						monotone_fix_up(ctx, v, left);
+						ctx->helper[left] = v;
+					}
+				}
+				break;
+			}
+		}
+	}
+}
+
+static void monotone_emit(monotone_context_t* ctx, uint a, uint b, uint c)
+{
+	// self-intersecting input can produce faces that overlap; never write past n - 2 triangles
+	if (*ctx->triangleCount >= ctx->n - 2)
+	{
+		return;
+	}
+
+	emit_triangle(ctx->triangles, ctx->triangleCount, ctx->positions, ctx->index[a], ctx->index[b], ctx->index[c]);
+}
+
+// face holds counter-clockwise vertices of a y-monotone polygon
+static void monotone_triangulate_face(monotone_context_t* ctx, const uint* face, uint m)
+{
+	if (m < 3)
+	{
+		return;
+	}
+
+	if (m == 3)
+	{
+		monotone_emit(ctx, face[0], face[1], face[2]);
+		return;
+	}
+
+	uint top = 0;
+	uint bottom = 0;
+	for (uint i = 1; i < m; ++i)
+	{
+		if (is_above(ctx, face[i], face[top])) top = i;
+		if (is_above(ctx, face[bottom], face[i])) bottom = i;
+	}
+
+	// merge the two chains into sweep order; walking forward from the top follows the left chain
+	uint* u = ctx->sorted;
+	uint8_t* chain = ctx->chain;
+	uint count = 0;
+
+	u[count] = face[top];
+	chain[count++] = MONOTONE_CHAIN_LEFT;
+
+	uint l = (top + 1) % m;
+	uint r = (top + m - 1) % m;
+	while (l != bottom || r != bottom)
+	{
+		if (r == bottom || (l != bottom && is_above(ctx, face[l], face[r])))
+		{
+			u[count] = face[l];
+			chain[count++] = MONOTONE_CHAIN_LEFT;
+			l = (l + 1) % m;
+		}
+		else
+		{
+			u[count] = face[r];
+			chain[count++] = MONOTONE_CHAIN_RIGHT;
+			r = (r + m - 1) % m;
+		}
+	}
+
+	u[count] = face[bottom];
+	chain[count++] = MONOTONE_CHAIN_LEFT;
+	assert(count == m);
+
+	uint* stack = ctx->stack;
+	uint stackSize = 0;
+	stack[stackSize++] = 0;
+	stack[stackSize++] = 1;
+
+	for (uint j = 2; j < m - 1; ++j)
+	{
+		if (chain[j] != chain[stack[stackSize - 1]])
+		{
+			for (uint k = 0; k + 1 < stackSize; ++k)
+			{
+				monotone_emit(ctx, u[j], u[stack[k]], u[stack[k + 1]]);
+			}
+
+			stackSize = 0;
+			stack[stackSize++] = j - 1;
+			stack[stackSize++] = j;
+		}
+		else
+		{
+			uint last = stack[--stackSize];
+
+			while (stackSize > 0)
+			{
+				const uint top = stack[stackSize - 1];
+				const float o = chain[j] == MONOTONE_CHAIN_LEFT
+					? orient(ctx->p[u[top]], ctx->p[u[last]], ctx->p[u[j]])
+					: orient(ctx->p[u[j]], ctx->p[u[last]], ctx->p[u[top]]);
+
+				if (o <= 0.0f)
+				{
+					break;
+				}
+
+				monotone_emit(ctx, u[j], u[last], u[top]);
+				last = stack[--stackSize];
+			}
+
+			stack[stackSize++] = last;
+			stack[stackSize++] = j;
+		}
+	}
+
+	for (uint k = 0; k + 1 < stackSize; ++k)
+	{
+		monotone_emit(ctx, u[m - 1], u[stack[k]], u[stack[k + 1]]);
+	}
+}
+
+// One zero-area triangle for every vertex that repeated the one before it and was left out of the sweep, between
+// the kept vertices either side, so there are still vertexCount - 2 triangles like ear clipping gives.
+static void monotone_emit_dropped(monotone_context_t* ctx, uint vertexCount, bool isClockwise)
+{
+	const uint step = isClockwise ? vertexCount - 1 : 1;
+	for (uint k = 0; k < ctx->n; ++k)
+	{
+		const uint a = ctx->index[k];
+		const uint b = ctx->index[(k + 1) % ctx->n];
+		for (uint v = (a + step) % vertexCount; v != b; v = (v + step) % vertexCount)
+		{
+			emit_triangle(ctx->triangles, ctx->triangleCount, ctx->positions, a, v, b);
+		}
+	}
+}
+
+// clockwise angle in (0, 2pi] from direction a to direction b
+static float clockwise_angle(vec2 a, vec2 b)
+{
+	const float cross = a.x * b.y - a.y * b.x;
+	const float dot = a.x * b.x + a.y * b.y;
+
+	float angle = atan2f(-cross, dot);
+	if (angle <= 0.0f)
+	{
+		angle += 6.28318530718f;
+	}
+	return angle;
+}
+
+void polygon_triangulate_monotone(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint n)
+{
+	*triangleCount = 0;
+
+	if (n < 3)
+	{
+		return;
+	}
+
+	const bool isClockwise = polygon_signed_area(positions, n) < 0.0f;
+
+	// the sweep adds at most two diagonals per vertex
+	const uint maxDiagonals = 2 * n;
+	const uint maxHalfEdges = n + 2 * maxDiagonals;
+
+	const size_t memSize =
+		n * sizeof(uint) +					// index
+		n * sizeof(vec2) +					// p
+		n * sizeof(uint8_t) +				// type
+		n * sizeof(uint) +					// helper
+		n * sizeof(uint) +					// status
+		n * sizeof(uint8_t) +				// inStatus
+		2 * maxDiagonals * sizeof(uint) +	// diagA, diagB
+		n * sizeof(uint) +					// sorted
+		n * sizeof(uint) +					// tmp
+		n * sizeof(uint8_t) +				// chain
+		n * sizeof(uint) +					// stack
+		(n + 1) * sizeof(uint) +			// adjacencyStart
+		2 * maxDiagonals * sizeof(uint) +	// adjacency
+		maxHalfEdges * sizeof(bool) +		// visited
+		n * sizeof(uint) +					// face
+		16 * 8;
+
+	uint8_t* mem = malloc(memSize);
+	assert(mem != NULL);
+	uint8_t* cursor = mem;
+
+	// repeated vertices make zero-length edges the sweep can't classify, so they are left out of it and
+	// given degenerate triangles afterwards, see monotone_emit_dropped
+	uint* index = carve(&cursor, n * sizeof(uint));
+	uint m = 0;
+	for (uint i = 0; i < n; ++i)
+	{
+		const uint v = isClockwise ? n - 1 - i : i;
+		if (m == 0 || !vec2_equal(positions[v], positions[index[m - 1]]))
+		{
+			index[m++] = v;
+		}
+	}
+	while (m > 1 && vec2_equal(positions[index[m - 1]], positions[index[0]]))
+	{
+		--m;
+	}
+
+	if (m < 3)
+	{
+		free(mem);
+		polygon_triangulate_ear_clipping(triangles, triangleCount, positions, n);
+		return;
+	}
+
+	monotone_context_t ctx = {
+		.n				= m,
+		.positions		= positions,
+		.index			= index,
+		.p				= carve(&cursor, n * sizeof(vec2)),
+		.type			= carve(&cursor, n * sizeof(uint8_t)),
+		.helper			= carve(&cursor, n * sizeof(uint)),
+		.status			= carve(&cursor, n * sizeof(uint)),
+		.inStatus		= carve(&cursor, n * sizeof(uint8_t)),
+		.diagA			= carve(&cursor, maxDiagonals * sizeof(uint)),
+		.diagB			= carve(&cursor, maxDiagonals * sizeof(uint)),
+		.sorted			= carve(&cursor, n * sizeof(uint)),
+		.tmp			= carve(&cursor, n * sizeof(uint)),
+		.chain			= carve(&cursor, n * sizeof(uint8_t)),
+		.stack			= carve(&cursor, n * sizeof(uint)),
+		.triangles		= triangles,
+		.triangleCount	= triangleCount,
+	};
+
+	uint* adjacencyStart	= carve(&cursor, (n + 1) * sizeof(uint));
+	uint* adjacency			= carve(&cursor, 2 * maxDiagonals * sizeof(uint));
+	bool* visited			= carve(&cursor, maxHalfEdges * sizeof(bool));
+	uint* face				= carve(&cursor, n * sizeof(uint));
+
+	for (uint i = 0; i < m; ++i)
+	{
+		ctx.p[i] = positions[index[i]];
+	}
+
+	monotone_make_monotone(&ctx);
+
+	if (ctx.diagCount == 0)
+	{
+		for (uint i = 0; i < m; ++i)
+		{
+			face[i] = i;
+		}
+		monotone_triangulate_face(&ctx, face, m);
+		monotone_emit_dropped(&ctx, n, isClockwise);
+		free(mem);
+		return;
+	}
+
+	// half-edge v -> v + 1 is v, diagonal d is m + 2d (a -> b) and m + 2d + 1 (b -> a)
+	for (uint i = 0; i <= m; ++i)
+	{
+		adjacencyStart[i] = 0;
+	}
+	for (uint d = 0; d < ctx.diagCount; ++d)
+	{
+		++adjacencyStart[ctx.diagA[d] + 1];
+		++adjacencyStart[ctx.diagB[d] + 1];
+	}
+	for (uint i = 0; i < m; ++i)
+	{
+		adjacencyStart[i + 1] += adjacencyStart[i];
+	}
+	for (uint d = 0; d < ctx.diagCount; ++d)
+	{
+		adjacency[adjacencyStart[ctx.diagA[d]]++] = m + 2 * d;
+		adjacency[adjacencyStart[ctx.diagB[d]]++] = m + 2 * d + 1;
+	}
+	for (uint i = m; i > 0; --i)
+	{
+		adjacencyStart[i] = adjacencyStart[i - 1];
+	}
+	adjacencyStart[0] = 0;
+
+	const uint halfEdgeCount = m + 2 * ctx.diagCount;
+	for (uint h = 0; h < halfEdgeCount; ++h)
+	{
+		visited[h] = false;
+	}
+
+	for (uint start = 0; start < halfEdgeCount; ++start)
+	{
+		if (visited[start])
+		{
+			continue;
+		}
+
+		// walk the face to the left of this half-edge, at every vertex taking the first outgoing
+		// half-edge clockwise from the one we arrived on
+		uint faceSize = 0;
+		uint h = start;
+
+		do
+		{
+			visited[h] = true;
+
+			uint from, to;
+			if (h < m)
+			{
+				from	= h;
+				to		= (h + 1) % m;
+			}
+			else
+			{
+				const uint d = (h - m) / 2;
+				const bool reversed = (h - m) & 1;
+				from	= reversed ? ctx.diagB[d] : ctx.diagA[d];
+				to		= reversed ? ctx.diagA[d] : ctx.diagB[d];
+			}
+
+			if (faceSize == m)
+			{
+				break;
+			}
+			face[faceSize++] = from;
+
+			uint nextHalfEdge = to;
+			if (adjacencyStart[to] != adjacencyStart[to + 1])
+			{
+				const vec2 origin = ctx.p[to];
+				const vec2 back = { ctx.p[from].x - origin.x, ctx.p[from].y - origin.y };
+
+				const vec2 boundaryDir = { ctx.p[(to + 1) % m].x - origin.x, ctx.p[(to + 1) % m].y - origin.y };
+				float bestAngle = clockwise_angle(back, boundaryDir);
+
+				for (uint k = adjacencyStart[to]; k < adjacencyStart[to + 1]; ++k)
+				{
+					const uint candidate = adjacency[k];
+					const uint d = (candidate - m) / 2;
+					const uint target = ((candidate - m) & 1) ? ctx.diagA[d] : ctx.diagB[d];
+					const vec2 dir = { ctx.p[target].x - origin.x, ctx.p[target].y - origin.y };
+
+					const float angle = clockwise_angle(back, dir);
+					if (angle < bestAngle)
+					{
+						bestAngle		= angle;
+						nextHalfEdge	= candidate;
+					}
+				}
+			}
+
+			h = nextHalfEdge;
+		}
+		while (h != start && !visited[h]);
+
+		monotone_triangulate_face(&ctx, face, faceSize);
+	}
+
+	monotone_emit_dropped(&ctx, n, isClockwise);
+	free(mem);
+}
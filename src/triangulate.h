@@ -0,0 +1,24 @@
+#pragma once
+
+#include "types.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct triangle
+{
+	uint32_t i[3];
+} triangle_t;
+
+// Polygons with more vertices than this are split into y-monotone pieces before triangulating.
+#define TRIANGULATE_MONOTONE_THRESHOLD 128
+
+// Triangulates a simple polygon. Either winding is accepted; triangles are emitted clockwise.
+// triangles must have room for vertexCount - 2 entries.
+void polygon_triangulate(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount);
+
+// Ear clipping over a linked list of vertices. O(n * r), where r is the number of reflex vertices.
+void polygon_triangulate_ear_clipping(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount);
+
+// Sweep-line decomposition into y-monotone pieces, each triangulated in linear time.
+void polygon_triangulate_monotone(triangle_t* triangles, size_t* triangleCount, const vec2* positions, uint vertexCount);
@@ -16,4 +16,15 @@ float clampf(float min, float value, float max)
 	if (value < min) value = min;
 	if (value > max) value = max;
 	return value;
-}
\ No newline at end of file
+}
+
+uint64_t fnv1a64(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* bytes = data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
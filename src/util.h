@@ -1,9 +1,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #define countof(Array) (sizeof(Array) / sizeof(Array[0]))
 
 uint32_t max(uint32_t a, uint32_t b);
 uint32_t alignUp(uint32_t value, uint32_t alignment);
-float clampf(float min, float value, float max);
\ No newline at end of file
+float clampf(float min, float value, float max);
+
+#define FNV1A64_OFFSET_BASIS 0xcbf29ce484222325ull
+
+// FNV-1a over size bytes, continuing from hash. Start a new hash with FNV1A64_OFFSET_BASIS.
+uint64_t fnv1a64(const void* data, size_t size, uint64_t hash);
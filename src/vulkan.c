@@ -305,7 +305,7 @@ static VkPhysicalDevice selectPhysicalDevice(
 	}
 	assert(deviceCount <= countof(devices));
 
-	VkPhysicalDevice selectedDevice;
+	VkPhysicalDevice selectedDevice = VK_NULL_HANDLE;
 	uint32_t selectedScore = 0u;
 
 	for (uint32_t deviceIndex = 0u; deviceIndex < deviceCount; ++deviceIndex)
@@ -345,8 +345,12 @@ static VkPhysicalDevice selectPhysicalDevice(
 		assert(queueFamilyCount <= countof(queueFamilies));
 
 		VkSurfaceFormatKHR surfaceFormats[64];
-		uint32_t surfaceFormatCount = countof(surfaceFormats);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surfaceFormatCount, surfaceFormats);
+		uint32_t surfaceFormatCount = 0;
+		if (surface != VK_NULL_HANDLE)
+		{
+			surfaceFormatCount = countof(surfaceFormats);
+			vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &surfaceFormatCount, surfaceFormats);
+		}
 
 		printf("Supported surface formats:\n");
 		for (uint32_t i = 0; i < surfaceFormatCount; ++i)
@@ -370,15 +374,19 @@ static VkPhysicalDevice selectPhysicalDevice(
 			}
 		}
 	
-		if (bestSurfaceFormatIndex == surfaceFormatCount) {
-			fprintf(stderr, "Device has no suitable surface format\n");
-			continue;
-		}
-		
-		char* nvidia = strstr(properties.deviceName, "NVIDIA");
-		if (nvidia == NULL)
+		// headless contexts take any device, software rasterizers such as lavapipe included
+		if (surface != VK_NULL_HANDLE)
 		{
-			continue;
+			if (bestSurfaceFormatIndex == surfaceFormatCount) {
+				fprintf(stderr, "Device has no suitable surface format\n");
+				continue;
+			}
+			
+			char* nvidia = strstr(properties.deviceName, "NVIDIA");
+			if (nvidia == NULL)
+			{
+				continue;
+			}
 		}
 
 		uint32_t selectedQueue = UINT32_MAX;
@@ -397,7 +405,8 @@ static VkPhysicalDevice selectPhysicalDevice(
 			continue;
 		}
 
-		uint32_t score = 0u;
+		// anything that got this far is usable, so it has to beat the initial score of zero
+		uint32_t score = 1u;
 		
 		if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
 		{
@@ -409,7 +418,7 @@ static VkPhysicalDevice selectPhysicalDevice(
 			selectedDevice		= device;
 			selectedScore		= score;
 			*mainQueueFamily	= selectedQueue;
-			*bestSurfaceFormat	= surfaceFormats[bestSurfaceFormatIndex];
+			*bestSurfaceFormat	= surface != VK_NULL_HANDLE ? surfaceFormats[bestSurfaceFormatIndex] : (VkSurfaceFormatKHR){0};
 		}
 	}
 	
@@ -493,7 +502,7 @@ int CreateVulkanContext(vulkan_t* vulkan, VkInstance instance, VkSurfaceKHR surf
 		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 		.pNext = &features2,
 		.ppEnabledExtensionNames = deviceExtensions,
-		.enabledExtensionCount = countof(deviceExtensions),
+		.enabledExtensionCount = surface != VK_NULL_HANDLE ? countof(deviceExtensions) : 0,
 		.pQueueCreateInfos = queueInfos,
 		.queueCreateInfoCount = countof(queueInfos),
 	};
@@ -37,6 +37,7 @@ typedef struct vulkan
 	PFN_vkSetDebugUtilsObjectNameEXT	vkSetDebugUtilsObjectNameEXT;
 } vulkan_t;
 
+// surface may be VK_NULL_HANDLE for a headless context that can't present, e.g. to run tests on lavapipe.
 int CreateVulkanContext(vulkan_t* vulkan, VkInstance instance, VkSurfaceKHR surface);
 void DestroyVulkanContext(vulkan_t* vulkan);
 const char* VkResultString(VkResult result);
@@ -2,16 +2,25 @@
 #include "types.h"
 #include "vec.h"
 #include "common.h"
+#include "util.h"
 #include "debug_renderer.h"
+#include "wind_solver.h"
 #include "../shaders/gpu_types.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <assert.h>
 
-#define WIND_GRID_CELL_COUNT	(WIND_GRID_RESOLUTION*WIND_GRID_RESOLUTION)
-#define WIND_GRID_BUFFER_SIZE	(WIND_GRID_CELL_COUNT*sizeof(vec2))
+// A step of the solver costs the same every tick, see wind_solver.h, and is budgeted 0.25 ms of a tick on one
+// thread at the default resolution. At this viscosity diffusion has converged after a couple of iterations. The
+// pressure iterations are what's left of the budget, and each halving of them about doubles how far the wind
+// strays from a fully converged solve.
+#define WIND_DIFFUSION_ITERATIONS	(2)
+#define WIND_PRESSURE_ITERATIONS	(16)
+#define WIND_VISCOSITY				(0.05f)
+#define WIND_DAMPING				(0.92f)
 
 typedef struct wind_frame
 {
@@ -22,7 +31,13 @@ typedef struct wind_frame
 typedef struct wind
 {
 	vulkan_t*		vk;
-	vec2			gridVel[WIND_GRID_CELL_COUNT];
+	uint			resolution;
+	size_t			gridBufferSize;
+	vec2*			gridVel;
+	wind_solver_t*	solver;
+	bool			isAtRest; // gridVel is all zero and the solver can be skipped
+	uint8_t*		dirtyRows; // rows changed since the last upload, one byte each
+	VkBufferCopy*	copyRegions;
 	//vec2			gridOrigin;
 	int2			gridOrigin;
 	VkBuffer		gridBuffer;
@@ -30,22 +45,61 @@ typedef struct wind
 	wind_frame_t	frames[FRAME_COUNT];
 } wind_t;
 
-wind_t* wind_create(vulkan_t* vulkan)
+wind_t* wind_create(vulkan_t* vulkan, job_pool_t* jobPool, uint resolution)
 {
+	assert(resolution >= 2 && (resolution & (resolution - 1)) == 0);
+
 	wind_t* wind = calloc(1, sizeof(wind_t));
 	if (wind == NULL)
 	{
 		return NULL;
 	}
 
-	wind->vk = vulkan;
+	wind->vk				= vulkan;
+	wind->resolution		= resolution;
+	wind->gridBufferSize	= (size_t)resolution * resolution * sizeof(vec2);
+
+	const wind_solver_desc_t solverDesc = {
+		.resolution				= resolution,
+		.diffusionIterations	= WIND_DIFFUSION_ITERATIONS,
+		.pressureIterations		= WIND_PRESSURE_ITERATIONS,
+		.viscosity				= WIND_VISCOSITY,
+		.damping				= WIND_DAMPING,
+	};
+	wind->gridVel = aligned_alloc(16, wind->gridBufferSize);
+	wind->solver = wind_solver_create(&solverDesc, jobPool);
+	wind->dirtyRows = malloc(resolution);
+	// dirty spans are separated by clean rows, so there are at most half as many as rows, rounded up
+	wind->copyRegions = malloc((resolution / 2 + 1) * sizeof(VkBufferCopy));
+	if (wind->gridVel == NULL || wind->solver == NULL || wind->dirtyRows == NULL || wind->copyRegions == NULL)
+	{
+		if (wind->solver != NULL)
+		{
+			wind_solver_destroy(wind->solver);
+		}
+		free(wind->gridVel);
+		free(wind->dirtyRows);
+		free(wind->copyRegions);
+		free(wind);
+		return NULL;
+	}
+	memset(wind->gridVel, 0, wind->gridBufferSize);
+	wind->isAtRest = true;
+
+	// the device buffer starts out undefined, so the first upload has to write all of it
+	memset(wind->dirtyRows, 1, resolution);
 
 	//wind->gridOrigin = (vec2){-5.0f, -5.0f};
+
+	if (vulkan == NULL)
+	{
+		return wind;
+	}
 	
 	wind->gridBuffer = CreateBuffer(
 		&wind->gridBufferMemory, 
 		vulkan,
-		WIND_GRID_BUFFER_SIZE,
+		wind->gridBufferSize,
 		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
@@ -56,14 +110,21 @@ void wind_destroy(wind_t* wind)
 {
 	vulkan_t* vk = wind->vk;
 
-	vkDestroyBuffer(vk->device, wind->gridBuffer, NULL);
-	vkFreeMemory(vk->device, wind->gridBufferMemory, NULL);
-
-	for (int i = 0; i < FRAME_COUNT; ++i)
+	if (vk != NULL)
 	{
-		vkDestroyBuffer(vk->device, wind->frames[i].stagingBuffer, NULL);
+		vkDestroyBuffer(vk->device, wind->gridBuffer, NULL);
+		vkFreeMemory(vk->device, wind->gridBufferMemory, NULL);
+
+		for (int i = 0; i < FRAME_COUNT; ++i)
+		{
+			vkDestroyBuffer(vk->device, wind->frames[i].stagingBuffer, NULL);
+		}
 	}
 
+	wind_solver_destroy(wind->solver);
+	free(wind->gridVel);
+	free(wind->dirtyRows);
+	free(wind->copyRegions);
 	free(wind);
 }
 
@@ -77,7 +138,7 @@ int wind_alloc_staging_mem(staging_memory_allocator_t* allocator, wind_t* wind)
 			allocator, 
 			&frame->stagingBuffer,
 			(void**)&frame->stagingMemory,
-			WIND_GRID_BUFFER_SIZE,
+			wind->gridBufferSize,
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			"Wind Staging");
 	}
@@ -87,43 +148,43 @@ int wind_alloc_staging_mem(staging_memory_allocator_t* allocator, wind_t* wind)
 
 void wind_tick(wind_t* wind)
 {
-	for (int i = 0; i < WIND_GRID_CELL_COUNT; ++i)
+	if (wind->isAtRest)
 	{
-		vec2 vel = wind->gridVel[i];
-		vel = vec2_scale(vel, 0.85f);
-		wind->gridVel[i] = vel;
+		return;
 	}
+
+	wind->isAtRest = !wind_solver_step(wind->solver, wind->gridVel, wind->dirtyRows);
 }
 
 void wind_update(VkCommandBuffer cb, wind_t* wind, const render_context_t* rc)
 {
 #if 0
-	for (int x = 0; x < WIND_GRID_RESOLUTION + 1; ++x)
+	for (int x = 0; x < wind->resolution + 1; ++x)
 	{
-		const int ox = x + wind->gridOrigin.x - (WIND_GRID_RESOLUTION/2);
+		const int ox = x + wind->gridOrigin.x - (wind->resolution/2);
 		DrawDebugLine(
-			(debug_vertex_t){.x = ox*WIND_GRID_CELL_SIZE, .y = (wind->gridOrigin.y - (WIND_GRID_RESOLUTION/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080},
-			(debug_vertex_t){.x = ox*WIND_GRID_CELL_SIZE, .y = (wind->gridOrigin.y + (WIND_GRID_RESOLUTION/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080}
+			(debug_vertex_t){.x = ox*WIND_GRID_CELL_SIZE, .y = (wind->gridOrigin.y - (wind->resolution/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080},
+			(debug_vertex_t){.x = ox*WIND_GRID_CELL_SIZE, .y = (wind->gridOrigin.y + (wind->resolution/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080}
 		);
 	}
-	for (int y = 0; y < WIND_GRID_RESOLUTION + 1; ++y)
+	for (int y = 0; y < wind->resolution + 1; ++y)
 	{
-		const int oy = y + wind->gridOrigin.y - (WIND_GRID_RESOLUTION/2);
+		const int oy = y + wind->gridOrigin.y - (wind->resolution/2);
 		DrawDebugLine(
-			(debug_vertex_t){.y = oy*WIND_GRID_CELL_SIZE, .x = (wind->gridOrigin.x - (WIND_GRID_RESOLUTION/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080},
-			(debug_vertex_t){.y = oy*WIND_GRID_CELL_SIZE, .x = (wind->gridOrigin.x + (WIND_GRID_RESOLUTION/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080}
+			(debug_vertex_t){.y = oy*WIND_GRID_CELL_SIZE, .x = (wind->gridOrigin.x - (wind->resolution/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080},
+			(debug_vertex_t){.y = oy*WIND_GRID_CELL_SIZE, .x = (wind->gridOrigin.x + (wind->resolution/2)) * WIND_GRID_CELL_SIZE, .color = 0xff808080}
 		);
 	}
 #endif
 #if 0
-	for (int y = 0; y < WIND_GRID_RESOLUTION; ++y)
+	for (int y = 0; y < wind->resolution; ++y)
 	{
-		for (int x = 0; x < WIND_GRID_RESOLUTION; ++x)
+		for (int x = 0; x < wind->resolution; ++x)
 		{
-			const int dx = (x - WIND_GRID_RESOLUTION/2) + wind->gridOrigin.x;
-			const int dy = (y - WIND_GRID_RESOLUTION/2) + wind->gridOrigin.y;
+			const int dx = (x - wind->resolution/2) + wind->gridOrigin.x;
+			const int dy = (y - wind->resolution/2) + wind->gridOrigin.y;
 			
-			const int i = (((uint)dx) % WIND_GRID_RESOLUTION) + (((uint)dy) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
+			const int i = (((uint)dx) % wind->resolution) + (((uint)dy) % wind->resolution) * wind->resolution;
 			const vec2 vel = vec2_scale(wind->gridVel[i], 2.0f);
 			
 			const vec2 center = {
@@ -139,46 +200,70 @@ void wind_update(VkCommandBuffer cb, wind_t* wind, const render_context_t* rc)
 	}
 #endif
 
+	// rows are contiguous, so every run of dirty rows is one copy
+	const size_t rowSize = wind->resolution * sizeof(vec2);
+	uint regionCount = 0;
+	for (uint y = 0; y < wind->resolution; ++y)
+	{
+		if (!wind->dirtyRows[y])
+		{
+			continue;
+		}
+
+		const uint first = y;
+		while (y < wind->resolution && wind->dirtyRows[y])
+		{
+			wind->dirtyRows[y++] = 0;
+		}
+
+		wind->copyRegions[regionCount++] = (VkBufferCopy){
+			.srcOffset	= first * rowSize,
+			.dstOffset	= first * rowSize,
+			.size		= (y - first) * rowSize,
+		};
+	}
+
+	// nothing changed since the last upload, which is every frame once the wind has died down
+	if (regionCount == 0)
+	{
+		return;
+	}
+
 	wind_frame_t* frame = &wind->frames[rc->frameIndex];
-	memcpy(frame->stagingMemory, wind->gridVel, WIND_GRID_BUFFER_SIZE);
-	PushStagingMemoryFlush(rc->stagingMemory, frame->stagingMemory, WIND_GRID_BUFFER_SIZE);
-	
-	const VkBufferCopy copyRegion = {
-		.size = WIND_GRID_BUFFER_SIZE,
-	};
-	vkCmdCopyBuffer(cb, frame->stagingBuffer, wind->gridBuffer, 1, &copyRegion);
+	for (uint i = 0; i < regionCount; ++i)
+	{
+		const VkBufferCopy* region = &wind->copyRegions[i];
+		memcpy((char*)frame->stagingMemory + region->srcOffset, (const char*)wind->gridVel + region->srcOffset, region->size);
+	}
+
+	// one flush over all the spans, since the context only has room for so many ranges. The start is rounded
+	// down to the flush alignment PushStagingMemoryFlush rounds the size up to.
+	const VkBufferCopy* firstRegion = &wind->copyRegions[0];
+	const VkBufferCopy* lastRegion = &wind->copyRegions[regionCount - 1];
+	const size_t flushBegin = firstRegion->srcOffset & ~(size_t)0x3f;
+	const size_t flushEnd = lastRegion->srcOffset + lastRegion->size;
+	PushStagingMemoryFlush(rc->stagingMemory, (char*)frame->stagingMemory + flushBegin, flushEnd - flushBegin);
+
+	vkCmdCopyBuffer(cb, frame->stagingBuffer, wind->gridBuffer, regionCount, wind->copyRegions);
 }
 
 void wind_inject(wind_t* wind, wind_injection_t injection)
 {
-	if (injection.vel.x == 0.0f && 
-		injection.vel.y == 0.0f)
-	{
-		return;
-	}
+	wind_inject_many(wind, &injection, 1);
+}
 
-	int x_min = (int)(floorf((injection.aabbMin.x) / WIND_GRID_CELL_SIZE));
-	int y_min = (int)(floorf((injection.aabbMin.y) / WIND_GRID_CELL_SIZE));
-	int x_max = (int)(ceilf((injection.aabbMax.x) / WIND_GRID_CELL_SIZE));
-	int y_max = (int)(ceilf((injection.aabbMax.y) / WIND_GRID_CELL_SIZE));
-	
-	for (int y = y_min; y < y_max; ++y)
+void wind_inject_many(wind_t* wind, const wind_injection_t* injections, uint count)
+{
+	for (uint i = 0; i < count; ++i)
 	{
-		for (int x = x_min; x < x_max; ++x)
+		const wind_injection_t* injection = &injections[i];
+		if (injection->vel.x == 0.0f && injection->vel.y == 0.0f)
 		{
-			const uint wrapX = ((uint)x) % WIND_GRID_RESOLUTION;
-			const uint wrapY = ((uint)y) % WIND_GRID_RESOLUTION;
-
-			const uint i = wrapX + wrapY * WIND_GRID_RESOLUTION;
-
-			vec2 vel = wind->gridVel[i];
-			vel = vec2_add(vel, vec2_scale(injection.vel, 1.5f));
-			if (vec2_length(vel) > 1.0f)
-			{
-				vel = vec2_normalize(vel);
-			}
-			wind->gridVel[i] = vel;
+			continue;
 		}
+
+		wind_grid_inject(wind->gridVel, wind->resolution, injection, wind->dirtyRows);
+		wind->isAtRest = false;
 	}
 }
 
@@ -190,38 +275,24 @@ void wind_set_focus(wind_t* wind, vec2 pos)
 
 vec2 wind_sample(const wind_t* wind, vec2 pos)
 {
-	const vec2 floatGridPos = vec2_scale(pos, 1.0f / WIND_GRID_CELL_SIZE);
-#if 1
-	const vec2 bilinearFactors = vec2_frac(floatGridPos);
-	const int dx = (int)floorf(floatGridPos.x - 0.5f);
-	const int dy = (int)floorf(floatGridPos.y - 0.5f);
-	
-	const int i00 = (((uint)(dx+0)) % WIND_GRID_RESOLUTION) + (((uint)(dy+0)) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
-	const int i10 = (((uint)(dx+1)) % WIND_GRID_RESOLUTION) + (((uint)(dy+0)) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
-	const int i01 = (((uint)(dx+0)) % WIND_GRID_RESOLUTION) + (((uint)(dy+1)) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
-	const int i11 = (((uint)(dx+1)) % WIND_GRID_RESOLUTION) + (((uint)(dy+1)) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
-
-	const vec2 v00 = wind->gridVel[i00];
-	const vec2 v10 = wind->gridVel[i10];
-	const vec2 v01 = wind->gridVel[i01];
-	const vec2 v11 = wind->gridVel[i11];
-	
-	const vec2 x0 = vec2_lerp(v00, v10, bilinearFactors.x);
-	const vec2 x1 = vec2_lerp(v01, v11, bilinearFactors.x);
-	
-	return vec2_lerp(x0, x1, bilinearFactors.y);
-#else
-	const int dx = (int)floorf(floatGridPos.x);
-	const int dy = (int)floorf(floatGridPos.y);
-	
-	const int i = (((uint)dx) % WIND_GRID_RESOLUTION) + (((uint)dy) % WIND_GRID_RESOLUTION) * WIND_GRID_RESOLUTION;
-
-	const vec2 vel = wind->gridVel[i];
+	vec2 vel;
+	wind_grid_sample(wind->gridVel, wind->resolution, &pos.x, &pos.y, &vel.x, &vel.y, 1);
 	return vel;
-#endif
+}
+
+void wind_sample_many(const wind_t* wind, const float* xs, const float* ys, float* outX, float* outY, size_t n)
+{
+	wind_grid_sample(wind->gridVel, wind->resolution, xs, ys, outX, outY, n);
+}
+
+uint64_t wind_hash_state(const wind_t* wind, uint64_t hash)
+{
+	hash = fnv1a64(&wind->gridOrigin, sizeof(wind->gridOrigin), hash);
+	return fnv1a64(wind->gridVel, wind->gridBufferSize, hash);
 }
 
 void wind_get_render_info(wind_render_info_t* info, wind_t* wind)
 {
-	info->gridBuffer	= wind->gridBuffer;
+	info->gridBuffer		= wind->gridBuffer;
+	info->gridResolution	= wind->resolution;
 }
\ No newline at end of file
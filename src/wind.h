@@ -4,10 +4,15 @@
 #include "vulkan.h"
 #include "staging_memory.h"
 #include "render_context.h"
+#include "wind_grid.h"
+#include "job_pool.h"
 
 typedef struct wind wind_t;
 
-wind_t* wind_create(vulkan_t* vulkan);
+// The grid covers resolution * WIND_GRID_CELL_SIZE world units and repeats past that. resolution has to be a
+// power of two, and jobPool (which may be NULL) runs the solver. vulkan may be NULL for wind that's only ticked
+// and sampled, never uploaded.
+wind_t* wind_create(vulkan_t* vulkan, job_pool_t* jobPool, uint resolution);
 void wind_destroy(wind_t* wind);
 
 int wind_alloc_staging_mem(staging_memory_allocator_t* allocator, wind_t* wind);
@@ -15,21 +20,22 @@ int wind_alloc_staging_mem(staging_memory_allocator_t* allocator, wind_t* wind);
 void wind_tick(wind_t* wind);
 void wind_update(VkCommandBuffer cb, wind_t* wind, const render_context_t* rc);
 
-typedef struct wind_injection
-{
-	vec2	aabbMin;
-	vec2	aabbMax;
-	vec2	vel;
-} wind_injection_t;
-
 void wind_inject(wind_t* wind, wind_injection_t injection);
+// Injections are applied in order, same as calling wind_inject for each of them.
+void wind_inject_many(wind_t* wind, const wind_injection_t* injections, uint count);
 void wind_set_focus(wind_t* wind, vec2 pos);
 
 vec2 wind_sample(const wind_t* wind, vec2 pos);
+// wind_sample for n positions given as separate x and y arrays, several at a time.
+void wind_sample_many(const wind_t* wind, const float* xs, const float* ys, float* outX, float* outY, size_t n);
+
+// Continues an fnv1a64 hash with the grid, for checking that two runs simulated the same thing.
+uint64_t wind_hash_state(const wind_t* wind, uint64_t hash);
 
 typedef struct wind_render_info
 {
 	VkBuffer	gridBuffer;
+	uint		gridResolution;
 } wind_render_info_t;
 
 void wind_get_render_info(wind_render_info_t* info, wind_t* wind);
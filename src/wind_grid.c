@@ -0,0 +1,228 @@
+#include "wind_grid.h"
+
+#include <math.h>
+#include <assert.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define WIND_GRID_INJECTION_SCALE	1.5f
+
+void wind_grid_decay(vec2* cells, uint count, float factor)
+{
+	assert(((uintptr_t)cells & 15) == 0);
+	assert((count & 1) == 0);
+
+	float* v = (float*)cells;
+#ifdef __SSE2__
+	const __m128 vfactor = _mm_set1_ps(factor);
+
+	// two cells per vector
+	for (uint i = 0; i < count * 2; i += 4)
+	{
+		_mm_store_ps(v + i, _mm_mul_ps(_mm_load_ps(v + i), vfactor));
+	}
+#else
+	for (uint i = 0; i < count * 2; ++i)
+	{
+		v[i] *= factor;
+	}
+#endif
+}
+
+// v = (v + add) / max(|v + add|, 1), written as a multiply by the reciprocal so that it rounds exactly like
+// vec2_normalize does
+static inline vec2 wind_grid_add_clamped(vec2 v, vec2 add)
+{
+	v.x += add.x;
+	v.y += add.y;
+	const float len = sqrtf(v.x * v.x + v.y * v.y);
+	const float rlen = 1.0f / (len > 1.0f ? len : 1.0f);
+	return (vec2){ v.x * rlen, v.y * rlen };
+}
+
+// Injects into count contiguous cells of one row.
+static void wind_grid_inject_run(vec2* cells, uint count, vec2 add)
+{
+	uint i = 0;
+#ifdef __SSE2__
+	const __m128 vadd = _mm_setr_ps(add.x, add.y, add.x, add.y);
+	const __m128 vone = _mm_set1_ps(1.0f);
+
+	// runs start on any cell, so the loads are unaligned
+	for (; i + 2 <= count; i += 2)
+	{
+		float* p = (float*)(cells + i);
+		const __m128 v = _mm_add_ps(_mm_loadu_ps(p), vadd);
+
+		// x*x + y*y in both lanes of each cell
+		const __m128 sq = _mm_mul_ps(v, v);
+		const __m128 len = _mm_sqrt_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1))));
+		const __m128 rlen = _mm_div_ps(vone, _mm_max_ps(len, vone));
+
+		_mm_storeu_ps(p, _mm_mul_ps(v, rlen));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		cells[i] = wind_grid_add_clamped(cells[i], add);
+	}
+}
+
+void wind_grid_inject(vec2* grid, uint resolution, const wind_injection_t* injection, uint8_t* touchedRows)
+{
+	assert(resolution > 0 && (resolution & (resolution - 1)) == 0);
+
+	if (injection->vel.x == 0.0f &&
+		injection->vel.y == 0.0f)
+	{
+		return;
+	}
+
+	const int xMin = (int)floorf(injection->aabbMin.x / WIND_GRID_CELL_SIZE);
+	const int yMin = (int)floorf(injection->aabbMin.y / WIND_GRID_CELL_SIZE);
+	const int xMax = (int)ceilf(injection->aabbMax.x / WIND_GRID_CELL_SIZE);
+	const int yMax = (int)ceilf(injection->aabbMax.y / WIND_GRID_CELL_SIZE);
+	if (xMax <= xMin || yMax <= yMin)
+	{
+		return;
+	}
+
+	const uint mask = resolution - 1;
+	const uint width = (uint)(xMax - xMin) < resolution ? (uint)(xMax - xMin) : resolution;
+	const uint height = (uint)(yMax - yMin) < resolution ? (uint)(yMax - yMin) : resolution;
+
+	const vec2 add = { injection->vel.x * WIND_GRID_INJECTION_SCALE, injection->vel.y * WIND_GRID_INJECTION_SCALE };
+
+	// a row of the box is at most two runs, split where it wraps around
+	const uint startX = ((uint)xMin) & mask;
+	const uint firstRun = (resolution - startX) < width ? (resolution - startX) : width;
+
+	for (uint y = 0; y < height; ++y)
+	{
+		const uint rowIndex = ((uint)yMin + y) & mask;
+		vec2* row = grid + rowIndex * resolution;
+
+		wind_grid_inject_run(row + startX, firstRun, add);
+		wind_grid_inject_run(row, width - firstRun, add);
+
+		if (touchedRows != NULL)
+		{
+			touchedRows[rowIndex] = 1;
+		}
+	}
+}
+
+// The scalar version of a lane of wind_grid_sample's vector loop, with the operations in the same order.
+static inline void wind_grid_sample_one(const vec2* grid, uint resolution, uint mask, float x, float y, float* outX, float* outY)
+{
+	// cell centers are at half cells, so the cell to the bottom left is the one half a cell back
+	const float gx = x * (1.0f / WIND_GRID_CELL_SIZE) - 0.5f;
+	const float gy = y * (1.0f / WIND_GRID_CELL_SIZE) - 0.5f;
+	const float fx = floorf(gx);
+	const float fy = floorf(gy);
+	const float tx = gx - fx;
+	const float ty = gy - fy;
+
+	const uint x0 = ((uint)(int)fx) & mask;
+	const uint y0 = ((uint)(int)fy) & mask;
+	const uint x1 = (x0 + 1) & mask;
+	const uint y1 = (y0 + 1) & mask;
+
+	const vec2 v00 = grid[x0 + y0 * resolution];
+	const vec2 v10 = grid[x1 + y0 * resolution];
+	const vec2 v01 = grid[x0 + y1 * resolution];
+	const vec2 v11 = grid[x1 + y1 * resolution];
+
+	const float ax = v00.x + tx * (v10.x - v00.x);
+	const float ay = v00.y + tx * (v10.y - v00.y);
+	const float bx = v01.x + tx * (v11.x - v01.x);
+	const float by = v01.y + tx * (v11.y - v01.y);
+	*outX = ax + ty * (bx - ax);
+	*outY = ay + ty * (by - ay);
+}
+
+#ifdef __SSE2__
+// Loads the cells at four indices and splits them into their x and y components.
+static inline void wind_grid_gather(const vec2* grid, const uint* indices, __m128* x, __m128* y)
+{
+	__m128 lo = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&grid[indices[0]]);
+	lo = _mm_loadh_pi(lo, (const __m64*)&grid[indices[1]]);
+	__m128 hi = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)&grid[indices[2]]);
+	hi = _mm_loadh_pi(hi, (const __m64*)&grid[indices[3]]);
+
+	*x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+	*y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// floorf for floats in int range: truncate, then step down the lanes that truncation rounded up
+static inline __m128 wind_grid_floor(__m128 v, __m128i* i)
+{
+	const __m128i t = _mm_cvttps_epi32(v);
+	const __m128 ft = _mm_cvtepi32_ps(t);
+	const __m128 roundedUp = _mm_cmpgt_ps(ft, v);
+	*i = _mm_add_epi32(t, _mm_castps_si128(roundedUp));
+	return _mm_sub_ps(ft, _mm_and_ps(roundedUp, _mm_set1_ps(1.0f)));
+}
+#endif
+
+void wind_grid_sample(const vec2* grid, uint resolution, const float* xs, const float* ys, float* outX, float* outY, size_t n)
+{
+	assert(resolution > 0 && (resolution & (resolution - 1)) == 0);
+
+	const uint mask = resolution - 1;
+	size_t i = 0;
+#ifdef __SSE2__
+	uint shift = 0;
+	while ((1u << shift) < resolution)
+	{
+		++shift;
+	}
+
+	const __m128 vscale = _mm_set1_ps(1.0f / WIND_GRID_CELL_SIZE);
+	const __m128 vhalf = _mm_set1_ps(0.5f);
+	const __m128i vmask = _mm_set1_epi32((int)mask);
+	const __m128i vone = _mm_set1_epi32(1);
+	const __m128i vshift = _mm_cvtsi32_si128((int)shift);
+
+	for (; i + 4 <= n; i += 4)
+	{
+		const __m128 gx = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(xs + i), vscale), vhalf);
+		const __m128 gy = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(ys + i), vscale), vhalf);
+
+		__m128i ix, iy;
+		const __m128 tx = _mm_sub_ps(gx, wind_grid_floor(gx, &ix));
+		const __m128 ty = _mm_sub_ps(gy, wind_grid_floor(gy, &iy));
+
+		const __m128i x0 = _mm_and_si128(ix, vmask);
+		const __m128i x1 = _mm_and_si128(_mm_add_epi32(ix, vone), vmask);
+		const __m128i row0 = _mm_sll_epi32(_mm_and_si128(iy, vmask), vshift);
+		const __m128i row1 = _mm_sll_epi32(_mm_and_si128(_mm_add_epi32(iy, vone), vmask), vshift);
+
+		_Alignas(16) uint indices[4][4];
+		_mm_store_si128((__m128i*)indices[0], _mm_add_epi32(x0, row0));
+		_mm_store_si128((__m128i*)indices[1], _mm_add_epi32(x1, row0));
+		_mm_store_si128((__m128i*)indices[2], _mm_add_epi32(x0, row1));
+		_mm_store_si128((__m128i*)indices[3], _mm_add_epi32(x1, row1));
+
+		__m128 v00x, v00y, v10x, v10y, v01x, v01y, v11x, v11y;
+		wind_grid_gather(grid, indices[0], &v00x, &v00y);
+		wind_grid_gather(grid, indices[1], &v10x, &v10y);
+		wind_grid_gather(grid, indices[2], &v01x, &v01y);
+		wind_grid_gather(grid, indices[3], &v11x, &v11y);
+
+		const __m128 ax = _mm_add_ps(v00x, _mm_mul_ps(tx, _mm_sub_ps(v10x, v00x)));
+		const __m128 ay = _mm_add_ps(v00y, _mm_mul_ps(tx, _mm_sub_ps(v10y, v00y)));
+		const __m128 bx = _mm_add_ps(v01x, _mm_mul_ps(tx, _mm_sub_ps(v11x, v01x)));
+		const __m128 by = _mm_add_ps(v01y, _mm_mul_ps(tx, _mm_sub_ps(v11y, v01y)));
+		_mm_storeu_ps(outX + i, _mm_add_ps(ax, _mm_mul_ps(ty, _mm_sub_ps(bx, ax))));
+		_mm_storeu_ps(outY + i, _mm_add_ps(ay, _mm_mul_ps(ty, _mm_sub_ps(by, ay))));
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		wind_grid_sample_one(grid, resolution, mask, xs[i], ys[i], &outX[i], &outY[i]);
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "types.h"
+#include "../shaders/gpu_types.h"
+
+#include <stddef.h>
+
+// Kernels over a wind velocity grid: resolution * resolution vec2s, row major and 16 byte aligned, where the
+// resolution is a power of two. The grid wraps around in both axes, so world cell (x, y) lives at
+// (x mod resolution, y mod resolution).
+
+typedef struct wind_injection
+{
+	vec2	aabbMin;
+	vec2	aabbMax;
+	vec2	vel;
+} wind_injection_t;
+
+// vel *= factor for count cells, where cells is 16 byte aligned and count is even
+void wind_grid_decay(vec2* cells, uint count, float factor);
+
+// Adds vel * 1.5 to every cell the box touches and clamps each cell's speed to 1. A box wider or taller than
+// the grid touches each cell once. touchedRows, if not NULL, has a byte per row that gets set for the rows the
+// box touches.
+void wind_grid_inject(vec2* grid, uint resolution, const wind_injection_t* injection, uint8_t* touchedRows);
+
+// Bilinear samples of the grid at n world positions, blending between the velocities at the cell centers. Four
+// positions at a time with SSE, and exactly the same results for the ones left over.
+void wind_grid_sample(const vec2* grid, uint resolution, const float* xs, const float* ys, float* outX, float* outY, size_t n);
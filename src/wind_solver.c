@@ -0,0 +1,340 @@
+#include "wind_solver.h"
+#include "wind_grid.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+// Grids smaller than this many cells per band aren't worth handing to the pool.
+#define WIND_SOLVER_MIN_CELLS_PER_JOB	(64 * 64)
+
+// Rows where no component is at least this fast are set to zero, in world units per tick.
+#define WIND_SOLVER_REST_SPEED			(1e-4f)
+
+typedef struct wind_solver
+{
+	wind_solver_desc_t	desc;
+	job_pool_t*			pool;
+	uint				mask;
+	uint				rowsPerJob;
+	uint				jobCount;
+
+	vec2*				vel[2];
+	float*				pressure[2];
+	float*				divergence;
+	uint8_t*			rowActive; // whether a row was left moving by the last step
+} wind_solver_t;
+
+// What a pass reads and writes. Each job works on rowsPerJob rows of the destination.
+typedef struct wind_solver_pass
+{
+	const wind_solver_t*	solver;
+	const vec2*				srcVel;
+	const vec2*				rhsVel;
+	vec2*					dstVel;
+	const float*			srcPressure;
+	float*					dstPressure;
+	uint8_t*				changedRows;
+} wind_solver_pass_t;
+
+wind_solver_t* wind_solver_create(const wind_solver_desc_t* desc, job_pool_t* pool)
+{
+	assert(desc->resolution >= 2 && (desc->resolution & (desc->resolution - 1)) == 0);
+
+	wind_solver_t* solver = calloc(1, sizeof(wind_solver_t));
+	if (solver == NULL)
+	{
+		return NULL;
+	}
+
+	const uint res = desc->resolution;
+	const size_t cellCount = (size_t)res * res;
+	const size_t size = cellCount * (2 * sizeof(vec2) + 3 * sizeof(float)) + res;
+	char* mem = aligned_alloc(16, size);
+	if (mem == NULL)
+	{
+		free(solver);
+		return NULL;
+	}
+	memset(mem, 0, size);
+
+	solver->desc		= *desc;
+	solver->pool		= pool;
+	solver->mask		= res - 1;
+	solver->rowsPerJob	= (WIND_SOLVER_MIN_CELLS_PER_JOB + res - 1) / res;
+	solver->rowsPerJob	= solver->rowsPerJob < res ? solver->rowsPerJob : res;
+	solver->jobCount	= res / solver->rowsPerJob;
+
+	// both are powers of two, so the bands tile the grid
+	assert(solver->jobCount * solver->rowsPerJob == res);
+
+	solver->vel[0]		= (vec2*)mem;
+	solver->vel[1]		= solver->vel[0] + cellCount;
+	solver->pressure[0]	= (float*)(solver->vel[1] + cellCount);
+	solver->pressure[1]	= solver->pressure[0] + cellCount;
+	solver->divergence	= solver->pressure[1] + cellCount;
+	solver->rowActive	= (uint8_t*)(solver->divergence + cellCount);
+
+	// nothing is known about the grid the first step gets
+	memset(solver->rowActive, 1, res);
+
+	return solver;
+}
+
+void wind_solver_destroy(wind_solver_t* solver)
+{
+	free(solver->vel[0]);
+	free(solver);
+}
+
+static void wind_solver_run(const wind_solver_t* solver, job_func_t func, wind_solver_pass_t* pass)
+{
+	pass->solver = solver;
+
+	if (solver->pool == NULL || solver->jobCount == 1)
+	{
+		for (uint i = 0; i < solver->jobCount; ++i)
+		{
+			func(pass, i);
+		}
+		return;
+	}
+
+	job_pool_run(solver->pool, func, pass, solver->jobCount);
+}
+
+static vec2 wind_solver_sample(const vec2* vel, uint res, uint mask, float x, float y)
+{
+	const float fx = floorf(x);
+	const float fy = floorf(y);
+	const float tx = x - fx;
+	const float ty = y - fy;
+
+	const uint x0 = ((uint)(int)fx) & mask;
+	const uint y0 = ((uint)(int)fy) & mask;
+	const uint x1 = (x0 + 1) & mask;
+	const uint y1 = (y0 + 1) & mask;
+
+	const vec2 v00 = vel[x0 + y0 * res];
+	const vec2 v10 = vel[x1 + y0 * res];
+	const vec2 v01 = vel[x0 + y1 * res];
+	const vec2 v11 = vel[x1 + y1 * res];
+
+	const vec2 a = { v00.x + (v10.x - v00.x) * tx, v00.y + (v10.y - v00.y) * tx };
+	const vec2 b = { v01.x + (v11.x - v01.x) * tx, v01.y + (v11.y - v01.y) * tx };
+	return (vec2){ a.x + (b.x - a.x) * ty, a.y + (b.y - a.y) * ty };
+}
+
+// Semi-Lagrangian: every cell takes the velocity found one step back along its own velocity.
+static void wind_solver_advect_job(void* userData, uint jobIndex)
+{
+	const wind_solver_pass_t* pass = userData;
+	const wind_solver_t* solver = pass->solver;
+	const uint res = solver->desc.resolution;
+	const float cellsPerUnit = 1.0f / WIND_GRID_CELL_SIZE;
+
+	const uint yBegin = jobIndex * solver->rowsPerJob;
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		for (uint x = 0; x < res; ++x)
+		{
+			const vec2 v = pass->srcVel[x + y * res];
+			pass->dstVel[x + y * res] = wind_solver_sample(pass->srcVel, res, solver->mask,
+				(float)x - v.x * cellsPerUnit,
+				(float)y - v.y * cellsPerUnit);
+		}
+	}
+}
+
+// One Jacobi iteration of (1 - viscosity * laplacian) v = rhs.
+static void wind_solver_diffuse_job(void* userData, uint jobIndex)
+{
+	const wind_solver_pass_t* pass = userData;
+	const wind_solver_t* solver = pass->solver;
+	const uint res = solver->desc.resolution;
+	const uint mask = solver->mask;
+	const float a = solver->desc.viscosity;
+	const float r = 1.0f / (1.0f + 4.0f * a);
+	const vec2* src = pass->srcVel;
+
+	const uint yBegin = jobIndex * solver->rowsPerJob;
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		const vec2* up = src + ((y - 1) & mask) * res;
+		const vec2* row = src + y * res;
+		const vec2* down = src + ((y + 1) & mask) * res;
+
+		for (uint x = 0; x < res; ++x)
+		{
+			const uint xl = (x - 1) & mask;
+			const uint xr = (x + 1) & mask;
+			const vec2 rhs = pass->rhsVel[x + y * res];
+
+			pass->dstVel[x + y * res] = (vec2){
+				(rhs.x + a * (row[xl].x + row[xr].x + up[x].x + down[x].x)) * r,
+				(rhs.y + a * (row[xl].y + row[xr].y + up[x].y + down[x].y)) * r,
+			};
+		}
+	}
+}
+
+// Writes the negated divergence, the right hand side of the pressure solve.
+static void wind_solver_divergence_job(void* userData, uint jobIndex)
+{
+	const wind_solver_pass_t* pass = userData;
+	const wind_solver_t* solver = pass->solver;
+	const uint res = solver->desc.resolution;
+	const uint mask = solver->mask;
+	const vec2* src = pass->srcVel;
+
+	const uint yBegin = jobIndex * solver->rowsPerJob;
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		const vec2* up = src + ((y - 1) & mask) * res;
+		const vec2* row = src + y * res;
+		const vec2* down = src + ((y + 1) & mask) * res;
+
+		for (uint x = 0; x < res; ++x)
+		{
+			const uint xl = (x - 1) & mask;
+			const uint xr = (x + 1) & mask;
+			solver->divergence[x + y * res] = -0.5f * ((row[xr].x - row[xl].x) + (down[x].y - up[x].y));
+		}
+	}
+}
+
+// One Jacobi iteration of laplacian p = divergence.
+static void wind_solver_pressure_job(void* userData, uint jobIndex)
+{
+	const wind_solver_pass_t* pass = userData;
+	const wind_solver_t* solver = pass->solver;
+	const uint res = solver->desc.resolution;
+	const uint mask = solver->mask;
+	const float* src = pass->srcPressure;
+
+	const uint yBegin = jobIndex * solver->rowsPerJob;
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		const float* up = src + ((y - 1) & mask) * res;
+		const float* row = src + y * res;
+		const float* down = src + ((y + 1) & mask) * res;
+
+		for (uint x = 0; x < res; ++x)
+		{
+			const uint xl = (x - 1) & mask;
+			const uint xr = (x + 1) & mask;
+			pass->dstPressure[x + y * res] = (solver->divergence[x + y * res] + row[xl] + row[xr] + up[x] + down[x]) * 0.25f;
+		}
+	}
+}
+
+// Subtracts the pressure gradient and damps the band while it's still in cache, then puts the rows that have
+// stopped moving to rest. srcVel may be dstVel.
+static void wind_solver_project_job(void* userData, uint jobIndex)
+{
+	const wind_solver_pass_t* pass = userData;
+	const wind_solver_t* solver = pass->solver;
+	const uint res = solver->desc.resolution;
+	const uint mask = solver->mask;
+	const float* p = pass->srcPressure;
+
+	const uint yBegin = jobIndex * solver->rowsPerJob;
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		const float* up = p + ((y - 1) & mask) * res;
+		const float* row = p + y * res;
+		const float* down = p + ((y + 1) & mask) * res;
+
+		for (uint x = 0; x < res; ++x)
+		{
+			const uint xl = (x - 1) & mask;
+			const uint xr = (x + 1) & mask;
+			const vec2 v = pass->srcVel[x + y * res];
+
+			pass->dstVel[x + y * res] = (vec2){
+				v.x - 0.5f * (row[xr] - row[xl]),
+				v.y - 0.5f * (down[x] - up[x]),
+			};
+		}
+	}
+
+	wind_grid_decay(pass->dstVel + yBegin * res, solver->rowsPerJob * res, solver->desc.damping);
+
+	for (uint y = yBegin; y < yBegin + solver->rowsPerJob; ++y)
+	{
+		vec2* row = pass->dstVel + y * res;
+
+		float speed = 0.0f;
+		for (uint x = 0; x < res; ++x)
+		{
+			speed = fmaxf(speed, fmaxf(fabsf(row[x].x), fabsf(row[x].y)));
+		}
+
+		const uint8_t isActive = speed >= WIND_SOLVER_REST_SPEED;
+		if (!isActive)
+		{
+			memset(row, 0, res * sizeof(vec2));
+		}
+
+		// a row that stays at rest is zero before and after
+		if (pass->changedRows != NULL)
+		{
+			pass->changedRows[y] |= isActive | solver->rowActive[y];
+		}
+		solver->rowActive[y] = isActive;
+	}
+}
+
+bool wind_solver_step(wind_solver_t* solver, vec2* grid, uint8_t* changedRows)
+{
+	wind_solver_pass_t pass = {
+		.changedRows = changedRows,
+	};
+
+	pass.srcVel = grid;
+	pass.dstVel = solver->vel[0];
+	wind_solver_run(solver, wind_solver_advect_job, &pass);
+
+	// starts from the advected velocity and ping-pongs between the grid and vel[1], leaving vel[0] as the rhs
+	const vec2* vel = solver->vel[0];
+	for (uint i = 0; i < solver->desc.diffusionIterations; ++i)
+	{
+		pass.srcVel = vel;
+		pass.rhsVel = solver->vel[0];
+		pass.dstVel = (i & 1) ? solver->vel[1] : grid;
+		wind_solver_run(solver, wind_solver_diffuse_job, &pass);
+		vel = pass.dstVel;
+	}
+
+	pass.srcVel = vel;
+	wind_solver_run(solver, wind_solver_divergence_job, &pass);
+
+	for (uint i = 0; i < solver->desc.pressureIterations; ++i)
+	{
+		pass.srcPressure = solver->pressure[0];
+		pass.dstPressure = solver->pressure[1];
+		wind_solver_run(solver, wind_solver_pressure_job, &pass);
+
+		float* tmp = solver->pressure[0];
+		solver->pressure[0] = solver->pressure[1];
+		solver->pressure[1] = tmp;
+	}
+
+	pass.srcVel = vel;
+	pass.srcPressure = solver->pressure[0];
+	pass.dstVel = grid;
+	wind_solver_run(solver, wind_solver_project_job, &pass);
+
+	for (uint y = 0; y < solver->desc.resolution; ++y)
+	{
+		if (solver->rowActive[y])
+		{
+			return true;
+		}
+	}
+
+	// a zero grid with zero pressure steps to zero, so the next step can be skipped
+	memset(solver->pressure[0], 0, (size_t)solver->desc.resolution * solver->desc.resolution * sizeof(float));
+	return false;
+}
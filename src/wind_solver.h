@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.h"
+#include "job_pool.h"
+
+#include <stdbool.h>
+
+// Stable fluids on a wind grid (see wind_grid.h for the layout). A step advects the velocity along itself,
+// diffuses it, projects it to be divergence free and damps it, with a fixed number of Jacobi iterations so a
+// step costs the same every tick. Velocities are in world units per tick.
+//
+// Every pass is split into bands of rows that run on a job pool. Jacobi iterations only read the previous
+// iterate, so the result is the same for any number of threads.
+typedef struct wind_solver wind_solver_t;
+
+typedef struct wind_solver_desc
+{
+	uint	resolution; // power of two, at least 2
+	uint	diffusionIterations;
+	uint	pressureIterations;
+	float	viscosity; // in cells^2 per tick
+	float	damping; // the velocity is scaled by this at the end of a step
+} wind_solver_desc_t;
+
+// pool may be NULL to run every pass on the calling thread.
+wind_solver_t* wind_solver_create(const wind_solver_desc_t* desc, job_pool_t* pool);
+void wind_solver_destroy(wind_solver_t* solver);
+
+// Steps grid in place. The pressure is kept between steps as the starting guess for the next one. Rows that
+// have slowed to a stop are set to exactly zero, and changedRows (if not NULL, one byte per row) gets set for
+// every row the step changed, leaving the others as they were.
+//
+// Returns false once the whole grid is at rest. Until something is injected into it, stepping it again
+// leaves it unchanged and can be skipped.
+bool wind_solver_step(wind_solver_t* solver, vec2* grid, uint8_t* changedRows);
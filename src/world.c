@@ -1,4 +1,9 @@
 #include "world.h"
+#include "offset_allocator.h"
+#include "collision_grid.h"
+#include "collision.h"
+#include "foliage.h"
+#include "world_file.h"
 #include "types.h"
 #include "debug_renderer.h"
 #include "vec.h"
@@ -7,41 +12,104 @@
 #include "profiler.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 
-#define WORLD_MAX_INDEX_COUNT (1024 * 1024)
-#define WORLD_MAX_VERTEX_COUNT (1024 * 1024)
+#define WORLD_MAX_INDEX_COUNT (768 * 1024)
+#define WORLD_MAX_VERTEX_COUNT (256 * 1024)
+#define WORLD_MAX_FOLIAGE_INSTANCE_COUNT (256 * 1024)
 #define WORLD_INDEX_BUFFER_SIZE (WORLD_MAX_INDEX_COUNT * sizeof(uint32_t))
-#define WORLD_POSITION_BUFFER_SIZE (WORLD_MAX_VERTEX_COUNT * sizeof(vec3))
+#define WORLD_POSITION_BUFFER_SIZE (WORLD_MAX_VERTEX_COUNT * sizeof(uint32_t))
 #define WORLD_COLOR_BUFFER_SIZE (WORLD_MAX_VERTEX_COUNT * sizeof(uint32_t))
-#define WORLD_STAGING_BUFFER_SIZE (WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE + WORLD_COLOR_BUFFER_SIZE)
+#define WORLD_FOLIAGE_BUFFER_SIZE (WORLD_MAX_FOLIAGE_INSTANCE_COUNT * sizeof(gpu_foliage_instance_t))
+#define WORLD_STAGING_BUFFER_SIZE (WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE + WORLD_COLOR_BUFFER_SIZE + WORLD_FOLIAGE_BUFFER_SIZE)
 
-#define WORLD_MAX_TRIANGLE_COLLIDERS 1024
+// each sub-buffer of the staging buffer starts on the flush alignment, see world_flush_staging_regions
+_Static_assert(WORLD_INDEX_BUFFER_SIZE % 0x40 == 0 && WORLD_POSITION_BUFFER_SIZE % 0x40 == 0 && WORLD_COLOR_BUFFER_SIZE % 0x40 == 0);
 
-typedef enum world_state
-{
-	WORLD_STATE_UPLOAD_TRIANGLES,
-	WORLD_STATE_DONE,
-} world_state_t;
+#define WORLD_COLLIDER_GRID_CELL_SIZE 2.0f
+
+// Polygons are bucketed into square chunks by the center of their bounds. Only chunks near the focus are
+// triangulated, uploaded and collided.
+#define WORLD_CHUNK_SIZE				32.0f
+#define WORLD_MAX_RESIDENT_CHUNKS		256
+#define WORLD_MAX_CHUNK_UPLOADS			16
+
+// Deeper layers show more of the world, so their streaming radius grows with their distance from the camera.
+// Chunks are evicted a bit further out than they are loaded, so a focus hovering on a boundary doesn't thrash.
+#define WORLD_STREAM_RADIUS				32.0f
+#define WORLD_STREAM_VIEW_SCALE			2.0f
+#define WORLD_STREAM_EVICT_SCALE		1.25f
 
 typedef struct world_colliders
 {
-	uint32_t			triangleCount;
-	triangle_collider_t	triangles[WORLD_MAX_TRIANGLE_COLLIDERS];
+	uint32_t				triangleCount;
+	uint32_t				triangleCapacity;
+	triangle_collider_t*	triangles;
+	collision_triangle_t*	shapes; // the triangles' edge planes
+	vec2*					boundsMin;
+	vec2*					boundsMax;
+	collision_grid_t		grid;
+
+	// resident layer 0 polygons, which is where pollen spawns
+	uint					polygonCount;
+	uint					polygonCapacity;
+	uint*					polygons;
 } world_colliders_t;
 
-typedef struct parallax_layer
+typedef struct world_chunk
+{
+	uint				layer;
+	int2				cell;
+
+	// a run of world->chunkPolygons
+	uint				firstPolygon;
+	uint				polygonCount;
+
+	bool				resident;
+	bool				dirty;
+	bool				uploadFailed;
+
+	// polygons are in memory. Chunks that weren't edited since they were read from world->file are dropped
+	// again on eviction.
+	bool				loaded;
+	bool				modified;
+	bool				loadFailed;
+
+	// sub-allocations in the world index/vertex/foliage buffers, in elements
+	bool				hasMesh;
+	offset_allocation_t	indexAllocation;
+	offset_allocation_t	vertexAllocation;
+	offset_allocation_t	foliageAllocation;
+	uint32_t			indexCount;
+	uint32_t			vertexCount;
+	uint32_t			foliageInstanceCount;
+	gpu_world_chunk_t	quantization;
+} world_chunk_t;
+
+typedef struct world_frame
 {
-	editor_polygon_t	polygon;
-} parallax_layer_t;
+	// allocations replaced while this frame was recorded; safe to free once its fence has been waited on
+	uint				retiredCount;
+	offset_allocation_t	retiredIndexAllocations[WORLD_MAX_RESIDENT_CHUNKS];
+	offset_allocation_t	retiredVertexAllocations[WORLD_MAX_RESIDENT_CHUNKS];
+	uint				retiredFoliageCount;
+	offset_allocation_t	retiredFoliageAllocations[WORLD_MAX_RESIDENT_CHUNKS];
+
+	// quantization of every drawn chunk as of this frame, so a rebuild never changes what an in-flight frame reads
+	VkBuffer			chunkBuffer;
+	gpu_world_chunk_t*	chunkBufferMemory;
+} world_frame_t;
 
 typedef struct world
 {
 	vulkan_t*			vulkan;
 	particles_t*		particles;
-	world_state_t		state;
-	uint				stagingCounter;
+	job_pool_t*			jobPool;
+	uint				framesSinceUpload;
+	uint				lastFrameIndex;
+	bool				collidersDirty;
 
 	VkBuffer			indexBuffer;
 	VkDeviceMemory		indexBufferMemory;
@@ -49,13 +117,46 @@ typedef struct world
 	VkDeviceMemory		vertexPositionBufferMemory;
 	VkBuffer			vertexColorBuffer;
 	VkDeviceMemory		vertexColorBufferMemory;
-	uint32_t			indexCount;
+	VkBuffer			foliageBuffer;
+	VkDeviceMemory		foliageBufferMemory;
+	offset_allocator_t	indexAllocator;
+	offset_allocator_t	vertexAllocator;
+	offset_allocator_t	foliageAllocator;
+	world_frame_t		frames[FRAME_COUNT];
 
 	VkBuffer			stagingBuffer;
 	void*				stagingBufferMemory;
 
+	foliage_job_t*		foliageJobs;
+	uint				foliageJobCapacity;
+
+	world_file_t		file;
+	world_file_save_t	save;
+	uint				polygonCount;
+	editor_polygon_t*	polygons;
+
+	uint				chunkCount;
+	world_chunk_t*		chunks;
+	uint*				chunkPolygons;
+	vec2*				chunkBoundsMin;
+	vec2*				chunkBoundsMax;
+	collision_grid_t	chunkGrid;
+	bool				chunkGridDirty;
+
+	vec2				focus;
+	vec2				streamFocus;
+	bool				streamDirty;
+	uint				residentChunkCount;
+	uint				residentChunks[WORLD_MAX_RESIDENT_CHUNKS];
+	uint				chunkQueryCapacity;
+	uint*				chunkQuery;
+
 	uint32_t			visibleLayerMask;
-	parallax_layer_t	layers[PARALLAX_LAYER_COUNT];
+	uint				drawCount;
+	world_draw_t		draws[WORLD_MAX_RESIDENT_CHUNKS];
+	world_draw_t		visibleDraws[WORLD_MAX_RESIDENT_CHUNKS];
+	editor_polygon_t**	editPolygons;
+
 	world_colliders_t	colliders;
 
 	uint				rng;
@@ -64,8 +165,10 @@ typedef struct world
 
 static void triangle_collider_debug_draw(triangle_collider_t* t);
 void editor_polygon_debug_draw(editor_polygon_t* p);
+static bool world_build_chunks(world_t* world);
+static void world_free_polygons(world_t* world);
 
-world_t* world_create(vulkan_t* vulkan, particles_t* particles)
+world_t* world_create(vulkan_t* vulkan, particles_t* particles, job_pool_t* jobPool)
 {
 	world_t* world = calloc(1, sizeof(world_t));
 	if (world == NULL)
@@ -75,32 +178,67 @@ world_t* world_create(vulkan_t* vulkan, particles_t* particles)
 
 	world->vulkan			= vulkan;
 	world->particles		= particles;
+	world->jobPool			= jobPool;
 	world->visibleLayerMask	= 0xffffffffu;
+	world->collidersDirty	= true;
+	world->streamDirty		= true;
+	world->framesSinceUpload	= FRAME_COUNT;
+	world->file.fd			= -1;
+
+	// live chunks plus whatever the in-flight frames have retired
+	const uint32_t maxAllocs = WORLD_MAX_RESIDENT_CHUNKS * (FRAME_COUNT + 1);
+	offset_allocator_create(&world->indexAllocator, WORLD_MAX_INDEX_COUNT, maxAllocs);
+	offset_allocator_create(&world->vertexAllocator, WORLD_MAX_VERTEX_COUNT, maxAllocs);
+	offset_allocator_create(&world->foliageAllocator, WORLD_MAX_FOLIAGE_INSTANCE_COUNT, maxAllocs);
 	
-	world->indexBuffer = CreateBuffer(
-		&world->indexBufferMemory,
-		vulkan,
-		WORLD_INDEX_BUFFER_SIZE,
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	world->vertexPositionBuffer = CreateBuffer(
-		&world->vertexPositionBufferMemory,
-		vulkan,
-		WORLD_POSITION_BUFFER_SIZE,
-		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-	world->vertexColorBuffer = CreateBuffer(
-		&world->vertexColorBufferMemory,
-		vulkan,
-		WORLD_COLOR_BUFFER_SIZE,
-		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	// a headless world streams and collides, but never meshes anything
+	if (vulkan != NULL)
+	{
+		world->indexBuffer = CreateBuffer(
+			&world->indexBufferMemory,
+			vulkan,
+			WORLD_INDEX_BUFFER_SIZE,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		world->vertexPositionBuffer = CreateBuffer(
+			&world->vertexPositionBufferMemory,
+			vulkan,
+			WORLD_POSITION_BUFFER_SIZE,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		world->vertexColorBuffer = CreateBuffer(
+			&world->vertexColorBufferMemory,
+			vulkan,
+			WORLD_COLOR_BUFFER_SIZE,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		world->foliageBuffer = CreateBuffer(
+			&world->foliageBufferMemory,
+			vulkan,
+			WORLD_FOLIAGE_BUFFER_SIZE,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	world->polygons = calloc(PARALLAX_LAYER_COUNT, sizeof(editor_polygon_t));
+	if (world->polygons == NULL)
+	{
+		world_destroy(world);
+		return NULL;
+	}
+	world->polygonCount = PARALLAX_LAYER_COUNT;
 
 	for (int i = 0; i < PARALLAX_LAYER_COUNT; ++i)
 	{
-		editor_polygon_t* polygon = &world->layers[i].polygon;
+		editor_polygon_t* polygon = &world->polygons[i];
+		if (!editor_polygon_reserve(polygon, 4))
+		{
+			world_destroy(world);
+			return NULL;
+		}
 		polygon->vertexPosition[polygon->vertexCount++] = (vec2){-10.0f, 0.0f};
 		polygon->vertexPosition[polygon->vertexCount++] = (vec2){10.0f, 0.0f};
 		polygon->vertexPosition[polygon->vertexCount++] = (vec2){10.0f, -10.0f};
@@ -111,6 +249,12 @@ world_t* world_create(vulkan_t* vulkan, particles_t* particles)
 		polygon->layer = i;
 	}
 
+	if (!world_build_chunks(world))
+	{
+		world_destroy(world);
+		return NULL;
+	}
+
 	return world;
 }
 
@@ -118,15 +262,47 @@ void world_destroy(world_t* world)
 {
 	vulkan_t* vulkan = world->vulkan;
 
-	vkDestroyBuffer(vulkan->device, world->stagingBuffer, NULL);
+	if (vulkan != NULL)
+	{
+		vkDestroyBuffer(vulkan->device, world->stagingBuffer, NULL);
+		for (int i = 0; i < FRAME_COUNT; ++i)
+		{
+			vkDestroyBuffer(vulkan->device, world->frames[i].chunkBuffer, NULL);
+		}
+
+		vkDestroyBuffer(vulkan->device, world->indexBuffer, NULL);
+		vkDestroyBuffer(vulkan->device, world->vertexPositionBuffer, NULL);
+		vkDestroyBuffer(vulkan->device, world->vertexColorBuffer, NULL);
+		vkDestroyBuffer(vulkan->device, world->foliageBuffer, NULL);
 
-	vkDestroyBuffer(vulkan->device, world->indexBuffer, NULL);
-	vkDestroyBuffer(vulkan->device, world->vertexPositionBuffer, NULL);
-	vkDestroyBuffer(vulkan->device, world->vertexColorBuffer, NULL);
+		vkFreeMemory(vulkan->device, world->indexBufferMemory, NULL);
+		vkFreeMemory(vulkan->device, world->vertexPositionBufferMemory, NULL);
+		vkFreeMemory(vulkan->device, world->vertexColorBufferMemory, NULL);
+		vkFreeMemory(vulkan->device, world->foliageBufferMemory, NULL);
+	}
 
-	vkFreeMemory(vulkan->device, world->indexBufferMemory, NULL);
-	vkFreeMemory(vulkan->device, world->vertexPositionBufferMemory, NULL);
-	vkFreeMemory(vulkan->device, world->vertexColorBufferMemory, NULL);
+	offset_allocator_destroy(&world->indexAllocator);
+	offset_allocator_destroy(&world->vertexAllocator);
+	offset_allocator_destroy(&world->foliageAllocator);
+
+	free(world->foliageJobs);
+
+	world_file_save_wait(&world->save);
+	world_free_polygons(world);
+	world_file_close(&world->file);
+	free(world->chunks);
+	free(world->chunkPolygons);
+	free(world->chunkBoundsMin);
+	free(world->chunkBoundsMax);
+	free(world->chunkQuery);
+	collision_grid_destroy(&world->chunkGrid);
+
+	free(world->colliders.triangles);
+	free(world->colliders.shapes);
+	free(world->colliders.boundsMin);
+	free(world->colliders.boundsMax);
+	free(world->colliders.polygons);
+	collision_grid_destroy(&world->colliders.grid);
 
 	free(world);
 }
@@ -140,170 +316,515 @@ void world_alloc_staging_mem(staging_memory_allocator_t* allocator, world_t* wor
 		WORLD_STAGING_BUFFER_SIZE,
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		"World");
+
+	for (int i = 0; i < FRAME_COUNT; ++i)
+	{
+		world_frame_t* frame = &world->frames[i];
+
+		PushStagingBufferAllocation(
+			allocator,
+			&frame->chunkBuffer,
+			(void**)&frame->chunkBufferMemory,
+			WORLD_MAX_RESIDENT_CHUNKS * sizeof(gpu_world_chunk_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			"World Chunks");
+	}
 }
 
-typedef struct primitive_context
+static void world_free_polygons(world_t* world)
 {
-	uint32_t*	indices;
-	vec3*		positions;
-	uint32_t*	colors;
-	
-	uint32_t	indexCount;
-	uint32_t	vertexCount;
-} primitive_context_t;
+	for (uint i = 0; i < world->polygonCount; ++i)
+	{
+		free(world->polygons[i].vertexPosition);
+		free(world->polygons[i].triangles);
+	}
+	free(world->polygons);
+	free(world->editPolygons);
 
-static void grow_grass(primitive_context_t* ctx, vec3 root, vec2 tangent)
+	world->polygons		= NULL;
+	world->editPolygons	= NULL;
+	world->polygonCount	= 0;
+}
+
+static int2 world_chunk_cell(vec2 p)
+{
+	return (int2){ (int)floorf(p.x / WORLD_CHUNK_SIZE), (int)floorf(p.y / WORLD_CHUNK_SIZE) };
+}
+
+static void editor_polygon_bounds(vec2* boundsMin, vec2* boundsMax, const editor_polygon_t* polygon)
 {
-	ctx->indices[ctx->indexCount + 0] = ctx->vertexCount + 0;
-	ctx->indices[ctx->indexCount + 1] = ctx->vertexCount + 1;
-	ctx->indices[ctx->indexCount + 2] = ctx->vertexCount + 2;
-	ctx->indexCount += 3;
+	*boundsMin = (vec2){ INFINITY, INFINITY };
+	*boundsMax = (vec2){ -INFINITY, -INFINITY };
+	for (uint i = 0; i < polygon->vertexCount; ++i)
+	{
+		const vec2 p = polygon->vertexPosition[i];
+		*boundsMin = (vec2){ fminf(boundsMin->x, p.x), fminf(boundsMin->y, p.y) };
+		*boundsMax = (vec2){ fmaxf(boundsMax->x, p.x), fmaxf(boundsMax->y, p.y) };
+	}
+}
 
-	float width = 0.025f;
-	float height = 0.1f + (rand() / (float)RAND_MAX) * 0.5f;
+static void world_update_chunk_bounds(world_t* world, uint chunkIndex)
+{
+	const world_chunk_t* chunk = &world->chunks[chunkIndex];
 
-	ctx->positions[ctx->vertexCount + 0] = (vec3){root.x, root.y + height, root.z};
-	ctx->positions[ctx->vertexCount + 1] = (vec3){root.x - width * tangent.x, root.y - width * tangent.y, root.z};
-	ctx->positions[ctx->vertexCount + 2] = (vec3){root.x + width * tangent.x, root.y + width * tangent.y, root.z};
+	vec2 boundsMin = { INFINITY, INFINITY };
+	vec2 boundsMax = { -INFINITY, -INFINITY };
+	for (uint i = 0; i < chunk->polygonCount; ++i)
+	{
+		vec2 polygonMin, polygonMax;
+		editor_polygon_bounds(&polygonMin, &polygonMax, &world->polygons[world->chunkPolygons[chunk->firstPolygon + i]]);
+		boundsMin = (vec2){ fminf(boundsMin.x, polygonMin.x), fminf(boundsMin.y, polygonMin.y) };
+		boundsMax = (vec2){ fmaxf(boundsMax.x, polygonMax.x), fmaxf(boundsMax.y, polygonMax.y) };
+	}
 
-	uint8_t red = rand() & 0b1111111;
+	world->chunkBoundsMin[chunkIndex] = boundsMin;
+	world->chunkBoundsMax[chunkIndex] = boundsMax;
+	world->chunkGridDirty = true;
+}
 
-	ctx->colors[ctx->vertexCount + 0] = 0xff00a000 | red;
-	ctx->colors[ctx->vertexCount + 1] = 0x00002000 | (red/2);
-	ctx->colors[ctx->vertexCount + 2] = 0x00002000 | (red/2);
+typedef struct chunk_sort_key
+{
+	uint	layer;
+	int2	cell;
+	uint	polygon;
+} chunk_sort_key_t;
 
-	ctx->vertexCount += 3;
+static int compare_chunk_sort_keys(const void* a, const void* b)
+{
+	const chunk_sort_key_t* ka = a;
+	const chunk_sort_key_t* kb = b;
+	if (ka->layer != kb->layer)		return ka->layer < kb->layer ? -1 : 1;
+	if (ka->cell.y != kb->cell.y)	return ka->cell.y < kb->cell.y ? -1 : 1;
+	if (ka->cell.x != kb->cell.x)	return ka->cell.x < kb->cell.x ? -1 : 1;
+	return ka->polygon < kb->polygon ? -1 : ka->polygon > kb->polygon;
 }
 
-static void grow_flower(primitive_context_t* ctx, vec3 root, vec2 tangent)
+static void world_retire_chunk_mesh(world_frame_t* frame, world_chunk_t* chunk)
 {
-	float width = 0.01f;
-	float height = 0.3f + (rand() / (float)RAND_MAX) * 0.5f;
-	float headSize = 0.1f;
+	if (!chunk->hasMesh)
+	{
+		return;
+	}
 
-	// stem
+	assert(frame->retiredCount < WORLD_MAX_RESIDENT_CHUNKS);
+	frame->retiredIndexAllocations[frame->retiredCount]		= chunk->indexAllocation;
+	frame->retiredVertexAllocations[frame->retiredCount]	= chunk->vertexAllocation;
+	++frame->retiredCount;
+
+	if (chunk->foliageInstanceCount > 0)
 	{
-		ctx->indices[ctx->indexCount + 0] = ctx->vertexCount + 0;
-		ctx->indices[ctx->indexCount + 1] = ctx->vertexCount + 1;
-		ctx->indices[ctx->indexCount + 2] = ctx->vertexCount + 2;
-		ctx->indices[ctx->indexCount + 3] = ctx->vertexCount + 2;
-		ctx->indices[ctx->indexCount + 4] = ctx->vertexCount + 1;
-		ctx->indices[ctx->indexCount + 5] = ctx->vertexCount + 3;
-		ctx->indexCount += 6;
+		frame->retiredFoliageAllocations[frame->retiredFoliageCount++] = chunk->foliageAllocation;
+	}
 
-		ctx->positions[ctx->vertexCount + 0] = (vec3){root.x - width, root.y + height, root.z};
-		ctx->positions[ctx->vertexCount + 1] = (vec3){root.x + width, root.y + height, root.z};
-		ctx->positions[ctx->vertexCount + 2] = (vec3){root.x - width * tangent.x, root.y - width * tangent.y, root.z};
-		ctx->positions[ctx->vertexCount + 3] = (vec3){root.x + width * tangent.x, root.y + width * tangent.y, root.z};
+	chunk->hasMesh				= false;
+	chunk->indexCount			= 0;
+	chunk->vertexCount			= 0;
+	chunk->foliageInstanceCount	= 0;
+}
 
-		uint8_t red = rand() & 0b11111;
+static void world_evict_chunk(world_t* world, world_frame_t* frame, world_chunk_t* chunk)
+{
+	world_retire_chunk_mesh(frame, chunk);
 
-		ctx->colors[ctx->vertexCount + 0] = 0xff007000 | red;
-		ctx->colors[ctx->vertexCount + 1] = 0xff007000 | red;
-		ctx->colors[ctx->vertexCount + 2] = 0x00001000 | (red/2);
-		ctx->colors[ctx->vertexCount + 3] = 0x00001000 | (red/2);
+	// the triangulation is the bulk of a polygon's memory, and is cheap to redo when the chunk comes back.
+	// Unedited polygons can be read back from the file just as cheaply.
+	for (uint i = 0; i < chunk->polygonCount; ++i)
+	{
+		editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + i]];
+		free(polygon->triangles);
+		polygon->triangles			= NULL;
+		polygon->triangleCount		= 0;
+		polygon->triangleCapacity	= 0;
 
-		ctx->vertexCount += 4;
+		if (!chunk->modified)
+		{
+			free(polygon->vertexPosition);
+			polygon->vertexPosition	= NULL;
+			polygon->vertexCount	= 0;
+			polygon->vertexCapacity	= 0;
+		}
 	}
 
-	// head
+	if (!chunk->modified)
 	{
+		chunk->loaded = false;
+	}
 
-		ctx->indices[ctx->indexCount + 0] = ctx->vertexCount + 0;
-		ctx->indices[ctx->indexCount + 1] = ctx->vertexCount + 1;
-		ctx->indices[ctx->indexCount + 2] = ctx->vertexCount + 2;
-		ctx->indices[ctx->indexCount + 3] = ctx->vertexCount + 2;
-		ctx->indices[ctx->indexCount + 4] = ctx->vertexCount + 1;
-		ctx->indices[ctx->indexCount + 5] = ctx->vertexCount + 3;
-		ctx->indexCount += 6;
+	if (chunk->layer == 0)
+	{
+		world->collidersDirty = true;
+	}
 
-		ctx->positions[ctx->vertexCount + 0] = (vec3){root.x - headSize * 0.5f, root.y + height + headSize * 0.5f, root.z};
-		ctx->positions[ctx->vertexCount + 1] = (vec3){root.x + headSize * 0.5f, root.y + height + headSize * 0.5f, root.z};
-		ctx->positions[ctx->vertexCount + 2] = (vec3){root.x - headSize * 0.2f, root.y + height - headSize * 0.5f, root.z};
-		ctx->positions[ctx->vertexCount + 3] = (vec3){root.x + headSize * 0.2f, root.y + height - headSize * 0.5f, root.z};
+	chunk->resident		= false;
+	chunk->dirty		= false;
+	chunk->uploadFailed	= false;
+}
 
-		uint8_t r = rand() & 0xffu;
-		uint8_t g = rand() & 0xffu;
-		uint8_t b = rand() & 0xffu;
+// Evicts every resident chunk and frees the chunk list, but leaves the polygons alone.
+static void world_reset_chunks(world_t* world)
+{
+	world_frame_t* frame = &world->frames[world->lastFrameIndex];
+	for (uint i = 0; i < world->residentChunkCount; ++i)
+	{
+		world_evict_chunk(world, frame, &world->chunks[world->residentChunks[i]]);
+	}
+	world->residentChunkCount	= 0;
+	world->drawCount			= 0;
+
+	free(world->chunks);
+	free(world->chunkPolygons);
+	free(world->chunkBoundsMin);
+	free(world->chunkBoundsMax);
+	free(world->editPolygons);
+	world->chunks			= NULL;
+	world->chunkPolygons	= NULL;
+	world->chunkBoundsMin	= NULL;
+	world->chunkBoundsMax	= NULL;
+	world->editPolygons		= NULL;
+	world->chunkCount		= 0;
+
+	world->streamDirty		= true;
+	world->collidersDirty	= true;
+}
+
+// Buckets every polygon into its chunk. The polygons stay in memory for good, as there's no file to read
+// them back from.
+static bool world_build_chunks(world_t* world)
+{
+	world_reset_chunks(world);
+
+	world->editPolygons = malloc(world->polygonCount * sizeof(editor_polygon_t*));
+	chunk_sort_key_t* keys = malloc(world->polygonCount * sizeof(chunk_sort_key_t));
+	world->chunkPolygons = malloc(world->polygonCount * sizeof(uint));
+	if ((world->editPolygons == NULL || keys == NULL || world->chunkPolygons == NULL) && world->polygonCount > 0)
+	{
+		free(keys);
+		return false;
+	}
+
+	for (uint i = 0; i < world->polygonCount; ++i)
+	{
+		vec2 boundsMin, boundsMax;
+		editor_polygon_bounds(&boundsMin, &boundsMax, &world->polygons[i]);
+
+		keys[i] = (chunk_sort_key_t){
+			.layer		= world->polygons[i].layer,
+			.cell		= world_chunk_cell(vec2_scale(vec2_add(boundsMin, boundsMax), 0.5f)),
+			.polygon	= i,
+		};
+	}
+
+	qsort(keys, world->polygonCount, sizeof(chunk_sort_key_t), compare_chunk_sort_keys);
+
+	uint chunkCount = 0;
+	for (uint i = 0; i < world->polygonCount; ++i)
+	{
+		if (i == 0 || compare_chunk_sort_keys(&(chunk_sort_key_t){ keys[i - 1].layer, keys[i - 1].cell, 0 }, &(chunk_sort_key_t){ keys[i].layer, keys[i].cell, 0 }) != 0)
+		{
+			++chunkCount;
+		}
+	}
+
+	world->chunks			= calloc(chunkCount, sizeof(world_chunk_t));
+	world->chunkBoundsMin	= malloc(chunkCount * sizeof(vec2));
+	world->chunkBoundsMax	= malloc(chunkCount * sizeof(vec2));
+	if ((world->chunks == NULL || world->chunkBoundsMin == NULL || world->chunkBoundsMax == NULL) && chunkCount > 0)
+	{
+		free(keys);
+		return false;
+	}
+
+	for (uint i = 0; i < world->polygonCount; ++i)
+	{
+		const chunk_sort_key_t* key = &keys[i];
+
+		world_chunk_t* chunk = world->chunkCount > 0 ? &world->chunks[world->chunkCount - 1] : NULL;
+		if (chunk == NULL || chunk->layer != key->layer || chunk->cell.x != key->cell.x || chunk->cell.y != key->cell.y)
+		{
+			chunk = &world->chunks[world->chunkCount++];
+			chunk->layer		= key->layer;
+			chunk->cell			= key->cell;
+			chunk->firstPolygon	= i;
+			chunk->loaded		= true;
+			chunk->modified		= true;
+		}
+
+		world->chunkPolygons[i] = key->polygon;
+		world->polygons[key->polygon].chunk = world->chunkCount - 1;
+		++chunk->polygonCount;
+	}
+	assert(world->chunkCount == chunkCount);
 
-		uint32_t color = r | (g << 8) | (b << 16);
-		uint32_t darkColor = (r/2) | ((g/2) << 8) | ((b/2) << 16);
+	free(keys);
 
-		ctx->colors[ctx->vertexCount + 0] = 0xff000000 | color;
-		ctx->colors[ctx->vertexCount + 1] = 0xff000000 | color;
-		ctx->colors[ctx->vertexCount + 2] = 0xff000000 | darkColor;
-		ctx->colors[ctx->vertexCount + 3] = 0xff000000 | darkColor;
-		ctx->vertexCount += 4;
+	for (uint i = 0; i < world->chunkCount; ++i)
+	{
+		world_update_chunk_bounds(world, i);
 	}
+
+	return true;
 }
 
-static void grow_plant(primitive_context_t* ctx, vec3 root, vec2 tangent)
+// Takes the chunks straight from the file's chunk table. No polygon is read until its chunk streams in.
+static bool world_build_chunks_from_file(world_t* world)
 {
-	const int type = rand() % 2;
-	if (type == 0)
+	const FILEFORMAT_world_header_t* header = world->file.header;
+	const uint chunkCount = header->chunkCount;
+	const uint polygonCount = header->polygonCount;
+
+	world->polygons			= calloc(polygonCount, sizeof(editor_polygon_t));
+	world->editPolygons		= malloc(polygonCount * sizeof(editor_polygon_t*));
+	world->chunkPolygons	= malloc(polygonCount * sizeof(uint));
+	world->chunks			= calloc(chunkCount, sizeof(world_chunk_t));
+	world->chunkBoundsMin	= malloc(chunkCount * sizeof(vec2));
+	world->chunkBoundsMax	= malloc(chunkCount * sizeof(vec2));
+	if ((world->polygons == NULL || world->editPolygons == NULL || world->chunkPolygons == NULL) && polygonCount > 0)
 	{
-		grow_grass(ctx, root, tangent);
+		return false;
 	}
-	else if (type == 1)
+	if ((world->chunks == NULL || world->chunkBoundsMin == NULL || world->chunkBoundsMax == NULL) && chunkCount > 0)
 	{
-		grow_flower(ctx, root, tangent);
+		return false;
 	}
+
+	world->polygonCount	= polygonCount;
+	world->chunkCount	= chunkCount;
+
+	uint firstPolygon = 0;
+	for (uint i = 0; i < chunkCount; ++i)
+	{
+		const FILEFORMAT_world_chunk_t* entry = &world->file.chunks[i];
+
+		world->chunks[i] = (world_chunk_t){
+			.layer			= entry->layer,
+			.cell			= { entry->cellX, entry->cellY },
+			.firstPolygon	= firstPolygon,
+			.polygonCount	= entry->polygonCount,
+		};
+		world->chunkBoundsMin[i] = entry->boundsMin;
+		world->chunkBoundsMax[i] = entry->boundsMax;
+
+		for (uint j = 0; j < entry->polygonCount; ++j)
+		{
+			const uint polygonIndex = firstPolygon + j;
+			world->chunkPolygons[polygonIndex] = polygonIndex;
+			world->polygons[polygonIndex].layer = entry->layer;
+			world->polygons[polygonIndex].chunk = i;
+		}
+		firstPolygon += entry->polygonCount;
+	}
+
+	world->chunkGridDirty = true;
+	return true;
 }
 
-static void fill_primitive_data(primitive_context_t* ctx, const editor_polygon_t* polygon, int layerIndex)
+static bool world_load_chunk(world_t* world, uint chunkIndex)
 {
-	triangle_t triangles[256];
-	size_t triangleCount;
-	editor_polygon_triangulate(triangles, &triangleCount, polygon);
+	world_chunk_t* chunk = &world->chunks[chunkIndex];
 
-	const float depth = world_get_parallax_layer_depth(layerIndex);
+	world_file_polygon_t* filePolygons = malloc(chunk->polygonCount * sizeof(world_file_polygon_t));
+	if (filePolygons == NULL && chunk->polygonCount > 0)
+	{
+		return false;
+	}
+
+	if (world_file_read_chunk(filePolygons, &world->file, chunkIndex) != 0)
+	{
+		// the chunk stays out of the world, and is written back untouched on save
+		free(filePolygons);
+		chunk->loadFailed = true;
+		return false;
+	}
 
-	for (size_t i = 0; i < triangleCount; ++i)
+	for (uint i = 0; i < chunk->polygonCount; ++i)
 	{
-		const triangle_t* triangle = &triangles[i];
+		editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + i]];
+		const world_file_polygon_t* filePolygon = &filePolygons[i];
+
+		if (!editor_polygon_reserve(polygon, filePolygon->vertexCount))
+		{
+			for (uint j = 0; j < i; ++j)
+			{
+				editor_polygon_t* loadedPolygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + j]];
+				free(loadedPolygon->vertexPosition);
+				loadedPolygon->vertexPosition	= NULL;
+				loadedPolygon->vertexCount		= 0;
+				loadedPolygon->vertexCapacity	= 0;
+			}
+			free(filePolygons);
+			return false;
+		}
 
-		ctx->indices[ctx->indexCount + 0] = triangle->i[0] + ctx->vertexCount;
-		ctx->indices[ctx->indexCount + 1] = triangle->i[1] + ctx->vertexCount;
-		ctx->indices[ctx->indexCount + 2] = triangle->i[2] + ctx->vertexCount;
-		ctx->indexCount += 3;
+		memcpy(polygon->vertexPosition, filePolygon->positions, filePolygon->vertexCount * sizeof(vec2));
+		polygon->vertexCount = filePolygon->vertexCount;
 	}
 
-	for (size_t i = 0; i < polygon->vertexCount; ++i)
+	free(filePolygons);
+	chunk->loaded = true;
+	return true;
+}
+
+static float world_stream_radius(uint layer)
+{
+	const float distance = CAMERA_OFFSET - world_get_parallax_layer_depth(layer);
+	return WORLD_STREAM_RADIUS + distance * WORLD_STREAM_VIEW_SCALE;
+}
+
+static bool world_chunk_in_range(const world_t* world, uint chunkIndex, float radius)
+{
+	const vec2 boundsMin = world->chunkBoundsMin[chunkIndex];
+	const vec2 boundsMax = world->chunkBoundsMax[chunkIndex];
+	return
+		boundsMax.x >= world->focus.x - radius && boundsMin.x <= world->focus.x + radius &&
+		boundsMax.y >= world->focus.y - radius && boundsMin.y <= world->focus.y + radius;
+}
+
+// Evicts resident chunks that drifted out of range and makes the chunks now in range resident. Only looks at
+// chunks near the focus, so the cost doesn't grow with the size of the level.
+static void world_stream(world_t* world, world_frame_t* frame)
+{
+	if (world->chunkGridDirty)
 	{
-		const vec2 p = polygon->vertexPosition[i];
-		ctx->positions[ctx->vertexCount + i] = (vec3){ p.x, p.y, depth };
-		ctx->colors[ctx->vertexCount + i] = 0x00222f;
+		if (collision_grid_build(&world->chunkGrid, world->chunkBoundsMin, world->chunkBoundsMax, world->chunkCount, WORLD_CHUNK_SIZE) != 0)
+		{
+			fprintf(stderr, "Failed to build world chunk grid\n");
+			return;
+		}
+		world->chunkGridDirty	= false;
+		world->streamDirty		= true;
 	}
 
-	ctx->vertexCount += polygon->vertexCount;
+	if (!world->streamDirty && vec2_distance(world->focus, world->streamFocus) < WORLD_CHUNK_SIZE * 0.25f)
+	{
+		return;
+	}
 
-	for (uint i = 0; i < polygon->vertexCount; ++i)
+	PROFILER_BEGIN(world_stream);
+
+	world->streamFocus	= world->focus;
+	world->streamDirty	= false;
+
+	for (uint i = 0; i < world->residentChunkCount;)
 	{
-		const uint j = (i + 1) % polygon->vertexCount;
+		const uint chunkIndex = world->residentChunks[i];
+		world_chunk_t* chunk = &world->chunks[chunkIndex];
+
+		if (world_chunk_in_range(world, chunkIndex, world_stream_radius(chunk->layer) * WORLD_STREAM_EVICT_SCALE))
+		{
+			++i;
+			continue;
+		}
 
-		const vec2 p0 = polygon->vertexPosition[i];
-		const vec2 p1 = polygon->vertexPosition[j];
+		world_evict_chunk(world, frame, chunk);
+		world->residentChunks[i] = world->residentChunks[--world->residentChunkCount];
+	}
 
-		const vec2 d = vec2_normalize(vec2_sub(p1, p0));
-		const vec2 n = {-d.y, d.x};
-		
-		if (n.y <= 0.0f)
+	const float queryRadius = world_stream_radius(PARALLAX_LAYER_COUNT - 1);
+	const vec2 queryMin = vec2_sub(world->focus, (vec2){ queryRadius, queryRadius });
+	const vec2 queryMax = vec2_add(world->focus, (vec2){ queryRadius, queryRadius });
+
+	uint candidateCount = collision_grid_query(&world->chunkGrid, world->chunkQuery, world->chunkQueryCapacity, queryMin, queryMax);
+	if (candidateCount > world->chunkQueryCapacity)
+	{
+		uint* chunkQuery = realloc(world->chunkQuery, candidateCount * sizeof(uint));
+		if (chunkQuery == NULL)
+		{
+			PROFILER_END();
+			return;
+		}
+		world->chunkQuery			= chunkQuery;
+		world->chunkQueryCapacity	= candidateCount;
+		candidateCount = collision_grid_query(&world->chunkGrid, world->chunkQuery, world->chunkQueryCapacity, queryMin, queryMax);
+	}
+
+	for (uint i = 0; i < candidateCount; ++i)
+	{
+		const uint chunkIndex = world->chunkQuery[i];
+		world_chunk_t* chunk = &world->chunks[chunkIndex];
+
+		if (chunk->resident || chunk->loadFailed || !world_chunk_in_range(world, chunkIndex, world_stream_radius(chunk->layer)))
 		{
 			continue;
 		}
 
-		const float len = vec2_length(vec2_sub(p1, p0));
-		const float plantDensity = 40.0f;
+		if (world->residentChunkCount == WORLD_MAX_RESIDENT_CHUNKS)
+		{
+			// picked up again once the focus moves and something gets evicted
+			world->streamDirty = true;
+			break;
+		}
 
-		const int plantCount = len * plantDensity;
-		
-		for (int i = 0; i < plantCount; ++i)
+		if (!chunk->loaded && !world_load_chunk(world, chunkIndex))
+		{
+			continue;
+		}
+
+		chunk->resident	= true;
+		chunk->dirty	= true;
+		world->residentChunks[world->residentChunkCount++] = chunkIndex;
+
+		if (chunk->layer == 0)
+		{
+			world->collidersDirty = true;
+		}
+	}
+
+	PROFILER_END();
+}
+
+static void fill_chunk_data(uint32_t* indices, uint32_t* positions, uint32_t* colors, const world_t* world, const world_chunk_t* chunk)
+{
+	uint32_t baseVertex = 0;
+
+	for (uint polygonIndex = 0; polygonIndex < chunk->polygonCount; ++polygonIndex)
+	{
+		editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + polygonIndex]];
+
+		size_t triangleCount;
+		const triangle_t* triangles = editor_polygon_get_triangles(polygon, &triangleCount);
+
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			const triangle_t* triangle = &triangles[i];
+
+			indices[i * 3 + 0] = baseVertex + triangle->i[0];
+			indices[i * 3 + 1] = baseVertex + triangle->i[1];
+			indices[i * 3 + 2] = baseVertex + triangle->i[2];
+		}
+
+		for (size_t i = 0; i < polygon->vertexCount; ++i)
 		{
-			const float t = (rand() / (float)RAND_MAX);
-			const vec2 p = vec2_lerp(p0, p1, t);
-			grow_plant(ctx, (vec3){p.x, p.y, depth}, d);
+			positions[baseVertex + i] = world_quantize_position(&chunk->quantization, polygon->vertexPosition[i]);
+			colors[baseVertex + i] = 0x00222f;
 		}
+
+		indices		+= triangleCount * 3;
+		baseVertex	+= polygon->vertexCount;
+	}
+}
+
+static bool world_reserve_foliage_jobs(world_t* world, uint count)
+{
+	if (count <= world->foliageJobCapacity)
+	{
+		return true;
+	}
+
+	uint capacity = world->foliageJobCapacity > 0 ? world->foliageJobCapacity : 256;
+	while (capacity < count)
+	{
+		capacity *= 2;
 	}
+
+	foliage_job_t* jobs = realloc(world->foliageJobs, capacity * sizeof(foliage_job_t));
+	if (jobs == NULL)
+	{
+		return false;
+	}
+
+	world->foliageJobs			= jobs;
+	world->foliageJobCapacity	= capacity;
+	return true;
 }
 
 void world_tick(world_t* world)
@@ -313,7 +834,13 @@ void world_tick(world_t* world)
 	{
 		world->pollenTimer -= 20.0f;
 
-		const editor_polygon_t* polygon = &world->layers[0].polygon;
+		if (world->colliders.polygonCount == 0)
+		{
+			return;
+		}
+
+		const uint polygonIndex = world->colliders.polygons[lcg_rand(&world->rng) % world->colliders.polygonCount];
+		const editor_polygon_t* polygon = &world->polygons[polygonIndex];
 
 		const uint vertexIndex = lcg_rand(&world->rng) % polygon->vertexCount;
 
@@ -334,104 +861,196 @@ void world_tick(world_t* world)
 	}
 }
 
-void world_update(world_t* world, VkCommandBuffer cb, const render_context_t* rc)
+static bool world_reserve_colliders(world_colliders_t* colliders, uint32_t count)
 {
+	if (count <= colliders->triangleCapacity)
 	{
-		editor_polygon_t* polygon = &world->layers[0].polygon;
-		world_colliders_t* colliders = &world->colliders;
+		return true;
+	}
 
-		triangle_t triangles[256];
-		size_t triangleCount;
-		editor_polygon_triangulate(triangles, &triangleCount, polygon);
-		
-		for (size_t i = 0; i < triangleCount; ++i)
-		{
-			const uint i0 = triangles[i].i[0];
-			const uint i1 = triangles[i].i[1];
-			const uint i2 = triangles[i].i[2];
-			
-			const vec2 p0 = polygon->vertexPosition[i0];
-			const vec2 p1 = polygon->vertexPosition[i1];
-			const vec2 p2 = polygon->vertexPosition[i2];
+	uint32_t capacity = colliders->triangleCapacity > 0 ? colliders->triangleCapacity : 256;
+	while (capacity < count)
+	{
+		capacity *= 2;
+	}
+
+	triangle_collider_t* triangles = realloc(colliders->triangles, capacity * sizeof(triangle_collider_t));
+	if (triangles == NULL) return false;
+	colliders->triangles = triangles;
+
+	collision_triangle_t* shapes = realloc(colliders->shapes, capacity * sizeof(collision_triangle_t));
+	if (shapes == NULL) return false;
+	colliders->shapes = shapes;
+
+	vec2* boundsMin = realloc(colliders->boundsMin, capacity * sizeof(vec2));
+	if (boundsMin == NULL) return false;
+	colliders->boundsMin = boundsMin;
+
+	vec2* boundsMax = realloc(colliders->boundsMax, capacity * sizeof(vec2));
+	if (boundsMax == NULL) return false;
+	colliders->boundsMax = boundsMax;
+
+	colliders->triangleCapacity = capacity;
+	return true;
+}
+
+static bool world_reserve_collider_polygons(world_colliders_t* colliders, uint count)
+{
+	if (count <= colliders->polygonCapacity)
+	{
+		return true;
+	}
+
+	uint* polygons = realloc(colliders->polygons, count * sizeof(uint));
+	if (polygons == NULL) return false;
+	colliders->polygons = polygons;
 
-			colliders->triangles[i] = (triangle_collider_t){ p0, p1, p2 };
+	colliders->polygonCapacity = count;
+	return true;
+}
+
+// Only the resident chunks of layer 0 collide.
+static void world_update_colliders(world_t* world)
+{
+	world_colliders_t* colliders = &world->colliders;
+
+	colliders->triangleCount	= 0;
+	colliders->polygonCount		= 0;
+
+	uint polygonCount = 0;
+	size_t triangleCount = 0;
+	for (uint i = 0; i < world->residentChunkCount; ++i)
+	{
+		const world_chunk_t* chunk = &world->chunks[world->residentChunks[i]];
+		if (chunk->layer != 0)
+		{
+			continue;
 		}
 
-		colliders->triangleCount = triangleCount;
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + j]];
+
+			size_t polygonTriangleCount;
+			editor_polygon_get_triangles(polygon, &polygonTriangleCount);
+			triangleCount += polygonTriangleCount;
+		}
+		polygonCount += chunk->polygonCount;
 	}
 
-	switch (world->state)
+	if (!world_reserve_colliders(colliders, triangleCount) || !world_reserve_collider_polygons(colliders, polygonCount))
 	{
-		case WORLD_STATE_UPLOAD_TRIANGLES:
+		fprintf(stderr, "Failed to allocate world colliders\n");
+		return;
+	}
+	
+	for (uint i = 0; i < world->residentChunkCount; ++i)
+	{
+		const world_chunk_t* chunk = &world->chunks[world->residentChunks[i]];
+		if (chunk->layer != 0)
 		{
-			if (world->stagingCounter++ < FRAME_COUNT)
+			continue;
+		}
+
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			const uint polygonIndex = world->chunkPolygons[chunk->firstPolygon + j];
+			editor_polygon_t* polygon = &world->polygons[polygonIndex];
+			colliders->polygons[colliders->polygonCount++] = polygonIndex;
+
+			size_t polygonTriangleCount;
+			const triangle_t* triangles = editor_polygon_get_triangles(polygon, &polygonTriangleCount);
+
+			for (size_t k = 0; k < polygonTriangleCount; ++k)
 			{
-				break;
+				const uint i0 = triangles[k].i[0];
+				const uint i1 = triangles[k].i[1];
+				const uint i2 = triangles[k].i[2];
+				
+				const vec2 p0 = polygon->vertexPosition[i0];
+				const vec2 p1 = polygon->vertexPosition[i1];
+				const vec2 p2 = polygon->vertexPosition[i2];
+
+				const uint32_t t = colliders->triangleCount++;
+				colliders->triangles[t] = (triangle_collider_t){ p0, p1, p2 };
+				collision_triangle_build(&colliders->shapes[t], p0, p1, p2);
+				colliders->boundsMin[t] = colliders->shapes[t].boundsMin;
+				colliders->boundsMax[t] = colliders->shapes[t].boundsMax;
 			}
-			world->stagingCounter = 0;
+		}
+	}
 
-			uint32_t* stagingIndices = (uint32_t*)world->stagingBufferMemory;
-			vec3* stagingPositions = (vec3*)((uint8_t*)world->stagingBufferMemory + WORLD_INDEX_BUFFER_SIZE);
-			uint32_t* stagingColors = (uint32_t*)((uint8_t*)world->stagingBufferMemory + WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE);
+	if (collision_grid_build(&colliders->grid, colliders->boundsMin, colliders->boundsMax, colliders->triangleCount, WORLD_COLLIDER_GRID_CELL_SIZE) != 0)
+	{
+		fprintf(stderr, "Failed to build world collider grid\n");
+		colliders->triangleCount = 0;
+	}
+}
 
-			srand(1337);
+static void world_update_colliders_if_dirty(world_t* world)
+{
+	if (world->collidersDirty)
+	{
+		world_update_colliders(world);
+		world->collidersDirty = false;
+	}
+}
 
-			primitive_context_t ctx = {
-				.indices = stagingIndices,
-				.positions = stagingPositions,
-				.colors = stagingColors,
-			};
+static void world_upload_chunks(world_t* world, world_frame_t* frame, VkCommandBuffer cb, const render_context_t* rc);
 
-			for (int i = 0; i < PARALLAX_LAYER_COUNT; ++i)
-			{
-				if (world->visibleLayerMask & (1u << i))
-				{
-					PROFILER_BEGIN(fill_primitive_data);
-					fill_primitive_data(&ctx, &world->layers[i].polygon, i);
-					PROFILER_END();
-				}
-			}
+void world_update(world_t* world, VkCommandBuffer cb, const render_context_t* rc)
+{
+	world_frame_t* frame = &world->frames[rc->frameIndex];
+	world->lastFrameIndex = rc->frameIndex;
 
-			//printf("World triangles: %u, vertices: %u\n", ctx.indexCount / 3u, ctx.vertexCount);
+	// the GPU is done with this frame, so nothing can be drawing from its retired ranges anymore
+	for (uint i = 0; i < frame->retiredCount; ++i)
+	{
+		offset_allocator_free(&world->indexAllocator, frame->retiredIndexAllocations[i]);
+		offset_allocator_free(&world->vertexAllocator, frame->retiredVertexAllocations[i]);
+	}
+	for (uint i = 0; i < frame->retiredFoliageCount; ++i)
+	{
+		offset_allocator_free(&world->foliageAllocator, frame->retiredFoliageAllocations[i]);
+	}
+	frame->retiredCount = 0;
+	frame->retiredFoliageCount = 0;
 
-			world->indexCount = ctx.indexCount;
-			
-			PushStagingMemoryFlush(rc->stagingMemory, world->stagingBufferMemory, WORLD_STAGING_BUFFER_SIZE);
-			
-			PROFILER_BEGIN(staging_copy);
+	world_stream(world, frame);
+	world_update_colliders_if_dirty(world);
 
+	world_upload_chunks(world, frame, cb, rc);
+
+	// drawn front to back, one layer at a time
+	world->drawCount = 0;
+	for (uint layer = 0; layer < PARALLAX_LAYER_COUNT; ++layer)
+	{
+		for (uint i = 0; i < world->residentChunkCount; ++i)
+		{
+			const world_chunk_t* chunk = &world->chunks[world->residentChunks[i]];
+			if (chunk->layer != layer || !chunk->hasMesh)
 			{
-				const VkBufferCopy copyRegion = {
-					.size = WORLD_INDEX_BUFFER_SIZE,
-				};
-				vkCmdCopyBuffer(cb, world->stagingBuffer, world->indexBuffer, 1, &copyRegion);
-			}
-			{
-				const VkBufferCopy copyRegion = {
-					.size = WORLD_POSITION_BUFFER_SIZE,
-					.srcOffset = WORLD_INDEX_BUFFER_SIZE,
-				};
-				vkCmdCopyBuffer(cb, world->stagingBuffer, world->vertexPositionBuffer, 1, &copyRegion);
-			}
-			{
-				const VkBufferCopy copyRegion = {
-					.size = WORLD_COLOR_BUFFER_SIZE,
-					.srcOffset = WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE,
-				};
-				vkCmdCopyBuffer(cb, world->stagingBuffer, world->vertexColorBuffer, 1, &copyRegion);
+				continue;
 			}
 
-			PROFILER_END();
-
-			//world->state = WORLD_STATE_DONE;
-			break;
-		}
-		
-		case WORLD_STATE_DONE:
-		{
-			break;
+			const uint drawIndex = world->drawCount++;
+			frame->chunkBufferMemory[drawIndex] = chunk->quantization;
+			world->draws[drawIndex] = (world_draw_t){
+				.indexCount		= chunk->indexCount,
+				.firstIndex		= chunk->indexAllocation.offset,
+				.vertexOffset	= chunk->vertexAllocation.offset,
+				.layer			= chunk->layer,
+				.chunk			= drawIndex,
+				.instanceCount	= chunk->foliageInstanceCount,
+				.firstInstance	= chunk->foliageAllocation.offset,
+			};
 		}
 	}
+
+	if (world->drawCount > 0)
+	{
+		PushStagingMemoryFlush(rc->stagingMemory, frame->chunkBufferMemory, world->drawCount * sizeof(gpu_world_chunk_t));
+	}
 	
 #if 0
 	for (size_t i = 0; i < world->colliders.triangleCount; ++i)
@@ -439,68 +1058,443 @@ void world_update(world_t* world, VkCommandBuffer cb, const render_context_t* rc
 		triangle_collider_debug_draw(&world->colliders.triangles[i]);
 	}
 #endif
+}
 
-#if 0
-	editor_polygon_debug_draw(&world->polygon);
-#endif
+void world_update_headless(world_t* world)
+{
+	assert(world->vulkan == NULL);
+
+	// nothing is ever meshed, so evicting chunks doesn't retire anything into the frame
+	world_stream(world, &world->frames[0]);
+	world_update_colliders_if_dirty(world);
+}
+
+// One flush over the staging bytes the regions are copied from. Per chunk flushes would start wherever the chunk's
+// allocation does, so the start is rounded down to the flush alignment PushStagingMemoryFlush rounds the size up
+// to. The sub-buffers of the staging buffer all start on it, so the range never leaves the staging buffer.
+static void world_flush_staging_regions(const render_context_t* rc, void* stagingMemory, const VkBufferCopy* regions, uint32_t regionCount)
+{
+	if (regionCount == 0)
+	{
+		return;
+	}
+
+	VkDeviceSize begin = regions[0].srcOffset;
+	VkDeviceSize end = regions[0].srcOffset + regions[0].size;
+	for (uint32_t i = 1; i < regionCount; ++i)
+	{
+		begin	= regions[i].srcOffset < begin ? regions[i].srcOffset : begin;
+		end		= regions[i].srcOffset + regions[i].size > end ? regions[i].srcOffset + regions[i].size : end;
+	}
+	begin &= ~(VkDeviceSize)0x3f;
+
+	PushStagingMemoryFlush(rc->stagingMemory, (uint8_t*)stagingMemory + begin, end - begin);
 }
 
-int world_serialize(world_t* world, FILE* f)
+static void world_upload_chunks(world_t* world, world_frame_t* frame, VkCommandBuffer cb, const render_context_t* rc)
 {
-	int r;
+	// the staging buffer is shared between frames, so wait until the previous copy out of it has retired
+	if (world->framesSinceUpload < FRAME_COUNT)
+	{
+		++world->framesSinceUpload;
+		return;
+	}
+
+	// a bounded number of chunks per upload, so streaming in a new area is spread over a few frames
+	uint uploadChunks[WORLD_MAX_CHUNK_UPLOADS];
+	uint uploadCount = 0;
+	uint maxJobCount = 0;
+	for (uint i = 0; i < world->residentChunkCount && uploadCount < WORLD_MAX_CHUNK_UPLOADS; ++i)
+	{
+		const uint chunkIndex = world->residentChunks[i];
+		const world_chunk_t* chunk = &world->chunks[chunkIndex];
+		if (!chunk->dirty || chunk->uploadFailed)
+		{
+			continue;
+		}
+
+		uploadChunks[uploadCount++] = chunkIndex;
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			maxJobCount += world->polygons[world->chunkPolygons[chunk->firstPolygon + j]].vertexCount;
+		}
+	}
 
-	uint polygonCount = PARALLAX_LAYER_COUNT;
-	r = fwrite(&polygonCount, sizeof(uint), 1, f);
-	assert(r == 1);
+	if (uploadCount == 0)
+	{
+		return;
+	}
 	
-	for (int i = 0; i < PARALLAX_LAYER_COUNT; ++i)
+	world->framesSinceUpload = 0;
+
+	uint32_t* stagingIndices = (uint32_t*)world->stagingBufferMemory;
+	uint32_t* stagingPositions = (uint32_t*)((uint8_t*)world->stagingBufferMemory + WORLD_INDEX_BUFFER_SIZE);
+	uint32_t* stagingColors = (uint32_t*)((uint8_t*)world->stagingBufferMemory + WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE);
+	gpu_foliage_instance_t* stagingFoliage = (gpu_foliage_instance_t*)((uint8_t*)world->stagingBufferMemory + WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE + WORLD_COLOR_BUFFER_SIZE);
+
+	if (!world_reserve_foliage_jobs(world, maxJobCount))
 	{
-		const editor_polygon_t* polygon = &world->layers[i].polygon;
-		r = fwrite(&polygon->vertexCount, sizeof(uint), 1, f);
-		assert(r == 1);
-		r = fwrite(polygon->vertexPosition, sizeof(vec2), polygon->vertexCount, f);
-		assert(r == polygon->vertexCount);
+		fprintf(stderr, "Failed to allocate foliage jobs\n");
+		return;
 	}
 
-	return 0;
+	VkBufferCopy indexCopyRegions[WORLD_MAX_CHUNK_UPLOADS];
+	VkBufferCopy positionCopyRegions[WORLD_MAX_CHUNK_UPLOADS];
+	VkBufferCopy colorCopyRegions[WORLD_MAX_CHUNK_UPLOADS];
+	VkBufferCopy foliageCopyRegions[WORLD_MAX_CHUNK_UPLOADS];
+	uint32_t copyCount = 0;
+	uint32_t foliageCopyCount = 0;
+
+	// foliage is generated per edge across all uploaded chunks at once, so a single big chunk still spreads
+	// over the whole pool
+	foliage_job_t* jobs = world->foliageJobs;
+	uint jobCount = 0;
+
+	for (uint uploadIndex = 0; uploadIndex < uploadCount; ++uploadIndex)
+	{
+		const uint chunkIndex = uploadChunks[uploadIndex];
+		world_chunk_t* chunk = &world->chunks[chunkIndex];
+		world_retire_chunk_mesh(frame, chunk);
+		chunk->dirty = false;
+
+		uint32_t indexCount = 0;
+		uint32_t vertexCount = 0;
+		for (uint i = 0; i < chunk->polygonCount; ++i)
+		{
+			editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + i]];
+
+			size_t triangleCount;
+			editor_polygon_get_triangles(polygon, &triangleCount);
+
+			indexCount	+= triangleCount * 3;
+			vertexCount	+= polygon->vertexCount;
+		}
+
+		if (indexCount == 0)
+		{
+			continue;
+		}
+
+		if (!offset_allocator_alloc(&chunk->indexAllocation, &world->indexAllocator, indexCount))
+		{
+			fprintf(stderr, "Out of world index memory (layer %u, chunk %d,%d)\n", chunk->layer, chunk->cell.x, chunk->cell.y);
+			chunk->uploadFailed = true;
+			continue;
+		}
+		if (!offset_allocator_alloc(&chunk->vertexAllocation, &world->vertexAllocator, vertexCount))
+		{
+			fprintf(stderr, "Out of world vertex memory (layer %u, chunk %d,%d)\n", chunk->layer, chunk->cell.x, chunk->cell.y);
+			offset_allocator_free(&world->indexAllocator, chunk->indexAllocation);
+			chunk->uploadFailed = true;
+			continue;
+		}
+
+		chunk->hasMesh		= true;
+		chunk->indexCount	= indexCount;
+		chunk->vertexCount	= vertexCount;
+		chunk->quantization	= world_chunk_quantization(world->chunkBoundsMin[chunkIndex], world->chunkBoundsMax[chunkIndex], chunk->layer);
+
+		const uint32_t firstIndex	= chunk->indexAllocation.offset;
+		const uint32_t firstVertex	= chunk->vertexAllocation.offset;
+
+		// written straight into the chunk's sub-allocation of the staging buffer
+		fill_chunk_data(
+			stagingIndices + firstIndex,
+			stagingPositions + firstVertex,
+			stagingColors + firstVertex,
+			world,
+			chunk);
+
+		indexCopyRegions[copyCount] = (VkBufferCopy){
+			.srcOffset = firstIndex * sizeof(uint32_t),
+			.dstOffset = firstIndex * sizeof(uint32_t),
+			.size = indexCount * sizeof(uint32_t),
+		};
+		positionCopyRegions[copyCount] = (VkBufferCopy){
+			.srcOffset = WORLD_INDEX_BUFFER_SIZE + firstVertex * sizeof(uint32_t),
+			.dstOffset = firstVertex * sizeof(uint32_t),
+			.size = vertexCount * sizeof(uint32_t),
+		};
+		colorCopyRegions[copyCount] = (VkBufferCopy){
+			.srcOffset = WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE + firstVertex * sizeof(uint32_t),
+			.dstOffset = firstVertex * sizeof(uint32_t),
+			.size = vertexCount * sizeof(uint32_t),
+		};
+		++copyCount;
+
+		uint chunkJobCount = 0;
+		for (uint i = 0; i < chunk->polygonCount; ++i)
+		{
+			const editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + i]];
+			chunkJobCount += foliage_add_polygon_jobs(jobs + jobCount + chunkJobCount, polygon, chunk->layer);
+		}
+
+		const uint32_t foliageInstanceCount = foliage_count_instances(jobs + jobCount, chunkJobCount);
+
+		if (foliageInstanceCount == 0)
+		{
+			continue;
+		}
+
+		if (!offset_allocator_alloc(&chunk->foliageAllocation, &world->foliageAllocator, foliageInstanceCount))
+		{
+			fprintf(stderr, "Out of world foliage memory (layer %u, chunk %d,%d)\n", chunk->layer, chunk->cell.x, chunk->cell.y);
+			continue;
+		}
+
+		chunk->foliageInstanceCount = foliageInstanceCount;
+
+		const uint32_t firstInstance = chunk->foliageAllocation.offset;
+		foliage_prefix_sum(jobs + jobCount, chunkJobCount, firstInstance);
+		jobCount += chunkJobCount;
+
+		foliageCopyRegions[foliageCopyCount] = (VkBufferCopy){
+			.srcOffset = WORLD_INDEX_BUFFER_SIZE + WORLD_POSITION_BUFFER_SIZE + WORLD_COLOR_BUFFER_SIZE + firstInstance * sizeof(gpu_foliage_instance_t),
+			.dstOffset = firstInstance * sizeof(gpu_foliage_instance_t),
+			.size = foliageInstanceCount * sizeof(gpu_foliage_instance_t),
+		};
+		++foliageCopyCount;
+	}
+
+	PROFILER_BEGIN(foliage_generate);
+	foliage_generate(world->jobPool, jobs, jobCount, stagingFoliage);
+	PROFILER_END();
+
+	//printf("World chunks uploaded: %u\n", copyCount);
+
+	world_flush_staging_regions(rc, world->stagingBufferMemory, indexCopyRegions, copyCount);
+	world_flush_staging_regions(rc, world->stagingBufferMemory, positionCopyRegions, copyCount);
+	world_flush_staging_regions(rc, world->stagingBufferMemory, colorCopyRegions, copyCount);
+	world_flush_staging_regions(rc, world->stagingBufferMemory, foliageCopyRegions, foliageCopyCount);
+
+	if (copyCount > 0)
+	{
+		PROFILER_BEGIN(staging_copy);
+		vkCmdCopyBuffer(cb, world->stagingBuffer, world->indexBuffer, copyCount, indexCopyRegions);
+		vkCmdCopyBuffer(cb, world->stagingBuffer, world->vertexPositionBuffer, copyCount, positionCopyRegions);
+		vkCmdCopyBuffer(cb, world->stagingBuffer, world->vertexColorBuffer, copyCount, colorCopyRegions);
+		PROFILER_END();
+	}
+
+	if (foliageCopyCount > 0)
+	{
+		vkCmdCopyBuffer(cb, world->stagingBuffer, world->foliageBuffer, foliageCopyCount, foliageCopyRegions);
+	}
 }
 
-int world_deserialize(world_t* world, FILE* f)
+// Copies out everything that can still change. Chunks that aren't loaded are left to the save thread to
+// copy from world->file, which is why world_load and world_destroy wait for the save to finish.
+static bool world_snapshot(world_file_snapshot_t* snapshot, const world_t* world)
 {
-	int r;
+	uint polygonCount = 0;
+	size_t vertexCount = 0;
+	for (uint i = 0; i < world->chunkCount; ++i)
+	{
+		const world_chunk_t* chunk = &world->chunks[i];
+		if (!chunk->loaded)
+		{
+			continue;
+		}
+
+		polygonCount += chunk->polygonCount;
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			vertexCount += world->polygons[world->chunkPolygons[chunk->firstPolygon + j]].vertexCount;
+		}
+	}
+
+	if (!world_file_snapshot_alloc(snapshot, world->chunkCount, polygonCount, vertexCount))
+	{
+		return false;
+	}
+
+	snapshot->source = &world->file;
+
+	uint polygonIndex = 0;
+	vec2* positions = snapshot->positions;
+	for (uint i = 0; i < world->chunkCount; ++i)
+	{
+		const world_chunk_t* chunk = &world->chunks[i];
+
+		snapshot->chunks[i] = (world_file_snapshot_chunk_t){
+			.layer			= chunk->layer,
+			.cell			= chunk->cell,
+			.boundsMin		= world->chunkBoundsMin[i],
+			.boundsMax		= world->chunkBoundsMax[i],
+			.fromSource		= !chunk->loaded,
+			.sourceChunk	= i,
+			.firstPolygon	= polygonIndex,
+			.polygonCount	= chunk->loaded ? chunk->polygonCount : 0,
+		};
+
+		if (!chunk->loaded)
+		{
+			continue;
+		}
+
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			const editor_polygon_t* polygon = &world->polygons[world->chunkPolygons[chunk->firstPolygon + j]];
+			snapshot->polygonVertexCounts[polygonIndex++] = polygon->vertexCount;
+			memcpy(positions, polygon->vertexPosition, polygon->vertexCount * sizeof(vec2));
+			positions += polygon->vertexCount;
+		}
+	}
+
+	return true;
+}
+
+int world_save_async(world_t* world, const char* path)
+{
+	if (world->save.running)
+	{
+		return 1;
+	}
+
+	PROFILER_BEGIN(world_snapshot);
+	world_file_snapshot_t snapshot;
+	const bool r = world_snapshot(&snapshot, world);
+	PROFILER_END();
+
+	if (!r)
+	{
+		return 1;
+	}
+
+	return world_file_save_start(&world->save, &snapshot, path);
+}
+
+bool world_poll_save(world_t* world, int* result)
+{
+	return world_file_save_poll(&world->save, result);
+}
+
+int world_save(world_t* world, const char* path)
+{
+	world_file_save_wait(&world->save);
+	if (world_save_async(world, path) != 0)
+	{
+		return 1;
+	}
+	return world_file_save_wait(&world->save);
+}
 
+static void free_polygon_array(editor_polygon_t* polygons, uint polygonCount)
+{
+	for (uint i = 0; i < polygonCount; ++i)
+	{
+		free(polygons[i].vertexPosition);
+	}
+	free(polygons);
+}
+
+// The format from before world_file: a polygon count, then a vertex count and positions for every polygon.
+// It has one polygon per layer, in layer order.
+static int world_load_legacy(world_t* world, FILE* f)
+{
 	uint polygonCount;
-	r = fread(&polygonCount, sizeof(uint), 1, f);
-	assert(r == 1);
-	assert(polygonCount <= PARALLAX_LAYER_COUNT);
-	
-	for (int i = 0; i < polygonCount; ++i)
+	if (fread(&polygonCount, sizeof(uint), 1, f) != 1 || polygonCount > PARALLAX_LAYER_COUNT)
+	{
+		fprintf(stderr, "World file is corrupt.\n");
+		return 1;
+	}
+
+	editor_polygon_t* polygons = calloc(polygonCount, sizeof(editor_polygon_t));
+	if (polygons == NULL && polygonCount > 0)
 	{
-		editor_polygon_t* polygon = &world->layers[i].polygon;
-		r = fread(&polygon->vertexCount, sizeof(uint), 1, f);
-		assert(r == 1);
-		r = fread(polygon->vertexPosition, sizeof(vec2), polygon->vertexCount, f);
-		assert(r == polygon->vertexCount);
+		return 1;
+	}
 
+	for (uint i = 0; i < polygonCount; ++i)
+	{
+		editor_polygon_t* polygon = &polygons[i];
 		polygon->layer = i;
+
+		uint vertexCount;
+		const bool valid =
+			fread(&vertexCount, sizeof(uint), 1, f) == 1 &&
+			vertexCount >= 3 &&
+			editor_polygon_reserve(polygon, vertexCount) &&
+			fread(polygon->vertexPosition, sizeof(vec2), vertexCount, f) == vertexCount;
+
+		if (!valid)
+		{
+			fprintf(stderr, "World file is corrupt.\n");
+			free_polygon_array(polygons, polygonCount);
+			return 1;
+		}
+
+		polygon->vertexCount = vertexCount;
 	}
 
-	return 0;
+	world_reset_chunks(world);
+	world_free_polygons(world);
+	world_file_close(&world->file);
+
+	world->polygons		= polygons;
+	world->polygonCount	= polygonCount;
+
+	return world_build_chunks(world) ? 0 : 1;
 }
 
-bool world_get_render_info(world_render_info_t* info, world_t* world)
+int world_load(world_t* world, const char* path)
 {
-	// if (world->state != WORLD_STATE_DONE)
-	// {
-	// 	return false;
-	// }
+	// an in-flight save may still be copying chunks out of world->file
+	world_file_save_wait(&world->save);
+
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		return 1;
+	}
+
+	uint32_t magic;
+	if (fread(&magic, sizeof(magic), 1, f) != 1 || magic != FILEFORMAT_world_MAGIC)
+	{
+		rewind(f);
+		const int r = world_load_legacy(world, f);
+		fclose(f);
+		return r;
+	}
+	fclose(f);
+
+	world_file_t file;
+	if (world_file_open(&file, path) != 0)
+	{
+		fprintf(stderr, "Failed to load world from %s.\n", path);
+		return 1;
+	}
 
+	world_reset_chunks(world);
+	world_free_polygons(world);
+	world_file_close(&world->file);
+	world->file = file;
+
+	return world_build_chunks_from_file(world) ? 0 : 1;
+}
+
+bool world_get_render_info(world_render_info_t* info, world_t* world, uint frameIndex)
+{
 	info->indexBuffer			= world->indexBuffer;
 	info->vertexPositionBuffer	= world->vertexPositionBuffer;
 	info->vertexColorBuffer		= world->vertexColorBuffer;
-	info->indexCount			= world->indexCount;
+	info->foliageBuffer			= world->foliageBuffer;
+	info->chunkBuffer			= world->frames[frameIndex].chunkBuffer;
+	info->draws					= world->visibleDraws;
+	info->drawCount				= 0;
 
-	return true;
+	for (uint i = 0; i < world->drawCount; ++i)
+	{
+		const world_draw_t* draw = &world->draws[i];
+		if ((world->visibleLayerMask & (1u << draw->layer)) == 0)
+		{
+			continue;
+		}
+
+		world->visibleDraws[info->drawCount++] = *draw;
+	}
+
+	return info->drawCount > 0;
 }
 
 void world_get_collision_info(world_collision_info_t* info, world_t* world)
@@ -511,17 +1505,55 @@ void world_get_collision_info(world_collision_info_t* info, world_t* world)
 	// info->polygons		= &world->polygon;
 }
 
-static editor_polygon_t* g_editInfoPolygons[PARALLAX_LAYER_COUNT];
+void world_get_collision_world(collision_world_t* collisionWorld, const world_t* world)
+{
+	collisionWorld->triangles	= world->colliders.shapes;
+	collisionWorld->grid		= &world->colliders.grid;
+}
 
-void world_get_edit_info(world_edit_info_t* info, world_t* world)
+uint world_query_colliders(uint* triangleIndices, uint maxCount, const world_t* world, vec2 aabbMin, vec2 aabbMax)
 {
-	for (int i = 0; i < PARALLAX_LAYER_COUNT; ++i)
+	return collision_grid_query(&world->colliders.grid, triangleIndices, maxCount, aabbMin, aabbMax);
+}
+
+uint64_t world_hash_state(const world_t* world, uint64_t hash)
+{
+	hash = fnv1a64(&world->rng, sizeof(world->rng), hash);
+	hash = fnv1a64(&world->pollenTimer, sizeof(world->pollenTimer), hash);
+
+	for (uint i = 0; i < world->polygonCount; ++i)
 	{
-		g_editInfoPolygons[i] = &world->layers[i].polygon;
+		const editor_polygon_t* polygon = &world->polygons[i];
+		hash = fnv1a64(&polygon->layer, sizeof(polygon->layer), hash);
+		hash = fnv1a64(&polygon->vertexCount, sizeof(polygon->vertexCount), hash);
+		hash = fnv1a64(polygon->vertexPosition, polygon->vertexCount * sizeof(vec2), hash);
 	}
 
-	info->polygonCount	= PARALLAX_LAYER_COUNT;
-	info->polygons		= g_editInfoPolygons;
+	return hash;
+}
+
+void world_get_edit_info(world_edit_info_t* info, world_t* world)
+{
+	// only what's streamed in can be edited, front layers first
+	info->polygonCount	= 0;
+	info->polygons		= world->editPolygons;
+
+	for (uint layer = 0; layer < PARALLAX_LAYER_COUNT; ++layer)
+	{
+		for (uint i = 0; i < world->residentChunkCount; ++i)
+		{
+			const world_chunk_t* chunk = &world->chunks[world->residentChunks[i]];
+			if (chunk->layer != layer)
+			{
+				continue;
+			}
+
+			for (uint j = 0; j < chunk->polygonCount; ++j)
+			{
+				world->editPolygons[info->polygonCount++] = &world->polygons[world->chunkPolygons[chunk->firstPolygon + j]];
+			}
+		}
+	}
 }
 
 static void triangle_collider_debug_draw(triangle_collider_t* t)
@@ -537,7 +1569,41 @@ static void triangle_collider_debug_draw(triangle_collider_t* t)
 
 float world_get_parallax_layer_depth(uint layerIndex)
 {
-	return layerIndex * -4.0f;
+	return layerIndex * WORLD_LAYER_DEPTH_STEP;
+}
+
+gpu_world_chunk_t world_chunk_quantization(vec2 boundsMin, vec2 boundsMax, uint layer)
+{
+	return (gpu_world_chunk_t){
+		.origin	= boundsMin,
+		.scale	= vec2_scale(vec2_sub(boundsMax, boundsMin), 1.0f / 65535.0f),
+		.layer	= layer,
+	};
+}
+
+static uint32_t quantize_unorm16(float v, float origin, float scale)
+{
+	if (scale <= 0.0f)
+	{
+		return 0;
+	}
+	return (uint32_t)lrintf(clampf(0.0f, (v - origin) / scale, 65535.0f));
+}
+
+uint32_t world_quantize_position(const gpu_world_chunk_t* chunk, vec2 p)
+{
+	const uint32_t x = quantize_unorm16(p.x, chunk->origin.x, chunk->scale.x);
+	const uint32_t y = quantize_unorm16(p.y, chunk->origin.y, chunk->scale.y);
+	return x | (y << 16);
+}
+
+vec2 world_dequantize_position(const gpu_world_chunk_t* chunk, uint32_t q)
+{
+	// same expression as world.hlsl
+	return (vec2){
+		chunk->origin.x + (float)(q & 0xffffu) * chunk->scale.x,
+		chunk->origin.y + (float)(q >> 16) * chunk->scale.y,
+	};
 }
 
 void editor_polygon_debug_draw(editor_polygon_t* p)
@@ -565,146 +1631,99 @@ void editor_polygon_debug_draw(editor_polygon_t* p)
 		const vec2 p1 = p->vertexPosition[j];
 		const vec2 p2 = p->vertexPosition[k];
 		
-		const vec2 d0 = vec2_normalize(vec2_sub(p1, p0));
-		const vec2 d1 = vec2_normalize(vec2_sub(p2, p1));
-
-		const float a0 = atan2f(d0.y, d0.x);
-		const float a1 = atan2f(d1.y, d1.x);
-
-		float da = a1 - a0;
-		da = atan2f(sin(da), cos(da));
+		const vec2 d0 = vec2_sub(p1, p0);
+		const vec2 d1 = vec2_sub(p2, p1);
 
-		const bool isConvex = da < 0.0f;
+		// polygons are wound clockwise, so convex corners turn right
+		const bool isConvex = d0.x * d1.y - d0.y * d1.x < 0.0f;
 		
 		DrawDebugPoint((debug_vertex_t){ .x = p1.x, .y = p1.y, .z = depth, .color = isConvex ? 0xff00ff00 : 0xff0000ff });
 	}
 }
 
-// https://www.geometrictools.com/Documentation/TriangulationByEarClipping.pdf
-void editor_polygon_triangulate(triangle_t* triangles, size_t* triangleCount, const editor_polygon_t* p)
+bool editor_polygon_reserve(editor_polygon_t* polygon, uint count)
 {
-	*triangleCount = 0;
-
-	uint workingSet[POLYGON_MAX_VERTICES];
-	uint workingSetSize = p->vertexCount;
-
-	for (size_t i = 0; i < p->vertexCount; ++i)
+	if (count <= polygon->vertexCapacity)
 	{
-		workingSet[i] = i;
+		return true;
 	}
 
-	while (workingSetSize > 3)
+	uint capacity = polygon->vertexCapacity > 0 ? polygon->vertexCapacity : 16;
+	while (capacity < count)
 	{
-		//printf("outer: %u\n", workingSetSize);
-
-		for (size_t i = 0; i < workingSetSize && workingSetSize > 3; ++i)
-		{
-			//printf("inner: %u\n", i);
-
-			const size_t j = (i + 1) % workingSetSize;
-			const size_t k = (i + 2) % workingSetSize;
-			
-			const uint i0 = workingSet[i];
-			const uint i1 = workingSet[j];
-			const uint i2 = workingSet[k];
-			
-			const vec2 p0 = p->vertexPosition[i0];
-			const vec2 p1 = p->vertexPosition[i1];
-			const vec2 p2 = p->vertexPosition[i2];
-
-			const vec2 d0 = vec2_normalize(vec2_sub(p1, p0));
-			const vec2 d1 = vec2_normalize(vec2_sub(p2, p1));
-
-			const float a0 = atan2f(d0.y, d0.x);
-			const float a1 = atan2f(d1.y, d1.x);
-
-			float da = a1 - a0;
-			da = atan2f(sin(da), cos(da));
-
-			const bool isConvex = da < 0.0f;
+		capacity *= 2;
+	}
 
-			if (!isConvex)
-			{
-				//printf("not convex\n");
-				continue;
-			}
+	vec2* vertexPosition = realloc(polygon->vertexPosition, capacity * sizeof(vec2));
+	if (vertexPosition == NULL)
+	{
+		return false;
+	}
 
-			// verify clockwise winding
-			const float det = 
-				p0.x * (p1.y - p2.y) + 
-				p1.x * (p2.y - p0.y) + 
-				p2.x * (p0.y - p1.y);
-			assert(det <= 0.0f);
-
-			const vec2 edges[][2] = {
-				{p0, p1},
-				{p1, p2},
-				{p2, p0},
-			};
-			
-			vec3 planes[3];
-			for (size_t edgeIndex = 0; edgeIndex < countof(edges); ++edgeIndex)
-			{
-				const vec2 a = edges[edgeIndex][0];
-				const vec2 b = edges[edgeIndex][1];
-				const vec2 d = vec2_normalize(vec2_sub(b, a));
-				const vec2 normal = {-d.y, d.x};
-				
-#if 0
-				const vec2 center = vec2_scale(vec2_add(a, b), 0.5f);
-				DrawDebugLine(
-					(debug_vertex_t){.x = center.x, .y = center.y, .color = 0xffff00ff},
-					(debug_vertex_t){.x = center.x + normal.x * 0.3f, .y = center.y + normal.y * 0.3f, .color = 0xffff00ff}
-				);
-#endif
+	polygon->vertexPosition	= vertexPosition;
+	polygon->vertexCapacity	= capacity;
+	return true;
+}
 
-				planes[edgeIndex] = (vec3){ normal.x, normal.y, vec2_dot(normal, a) };
-			}
-			
-			bool shouldClip = true;
+const triangle_t* editor_polygon_get_triangles(editor_polygon_t* polygon, size_t* triangleCount)
+{
+	uint64_t hash = FNV1A64_OFFSET_BASIS;
+	hash = fnv1a64(&polygon->vertexCount, sizeof(polygon->vertexCount), hash);
+	hash = fnv1a64(polygon->vertexPosition, polygon->vertexCount * sizeof(vec2), hash);
 
-			//printf("workingSetSize: %u\n", workingSetSize);
-			uint insideTestCount = workingSetSize - 3;
-			for (uint testIndex = 0; testIndex < insideTestCount; ++testIndex)
-			{
-				const uint vertexIndex = workingSet[(testIndex + k + 1) % workingSetSize];
-				const vec2 pos = p->vertexPosition[vertexIndex];
-				
-				if (vec2_dot(vec3_xy(planes[0]), pos) - planes[0].z < 0.0f &&
-					vec2_dot(vec3_xy(planes[1]), pos) - planes[1].z < 0.0f &&
-					vec2_dot(vec3_xy(planes[2]), pos) - planes[2].z < 0.0f)
-				{
-					shouldClip = false;
-					break;
-				}
-			}
-			
-			if (shouldClip)
-			{
-				triangle_t* triangle = &triangles[(*triangleCount)++];
-				triangle->i[0] = i0;
-				triangle->i[1] = i1;
-				triangle->i[2] = i2;
+	if (polygon->triangles != NULL && polygon->triangleHash == hash)
+	{
+		*triangleCount = polygon->triangleCount;
+		return polygon->triangles;
+	}
 
-				--workingSetSize;
+	PROFILER_BEGIN(editor_polygon_triangulate);
 
-				for (uint del = j; del < workingSetSize; ++del)
-				{
-					workingSet[del] = workingSet[del + 1];
-				}
-			}
+	if (polygon->vertexCount > polygon->triangleCapacity)
+	{
+		triangle_t* triangles = realloc(polygon->triangles, polygon->vertexCount * sizeof(triangle_t));
+		if (triangles == NULL)
+		{
+			// the cached triangles are left for the vertices they were hashed from, and this is tried again next time
+			PROFILER_END();
+			*triangleCount = 0;
+			return NULL;
 		}
+		polygon->triangles			= triangles;
+		polygon->triangleCapacity	= polygon->vertexCount;
 	}
 
-	assert(workingSetSize == 3);
+	polygon_triangulate(polygon->triangles, &polygon->triangleCount, polygon->vertexPosition, polygon->vertexCount);
+	polygon->triangleHash = hash;
+
+	PROFILER_END();
 
-	triangle_t* triangle = &triangles[(*triangleCount)++];
-	triangle->i[0] = workingSet[0];
-	triangle->i[1] = workingSet[1];
-	triangle->i[2] = workingSet[2];
+	*triangleCount = polygon->triangleCount;
+	return polygon->triangles;
 }
 
 void world_set_visible_layers(world_t* world, uint32_t mask)
 {
 	world->visibleLayerMask = mask;
-}
\ No newline at end of file
+}
+
+void world_set_focus(world_t* world, vec2 focus)
+{
+	world->focus = focus;
+}
+
+void world_mark_polygon_dirty(world_t* world, const editor_polygon_t* polygon)
+{
+	assert(polygon->chunk < world->chunkCount);
+	world_chunk_t* chunk = &world->chunks[polygon->chunk];
+
+	world_update_chunk_bounds(world, polygon->chunk);
+	chunk->dirty		= chunk->resident;
+	chunk->modified		= true;
+	chunk->uploadFailed	= false;
+
+	if (polygon->layer == 0)
+	{
+		world->collidersDirty = true;
+	}
+}
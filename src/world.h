@@ -1,46 +1,88 @@
 #pragma once
 
+#include "common.h"
 #include "vulkan.h"
 #include "render_context.h"
 #include "staging_memory.h"
 #include "types.h"
 #include "particles.h"
+#include "triangulate.h"
+#include "job_pool.h"
+#include "collision.h"
 
 #include <stdio.h>
 #include <stdbool.h>
 
-#define POLYGON_MAX_VERTICES 64
-
 typedef struct world world_t;
 
-world_t* world_create(vulkan_t* vulkan, particles_t* particles);
+// vulkan may be NULL for a headless world, which streams chunks and builds colliders but draws nothing. It's
+// updated with world_update_headless instead of world_update.
+world_t* world_create(vulkan_t* vulkan, particles_t* particles, job_pool_t* jobPool);
 void world_destroy(world_t* world);
 
 void world_alloc_staging_mem(staging_memory_allocator_t* allocator, world_t* world);
 
 void world_tick(world_t* world);
 void world_update(world_t* world, VkCommandBuffer cb, const render_context_t* rc);
+void world_update_headless(world_t* world);
+
+// world_load maps a world file and reads chunks from it as they stream in. Files in the older
+// one-polygon-per-layer format are read in full. A file with a bad header or chunk table leaves the world
+// unchanged, and a chunk whose data fails its checksum is left out of the world when it streams in.
+int world_load(world_t* world, const char* path);
+// Snapshots the world and writes it to path on a background thread. The new file is written next to path
+// and renamed over it once it's complete, so path is never left half written. Returns nonzero without
+// starting anything if a save is already in flight.
+int world_save_async(world_t* world, const char* path);
+// Returns true once for every finished save, with result set to 0 if it succeeded.
+bool world_poll_save(world_t* world, int* result);
+// world_save_async, then waits for it
+int world_save(world_t* world, const char* path);
+
+typedef struct world_draw
+{
+	uint32_t	indexCount;
+	uint32_t	firstIndex;
+	int32_t		vertexOffset;
+	uint32_t	layer;
+	uint32_t	chunk; // index into chunkBuffer, passed as firstInstance
 
-int world_serialize(world_t* world, FILE* f);
-int world_deserialize(world_t* world, FILE* f);
+	// the chunk's range of foliageBuffer, drawn as FOLIAGE_VERTICES_PER_INSTANCE vertices per instance
+	uint32_t	instanceCount;
+	uint32_t	firstInstance;
+} world_draw_t;
 
 typedef struct world_render_info
 {
-	uint32_t	indexCount;
-	VkBuffer	indexBuffer;
-	VkBuffer	vertexPositionBuffer;
-	VkBuffer	vertexColorBuffer;
+	uint32_t		drawCount;
+	world_draw_t*	draws;
+	VkBuffer		indexBuffer;
+	VkBuffer		vertexPositionBuffer;
+	VkBuffer		vertexColorBuffer;
+	VkBuffer		foliageBuffer;
+	VkBuffer		chunkBuffer; // gpu_world_chunk_t per draw
 } world_render_info_t;
 
-bool world_get_render_info(world_render_info_t* info, world_t* world);
+bool world_get_render_info(world_render_info_t* info, world_t* world, uint frameIndex);
 
 typedef struct editor_polygon
 {
-	uint	vertexCount;
-	vec2	vertexPosition[POLYGON_MAX_VERTICES];
-	uint	layer;
+	uint		vertexCount;
+	uint		vertexCapacity;
+	vec2*		vertexPosition;
+	uint		layer;
+	uint		chunk;
+
+	// cached triangulation of vertexPosition, see editor_polygon_get_triangles
+	uint64_t	triangleHash;
+	size_t		triangleCount;
+	uint		triangleCapacity;
+	triangle_t*	triangles;
 } editor_polygon_t;
 
+// grows vertexPosition to hold at least count vertices
+bool editor_polygon_reserve(editor_polygon_t* polygon, uint count);
+
 typedef struct triangle_collider
 {
 	vec2 a;
@@ -60,6 +102,14 @@ typedef struct world_collision_info
 
 void world_get_collision_info(world_collision_info_t* info, world_t* world);
 
+// The resident colliders for collision_move_bodies. They're rebuilt by world_update(_headless) when chunks stream in or
+// out, which leaves the previous pointers dangling.
+void world_get_collision_world(collision_world_t* collisionWorld, const world_t* world);
+
+// Writes up to maxCount indices into world_collision_info_t.triangles for the colliders whose bounds overlap
+// [aabbMin, aabbMax]. Returns the total number of overlapping colliders, which may exceed maxCount.
+uint world_query_colliders(uint* triangleIndices, uint maxCount, const world_t* world, vec2 aabbMin, vec2 aabbMax);
+
 typedef struct world_edit_info
 {
 	uint				polygonCount;
@@ -68,15 +118,28 @@ typedef struct world_edit_info
 
 void world_get_edit_info(world_edit_info_t* info, world_t* world);
 
+// Continues an fnv1a64 hash with the polygons in memory and the ambient spawns, for checking that two runs edited
+// and simulated the same thing.
+uint64_t world_hash_state(const world_t* world, uint64_t hash);
+
 float world_get_parallax_layer_depth(uint layerIndex);
+
+// Fits the quantization grid of a chunk to its bounds.
+gpu_world_chunk_t world_chunk_quantization(vec2 boundsMin, vec2 boundsMax, uint layer);
+uint32_t world_quantize_position(const gpu_world_chunk_t* chunk, vec2 p);
+vec2 world_dequantize_position(const gpu_world_chunk_t* chunk, uint32_t q);
 void editor_polygon_debug_draw(editor_polygon_t* p);
 
+// Returns the polygon's triangulation. It's cached against a hash of the vertex array, so the polygon is only
+// re-triangulated after its vertices change. The returned pointer is valid until the next edit. Returns NULL and
+// no triangles if there wasn't the memory to triangulate it.
+const triangle_t* editor_polygon_get_triangles(editor_polygon_t* polygon, size_t* triangleCount);
 
-typedef struct triangle
-{
-	uint32_t i[3];
-} triangle_t;
+void world_set_visible_layers(world_t* world, uint32_t mask);
 
-void editor_polygon_triangulate(triangle_t* triangles, size_t* triangleCount, const editor_polygon_t* polygon);
+// Chunks within a per-layer radius of the focus are streamed in on the next world_update, and chunks that
+// drift further out are evicted.
+void world_set_focus(world_t* world, vec2 focus);
 
-void world_set_visible_layers(world_t* world, uint32_t mask);
\ No newline at end of file
+// re-tessellates and re-uploads the polygon's chunk on the next world_update
+void world_mark_polygon_dirty(world_t* world, const editor_polygon_t* polygon);
\ No newline at end of file
@@ -0,0 +1,490 @@
+#include "world_file.h"
+#include "common.h"
+#include "util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static uint64_t world_file_header_checksum(const FILEFORMAT_world_header_t* header)
+{
+	return fnv1a64(header, offsetof(FILEFORMAT_world_header_t, headerChecksum), FNV1A64_OFFSET_BASIS);
+}
+
+int world_file_parse(world_file_t* file, const uint8_t* mem, size_t len)
+{
+	file->fd		= -1;
+	file->mem		= mem;
+	file->len		= len;
+	file->header	= NULL;
+	file->chunks	= NULL;
+
+	if (len < sizeof(FILEFORMAT_world_header_t))
+	{
+		return 1;
+	}
+
+	// read without assuming alignment, so any buffer can be probed for the format
+	uint32_t magic;
+	memcpy(&magic, mem, sizeof(magic));
+	if (magic != FILEFORMAT_world_MAGIC)
+	{
+		return 1;
+	}
+	if ((uintptr_t)mem % _Alignof(FILEFORMAT_world_header_t) != 0)
+	{
+		fprintf(stderr, "World file image is misaligned.\n");
+		return 1;
+	}
+
+	const FILEFORMAT_world_header_t* header = (const FILEFORMAT_world_header_t*)mem;
+	if (header->version != FILEFORMAT_world_VERSION)
+	{
+		fprintf(stderr, "Unsupported world file version %u.\n", header->version);
+		return 1;
+	}
+	if (header->headerChecksum != world_file_header_checksum(header) || header->fileSize != len)
+	{
+		fprintf(stderr, "World file header is corrupt or the file is truncated.\n");
+		return 1;
+	}
+
+	const uint64_t tableEnd = sizeof(FILEFORMAT_world_header_t) + (uint64_t)header->chunkCount * sizeof(FILEFORMAT_world_chunk_t);
+	if (tableEnd > len)
+	{
+		fprintf(stderr, "World file chunk table is out of bounds.\n");
+		return 1;
+	}
+
+	const FILEFORMAT_world_chunk_t* chunks = (const FILEFORMAT_world_chunk_t*)(mem + sizeof(FILEFORMAT_world_header_t));
+	if (header->chunkTableChecksum != fnv1a64(chunks, header->chunkCount * sizeof(FILEFORMAT_world_chunk_t), FNV1A64_OFFSET_BASIS))
+	{
+		fprintf(stderr, "World file chunk table is corrupt.\n");
+		return 1;
+	}
+
+	uint64_t polygonCount = 0;
+	for (uint i = 0; i < header->chunkCount; ++i)
+	{
+		const FILEFORMAT_world_chunk_t* chunk = &chunks[i];
+
+		const bool valid =
+			chunk->layer < PARALLAX_LAYER_COUNT &&
+			chunk->dataOffset >= tableEnd && chunk->dataOffset % sizeof(uint32_t) == 0 &&
+			chunk->dataOffset <= len && chunk->dataSize <= len - chunk->dataOffset &&
+			chunk->dataSize >= (uint64_t)chunk->polygonCount * sizeof(FILEFORMAT_world_polygon_t) &&
+			isfinite(chunk->boundsMin.x) && isfinite(chunk->boundsMin.y) &&
+			isfinite(chunk->boundsMax.x) && isfinite(chunk->boundsMax.y);
+
+		if (!valid)
+		{
+			fprintf(stderr, "World file chunk %u is out of bounds.\n", i);
+			return 1;
+		}
+
+		polygonCount += chunk->polygonCount;
+	}
+
+	if (polygonCount != header->polygonCount)
+	{
+		fprintf(stderr, "World file polygon count doesn't match its chunks.\n");
+		return 1;
+	}
+
+	file->header	= header;
+	file->chunks	= chunks;
+	return 0;
+}
+
+int world_file_open(world_file_t* file, const char* path)
+{
+	file->fd	= -1;
+	file->mem	= NULL;
+	file->len	= 0;
+	file->header	= NULL;
+	file->chunks	= NULL;
+
+	const int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 1;
+	}
+
+	const off_t len = lseek(fd, 0, SEEK_END);
+	lseek(fd, 0, SEEK_SET);
+	if (len <= 0)
+	{
+		close(fd);
+		return 1;
+	}
+
+	void* mem = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mem == MAP_FAILED)
+	{
+		fprintf(stderr, "Failed to map world file.\n");
+		close(fd);
+		return 1;
+	}
+
+	if (world_file_parse(file, mem, len) != 0)
+	{
+		munmap(mem, len);
+		close(fd);
+		file->mem = NULL;
+		file->len = 0;
+		return 1;
+	}
+
+	file->fd = fd;
+	return 0;
+}
+
+void world_file_close(world_file_t* file)
+{
+	if (file->fd != -1)
+	{
+		munmap((void*)file->mem, file->len);
+		close(file->fd);
+	}
+
+	file->fd		= -1;
+	file->mem		= NULL;
+	file->len		= 0;
+	file->header	= NULL;
+	file->chunks	= NULL;
+}
+
+int world_file_read_chunk(world_file_polygon_t* polygons, const world_file_t* file, uint chunkIndex)
+{
+	assert(chunkIndex < file->header->chunkCount);
+	const FILEFORMAT_world_chunk_t* chunk = &file->chunks[chunkIndex];
+
+	const uint8_t* data = file->mem + chunk->dataOffset;
+	if (chunk->checksum != fnv1a64(data, chunk->dataSize, FNV1A64_OFFSET_BASIS))
+	{
+		fprintf(stderr, "World file chunk %u is corrupt.\n", chunkIndex);
+		return 1;
+	}
+
+	uint64_t offset = 0;
+	for (uint i = 0; i < chunk->polygonCount; ++i)
+	{
+		if (chunk->dataSize - offset < sizeof(FILEFORMAT_world_polygon_t))
+		{
+			break;
+		}
+
+		const FILEFORMAT_world_polygon_t* polygon = (const FILEFORMAT_world_polygon_t*)(data + offset);
+		offset += sizeof(FILEFORMAT_world_polygon_t);
+
+		if (polygon->vertexCount < 3 || (uint64_t)polygon->vertexCount * sizeof(vec2) > chunk->dataSize - offset)
+		{
+			break;
+		}
+
+		polygons[i] = (world_file_polygon_t){
+			.vertexCount	= polygon->vertexCount,
+			.positions		= (const vec2*)(data + offset),
+		};
+		offset += polygon->vertexCount * sizeof(vec2);
+	}
+
+	// a short read above leaves offset behind, so this catches both truncated and trailing data
+	if (offset != chunk->dataSize)
+	{
+		fprintf(stderr, "World file chunk %u has malformed polygons.\n", chunkIndex);
+		return 1;
+	}
+
+	return 0;
+}
+
+static void world_file_write(world_file_writer_t* writer, const void* data, size_t size)
+{
+	if (size > 0 && fwrite(data, 1, size, writer->f) != size)
+	{
+		writer->failed = true;
+	}
+	writer->offset += size;
+}
+
+int world_file_writer_begin(world_file_writer_t* writer, FILE* f, uint chunkCount)
+{
+	*writer = (world_file_writer_t){
+		.f			= f,
+		.chunkCount	= chunkCount,
+		.header		= {
+			.magic		= FILEFORMAT_world_MAGIC,
+			.version	= FILEFORMAT_world_VERSION,
+			.chunkCount	= chunkCount,
+		},
+	};
+
+	writer->chunks = calloc(chunkCount, sizeof(FILEFORMAT_world_chunk_t));
+	if (writer->chunks == NULL && chunkCount > 0)
+	{
+		return 1;
+	}
+
+	// placeholders, filled in by world_file_writer_end. Write errors are reported there too.
+	world_file_write(writer, &writer->header, sizeof(FILEFORMAT_world_header_t));
+	world_file_write(writer, writer->chunks, chunkCount * sizeof(FILEFORMAT_world_chunk_t));
+	return 0;
+}
+
+void world_file_writer_begin_chunk(world_file_writer_t* writer, uint layer, int2 cell, vec2 boundsMin, vec2 boundsMax)
+{
+	assert(writer->chunkIndex < writer->chunkCount);
+	writer->chunks[writer->chunkIndex++] = (FILEFORMAT_world_chunk_t){
+		.layer		= layer,
+		.cellX		= cell.x,
+		.cellY		= cell.y,
+		.boundsMin	= boundsMin,
+		.boundsMax	= boundsMax,
+		.dataOffset	= writer->offset,
+		.checksum	= FNV1A64_OFFSET_BASIS,
+	};
+}
+
+void world_file_writer_add_polygon(world_file_writer_t* writer, const vec2* positions, uint vertexCount)
+{
+	assert(writer->chunkIndex > 0);
+	FILEFORMAT_world_chunk_t* chunk = &writer->chunks[writer->chunkIndex - 1];
+
+	const FILEFORMAT_world_polygon_t polygon = { .vertexCount = vertexCount };
+	world_file_write(writer, &polygon, sizeof(polygon));
+	world_file_write(writer, positions, vertexCount * sizeof(vec2));
+
+	chunk->checksum = fnv1a64(&polygon, sizeof(polygon), chunk->checksum);
+	chunk->checksum = fnv1a64(positions, vertexCount * sizeof(vec2), chunk->checksum);
+	chunk->dataSize += sizeof(polygon) + vertexCount * sizeof(vec2);
+	++chunk->polygonCount;
+	++writer->header.polygonCount;
+}
+
+void world_file_writer_copy_chunk(world_file_writer_t* writer, const world_file_t* file, uint chunkIndex)
+{
+	assert(writer->chunkIndex < writer->chunkCount);
+	assert(chunkIndex < file->header->chunkCount);
+	const FILEFORMAT_world_chunk_t* source = &file->chunks[chunkIndex];
+
+	FILEFORMAT_world_chunk_t* chunk = &writer->chunks[writer->chunkIndex++];
+	*chunk = *source;
+	chunk->dataOffset = writer->offset;
+
+	world_file_write(writer, file->mem + source->dataOffset, source->dataSize);
+	writer->header.polygonCount += source->polygonCount;
+}
+
+int world_file_writer_end(world_file_writer_t* writer)
+{
+	assert(writer->chunkIndex == writer->chunkCount);
+
+	FILEFORMAT_world_header_t* header = &writer->header;
+	header->fileSize			= writer->offset;
+	header->chunkTableChecksum	= fnv1a64(writer->chunks, writer->chunkCount * sizeof(FILEFORMAT_world_chunk_t), FNV1A64_OFFSET_BASIS);
+	header->headerChecksum		= world_file_header_checksum(header);
+
+	if (fseek(writer->f, 0, SEEK_SET) != 0)
+	{
+		writer->failed = true;
+	}
+	else
+	{
+		world_file_write(writer, header, sizeof(FILEFORMAT_world_header_t));
+		world_file_write(writer, writer->chunks, writer->chunkCount * sizeof(FILEFORMAT_world_chunk_t));
+	}
+
+	if (fflush(writer->f) != 0)
+	{
+		writer->failed = true;
+	}
+
+	free(writer->chunks);
+	writer->chunks = NULL;
+
+	return writer->failed ? 1 : 0;
+}
+
+bool world_file_snapshot_alloc(world_file_snapshot_t* snapshot, uint chunkCount, uint polygonCount, size_t vertexCount)
+{
+	*snapshot = (world_file_snapshot_t){
+		.chunkCount		= chunkCount,
+		.polygonCount	= polygonCount,
+	};
+
+	snapshot->chunks				= calloc(chunkCount, sizeof(world_file_snapshot_chunk_t));
+	snapshot->polygonVertexCounts	= malloc(polygonCount * sizeof(uint));
+	snapshot->positions				= malloc(vertexCount * sizeof(vec2));
+
+	if ((snapshot->chunks == NULL && chunkCount > 0) ||
+		(snapshot->polygonVertexCounts == NULL && polygonCount > 0) ||
+		(snapshot->positions == NULL && vertexCount > 0))
+	{
+		world_file_snapshot_free(snapshot);
+		return false;
+	}
+
+	return true;
+}
+
+void world_file_snapshot_free(world_file_snapshot_t* snapshot)
+{
+	free(snapshot->chunks);
+	free(snapshot->polygonVertexCounts);
+	free(snapshot->positions);
+	*snapshot = (world_file_snapshot_t){0};
+}
+
+int world_file_write_snapshot(FILE* f, const world_file_snapshot_t* snapshot)
+{
+	world_file_writer_t writer;
+	if (world_file_writer_begin(&writer, f, snapshot->chunkCount) != 0)
+	{
+		return 1;
+	}
+
+	// polygons are stored in chunk order, so one running offset covers every chunk's vertices
+	const vec2* positions = snapshot->positions;
+
+	for (uint i = 0; i < snapshot->chunkCount; ++i)
+	{
+		const world_file_snapshot_chunk_t* chunk = &snapshot->chunks[i];
+
+		if (chunk->fromSource)
+		{
+			world_file_writer_copy_chunk(&writer, snapshot->source, chunk->sourceChunk);
+			continue;
+		}
+
+		world_file_writer_begin_chunk(&writer, chunk->layer, chunk->cell, chunk->boundsMin, chunk->boundsMax);
+		for (uint j = 0; j < chunk->polygonCount; ++j)
+		{
+			const uint vertexCount = snapshot->polygonVertexCounts[chunk->firstPolygon + j];
+			world_file_writer_add_polygon(&writer, positions, vertexCount);
+			positions += vertexCount;
+		}
+	}
+
+	return world_file_writer_end(&writer);
+}
+
+// Makes the rename itself durable, not just the file contents.
+static void world_file_sync_directory(const char* path)
+{
+	char directory[WORLD_FILE_MAX_PATH];
+	const char* slash = strrchr(path, '/');
+	if (slash == NULL)
+	{
+		strcpy(directory, ".");
+	}
+	else
+	{
+		const size_t len = slash == path ? 1 : (size_t)(slash - path);
+		memcpy(directory, path, len);
+		directory[len] = '\0';
+	}
+
+	const int fd = open(directory, O_RDONLY);
+	if (fd != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+}
+
+static int world_file_save_snapshot(const char* path, const world_file_snapshot_t* snapshot)
+{
+	char tempPath[WORLD_FILE_MAX_PATH + 4];
+	snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+	FILE* f = fopen(tempPath, "wb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Failed to open %s for writing.\n", tempPath);
+		return 1;
+	}
+
+	int r = world_file_write_snapshot(f, snapshot);
+	if (r == 0 && fsync(fileno(f)) != 0)
+	{
+		r = 1;
+	}
+	if (fclose(f) != 0)
+	{
+		r = 1;
+	}
+
+	if (r != 0 || rename(tempPath, path) != 0)
+	{
+		fprintf(stderr, "Failed to save world to %s.\n", path);
+		remove(tempPath);
+		return 1;
+	}
+
+	world_file_sync_directory(path);
+	return 0;
+}
+
+static void* world_file_save_thread(void* arg)
+{
+	world_file_save_t* save = arg;
+	save->result = world_file_save_snapshot(save->path, &save->snapshot);
+	atomic_store_explicit(&save->finished, true, memory_order_release);
+	return NULL;
+}
+
+int world_file_save_start(world_file_save_t* save, world_file_snapshot_t* snapshot, const char* path)
+{
+	assert(!save->running);
+
+	if (strlen(path) >= sizeof(save->path))
+	{
+		world_file_snapshot_free(snapshot);
+		return 1;
+	}
+
+	strcpy(save->path, path);
+	save->snapshot	= *snapshot;
+	save->result	= 0;
+	atomic_store_explicit(&save->finished, false, memory_order_relaxed);
+	*snapshot = (world_file_snapshot_t){0};
+
+	if (pthread_create(&save->thread, NULL, world_file_save_thread, save) != 0)
+	{
+		world_file_snapshot_free(&save->snapshot);
+		return 1;
+	}
+
+	save->running = true;
+	return 0;
+}
+
+bool world_file_save_poll(world_file_save_t* save, int* result)
+{
+	if (!save->running || !atomic_load_explicit(&save->finished, memory_order_acquire))
+	{
+		return false;
+	}
+
+	*result = world_file_save_wait(save);
+	return true;
+}
+
+int world_file_save_wait(world_file_save_t* save)
+{
+	if (!save->running)
+	{
+		return 0;
+	}
+
+	pthread_join(save->thread, NULL);
+	world_file_snapshot_free(&save->snapshot);
+	save->running = false;
+	return save->result;
+}
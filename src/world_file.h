@@ -0,0 +1,107 @@
+#pragma once
+
+#include "types.h"
+#include "file_format.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// A world.bin image, either mapped from disk or parsed from memory. Only the header and the chunk table are
+// checked up front, chunk data is checked when world_file_read_chunk first touches it.
+typedef struct world_file
+{
+	int									fd;
+	const uint8_t*						mem;
+	size_t								len;
+
+	const FILEFORMAT_world_header_t*	header;
+	const FILEFORMAT_world_chunk_t*		chunks;
+} world_file_t;
+
+typedef struct world_file_polygon
+{
+	uint		vertexCount;
+	const vec2*	positions; // points into the file image
+} world_file_polygon_t;
+
+// Returns 1 without printing anything if the file doesn't start with FILEFORMAT_world_MAGIC, so the caller
+// can fall back to another format.
+int world_file_parse(world_file_t* file, const uint8_t* mem, size_t len);
+int world_file_open(world_file_t* file, const char* path);
+void world_file_close(world_file_t* file);
+
+// Verifies the chunk's checksum and fills polygons[0..chunks[chunkIndex].polygonCount).
+int world_file_read_chunk(world_file_polygon_t* polygons, const world_file_t* file, uint chunkIndex);
+
+typedef struct world_file_writer
+{
+	FILE*						f;
+	uint						chunkCount;
+	uint						chunkIndex;
+	FILEFORMAT_world_header_t	header;
+	FILEFORMAT_world_chunk_t*	chunks;
+	uint64_t					offset;
+	bool						failed;
+} world_file_writer_t;
+
+// Chunks are written in order with begin_chunk + add_polygon, or copied verbatim from an open file.
+// world_file_writer_end fills in the header and chunk table, so f has to be seekable.
+int world_file_writer_begin(world_file_writer_t* writer, FILE* f, uint chunkCount);
+void world_file_writer_begin_chunk(world_file_writer_t* writer, uint layer, int2 cell, vec2 boundsMin, vec2 boundsMax);
+void world_file_writer_add_polygon(world_file_writer_t* writer, const vec2* positions, uint vertexCount);
+void world_file_writer_copy_chunk(world_file_writer_t* writer, const world_file_t* file, uint chunkIndex);
+int world_file_writer_end(world_file_writer_t* writer);
+
+typedef struct world_file_snapshot_chunk
+{
+	uint	layer;
+	int2	cell;
+	vec2	boundsMin;
+	vec2	boundsMax;
+
+	// either copied verbatim from chunk sourceChunk of the snapshot's source, or a run of its polygons
+	bool	fromSource;
+	uint	sourceChunk;
+	uint	firstPolygon;
+	uint	polygonCount;
+} world_file_snapshot_chunk_t;
+
+// Everything a save needs, so it can be written while the world carries on changing.
+typedef struct world_file_snapshot
+{
+	const world_file_t*				source; // has to stay open until the snapshot is written
+	uint							chunkCount;
+	world_file_snapshot_chunk_t*	chunks;
+	uint							polygonCount;
+	uint*							polygonVertexCounts;
+	vec2*							positions; // every polygon's vertices, back to back
+} world_file_snapshot_t;
+
+bool world_file_snapshot_alloc(world_file_snapshot_t* snapshot, uint chunkCount, uint polygonCount, size_t vertexCount);
+void world_file_snapshot_free(world_file_snapshot_t* snapshot);
+
+int world_file_write_snapshot(FILE* f, const world_file_snapshot_t* snapshot);
+
+#define WORLD_FILE_MAX_PATH 256
+
+typedef struct world_file_save
+{
+	pthread_t				thread;
+	bool					running;
+	atomic_bool				finished;
+	int						result;
+	char					path[WORLD_FILE_MAX_PATH];
+	world_file_snapshot_t	snapshot;
+} world_file_save_t;
+
+// Takes ownership of the snapshot and writes it to path on a thread of its own. It goes to a temporary file
+// that is synced and then renamed over path, so path holds either the old or the new world at all times.
+int world_file_save_start(world_file_save_t* save, world_file_snapshot_t* snapshot, const char* path);
+// Returns true once, when the save has finished. result is 0 if it succeeded.
+bool world_file_save_poll(world_file_save_t* save, int* result);
+// Blocks until the save is done, and returns its result. Returns 0 right away if no save is running.
+int world_file_save_wait(world_file_save_t* save);